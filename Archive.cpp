@@ -0,0 +1,161 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+#include "Archive.h"
+#include"Exception.h"
+#include<cstring>
+
+namespace model
+{
+	namespace
+	{
+		void corrupt()
+		{
+			throw utility::Exception("Warning: the snapshot is corrupt");
+		}
+	}
+
+	Archive::Archive()
+		:m_loading{ false }, m_buffer{}, m_data{ nullptr }, m_size{ 0 }, m_position{ 0 }
+	{
+	}
+
+	Archive::Archive(const char* data, size_t size)
+		:m_loading{ true }, m_buffer{}, m_data{ data }, m_size{ size }, m_position{ 0 }
+	{
+	}
+
+	void Archive::bytes(void* p, size_t n)
+	{
+		if (!m_loading)
+		{
+			m_buffer.append(static_cast<const char*>(p), n);
+			return;
+		}
+
+		if (n > remaining()) corrupt();
+		std::memcpy(p, m_data + m_position, n);
+		m_position += n;
+	}
+
+	size_t Archive::count(size_t n, size_t elementSize)
+	{
+		field(n);
+		if (m_loading && n > remaining() / elementSize) corrupt();
+		return n;
+	}
+
+	void Archive::field(std::string& s)
+	{
+		size_t n{ count(s.size(), 1) };
+		if (m_loading) s.resize(n);
+		if (n) bytes(&s[0], n);
+	}
+
+	void Archive::field(std::vector<std::string>& v)
+	{
+		// each string takes at least its length
+		size_t n{ count(v.size(), sizeof(std::uint64_t)) };
+		if (m_loading) v.resize(n);
+		for (auto& s : v)
+			field(s);
+	}
+
+	void Archive::field(std::vector<double>& v)
+	{
+		size_t n{ count(v.size(), sizeof(double)) };
+		if (m_loading) v.resize(n);
+		if (n) bytes(v.data(), n * sizeof(double));
+	}
+
+	std::shared_ptr<const Array> Archive::array(const std::shared_ptr<const Array>& a)
+	{
+		// an array is its number, followed by its elements the first time it is met
+		if (!m_loading)
+		{
+			auto known = m_savedArrays.emplace(a.get(), m_savedArrays.size());
+			std::uint64_t index{ known.first->second };
+			field(index);
+			if (known.second)
+			{
+				size_t n{ a->size() };
+				field(n);
+				bytes(const_cast<double*>(a->data()), n * sizeof(double));
+			}
+			return a;
+		}
+
+		std::uint64_t index{};
+		field(index);
+		if (index < m_loadedArrays.size()) return m_loadedArrays[index];
+		if (index > m_loadedArrays.size()) corrupt();
+
+		size_t n{ count(0, sizeof(double)) };
+		auto loaded = std::make_shared<Array>(n);
+		bytes(loaded->data(), n * sizeof(double));
+		m_loadedArrays.push_back(loaded);
+		return loaded;
+	}
+
+	void Archive::field(Value& v)
+	{
+		std::uint64_t kind{ static_cast<std::uint64_t>(v.getKind()) };
+		field(kind);
+		switch (static_cast<Value::Kind>(kind))
+		{
+		case Value::Kind::Scalar:
+		{
+			double d{ v.getScalar() };
+			field(d);
+			if (m_loading) v = Value{ d };
+			break;
+		}
+		case Value::Kind::Vector:
+		{
+			auto a = array(v.getArray());
+			if (m_loading) v = Value{ std::move(a) };
+			break;
+		}
+		case Value::Kind::Matrix:
+		{
+			auto a = array(v.getArray());
+			size_t cols{ m_loading ? 0 : v.getCols() };
+			field(cols);
+			if (m_loading)
+			{
+				if (cols == 0 || a->size() % cols != 0) corrupt();
+				v = Value{ std::move(a), cols };
+			}
+			break;
+		}
+		default:
+			corrupt();
+		}
+	}
+
+	void Archive::field(std::vector<Value>& v)
+	{
+		// a scalar takes 16 bytes, the least any value takes
+		size_t n{ count(v.size(), 16) };
+		if (m_loading) v.resize(n);
+		for (auto& value : v)
+			field(value);
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+#include<cstddef>
+#include<cstdint>
+#include<memory>
+#include<string>
+#include<type_traits>
+#include<unordered_map>
+#include<vector>
+
+#include"Value.h"
+
+namespace model
+{
+	/*
+		Binary encoding of stack values and of the state the commands keep for
+		undo, used by the snapshots of a session.
+
+		A class names its fields once, in one function taking the archive, and
+		the archive either appends them to its buffer or reads them back in
+		the same order, depending on how it was made. Numbers take 8 little
+		endian bytes each. An array shared by several values, like the operand
+		of an undone command that is also on the stack, is written once and
+		shared again after loading. Loading data that ends early or describes
+		an impossible value throws a utility::Exception.
+	*/
+	class Archive
+	{
+	public:
+		// an archive saving into its buffer
+		Archive();
+		// an archive loading from the size bytes at data, which must outlive it
+		Archive(const char* data, size_t size);
+
+		bool isLoading()const { return m_loading; }
+
+		template<typename T>
+		void field(T& x)
+		{
+			static_assert(std::is_arithmetic<T>::value, "only numbers are archived as they are");
+			if constexpr (std::is_floating_point<T>::value)
+			{
+				double d = static_cast<double>(x);
+				bytes(&d, sizeof d);
+				x = static_cast<T>(d);
+			}
+			else
+			{
+				std::uint64_t u = static_cast<std::uint64_t>(x);
+				bytes(&u, sizeof u);
+				x = static_cast<T>(u);
+			}
+		}
+
+		void field(std::string&);
+		void field(std::vector<std::string>&);
+		void field(std::vector<double>&);
+		void field(Value&);
+		void field(std::vector<Value>&);
+
+		// what has been saved so far
+		const std::string& getBuffer()const { return m_buffer; }
+		// the bytes not loaded yet
+		size_t remaining()const { return m_size - m_position; }
+
+	private:
+		void bytes(void* p, size_t n);
+		// an element count, checked on loading against the bytes left
+		size_t count(size_t n, size_t elementSize);
+		std::shared_ptr<const Array> array(const std::shared_ptr<const Array>&);
+
+		bool m_loading;
+		std::string m_buffer;
+		const char* m_data;
+		size_t m_size;
+		size_t m_position;
+
+		// the arrays met so far, numbered in order
+		std::unordered_map<const Array*, std::uint64_t> m_savedArrays;
+		std::vector<std::shared_ptr<const Array>> m_loadedArrays;
+
+	private:
+		Archive(const Archive&) = delete;
+		Archive& operator=(const Archive&) = delete;
+	};
+}
+#endif // !ARCHIVE_H
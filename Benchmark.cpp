@@ -0,0 +1,673 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "Benchmark.h"
+#include "Kernels.h"
+#include "VectorMath.h"
+#include "ThreadPool.h"
+#include "DataFile.h"
+#include "Journal.h"
+#include "Reclaimer.h"
+#include "CommandManager.h"
+#include "Command.h"
+#include "CommandRepository.h"
+#include "Stack.h"
+#include "Expression.h"
+#include "ColumnFormula.h"
+#include<algorithm>
+#include<charconv>
+#include<chrono>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<filesystem>
+#include<fstream>
+#include<functional>
+#include<iomanip>
+#include<random>
+#include<thread>
+#include<vector>
+
+namespace utility
+{
+	namespace
+	{
+		class Timer
+		{
+		public:
+			Timer() : m_start{ std::chrono::steady_clock::now() } {}
+			double seconds()const
+			{
+				return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+			}
+		private:
+			std::chrono::steady_clock::time_point m_start;
+		};
+
+		// runs f until at least minSeconds have passed and returns the best time of one run
+		template<typename F>
+		double bestOf(F f, double minSeconds = 0.2)
+		{
+			double best{ 1e300 }, total{ 0.0 };
+			do
+			{
+				Timer t;
+				f();
+				double s{ t.seconds() };
+				best = std::min(best, s);
+				total += s;
+			} while (total < minSeconds);
+
+			return best;
+		}
+
+		std::vector<double> uniformSamples(size_t n, double lo, double hi)
+		{
+			std::mt19937_64 gen{ 42 };
+			std::uniform_real_distribution<double> dist{ lo, hi };
+			std::vector<double> v(n);
+			for (auto& d : v)
+				d = dist(gen);
+			return v;
+		}
+
+		// distance in units in the last place, counting across zero
+		double ulpDistance(double a, double b)
+		{
+			if (std::isnan(a) && std::isnan(b)) return 0.0;
+			if (std::isnan(a) || std::isnan(b)) return 1e300;
+
+			auto ordered = [](double d)
+			{
+				std::int64_t i;
+				std::memcpy(&i, &d, sizeof i);
+				return i < 0 ? -(i & INT64_MAX) : i;
+			};
+			std::int64_t ia{ ordered(a) }, ib{ ordered(b) };
+			std::uint64_t d{ ia > ib ? static_cast<std::uint64_t>(ia) - static_cast<std::uint64_t>(ib)
+				: static_cast<std::uint64_t>(ib) - static_cast<std::uint64_t>(ia) };
+			return static_cast<double>(d);
+		}
+
+		void vectorMathBenchmark(std::ostream& os)
+		{
+			struct Domain { MathFunction f; double lo, hi; };
+			const Domain domains[] = {
+				{ MathFunction::Sin, -3.14159, 3.14159 }, { MathFunction::Sin, -1e4, 1e4 },
+				{ MathFunction::Cos, -3.14159, 3.14159 }, { MathFunction::Cos, -1e4, 1e4 },
+				{ MathFunction::Tan, -1.5, 1.5 }, { MathFunction::Tan, -1e4, 1e4 },
+				{ MathFunction::ASin, -1.0, 1.0 }, { MathFunction::ACos, -1.0, 1.0 },
+				{ MathFunction::ATan, -10.0, 10.0 }, { MathFunction::ATan, -1e8, 1e8 }
+			};
+
+			const size_t n{ 1 << 20 };
+			auto& math = VectorMath::getInstance();
+			auto& registry = KernelRegistry::getInstance();
+			const KernelTier activeTier{ registry.getActiveTier() };
+
+			os << "vectormath: " << n << " samples per domain, ulp error of the fast mode measured against libm\n";
+			os << std::fixed;
+
+			std::vector<double> exact(n), fast(n);
+			for (const auto& d : domains)
+			{
+				auto x = uniformSamples(n, d.lo, d.hi);
+				double tExact{ bestOf([&] { math.evaluateExact(d.f, x.data(), exact.data(), n); }) };
+
+				os << "  " << std::setw(6) << VectorMath::getName(d.f) << " [" << std::setprecision(2)
+					<< d.lo << ", " << d.hi << "]\n"
+					<< "    libm          " << std::setprecision(1) << std::setw(8) << n / tExact / 1e6 << " M/s\n";
+
+				for (int t = 0; t <= static_cast<int>(registry.getDetectedTier()); ++t)
+				{
+					registry.bind(static_cast<KernelTier>(t));
+					double tFast{ bestOf([&] { math.evaluateFast(d.f, x.data(), fast.data(), n); }) };
+
+					double maxUlp{ 0.0 }, sumUlp{ 0.0 };
+					for (size_t i = 0; i < n; ++i)
+					{
+						double u{ ulpDistance(fast[i], exact[i]) };
+						maxUlp = std::max(maxUlp, u);
+						sumUlp += u;
+					}
+
+					os << "    fast/" << std::left << std::setw(8) << KernelRegistry::getName(static_cast<KernelTier>(t))
+						<< std::right << std::setprecision(1) << std::setw(8) << n / tFast / 1e6 << " M/s  "
+						<< std::setw(5) << tExact / tFast << "x  max ulp " << std::setprecision(0) << maxUlp
+						<< "  mean ulp " << std::setprecision(3) << sumUlp / n << "\n";
+				}
+				registry.bind(activeTier);
+			}
+		}
+
+		void gemmBenchmark(std::ostream& os)
+		{
+			// the naive loop needs minutes for the large sizes; it is skipped once
+			// the rate measured on the smaller ones predicts more than this
+			const double naiveBudget{ 20.0 };
+
+			auto& registry = KernelRegistry::getInstance();
+			os << "gemm: square products, " << KernelRegistry::getName(registry.getActiveTier()) << " kernels, "
+				<< std::thread::hardware_concurrency() << " hardware threads\n"
+				<< "       n   blocked GFLOP/s   naive GFLOP/s   speedup   max rel diff\n";
+
+			double naiveRate{ 0.0 };
+			for (size_t n = 64; n <= 4096; n *= 2)
+			{
+				auto a = uniformSamples(n * n, -1.0, 1.0), b = uniformSamples(n * n, -1.0, 1.0);
+				std::vector<double> c(n * n), reference(n * n);
+				double flops{ 2.0 * n * n * n };
+
+				double tBlocked{ bestOf([&] { multiplyMatrices(a.data(), b.data(), c.data(), n, n, n); }) };
+				double rate{ flops / tBlocked / 1e9 };
+				os << std::fixed << std::setw(8) << n << std::setprecision(1) << std::setw(18) << rate;
+
+				if (naiveRate > 0.0 && flops / (naiveRate * 1e9) > naiveBudget)
+				{
+					os << "         skipped\n";
+					continue;
+				}
+
+				double tNaive{ bestOf([&] { multiplyMatricesNaive(a.data(), b.data(), reference.data(), n, n, n); }, 0.0) };
+				naiveRate = flops / tNaive / 1e9;
+
+				double largest{ 0.0 }, diff{ 0.0 };
+				for (size_t i = 0; i < n * n; ++i)
+				{
+					largest = std::max(largest, std::fabs(reference[i]));
+					diff = std::max(diff, std::fabs(c[i] - reference[i]));
+				}
+
+				os << std::setw(16) << naiveRate << std::setw(9) << rate / naiveRate << "x"
+					<< std::scientific << std::setprecision(1) << std::setw(15) << diff / largest << "\n";
+			}
+		}
+
+		void scalingBenchmark(std::ostream& os)
+		{
+			const size_t n{ 1 << 23 }, dim{ 1024 };
+			auto x = uniformSamples(n, -1.0, 1.0), y = uniformSamples(n, -1.0, 1.0);
+			std::vector<double> out(n);
+			auto a = uniformSamples(dim * dim, -1.0, 1.0);
+			std::vector<double> c(dim * dim);
+
+			auto& pool = ThreadPool::getInstance();
+			auto& math = VectorMath::getInstance();
+			const size_t threads{ pool.getThreadCount() };
+			const MathMode mode{ math.getMode() };
+			math.setMode(MathMode::Fast);
+
+			struct Kernel { const char* name; const char* unit; double work; std::function<void()> run; };
+			const Kernel kernels[] = {
+				{ "sum", "GB/s", n * 8.0, [&] { reduceSum(x.data(), n); } },
+				{ "add", "GB/s", n * 24.0, [&] { applyElementwise(BinaryOp::Add, x.data(), y.data(), out.data(), n); } },
+				{ "sin", "M/s", n * 1.0, [&] { math.evaluate(MathFunction::Sin, x.data(), out.data(), n); } },
+				{ "gemm", "GFLOP/s", 2.0 * dim * dim * dim, [&] { multiplyMatrices(a.data(), a.data(), c.data(), dim, dim, dim); } }
+			};
+
+			os << "scaling: " << n << " elements (gemm " << dim << "x" << dim << "), "
+				<< std::thread::hardware_concurrency() << " hardware threads, speedup against 1 thread\n"
+				<< "  threads";
+			for (const auto& k : kernels)
+				os << std::setw(10) << k.name << std::setw(9) << k.unit;
+			os << "\n" << std::fixed << std::setprecision(1);
+
+			std::vector<double> single(std::size(kernels));
+			for (size_t t = 1; t <= 64; t *= 2)
+			{
+				pool.setThreadCount(t);
+				os << std::setw(9) << t;
+				for (size_t i = 0; i < std::size(kernels); ++i)
+				{
+					double rate{ kernels[i].work / bestOf(kernels[i].run) / 1e9 };
+					if (kernels[i].unit[0] == 'M') rate *= 1e3;
+					if (t == 1) single[i] = rate;
+					os << std::setw(10) << rate << std::setw(8) << rate / single[i] << "x";
+				}
+				os << "\n";
+			}
+
+			pool.setThreadCount(threads);
+			math.setMode(mode);
+		}
+
+		void sortBenchmark(std::ostream& os)
+		{
+			// a few million samples with repeats and both signs, far above the
+			// radix threshold, so every thread count splits them into chunks
+			const size_t n{ size_t{ 1 } << 21 };
+			auto x = uniformSamples(n, -1e3, 1e3);
+			for (size_t i = 0; i < n; i += 7)
+				x[i] = std::floor(x[i]);
+			auto reference = x;
+			std::sort(reference.begin(), reference.end());
+
+			auto& pool = ThreadPool::getInstance();
+			const size_t threads{ pool.getThreadCount() };
+
+			os << "sort: " << n << " elements, checked against std::sort\n"
+				<< "  threads       M/s   matches\n" << std::fixed << std::setprecision(1);
+
+			std::vector<double> y(n);
+			for (size_t t = 1; t <= 8; t *= 2)
+			{
+				pool.setThreadCount(t);
+				double s{ bestOf([&]
+				{
+					std::copy(x.begin(), x.end(), y.begin());
+					sortAscending(y.data(), n);
+				}) };
+				os << std::setw(9) << t << std::setw(10) << n / s / 1e6
+					<< std::setw(10) << (y == reference ? "yes" : "NO") << "\n";
+			}
+
+			pool.setThreadCount(threads);
+		}
+
+		void loadBenchmark(std::ostream& os)
+		{
+			const size_t n{ 1 << 22 };
+			auto x = uniformSamples(n, -1e6, 1e6);
+
+			// shortest round trip text, one number per line
+			std::string text;
+			text.reserve(n * 24);
+			char buffer[32];
+			for (double d : x)
+			{
+				auto r = std::to_chars(buffer, buffer + sizeof buffer, d);
+				text.append(buffer, r.ptr);
+				text += '\n';
+			}
+
+			auto directory = std::filesystem::temp_directory_path();
+			auto textPath = (directory / "nimpo_bench_load.txt").string();
+			auto binaryPath = (directory / "nimpo_bench_load.bin").string();
+			std::ofstream{ textPath, std::ios::binary }.write(text.data(), static_cast<std::streamsize>(text.size()));
+			std::ofstream{ binaryPath, std::ios::binary }.write(reinterpret_cast<const char*>(x.data()),
+				static_cast<std::streamsize>(n * sizeof(double)));
+
+			os << std::fixed << std::setprecision(1) << "load: " << n << " numbers, " << text.size() / 1e6
+				<< " MB of text, " << ThreadPool::getInstance().getThreadCount() << " threads\n" << std::setprecision(2);
+
+			struct Case { const char* name; double bytes; std::function<void(std::vector<double>&)> run; };
+			const Case cases[] = {
+				{ "parse text in memory", static_cast<double>(text.size()),
+					[&](std::vector<double>& out) { parseNumbers(text.data(), text.size(), out); } },
+				{ "load text file", static_cast<double>(text.size()),
+					[&](std::vector<double>& out) { readNumbers(textPath, out); } },
+				{ "load binary file", n * 8.0,
+					[&](std::vector<double>& out) { readNumbers(binaryPath, out); } }
+			};
+
+			for (const auto& c : cases)
+			{
+				std::vector<double> out;
+				double t{ bestOf([&] { out.clear(); c.run(out); }) };
+				bool same{ out.size() == n && std::memcmp(out.data(), x.data(), n * sizeof(double)) == 0 };
+				os << "  " << std::left << std::setw(22) << c.name << std::right << std::setw(8) << c.bytes / t / 1e9
+					<< " GB/s" << std::setw(9) << n / t / 1e6 << " M numbers/s" << (same ? "" : "  MISMATCH") << "\n";
+			}
+
+			std::filesystem::remove(textPath);
+			std::filesystem::remove(binaryPath);
+		}
+
+		void journalBenchmark(std::ostream& os)
+		{
+			// the size of the record for a number entered
+			const size_t recordSize{ 30 };
+			const std::string record(recordSize, 'r');
+			auto path = (std::filesystem::temp_directory_path() / "nimpo_bench.journal").string();
+
+			os << std::fixed << std::setprecision(2) << "journal: records of " << recordSize << " bytes\n";
+
+			struct Case { const char* name; long intervalMs; bool commitEach; };
+			const Case cases[] = {
+				{ "group commit 10 ms", 10, false },
+				{ "group commit 1 ms", 1, false },
+				{ "sync per record", 1, true }
+			};
+
+			for (const auto& c : cases)
+			{
+				std::filesystem::remove(path);
+				Journal::Statistics st{};
+				double seconds{ 0.0 };
+				{
+					Journal journal{ path, std::chrono::milliseconds{ c.intervalMs }, [](const char*, size_t) {} };
+					Timer t;
+					do
+					{
+						for (int i = 0; i < 1000; ++i)
+						{
+							journal.append(record.data(), record.size());
+							if (c.commitEach) journal.commit();
+						}
+					} while (t.seconds() < 0.5);
+					journal.commit();
+					seconds = t.seconds();
+					st = journal.getStatistics();
+				}
+
+				os << "  " << std::left << std::setw(20) << c.name << std::right << std::setw(10) << st.bytes / seconds / 1e6
+					<< " MB/s" << std::setw(12) << st.records / seconds / 1e3 << " k records/s" << std::setw(9)
+					<< (st.commits ? st.commitSeconds / st.commits * 1e3 : 0.0) << " ms commit latency, "
+					<< st.maxCommitSeconds * 1e3 << " ms at most, " << st.commits << " commits\n";
+			}
+
+			std::filesystem::remove(path);
+		}
+
+		void reclaimBenchmark(std::ostream& os)
+		{
+			using control::CommandManager;
+			const size_t n{ 1000000 };
+
+			os << std::fixed << std::setprecision(3) << "reclaim: pauses after undoing " << n
+				<< " numbers, of the next command and of the end of the history\n";
+
+			struct Case { const char* name; CommandManager::UndoRedoStrategy strategy; };
+			const Case cases[] = {
+				{ "stack", CommandManager::UndoRedoStrategy::StackStrategy },
+				{ "list", CommandManager::UndoRedoStrategy::ListStrategy },
+				{ "list vector", CommandManager::UndoRedoStrategy::ListStrategyVector },
+				{ "tree", CommandManager::UndoRedoStrategy::TreeStrategy }
+			};
+
+			auto& reclaimer = Reclaimer::getInstance();
+			bool background{ reclaimer.isBackground() };
+			for (const auto& c : cases)
+			{
+				for (bool inBackground : { false, true })
+				{
+					reclaimer.setBackground(inBackground);
+
+					auto manager = std::make_unique<CommandManager>(c.strategy);
+					for (size_t i = 0; i < n; ++i)
+						manager->executeCommand(control::MakeCommandPtr<control::EnterNumber>(static_cast<double>(i)));
+					for (size_t i = 0; i < n; ++i)
+						manager->undo();
+
+					Timer next;
+					manager->executeCommand(control::MakeCommandPtr<control::EnterNumber>(0.0));
+					double nextSeconds{ next.seconds() };
+					manager->undo();
+
+					Timer end;
+					manager.reset();
+					double endSeconds{ end.seconds() };
+					reclaimer.drain();
+
+					os << "  " << std::left << std::setw(12) << c.name << std::setw(12) << (inBackground ? "background" : "inline")
+						<< std::right << std::setw(10) << nextSeconds * 1e3 << " ms next command" << std::setw(10)
+						<< endSeconds * 1e3 << " ms end of history\n";
+				}
+			}
+			reclaimer.setBackground(background);
+
+			auto st = reclaimer.getStatistics();
+			os << "  the reclaimer took up to " << st.maxSeconds * 1e3 << " ms for a batch, "
+				<< st.seconds * 1e3 << " ms for " << st.freed << " batches\n";
+		}
+
+		void macroBenchmark(std::ostream& os)
+		{
+			using namespace control;
+
+			// 25 times "1 +" on a running sum, as steps, as a macro and as the
+			// stack operations the steps come down to
+			const size_t pairs{ 25 };
+			auto& repository = CommandRepository::getInstance();
+			if (!repository.hasKey("+"))
+				repository.registerCommand("+", MakeCommandPtr<AddCommand>());
+
+			std::vector<std::string> tokens;
+			for (size_t i = 0; i < pairs; ++i)
+			{
+				tokens.push_back("1");
+				tokens.push_back("+");
+			}
+			auto macro = MacroCommand::compile(tokens);
+			auto& stack = model::Stack::getInstance();
+
+			os << std::fixed << std::setprecision(1) << "macro: " << tokens.size() << " steps adding 1 to the top\n";
+
+			struct Case { const char* name; std::function<void(CommandManager&)> run; };
+			const Case cases[] = {
+				{ "one command per step", [&](CommandManager& manager)
+					{
+						for (size_t i = 0; i < pairs; ++i)
+						{
+							manager.executeCommand(MakeCommandPtr<EnterNumber>(1.0));
+							manager.executeCommand(repository.getCommandByName("+"));
+						}
+					} },
+				{ "macro", [&](CommandManager& manager)
+					{
+						manager.executeCommand(MakeCommandPtr(macro->clone()));
+					} },
+				{ "stack only", [&](CommandManager&)
+					{
+						for (size_t i = 0; i < pairs; ++i)
+						{
+							stack.push(1.0);
+							double top{ *stack.pop() };
+							stack.push(*stack.pop() + top);
+						}
+					} }
+			};
+
+			const size_t runs{ 20000 };
+			for (const auto& c : cases)
+			{
+				double t{ bestOf([&]
+				{
+					CommandManager manager;
+					stack.push(0.0, false);
+					for (size_t r = 0; r < runs; ++r)
+						c.run(manager);
+					stack.clear();
+				}) };
+
+				os << "  " << std::left << std::setw(22) << c.name << std::right << std::setw(10)
+					<< t / (runs * tokens.size()) * 1e9 << " ns per step\n";
+			}
+		}
+
+		void functionBenchmark(std::ostream& os)
+		{
+			using namespace control;
+
+			// the sum of the turns of a loop, "i +" each turn, run by a compiled
+			// function against the same two tokens entered as commands
+			auto& repository = CommandRepository::getInstance();
+			if (!repository.hasKey("+"))
+				repository.registerCommand("+", MakeCommandPtr<AddCommand>());
+			auto function = FunctionCommand::compile({ "0", "swap", "times", "i", "+", "next" });
+			auto& stack = model::Stack::getInstance();
+
+			os << std::fixed << std::setprecision(1) << "function: a loop adding its turn to a running sum\n";
+
+			const size_t turns{ 10000000 };
+			double t{ bestOf([&]
+			{
+				CommandManager manager;
+				stack.push(static_cast<double>(turns), false);
+				manager.executeCommand(MakeCommandPtr(function->clone()));
+				stack.clear();
+			}) };
+			os << "  " << std::left << std::setw(22) << "function" << std::right << std::setw(10)
+				<< t * 1e3 << " ms for " << turns << " turns, " << t / turns * 1e9 << " ns per turn\n";
+
+			const size_t entered{ 20000 };
+			t = bestOf([&]
+			{
+				CommandManager manager;
+				stack.push(0.0, false);
+				for (size_t i = 0; i < entered; ++i)
+				{
+					manager.executeCommand(MakeCommandPtr<EnterNumber>(static_cast<double>(i)));
+					manager.executeCommand(repository.getCommandByName("+"));
+				}
+				stack.clear();
+			});
+			os << "  " << std::left << std::setw(22) << "one command per token" << std::right << std::setw(10)
+				<< t / entered * 1e9 << " ns per turn\n";
+		}
+
+		void lazyBenchmark(std::ostream& os)
+		{
+			using namespace control;
+
+			// sin(2x + 1) / 3, cos of that, times 4: eight commands on a vector,
+			// eager, lazy and read in the end, and lazy and dropped unread
+			const size_t n{ size_t{ 1 } << 22 };
+			auto x = std::make_shared<model::Array>(n);
+			auto samples = uniformSamples(n, -1.0, 1.0);
+			std::copy(samples.begin(), samples.end(), x->data());
+
+			auto& stack = model::Stack::getInstance();
+			auto& graph = model::ExpressionGraph::getInstance();
+			auto chain = [&](CommandManager& manager)
+			{
+				stack.push(model::Value{ x }, false);
+				manager.executeCommand(MakeCommandPtr<EnterNumber>(2.0));
+				manager.executeCommand(MakeCommandPtr<MultiplyCommand>());
+				manager.executeCommand(MakeCommandPtr<EnterNumber>(1.0));
+				manager.executeCommand(MakeCommandPtr<AddCommand>());
+				manager.executeCommand(MakeCommandPtr<SineCommand>());
+				manager.executeCommand(MakeCommandPtr<EnterNumber>(3.0));
+				manager.executeCommand(MakeCommandPtr<DivideCommand>());
+				manager.executeCommand(MakeCommandPtr<CosineCommand>());
+			};
+
+			os << std::fixed << std::setprecision(1) << "lazy: 8 commands on a vector of " << n << " elements\n";
+
+			struct Case { const char* name; bool lazy; bool read; };
+			const Case cases[] = { { "eager", false, true }, { "lazy, read", true, true }, { "lazy, dropped", true, false } };
+			for (const auto& c : cases)
+			{
+				graph.setLazy(c.lazy);
+				double t{ bestOf([&]
+				{
+					CommandManager manager;
+					chain(manager);
+					if (c.read)
+						stack.topValue()->getArray()->data();
+					stack.clear();
+				}) };
+
+				os << "  " << std::left << std::setw(22) << c.name << std::right << std::setw(10)
+					<< t * 1e3 << " ms\n";
+			}
+			graph.setLazy(false);
+		}
+
+		void columnsBenchmark(std::ostream& os)
+		{
+			using namespace control;
+
+			// "a b * c +" over columns, against the same formula entered as
+			// commands once per row
+			const size_t rows{ size_t{ 1 } << 22 };
+			ColumnFormula::Columns columns;
+			for (const char* name : { "a", "b", "c" })
+			{
+				auto samples = uniformSamples(rows, -1.0, 1.0);
+				auto column = std::make_shared<model::Array>(rows);
+				std::copy(samples.begin(), samples.end(), column->data());
+				columns[name] = column;
+			}
+			ColumnFormula formula{ "a b * c +" };
+
+			os << std::fixed << std::setprecision(1) << "columns: a b * c + over " << rows << " rows\n";
+
+			double t{ bestOf([&] { formula.evaluate(columns); }) };
+			os << "  " << std::left << std::setw(22) << "columns" << std::right << std::setw(10)
+				<< rows / t / 1e6 << " M rows/s\n";
+
+			// sin a is read twice by one step, its block may go back to the
+			// plan only once or two later steps write over each other
+			auto squared = ColumnFormula{ "b cos c sin + a sin dup * +" }.evaluate(columns);
+			double diff{ 0.0 };
+			for (size_t i = 0; i < rows; ++i)
+			{
+				double sa{ std::sin((*columns["a"])[i]) };
+				double expected{ std::cos((*columns["b"])[i]) + std::sin((*columns["c"])[i]) + sa * sa };
+				diff = std::max(diff, std::fabs((*squared)[i] - expected));
+			}
+			os << "  " << std::left << std::setw(22) << "sin a squared" << std::right
+				<< std::scientific << std::setprecision(1) << std::setw(10) << diff << " max abs diff\n"
+				<< std::fixed << std::setprecision(1);
+
+			const size_t entered{ 20000 };
+			auto& stack = model::Stack::getInstance();
+			t = bestOf([&]
+			{
+				CommandManager manager;
+				for (size_t i = 0; i < entered; ++i)
+				{
+					for (const char* name : { "a", "b" })
+						manager.executeCommand(MakeCommandPtr<EnterNumber>((*columns[name])[i]));
+					manager.executeCommand(MakeCommandPtr<MultiplyCommand>());
+					manager.executeCommand(MakeCommandPtr<EnterNumber>((*columns["c"])[i]));
+					manager.executeCommand(MakeCommandPtr<AddCommand>());
+					stack.clear();
+				}
+			});
+			os << "  " << std::left << std::setw(22) << "one row at a time" << std::right << std::setw(10)
+				<< entered / t << " rows/s\n";
+		}
+
+		struct Entry
+		{
+			const char* name;
+			void (*run)(std::ostream&);
+		};
+
+		const Entry benchmarks[] = {
+			{ "vectormath", vectorMathBenchmark },
+			{ "gemm", gemmBenchmark },
+			{ "scaling", scalingBenchmark },
+			{ "sort", sortBenchmark },
+			{ "load", loadBenchmark },
+			{ "journal", journalBenchmark },
+			{ "reclaim", reclaimBenchmark },
+			{ "macro", macroBenchmark },
+			{ "function", functionBenchmark },
+			{ "lazy", lazyBenchmark },
+			{ "columns", columnsBenchmark }
+		};
+	}
+
+	void runBenchmarks(const std::string& filter, std::ostream& os)
+	{
+		for (const auto& b : benchmarks)
+		{
+			if (std::string{ b.name }.compare(0, filter.size(), filter) != 0)
+				continue;
+
+			b.run(os);
+			os << std::endl;
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+#include<string>
+#include<ostream>
+
+namespace utility
+{
+	// The benchmark suite, started with 'nimpo --bench [name]'. Runs every
+	// benchmark whose name starts with filter (all of them for an empty
+	// filter) and writes the results to os.
+	void runBenchmarks(const std::string& filter, std::ostream& os);
+}
+#endif // !BENCHMARK_H
+
@@ -0,0 +1,223 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+#include "ChunkedStorage.h"
+#include<algorithm>
+
+namespace model
+{
+	namespace
+	{
+		// the capacity a new chunk starts with when numbers come one at a time
+		const size_t FirstCapacity = 1024;
+
+		// a vector pushed in bulk at least this long becomes a chunk of its own,
+		// a shorter one is copied onto an unshared top chunk
+		const size_t AdoptSize = 4096;
+	}
+
+	std::vector<double>* ChunkedStorage::ownedTop()
+	{
+		if (m_chunks.empty() || m_chunks.back().data.use_count() != 1)
+			return nullptr;
+
+		// the copies that shared the rest of the vector are gone
+		auto& top = m_chunks.back();
+		top.data->resize(top.size);
+		return top.data.get();
+	}
+
+	size_t ChunkedStorage::locate(size_t i, size_t& first) const
+	{
+		// the stack is used near its top, the search starts there
+		first = m_size;
+		size_t k{ m_chunks.size() };
+		do
+		{
+			--k;
+			first -= m_chunks[k].size;
+		} while (i < first);
+		return k;
+	}
+
+	double ChunkedStorage::operator[](size_t i) const
+	{
+		size_t first;
+		size_t k{ locate(i, first) };
+		return (*m_chunks[k].data)[i - first];
+	}
+
+	double ChunkedStorage::back() const
+	{
+		const auto& top = m_chunks.back();
+		return (*top.data)[top.size - 1];
+	}
+
+	void ChunkedStorage::set(size_t i, double d)
+	{
+		size_t first;
+		size_t k{ locate(i, first) };
+		size_t offset{ i - first };
+
+		auto& chunk = m_chunks[k];
+		if (chunk.data.use_count() != 1)
+		{
+			// the rest of the shared chunk moves into one of its own
+			Chunk tail{ std::make_shared<std::vector<double>>(chunk.data->begin() + offset, chunk.data->begin() + chunk.size),
+				chunk.size - offset };
+			chunk.size = offset;
+			if (offset == 0)
+				m_chunks[k] = std::move(tail);
+			else
+				m_chunks.insert(m_chunks.begin() + ++k, std::move(tail));
+			offset = 0;
+		}
+
+		(*m_chunks[k].data)[offset] = d;
+	}
+
+	void ChunkedStorage::push_back(double d)
+	{
+		if (auto top = ownedTop())
+		{
+			top->push_back(d);
+			++m_chunks.back().size;
+		}
+		else
+		{
+			auto data = std::make_shared<std::vector<double>>();
+			data->reserve(FirstCapacity);
+			data->push_back(d);
+			m_chunks.push_back({ std::move(data), 1 });
+		}
+		++m_size;
+	}
+
+	void ChunkedStorage::pop_back()
+	{
+		auto& top = m_chunks.back();
+		if (top.data.use_count() == 1)
+			top.data->resize(top.size - 1);
+		if (--top.size == 0)
+			m_chunks.pop_back();
+		--m_size;
+	}
+
+	void ChunkedStorage::append(std::vector<double>&& v)
+	{
+		if (v.empty())
+			return;
+
+		size_t n{ v.size() };
+		auto top = v.size() < AdoptSize ? ownedTop() : nullptr;
+		if (top)
+		{
+			top->insert(top->end(), v.begin(), v.end());
+			m_chunks.back().size += n;
+			v.clear();
+		}
+		else
+			m_chunks.push_back({ std::make_shared<std::vector<double>>(std::move(v)), n });
+		m_size += n;
+	}
+
+	double* ChunkedStorage::extend(size_t n)
+	{
+		if (auto top = ownedTop())
+		{
+			size_t first{ top->size() };
+			top->resize(first + n);
+			m_chunks.back().size += n;
+			m_size += n;
+			return top->data() + first;
+		}
+
+		m_chunks.push_back({ std::make_shared<std::vector<double>>(n), n });
+		m_size += n;
+		return m_chunks.back().data->data();
+	}
+
+	void ChunkedStorage::popTo(size_t n, std::vector<double>& out)
+	{
+		// the whole of a single unshared chunk is handed over
+		if (n == m_size && m_chunks.size() == 1 && out.empty() && ownedTop())
+		{
+			out.swap(*m_chunks.back().data);
+			clear();
+			return;
+		}
+
+		if (n == 0)
+			return;
+
+		size_t begin{ m_size - n };
+		size_t first;
+		out.reserve(out.size() + n);
+		for (size_t k = locate(begin, first); k < m_chunks.size(); ++k)
+		{
+			auto data = m_chunks[k].data->begin();
+			out.insert(out.end(), data + (begin > first ? begin - first : 0), data + m_chunks[k].size);
+			first += m_chunks[k].size;
+		}
+		truncate(begin);
+	}
+
+	void ChunkedStorage::copyTop(size_t n, std::vector<double>& out) const
+	{
+		out.reserve(out.size() + n);
+		for (auto k = m_chunks.rbegin(); k != m_chunks.rend() && n > 0; ++k)
+		{
+			size_t take{ std::min(n, k->size) };
+			auto end = k->data->begin() + k->size;
+			out.insert(out.end(), std::make_reverse_iterator(end), std::make_reverse_iterator(end - take));
+			n -= take;
+		}
+	}
+
+	void ChunkedStorage::truncate(size_t n)
+	{
+		while (!m_chunks.empty() && m_size - m_chunks.back().size >= n)
+		{
+			m_size -= m_chunks.back().size;
+			m_chunks.pop_back();
+		}
+
+		if (m_size > n)
+		{
+			auto& top = m_chunks.back();
+			top.size -= m_size - n;
+			if (top.data.use_count() == 1)
+				top.data->resize(top.size);
+			m_size = n;
+		}
+	}
+
+	void ChunkedStorage::clear()
+	{
+		m_chunks.clear();
+		m_size = 0;
+	}
+
+	void ChunkedStorage::forEachChunk(const std::function<void(const double*, size_t)>& reader) const
+	{
+		for (const auto& chunk : m_chunks)
+			reader(chunk.data->data(), chunk.size);
+	}
+}
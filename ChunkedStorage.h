@@ -0,0 +1,96 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef CHUNKED_STORAGE_H
+#define CHUNKED_STORAGE_H
+#include<cstddef>
+#include<functional>
+#include<memory>
+#include<vector>
+
+namespace model
+{
+	/*
+		The numbers of the stack, bottom first, kept as a list of chunks of
+		contiguous doubles. A copy shares the chunks of the original and
+		costs a copy of the list, not of the numbers; a chunk is written in
+		place only while nothing else refers to it. Writing into a shared
+		chunk moves the part from there to its end into a chunk of its own,
+		which near the top of the stack, where the writes are, is a few
+		elements.
+
+		A vector pushed in bulk becomes a chunk as it is, and popping the
+		whole of a single unshared chunk hands its vector back, so nothing
+		is copied that a plain vector would not copy either.
+	*/
+	class ChunkedStorage
+	{
+	public:
+		ChunkedStorage() :m_chunks{}, m_size{ 0 } {}
+
+		size_t size()const { return m_size; }
+		bool empty()const { return m_size == 0; }
+
+		double operator[](size_t i)const;
+		double back()const;
+		void set(size_t i, double d);
+
+		void push_back(double d);
+		void pop_back();
+
+		// appends the numbers of v, taking its storage over where it can
+		void append(std::vector<double>&& v);
+
+		// n more zeros on top, contiguous, to be overwritten through the
+		// pointer returned until the storage changes again
+		double* extend(size_t n);
+
+		// moves the top n elements to the end of out, bottom first
+		void popTo(size_t n, std::vector<double>& out);
+
+		// the top n elements appended to out, top first
+		void copyTop(size_t n, std::vector<double>& out)const;
+
+		// keeps the bottom n elements
+		void truncate(size_t n);
+		void clear();
+
+		// reader sees each chunk, bottom first
+		void forEachChunk(const std::function<void(const double* first, size_t n)>& reader)const;
+
+	private:
+		struct Chunk
+		{
+			std::shared_ptr<std::vector<double>> data;
+			size_t size;	// the elements in use, at the start of data
+		};
+
+		// the top chunk, if it can be written and grown in place
+		std::vector<double>* ownedTop();
+		// the chunk holding element i and the position of its first element
+		size_t locate(size_t i, size_t& first)const;
+
+		std::vector<Chunk> m_chunks;
+		size_t m_size;
+	};
+}
+#endif // !CHUNKED_STORAGE_H
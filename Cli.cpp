@@ -25,6 +25,7 @@
 #include<sstream>
 #include<vector>
 #include<algorithm>
+#include<functional>
 #include"Stack.h"
 #include"ConsoleLogger.h"
 
@@ -43,6 +44,8 @@ namespace view
 
 	private:
 		void startupMessage();
+		static void printValue(std::ostream& os, const model::Value& v);
+		static void printArray(std::ostream& os, const model::Value& v, const std::function<void(std::ostream&, size_t)>& element);
 
 		std::istream& m_is;
 		std::ostream& m_os;
@@ -100,7 +103,7 @@ namespace view
 #endif // DEBUG_MODE
 
 		unsigned int nElements{ 4 };
-		auto v = model::Stack::getInstance().getElements(nElements);
+		auto v = model::Stack::getInstance().getValues(nElements);
 		std::ostringstream oss;
 		oss.precision(12);
 		size_t size = model::Stack::getInstance().size();
@@ -118,13 +121,80 @@ namespace view
 		size_t j{ v.size() };
 		for (auto i = v.rbegin(); i != v.rend(); ++i)
 		{
-			oss << j << ":\t" << *i << "\n";
+			oss << j << ":\t";
+			printValue(oss, *i);
+			oss << "\n";
 			--j;
 		}
 
 		displayMessage(oss.str());
 	}
 
+	void Cli::CliImpl::printValue(std::ostream& os, const model::Value& v)
+	{
+		if (v.isScalar())
+		{
+			os << v.getScalar();
+			return;
+		}
+
+		// a first pass finds the positions shown, read in one go: a deferred
+		// array computes just these
+		std::vector<size_t> positions;
+		std::ostringstream skipped;
+		printArray(skipped, v, [&positions](std::ostream&, size_t i) { positions.push_back(i); });
+
+		std::vector<double> values(positions.size());
+		v.getArray()->peek(positions.data(), positions.size(), values.data());
+
+		size_t k{ 0 };
+		printArray(os, v, [&values, &k](std::ostream& out, size_t) { out << values[k++]; });
+	}
+
+	void Cli::CliImpl::printArray(std::ostream& os, const model::Value& v, const std::function<void(std::ostream&, size_t)>& element)
+	{
+		// long rows show their head and last element only, big matrices
+		// their first rows and the last one
+		const size_t nShown{ 6 };
+		const model::Array& a = *v.getArray();
+		auto printRow = [&os, &element, nShown](size_t first, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				if (i == nShown && n > nShown + 2)
+				{
+					os << ", ...";
+					i = n - 1;
+				}
+				os << (i ? ", " : "");
+				element(os, first + i);
+			}
+		};
+
+		if (v.isVector())
+		{
+			os << "vector(" << a.size() << ") [";
+			printRow(0, a.size());
+			os << "]";
+			return;
+		}
+
+		const size_t nRowsShown{ 4 };
+		size_t rows{ v.getRows() }, cols{ v.getCols() };
+		os << "matrix(" << rows << "x" << cols << ")";
+		for (size_t r = 0; r < rows; ++r)
+		{
+			if (r == nRowsShown && rows > nRowsShown + 2)
+			{
+				os << "\n\t  ...";
+				r = rows - 1;
+			}
+			os << "\n\t  [";
+			printRow(r * cols, cols);
+			os << "]";
+		}
+	}
+
 	void Cli::CliImpl::displayMessage(const std::string& msg)
 	{
 #ifdef DEBUG_MODE
@@ -148,7 +218,9 @@ namespace view
 			utility::Tokenizer tokenizer{ line };
 			for (const auto& i : tokenizer)
 			{
-				if (i == "exit" || i == "quit")
+				string name{ i };
+				std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+				if (name == "exit" || name == "quit")
 				{
 					return;
 				}
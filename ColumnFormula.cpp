@@ -0,0 +1,242 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "ColumnFormula.h"
+#include<algorithm>
+#include"DataFile.h"
+#include"Exception.h"
+#include"Expression.h"
+#include"ThreadPool.h"
+#include"Tokenizer.h"
+
+namespace control
+{
+	namespace
+	{
+		std::shared_ptr<const model::Array> makeColumn(const double* first, size_t n, size_t stride)
+		{
+			auto a = std::make_shared<model::Array>(n);
+			double* out{ a->data() };
+			utility::ThreadPool::getInstance().parallelFor(n, size_t{ 1 } << 16, [=](size_t i, size_t j)
+			{
+				for (; i < j; ++i)
+					out[i] = first[i * stride];
+			});
+			return a;
+		}
+
+		bool isSeparator(char c)
+		{
+			return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r';
+		}
+	}
+
+	ColumnFormula::ColumnFormula(const std::string& formula)
+		:m_steps{}, m_names{}
+	{
+		static const std::map<std::string, utility::BinaryOp> Operators{
+			{ "+", utility::BinaryOp::Add }, { "-", utility::BinaryOp::Subtract },
+			{ "*", utility::BinaryOp::Multiply }, { "/", utility::BinaryOp::Divide } };
+		static const std::map<std::string, utility::MathFunction> Functions{
+			{ "sin", utility::MathFunction::Sin }, { "cos", utility::MathFunction::Cos }, { "tan", utility::MathFunction::Tan },
+			{ "arcsin", utility::MathFunction::ASin }, { "arccos", utility::MathFunction::ACos }, { "arctan", utility::MathFunction::ATan } };
+		static const std::map<std::string, Op> StackWords{
+			{ "dup", Op::Dup }, { "drop", Op::Drop }, { "swap", Op::Swap }, { "over", Op::Over } };
+
+		// the values the formula holds after each step, checked here once
+		size_t depth{ 0 };
+		auto need = [&depth](size_t n, const std::string& token)
+		{
+			if (depth < n)
+				throw utility::Exception("Warning: " + token + " needs " + std::to_string(n) + " values before it in the formula");
+		};
+
+		utility::Tokenizer tokenizer{ formula };
+		for (const auto& token : tokenizer)
+		{
+			std::string word{ token };
+			std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+
+			Step step{ Op::Number, 0.0, 0, utility::MathFunction::Sin, utility::BinaryOp::Add };
+			if (Operators.count(word))
+			{
+				need(2, token);
+				--depth;
+				step.op = Op::Operator;
+				step.binary = Operators.at(word);
+			}
+			else if (Functions.count(word))
+			{
+				need(1, token);
+				step.op = Op::Function;
+				step.function = Functions.at(word);
+			}
+			else if (StackWords.count(word))
+			{
+				step.op = StackWords.at(word);
+				need(step.op == Op::Swap || step.op == Op::Over ? 2 : 1, token);
+				if (step.op == Op::Dup || step.op == Op::Over) ++depth;
+				if (step.op == Op::Drop) --depth;
+			}
+			else if (utility::parseNumber(word, step.number))
+				++depth;
+			else
+			{
+				// column names keep their case, like the header of a csv
+				auto known = std::find(m_names.begin(), m_names.end(), token);
+				step.op = Op::Column;
+				step.column = static_cast<size_t>(known - m_names.begin());
+				if (known == m_names.end())
+					m_names.push_back(token);
+				++depth;
+			}
+			m_steps.push_back(step);
+		}
+
+		if (depth != 1)
+			throw utility::Exception("Warning: the formula leaves " + std::to_string(depth) + " values, it must leave one");
+	}
+
+	ColumnFormula::~ColumnFormula()
+	{
+	}
+
+	const std::vector<std::string>& ColumnFormula::getColumnNames() const
+	{
+		return m_names;
+	}
+
+	std::shared_ptr<const model::Array> ColumnFormula::evaluate(const Columns& columns) const
+	{
+		std::vector<model::Value> bound;
+		for (const auto& name : m_names)
+		{
+			auto column = columns.find(name);
+			if (column == columns.end())
+				throw utility::Exception("Warning: the formula uses the column " + name + ", which is not given");
+			if (!bound.empty() && column->second->size() != bound.front().getArray()->size())
+				throw utility::Exception("Warning: the column " + name + " has " + std::to_string(column->second->size())
+					+ " rows, " + m_names.front() + " has " + std::to_string(bound.front().getArray()->size()));
+			bound.push_back(model::Value{ column->second });
+		}
+
+		// the numbers are folded right away, the rest becomes one graph
+		auto& graph = model::ExpressionGraph::getInstance();
+		const auto& kernels = utility::KernelRegistry::getInstance().kernels();
+		std::vector<model::Value> stack;
+		for (const auto& step : m_steps)
+		{
+			switch (step.op)
+			{
+			case Op::Number:
+				stack.push_back(model::Value{ step.number });
+				break;
+			case Op::Column:
+				stack.push_back(bound[step.column]);
+				break;
+			case Op::Function:
+			{
+				auto& x = stack.back();
+				if (x.isScalar())
+					x = model::Value{ utility::VectorMath::getInstance().evaluate(step.function, x.getScalar()) };
+				else
+					x = x.withArray(graph.apply(step.function, x.getArray()));
+				break;
+			}
+			case Op::Operator:
+			{
+				model::Value top{ stack.back() };
+				stack.pop_back();
+				auto& next = stack.back();
+				if (next.isScalar() && top.isScalar())
+				{
+					double a{ next.getScalar() }, b{ top.getScalar() }, r;
+					kernels.elementwise[static_cast<size_t>(step.binary)](&a, &b, &r, 1);
+					next = model::Value{ r };
+				}
+				else
+					next = (next.isScalar() ? top : next).withArray(graph.apply(step.binary, next, top));
+				break;
+			}
+			case Op::Dup:
+				stack.push_back(model::Value{ stack.back() });
+				break;
+			case Op::Drop:
+				stack.pop_back();
+				break;
+			case Op::Swap:
+				std::swap(stack[stack.size() - 1], stack[stack.size() - 2]);
+				break;
+			case Op::Over:
+				stack.push_back(model::Value{ stack[stack.size() - 2] });
+				break;
+			}
+		}
+
+		if (stack.back().isScalar())
+			throw utility::Exception("Warning: the formula gives a single number, it uses no column");
+
+		auto result = stack.back().getArray();
+		result->data();
+		return result;
+	}
+
+	void ColumnFormula::readColumns(const std::string& source, Columns& columns)
+	{
+		auto equal = source.find('=');
+		if (equal != std::string::npos)
+		{
+			std::vector<double> numbers;
+			utility::readNumbers(source.substr(equal + 1), numbers);
+			columns[source.substr(0, equal)] = makeColumn(numbers.data(), numbers.size(), 1);
+			return;
+		}
+
+		std::vector<std::string> names;
+		{
+			utility::MappedFile file{ source };
+			const char* text{ file.data() + utility::byteOrderMark(file.data(), file.size()) };
+			const char* end{ std::find(text, file.data() + file.size(), '\n') };
+			while (text < end)
+			{
+				while (text < end && isSeparator(*text)) ++text;
+				const char* name{ text };
+				while (text < end && !isSeparator(*text)) ++text;
+				if (text > name)
+					names.emplace_back(name, text);
+			}
+		}
+
+		double d;
+		if (names.empty() || utility::parseNumber(names.front(), d))
+			throw utility::Exception("Warning: " + source + " needs a header line naming its columns");
+
+		std::vector<double> numbers;
+		utility::readNumbers(source, numbers);
+		if (numbers.size() % names.size() != 0)
+			throw utility::Exception("Warning: " + source + " has " + std::to_string(numbers.size())
+				+ " numbers, not a whole number of rows of " + std::to_string(names.size()));
+
+		size_t rows{ numbers.size() / names.size() };
+		for (size_t c = 0; c < names.size(); ++c)
+			columns[names[c]] = makeColumn(numbers.data() + c, rows, names.size());
+	}
+}
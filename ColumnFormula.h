@@ -0,0 +1,89 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef COLUMN_FORMULA_H
+#define COLUMN_FORMULA_H
+#include<map>
+#include<memory>
+#include<string>
+#include<vector>
+#include"Kernels.h"
+#include"Value.h"
+#include"VectorMath.h"
+
+namespace control
+{
+	/*
+		nimpo --columns: one formula evaluated over columns of millions of rows
+		at once instead of one interaction per row. The formula is RPN made of
+		numbers, + - * /, sin cos tan arcsin arccos arctan, dup drop swap over
+		and names, each of them standing for a column. It is compiled once,
+		then put together over the columns as the graph of lazy mode (see
+		ExpressionGraph), which takes the rows in blocks of 1024 through every
+		operation with the vector kernels and spreads morsels of blocks over
+		the ThreadPool. The result is one column.
+	*/
+	class ColumnFormula
+	{
+	public:
+		using Columns = std::map<std::string, std::shared_ptr<const model::Array>>;
+
+		// throws on a word it does not know and on a formula that does not
+		// leave exactly one value
+		explicit ColumnFormula(const std::string& formula);
+		~ColumnFormula();
+
+		// the names, in the order they are first used
+		const std::vector<std::string>& getColumnNames()const;
+
+		// the result over columns of one length, bound by name; throws if
+		// a column is missing or the lengths differ
+		std::shared_ptr<const model::Array> evaluate(const Columns& columns)const;
+
+		// Adds the columns of source: "name=path" binds a file of one column,
+		// text or binary, a path alone a csv file whose header line names its
+		// columns. Throws if a file cannot be read or a csv has ragged rows.
+		static void readColumns(const std::string& source, Columns& columns);
+
+	private:
+		enum class Op : unsigned char { Number, Column, Function, Operator, Dup, Drop, Swap, Over };
+
+		struct Step
+		{
+			Op op;
+			double number;					// of Number
+			size_t column;					// of Column, into the names
+			utility::MathFunction function;
+			utility::BinaryOp binary;
+		};
+
+		std::vector<Step> m_steps;
+		std::vector<std::string> m_names;
+
+	private:
+		ColumnFormula(const ColumnFormula&) = delete;
+		ColumnFormula(ColumnFormula&&) = delete;
+		ColumnFormula& operator=(const ColumnFormula&) = delete;
+		ColumnFormula& operator=(ColumnFormula&&) = delete;
+	};
+}
+#endif // !COLUMN_FORMULA_H
@@ -23,6 +23,15 @@
 #include<cmath>
 #include"Exception.h"
 #include"CommandRepository.h"
+#include"Kernels.h"
+#include"VectorMath.h"
+#include"DataFile.h"
+#include"Archive.h"
+#include"Tokenizer.h"
+#include"Program.h"
+#include"Expression.h"
+#include<algorithm>
+#include<random>
 
 using namespace model;
 namespace control
@@ -30,12 +39,71 @@ namespace control
 	double eps = 1e-12; // arbitrary floating closeness
 	const double M_PI = 3.14;
 
-	void Command::execute()
+	namespace
+	{
+		// the stack must hold a count n on top and at least n numbers below it
+		utility::Status checkCountedRange(const Stack& stack)
+		{
+			if (stack.size() < 2)
+				return utility::Status::failure("Warning: Stack must have the count n and at least one Element!");
+
+			double n{ stack.top() };
+			if (n < 1.0 || n != std::floor(n))
+				return utility::Status::failure("Warning: the count n must be a positive integer!");
+
+			if (n > static_cast<double>(stack.size() - 1))
+				return utility::Status::failure("Warning: Stack has fewer than n elements!");
+
+			if (stack.hasArrays(static_cast<size_t>(n) + 1))
+				return utility::Status::failure("Warning: the n elements must be numbers, not vectors or matrices!");
+
+			return {};
+		}
+
+		// the most elements one generator command may push, 8 GiB of doubles
+		const double MaxGenerated = 1 << 30;
+
+		utility::Expected<size_t> checkGeneratedCount(double n)
+		{
+			if (n < 1.0 || n != std::floor(n))
+				return utility::Status::failure("Warning: the count n must be a positive integer!");
+
+			if (n > MaxGenerated)
+				return utility::Status::failure("Warning: at most 2^30 elements can be generated at once!");
+
+			return static_cast<size_t>(n);
+		}
+
+		// rand without a seed continues one stream per session, each thread
+		// running commands has its own
+		struct RandomStream
+		{
+			std::uint64_t seed;
+			std::uint64_t next;
+		};
+
+		RandomStream& sessionStream()
+		{
+			thread_local RandomStream stream{ std::uint64_t{ std::random_device{}() } << 32 | std::random_device{}(), 0 };
+			return stream;
+		}
+
+		std::shared_ptr<Array> makeArray(const double* first, size_t n)
+		{
+			auto a = std::make_shared<Array>(n);
+			std::copy(first, first + n, a->data());
+			return a;
+		}
+	}
+
+	utility::Status Command::execute()
 	{
 		// like the Template Methode Pattern
-		checkPreConditionImpl();
+		auto status = checkPreConditionImpl();
+		if (!status) return status;
+
 		executeImpl();
-		checkPostConditionImpl();
+		return checkPostConditionImpl();
 	}
 	void Command::undo()
 	{
@@ -49,24 +117,83 @@ namespace control
 	{
 		return getHelpMessageImpl();
 	}
+	bool Command::takesArgument() const
+	{
+		return takesArgumentImpl();
+	}
+	void Command::setArgument(const std::string& argument)
+	{
+		setArgumentImpl(argument);
+	}
+	const std::string& Command::getName() const
+	{
+		return m_name;
+	}
+	void Command::setName(const std::string& name)
+	{
+		m_name = name;
+	}
+	void Command::serialize(Archive& archive)
+	{
+		serializeImpl(archive);
+	}
+	void Command::serializeInput(Archive& archive)
+	{
+		serializeInputImpl(archive);
+	}
 	void Command::deallocate()
 	{
 		delete this;
 	}
-	void Command::checkPostConditionImpl() const
+	utility::Status Command::checkPostConditionImpl() const
 	{
 		// to be overrided by the Children;
+
+		return {};
 	}
-	void Command::checkPreConditionImpl() const
+	utility::Status Command::checkPreConditionImpl() const
 	{
 		// to be overrided by the Children;
+
+		return {};
+	}
+	bool Command::takesArgumentImpl() const noexcept
+	{
+		return false;
+	}
+	void Command::setArgumentImpl(const std::string&)
+	{
+		// to be overrided by the Children taking an argument;
+	}
+	void Command::serializeImpl(Archive&)
+	{
+		// to be overrided by the Children keeping state;
+	}
+	void Command::serializeInputImpl(Archive&)
+	{
+		// to be overrided by the Children taking more than the stack;
 	}
 
 	// UnaryCommand Implementation
 	void UnaryCommand::executeImpl()noexcept
 	{
-		m_stackTop = Stack::getInstance().pop(true);
-		Stack::getInstance().push(unaryOperation(m_stackTop));
+		m_stackTop = *Stack::getInstance().popValue(true);
+		if (m_stackTop.isScalar())
+			Stack::getInstance().push(unaryOperation(m_stackTop.getScalar()));
+		else if (model::ExpressionGraph::getInstance().isLazy())
+			Stack::getInstance().push(m_stackTop.withArray(model::ExpressionGraph::getInstance().apply(getFunction(), m_stackTop.getArray())));
+		else
+		{
+			const Array& in = *m_stackTop.getArray();
+			auto out = std::make_shared<Array>(in.size());
+			unaryOperation(in.data(), out->data(), in.size());
+			Stack::getInstance().push(m_stackTop.withArray(std::move(out)));
+		}
+	}
+	void UnaryCommand::unaryOperation(const double* in, double* out, size_t n)const noexcept
+	{
+		for (size_t i = 0; i < n; ++i)
+			out[i] = unaryOperation(in[i]);
 	}
 	void UnaryCommand::undoImpl()noexcept
 	{
@@ -74,23 +201,30 @@ namespace control
 		Stack::getInstance().push(m_stackTop);
 
 	}
-	void UnaryCommand::checkPostConditionImpl()const
+	void UnaryCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_stackTop);
+	}
+	utility::Status UnaryCommand::checkPostConditionImpl()const
 	{
 		// To Do
+
+		return {};
 	}
-	void UnaryCommand::checkPreConditionImpl()const
+	utility::Status UnaryCommand::checkPreConditionImpl()const
 	{
 		if (model::Stack::getInstance().size() < 1)
-			throw utility::Exception("Warning: Stack must have at least one Element!");
+			return utility::Status::failure("Warning: Stack must have at least one Element!");
 
+		return {};
 	}
 	UnaryCommand::UnaryCommand(const UnaryCommand & rhs):Command(rhs),m_stackTop(rhs.m_stackTop)
 	{
 	}
 	void BinaryCommand::executeImpl()noexcept
 	{
-		m_stackTop = model::Stack::getInstance().pop();
-		m_stackNext = model::Stack::getInstance().pop();
+		m_stackTop = *model::Stack::getInstance().popValue();
+		m_stackNext = *model::Stack::getInstance().popValue();
 		model::Stack::getInstance().push(binaryOperation(m_stackNext, m_stackTop));
 
 	}
@@ -100,22 +234,61 @@ namespace control
 		model::Stack::getInstance().push(m_stackNext);
 		model::Stack::getInstance().push(m_stackTop);
 	}
-	void BinaryCommand::checkPostConditionImpl() const
+	void BinaryCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_stackTop);
+		archive.field(m_stackNext);
+	}
+	utility::Status BinaryCommand::checkPostConditionImpl() const
 	{
 		// To do
+
+		return {};
 	}
-	void BinaryCommand::checkPreConditionImpl() const
+	utility::Status BinaryCommand::checkPreConditionImpl() const
 	{
 		if (model::Stack::getInstance().size() < 2)
-			throw utility::Exception{ "Warning: Stack must have at least 2 elements!" };
+			return utility::Status::failure("Warning: Stack must have at least 2 elements!");
 
+		auto v = model::Stack::getInstance().getValues(2);
+		if (!v[0].isScalar() && !v[1].isScalar() && !v[0].hasShapeOf(v[1]))
+			return utility::Status::failure("Warning: the two operands must have the same shape!");
+
+		return {};
+	}
+	model::Value BinaryCommand::binaryOperation(const model::Value& next, const model::Value& top)const noexcept
+	{
+		if (next.isScalar() && top.isScalar())
+			return binaryOperation(next.getScalar(), top.getScalar());
+
+		if (model::ExpressionGraph::getInstance().isLazy())
+			return (next.isScalar() ? top : next).withArray(model::ExpressionGraph::getInstance().apply(getOperator(), next, top));
+
+		size_t n{ next.isScalar() ? top.getArray()->size() : next.getArray()->size() };
+		auto out = std::make_shared<Array>(n);
+		if (top.isScalar())
+			utility::applyBroadcastRight(getOperator(), next.getArray()->data(), top.getScalar(), out->data(), n);
+		else if (next.isScalar())
+			utility::applyBroadcastLeft(getOperator(), next.getScalar(), top.getArray()->data(), out->data(), n);
+		else
+			utility::applyElementwise(getOperator(), next.getArray()->data(), top.getArray()->data(), out->data(), n);
+
+		return (next.isScalar() ? top : next).withArray(std::move(out));
 	}
 	BinaryCommand::BinaryCommand(const BinaryCommand &rhs):Command(rhs),m_stackTop{rhs.m_stackTop},m_stackNext{rhs.m_stackNext}
 	{
 	}
 	double CosineCommand::unaryOperation(double d) const noexcept
 	{
-		return std::cos(d);
+		return utility::VectorMath::getInstance().evaluate(utility::MathFunction::Cos, d);
+	}
+	void CosineCommand::unaryOperation(const double* in, double* out, size_t n) const noexcept
+	{
+		utility::VectorMath::getInstance().evaluate(utility::MathFunction::Cos, in, out, n);
+	}
+	utility::MathFunction CosineCommand::getFunction() const noexcept
+	{
+		return utility::MathFunction::Cos;
 	}
 	CosineCommand::CosineCommand(const CosineCommand & s): UnaryCommand{s}
 	{
@@ -141,6 +314,10 @@ namespace control
 	{
 		return top + next;
 	}
+	utility::BinaryOp AddCommand::getOperator() const noexcept
+	{
+		return utility::BinaryOp::Add;
+	}
 	AddCommand * AddCommand::cloneImpl() const
 	{
 		return new AddCommand{ *this };
@@ -149,8 +326,11 @@ namespace control
 	{
 		return "Add the top two numbers";
 	}
+	const std::string EnterNumber::Name = "number";
+
 	EnterNumber::EnterNumber(double d):Command{},m_number{d}
 	{
+		setName(Name);
 	}
 	EnterNumber::EnterNumber(const EnterNumber & en) : Command{en}, m_number{ en.m_number }
 	{
@@ -168,6 +348,14 @@ namespace control
 		model::Stack::getInstance().pop();
 
 	}
+	void EnterNumber::serializeImpl(Archive& archive)
+	{
+		archive.field(m_number);
+	}
+	void EnterNumber::serializeInputImpl(Archive& archive)
+	{
+		archive.field(m_number);
+	}
 	EnterNumber * EnterNumber::cloneImpl() const
 	{
 		return new EnterNumber{ *this };
@@ -190,6 +378,11 @@ namespace control
 		return next - top;
 	}
 
+	utility::BinaryOp SubstractCommand::getOperator() const noexcept
+	{
+		return utility::BinaryOp::Subtract;
+	}
+
 	SubstractCommand* SubstractCommand::cloneImpl() const
 	{
 		return new SubstractCommand{ *this };
@@ -213,6 +406,11 @@ namespace control
 		return next * top;
 	}
 
+	utility::BinaryOp MultiplyCommand::getOperator() const noexcept
+	{
+		return utility::BinaryOp::Multiply;
+	}
+
 	MultiplyCommand* MultiplyCommand::cloneImpl() const
 	{
 		return new MultiplyCommand{ *this };
@@ -236,15 +434,26 @@ namespace control
 		return next / top;
 	}
 
+	utility::BinaryOp DivideCommand::getOperator() const noexcept
+	{
+		return utility::BinaryOp::Divide;
+	}
+
 	DivideCommand* DivideCommand::cloneImpl() const
 	{
 		return new DivideCommand{ *this };
 	}
 
-	void DivideCommand::checkPreConditionImpl() const
+	utility::Status DivideCommand::checkPreConditionImpl() const
 	{
+		auto status = BinaryCommand::checkPreConditionImpl();
+		if (!status) return status;
+
+		// a vector divisor follows IEEE arithmetic element by element
 		if (model::Stack::getInstance().top() == 0.0)
-			throw utility::Exception{ "Warning trying to divide by zero!" };
+			return utility::Status::failure("Warning trying to divide by zero!");
+
+		return {};
 	}
 
 	const char* DivideCommand::getHelpMessageImpl() const noexcept
@@ -254,7 +463,15 @@ namespace control
 
 	double SineCommand::unaryOperation(double d) const noexcept
 	{
-		return std::sin(d);
+		return utility::VectorMath::getInstance().evaluate(utility::MathFunction::Sin, d);
+	}
+	void SineCommand::unaryOperation(const double* in, double* out, size_t n) const noexcept
+	{
+		utility::VectorMath::getInstance().evaluate(utility::MathFunction::Sin, in, out, n);
+	}
+	utility::MathFunction SineCommand::getFunction() const noexcept
+	{
+		return utility::MathFunction::Sin;
 	}
 
 	SineCommand::SineCommand(const SineCommand& s) : UnaryCommand(s)
@@ -277,7 +494,15 @@ namespace control
 
 	double TangentCommand::unaryOperation(double d) const noexcept
 	{
-		return std::tan(d);
+		return utility::VectorMath::getInstance().evaluate(utility::MathFunction::Tan, d);
+	}
+	void TangentCommand::unaryOperation(const double* in, double* out, size_t n) const noexcept
+	{
+		utility::VectorMath::getInstance().evaluate(utility::MathFunction::Tan, in, out, n);
+	}
+	utility::MathFunction TangentCommand::getFunction() const noexcept
+	{
+		return utility::MathFunction::Tan;
 	}
 
 	TangentCommand::TangentCommand(const TangentCommand& s): UnaryCommand(s)
@@ -298,9 +523,10 @@ namespace control
 		return "Replace the first element, x, on the stack with tan(x). x must be in radians";
 	}
 
-	void TangentCommand::checkPreConditionImpl() const
+	utility::Status TangentCommand::checkPreConditionImpl() const
 	{
-		UnaryCommand::checkPreConditionImpl();
+		auto status = UnaryCommand::checkPreConditionImpl();
+		if (!status) return status;
 
 		auto v = Stack::getInstance().getElements(1);
 
@@ -312,12 +538,22 @@ namespace control
 		r = r - w;
 
 		if (r < eps && r > -eps)
-			throw utility::Exception{ "Infinite result" };
+			return utility::Status::failure("Infinite result");
+
+		return {};
 	}
 
-	double ACosineCommand::unaryOperation(double) const noexcept
+	double ACosineCommand::unaryOperation(double d) const noexcept
+	{
+		return utility::VectorMath::getInstance().evaluate(utility::MathFunction::ACos, d);
+	}
+	void ACosineCommand::unaryOperation(const double* in, double* out, size_t n) const noexcept
+	{
+		utility::VectorMath::getInstance().evaluate(utility::MathFunction::ACos, in, out, n);
+	}
+	utility::MathFunction ACosineCommand::getFunction() const noexcept
 	{
-		return 0.0;
+		return utility::MathFunction::ACos;
 	}
 
 	ACosineCommand::ACosineCommand(const ACosineCommand& s): UnaryCommand(s)
@@ -340,7 +576,15 @@ namespace control
 
 	double ASineCommand::unaryOperation(double d) const noexcept
 	{
-		return std::asin(d);
+		return utility::VectorMath::getInstance().evaluate(utility::MathFunction::ASin, d);
+	}
+	void ASineCommand::unaryOperation(const double* in, double* out, size_t n) const noexcept
+	{
+		utility::VectorMath::getInstance().evaluate(utility::MathFunction::ASin, in, out, n);
+	}
+	utility::MathFunction ASineCommand::getFunction() const noexcept
+	{
+		return utility::MathFunction::ASin;
 	}
 
 	ASineCommand::ASineCommand(const ASineCommand& s): UnaryCommand(s)
@@ -363,7 +607,15 @@ namespace control
 
 	double ATangentCommand::unaryOperation(double d) const noexcept
 	{
-		return std::atan(d);
+		return utility::VectorMath::getInstance().evaluate(utility::MathFunction::ATan, d);
+	}
+	void ATangentCommand::unaryOperation(const double* in, double* out, size_t n) const noexcept
+	{
+		utility::VectorMath::getInstance().evaluate(utility::MathFunction::ATan, in, out, n);
+	}
+	utility::MathFunction ATangentCommand::getFunction() const noexcept
+	{
+		return utility::MathFunction::ATan;
 	}
 
 	ATangentCommand::ATangentCommand(const ATangentCommand& s): UnaryCommand(s)
@@ -397,10 +649,12 @@ namespace control
 		return new SwapCommand{ *this };
 	}
 
-	void SwapCommand::checkPreConditionImpl() const
+	utility::Status SwapCommand::checkPreConditionImpl() const
 	{
 		if(model::Stack::getInstance().size() < 2)
-			throw utility::Exception("The Stack must have at least 2 numbers");
+			return utility::Status::failure("The Stack must have at least 2 numbers");
+
+		return {};
 	}
 
 	const char* SwapCommand::getHelpMessageImpl() const noexcept
@@ -418,7 +672,7 @@ namespace control
 		model::Stack::getInstance().swap();
 	}
 
-	ClearCommand::ClearCommand(const ClearCommand& s) :Command(s), m_stack_{}
+	ClearCommand::ClearCommand(const ClearCommand& s) :Command(s), m_values_{}
 	{
 	}
 
@@ -438,22 +692,22 @@ namespace control
 
 	void ClearCommand::executeImpl()noexcept
 	{
-		while (model::Stack::getInstance().size() > 0)
-		{
-			double d = model::Stack::getInstance().top();
-			m_stack_.push(d);
-			model::Stack::getInstance().pop(true);
-		}
+		auto& stack = model::Stack::getInstance();
+		m_values_ = stack.getValues(stack.size());
+		stack.clear();
 	}
 
 	void ClearCommand::undoImpl()noexcept
 	{
-		while (!m_stack_.empty())
-		{
-			double d = m_stack_.top();
-			model::Stack::getInstance().push(d);
-			m_stack_.pop();
-		}
+		for (auto i = m_values_.rbegin(); i != m_values_.rend(); ++i)
+			model::Stack::getInstance().push(*i, i + 1 == m_values_.rend());
+
+		m_values_.clear();
+	}
+
+	void ClearCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_values_);
 	}
 
 	DropCommand::DropCommand(const DropCommand& s) :Command(s), m_droppedNumber_{}
@@ -474,10 +728,17 @@ namespace control
 		return "Erase the top number";
 	}
 
+	utility::Status DropCommand::checkPreConditionImpl()const
+	{
+		if (model::Stack::getInstance().size() < 1)
+			return utility::Status::failure("Warning: Stack must have at least one Element!");
+
+		return {};
+	}
+
 	void DropCommand::executeImpl()noexcept
 	{
-		m_droppedNumber_ = model::Stack::getInstance().top();
-		model::Stack::getInstance().pop(true);
+		m_droppedNumber_ = *model::Stack::getInstance().popValue(true);
 	}
 
 	void DropCommand::undoImpl()noexcept
@@ -485,4 +746,1487 @@ namespace control
 		model::Stack::getInstance().push(m_droppedNumber_);
 	}
 
+	void DropCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_droppedNumber_);
+	}
+
+	ReductionCommand::ReductionCommand(const ReductionCommand& rhs)
+		:Command(rhs), m_range{ rhs.m_range }, m_count{ rhs.m_count }, m_operands{ rhs.m_operands }
+	{
+	}
+
+	utility::Status ReductionCommand::checkPreConditionImpl() const
+	{
+		auto& stack = model::Stack::getInstance();
+		if (m_range == Range::Stack)
+		{
+			if (stack.size() < 1)
+				return utility::Status::failure("Warning: Stack must have at least one Element!");
+
+			if (stack.hasArrays(stack.size()))
+				return utility::Status::failure("Warning: the elements must be numbers, not vectors or matrices!");
+
+			return {};
+		}
+
+		return checkCountedRange(stack);
+	}
+
+	void ReductionCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		size_t n{ stack.size() };
+		if (m_range == Range::TopN)
+		{
+			m_count = *stack.pop(false);
+			n = static_cast<size_t>(m_count);
+		}
+
+		stack.pop(n, m_operands, false);
+		stack.push(reduce(m_operands.data(), m_operands.size()));
+	}
+
+	void ReductionCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		stack.pop(false);
+		stack.push(std::move(m_operands), m_range == Range::Stack);
+		if (m_range == Range::TopN)
+			stack.push(m_count);
+	}
+
+	void ReductionCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_count);
+		archive.field(m_operands);
+	}
+
+	SumCommand::SumCommand(const SumCommand& c) :ReductionCommand(c)
+	{
+	}
+
+	SumCommand::~SumCommand()
+	{
+	}
+
+	double SumCommand::reduce(const double* first, size_t n) const noexcept
+	{
+		return utility::reduceSum(first, n);
+	}
+
+	SumCommand* SumCommand::cloneImpl() const
+	{
+		return new SumCommand{ *this };
+	}
+
+	const char* SumCommand::getHelpMessageImpl() const noexcept
+	{
+		if (getRange() == Range::Stack)
+			return "Replace all the elements on the stack with their sum";
+		else
+			return "Pop n, then replace the top n elements with their sum";
+	}
+
+	ProductCommand::ProductCommand(const ProductCommand& c) :ReductionCommand(c)
+	{
+	}
+
+	ProductCommand::~ProductCommand()
+	{
+	}
+
+	double ProductCommand::reduce(const double* first, size_t n) const noexcept
+	{
+		return utility::reduceProduct(first, n);
+	}
+
+	ProductCommand* ProductCommand::cloneImpl() const
+	{
+		return new ProductCommand{ *this };
+	}
+
+	const char* ProductCommand::getHelpMessageImpl() const noexcept
+	{
+		if (getRange() == Range::Stack)
+			return "Replace all the elements on the stack with their product";
+		else
+			return "Pop n, then replace the top n elements with their product";
+	}
+
+	MeanCommand::MeanCommand(const MeanCommand& c) :ReductionCommand(c)
+	{
+	}
+
+	MeanCommand::~MeanCommand()
+	{
+	}
+
+	double MeanCommand::reduce(const double* first, size_t n) const noexcept
+	{
+		return utility::reduceSum(first, n) / static_cast<double>(n);
+	}
+
+	MeanCommand* MeanCommand::cloneImpl() const
+	{
+		return new MeanCommand{ *this };
+	}
+
+	const char* MeanCommand::getHelpMessageImpl() const noexcept
+	{
+		if (getRange() == Range::Stack)
+			return "Replace all the elements on the stack with their mean";
+		else
+			return "Pop n, then replace the top n elements with their mean";
+	}
+
+	MinCommand::MinCommand(const MinCommand& c) :ReductionCommand(c)
+	{
+	}
+
+	MinCommand::~MinCommand()
+	{
+	}
+
+	double MinCommand::reduce(const double* first, size_t n) const noexcept
+	{
+		return utility::reduceMin(first, n);
+	}
+
+	MinCommand* MinCommand::cloneImpl() const
+	{
+		return new MinCommand{ *this };
+	}
+
+	const char* MinCommand::getHelpMessageImpl() const noexcept
+	{
+		if (getRange() == Range::Stack)
+			return "Replace all the elements on the stack with their minimum";
+		else
+			return "Pop n, then replace the top n elements with their minimum";
+	}
+
+	MaxCommand::MaxCommand(const MaxCommand& c) :ReductionCommand(c)
+	{
+	}
+
+	MaxCommand::~MaxCommand()
+	{
+	}
+
+	double MaxCommand::reduce(const double* first, size_t n) const noexcept
+	{
+		return utility::reduceMax(first, n);
+	}
+
+	MaxCommand* MaxCommand::cloneImpl() const
+	{
+		return new MaxCommand{ *this };
+	}
+
+	const char* MaxCommand::getHelpMessageImpl() const noexcept
+	{
+		if (getRange() == Range::Stack)
+			return "Replace all the elements on the stack with their maximum";
+		else
+			return "Pop n, then replace the top n elements with their maximum";
+	}
+
+	NormCommand::NormCommand(const NormCommand& c) :ReductionCommand(c)
+	{
+	}
+
+	NormCommand::~NormCommand()
+	{
+	}
+
+	double NormCommand::reduce(const double* first, size_t n) const noexcept
+	{
+		return std::sqrt(utility::reduceSumOfSquares(first, n));
+	}
+
+	NormCommand* NormCommand::cloneImpl() const
+	{
+		return new NormCommand{ *this };
+	}
+
+	const char* NormCommand::getHelpMessageImpl() const noexcept
+	{
+		if (getRange() == Range::Stack)
+			return "Replace all the elements on the stack with their euclidean norm";
+		else
+			return "Pop n, then replace the top n elements with their euclidean norm";
+	}
+
+	PackCommand::PackCommand(const PackCommand& c) :Command(c), m_count{ c.m_count }
+	{
+	}
+
+	PackCommand::~PackCommand()
+	{
+	}
+
+	PackCommand* PackCommand::cloneImpl() const
+	{
+		return new PackCommand{ *this };
+	}
+
+	utility::Status PackCommand::checkPreConditionImpl() const
+	{
+		return checkCountedRange(model::Stack::getInstance());
+	}
+
+	const char* PackCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Pop n, then pack the top n numbers into one vector";
+	}
+
+	void PackCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		m_count = *stack.pop(false);
+
+		std::vector<double> elements;
+		stack.pop(static_cast<size_t>(m_count), elements, false);
+		stack.push(Value{ makeArray(elements.data(), elements.size()) });
+	}
+
+	void PackCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		auto v = *stack.popValue(false);
+		const Array& a = *v.getArray();
+		stack.push(std::vector<double>(a.data(), a.data() + a.size()), false);
+		stack.push(m_count);
+	}
+
+	void PackCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_count);
+	}
+
+	UnpackCommand::UnpackCommand(const UnpackCommand& c) :Command(c)
+	{
+	}
+
+	UnpackCommand::~UnpackCommand()
+	{
+	}
+
+	UnpackCommand* UnpackCommand::cloneImpl() const
+	{
+		return new UnpackCommand{ *this };
+	}
+
+	utility::Status UnpackCommand::checkPreConditionImpl() const
+	{
+		auto& stack = model::Stack::getInstance();
+		if (stack.size() < 1 || !stack.topValue()->isVector())
+			return utility::Status::failure("Warning: the top of the stack must be a vector!");
+
+		return {};
+	}
+
+	const char* UnpackCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Replace the vector on top with its elements followed by their count";
+	}
+
+	void UnpackCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		auto v = *stack.popValue(false);
+		const Array& a = *v.getArray();
+		stack.push(std::vector<double>(a.data(), a.data() + a.size()), false);
+		stack.push(static_cast<double>(a.size()));
+	}
+
+	void UnpackCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		size_t n{ static_cast<size_t>(*stack.pop(false)) };
+
+		std::vector<double> elements;
+		stack.pop(n, elements, false);
+		stack.push(Value{ makeArray(elements.data(), elements.size()) });
+	}
+
+	ReshapeCommand::ReshapeCommand(const ReshapeCommand& c) :Command(c), m_count{ c.m_count }
+	{
+	}
+
+	ReshapeCommand::~ReshapeCommand()
+	{
+	}
+
+	ReshapeCommand* ReshapeCommand::cloneImpl() const
+	{
+		return new ReshapeCommand{ *this };
+	}
+
+	utility::Status ReshapeCommand::checkPreConditionImpl() const
+	{
+		auto& stack = model::Stack::getInstance();
+		if (stack.size() < 2)
+			return utility::Status::failure("Warning: Stack must have a vector and the column count!");
+
+		auto v = stack.getValues(2);
+		double c{ v[0].getScalar() };
+		if (!v[0].isScalar() || c < 1.0 || c != std::floor(c))
+			return utility::Status::failure("Warning: the column count must be a positive integer!");
+
+		if (!v[1].isVector())
+			return utility::Status::failure("Warning: only a vector can be reshaped into a matrix!");
+
+		if (v[1].getArray()->size() % static_cast<size_t>(c) != 0)
+			return utility::Status::failure("Warning: the vector length must be a multiple of the column count!");
+
+		return {};
+	}
+
+	const char* ReshapeCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Pop c, then reshape the vector on top into a matrix with c columns";
+	}
+
+	void ReshapeCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		m_count = *stack.pop(false);
+		auto v = *stack.popValue(false);
+		stack.push(Value{ v.getArray(), static_cast<size_t>(m_count) });
+	}
+
+	void ReshapeCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		auto v = *stack.popValue(false);
+		stack.push(Value{ v.getArray() }, false);
+		stack.push(m_count);
+	}
+
+	void ReshapeCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_count);
+	}
+
+	FlattenCommand::FlattenCommand(const FlattenCommand& c) :Command(c)
+	{
+	}
+
+	FlattenCommand::~FlattenCommand()
+	{
+	}
+
+	FlattenCommand* FlattenCommand::cloneImpl() const
+	{
+		return new FlattenCommand{ *this };
+	}
+
+	utility::Status FlattenCommand::checkPreConditionImpl() const
+	{
+		auto& stack = model::Stack::getInstance();
+		if (stack.size() < 1 || !stack.topValue()->isMatrix())
+			return utility::Status::failure("Warning: the top of the stack must be a matrix!");
+
+		return {};
+	}
+
+	const char* FlattenCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Replace the matrix on top with the vector of its rows followed by its column count";
+	}
+
+	void FlattenCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		auto v = *stack.popValue(false);
+		stack.push(Value{ v.getArray() }, false);
+		stack.push(static_cast<double>(v.getCols()));
+	}
+
+	void FlattenCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		size_t c{ static_cast<size_t>(*stack.pop(false)) };
+		auto v = *stack.popValue(false);
+		stack.push(Value{ v.getArray(), c });
+	}
+
+	TransposeCommand::TransposeCommand(const TransposeCommand& c) :Command(c), m_operand{ c.m_operand }
+	{
+	}
+
+	TransposeCommand::~TransposeCommand()
+	{
+	}
+
+	TransposeCommand* TransposeCommand::cloneImpl() const
+	{
+		return new TransposeCommand{ *this };
+	}
+
+	utility::Status TransposeCommand::checkPreConditionImpl() const
+	{
+		auto& stack = model::Stack::getInstance();
+		if (stack.size() < 1 || !stack.topValue()->isMatrix())
+			return utility::Status::failure("Warning: the top of the stack must be a matrix!");
+
+		return {};
+	}
+
+	const char* TransposeCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Replace the matrix on top with its transpose";
+	}
+
+	void TransposeCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		m_operand = *stack.popValue(false);
+
+		size_t rows{ m_operand.getRows() }, cols{ m_operand.getCols() };
+		auto out = std::make_shared<Array>(rows * cols);
+		utility::transposeMatrix(m_operand.getArray()->data(), out->data(), rows, cols);
+		stack.push(Value{ std::move(out), rows });
+	}
+
+	void TransposeCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		stack.pop(false);
+		stack.push(m_operand);
+	}
+
+	void TransposeCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_operand);
+	}
+
+	MatrixCommand::MatrixCommand(const MatrixCommand& rhs) :Command(rhs), m_stackTop{ rhs.m_stackTop }, m_stackNext{ rhs.m_stackNext }
+	{
+	}
+
+	utility::Status MatrixCommand::checkPreConditionImpl() const
+	{
+		auto& stack = model::Stack::getInstance();
+		if (stack.size() < 2)
+			return utility::Status::failure("Warning: Stack must have at least 2 elements!");
+
+		auto v = stack.getValues(2);
+		if (!v[1].isMatrix() || v[0].isScalar())
+			return utility::Status::failure("Warning: needs a matrix below a vector or matrix!");
+
+		return {};
+	}
+
+	void MatrixCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		m_stackTop = *stack.popValue(false);
+		m_stackNext = *stack.popValue(false);
+		stack.push(matrixOperation(m_stackNext, m_stackTop));
+	}
+
+	void MatrixCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		stack.pop(false);
+		stack.push(m_stackNext, false);
+		stack.push(m_stackTop);
+	}
+
+	void MatrixCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_stackTop);
+		archive.field(m_stackNext);
+	}
+
+	MatMulCommand::MatMulCommand(const MatMulCommand& c) :MatrixCommand(c)
+	{
+	}
+
+	MatMulCommand::~MatMulCommand()
+	{
+	}
+
+	model::Value MatMulCommand::matrixOperation(const model::Value& next, const model::Value& top) const noexcept
+	{
+		size_t m{ next.getRows() }, k{ next.getCols() }, n{ top.getCols() };
+		auto out = std::make_shared<Array>(m * n);
+		utility::multiplyMatrices(next.getArray()->data(), top.getArray()->data(), out->data(), m, k, n);
+
+		// a matrix times a vector is a vector
+		return top.isVector() ? Value{ std::move(out) } : Value{ std::move(out), n };
+	}
+
+	MatMulCommand* MatMulCommand::cloneImpl() const
+	{
+		return new MatMulCommand{ *this };
+	}
+
+	utility::Status MatMulCommand::checkPreConditionImpl() const
+	{
+		auto status = MatrixCommand::checkPreConditionImpl();
+		if (!status) return status;
+
+		auto v = model::Stack::getInstance().getValues(2);
+		if (v[1].getCols() != v[0].getRows())
+			return utility::Status::failure("Warning: the columns of the matrix must match the rows of the top element!");
+
+		return {};
+	}
+
+	const char* MatMulCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Replace the top two elements, a matrix and a vector or matrix, with their matrix product";
+	}
+
+	SolveCommand::SolveCommand(const SolveCommand& c) :MatrixCommand(c), m_lu{}, m_pivots{}
+	{
+	}
+
+	SolveCommand::~SolveCommand()
+	{
+	}
+
+	model::Value SolveCommand::matrixOperation(const model::Value& next, const model::Value& top) const noexcept
+	{
+		size_t n{ next.getRows() }, nrhs{ top.getCols() };
+		const double* b{ top.getArray()->data() };
+		auto out = makeArray(b, n * nrhs);
+		utility::solveLU(m_lu.data(), m_pivots.data(), out->data(), n, nrhs);
+
+		// a redo runs the precondition and factors again
+		m_lu = std::vector<double>{};
+		m_pivots = std::vector<size_t>{};
+		return top.withArray(std::move(out));
+	}
+
+	SolveCommand* SolveCommand::cloneImpl() const
+	{
+		return new SolveCommand{ *this };
+	}
+
+	utility::Status SolveCommand::checkPreConditionImpl() const
+	{
+		auto status = MatrixCommand::checkPreConditionImpl();
+		if (!status) return status;
+
+		auto v = model::Stack::getInstance().getValues(2);
+		size_t n{ v[1].getRows() };
+		if (v[1].getCols() != n)
+			return utility::Status::failure("Warning: the matrix must be square!");
+
+		if (v[0].getRows() != n)
+			return utility::Status::failure("Warning: the right hand side must have as many rows as the matrix!");
+
+		const Array& a = *v[1].getArray();
+		m_lu.assign(a.data(), a.data() + a.size());
+		m_pivots.resize(n);
+		if (!utility::factorLU(m_lu.data(), m_pivots.data(), n))
+			return utility::Status::failure("Warning: the matrix is singular!");
+
+		return {};
+	}
+
+	const char* SolveCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Replace a matrix a and the vector or matrix b on top with the solution x of a x = b";
+	}
+
+	SortCommand::SortCommand(const SortCommand& c) :Command(c), m_original{ c.m_original }
+	{
+	}
+
+	SortCommand::~SortCommand()
+	{
+	}
+
+	SortCommand* SortCommand::cloneImpl() const
+	{
+		return new SortCommand{ *this };
+	}
+
+	utility::Status SortCommand::checkPreConditionImpl() const
+	{
+		auto& stack = model::Stack::getInstance();
+		if (stack.size() < 1)
+			return utility::Status::failure("Warning: Stack must have at least one Element!");
+
+		if (stack.hasArrays(stack.size()))
+			return utility::Status::failure("Warning: the elements must be numbers, not vectors or matrices!");
+
+		return {};
+	}
+
+	const char* SortCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Sort the stack ascending, the largest element on top";
+	}
+
+	void SortCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		std::vector<double> v;
+		stack.pop(stack.size(), v, false);
+
+		m_original = v;
+		utility::sortAscending(v.data(), v.size());
+		stack.push(std::move(v));
+	}
+
+	void SortCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		std::vector<double> sorted;
+		stack.pop(stack.size(), sorted, false);
+		stack.push(std::move(m_original));
+	}
+
+	void SortCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_original);
+	}
+
+	TopKCommand::TopKCommand(const TopKCommand& c) :Command(c), m_count{ c.m_count }, m_original{ c.m_original }
+	{
+	}
+
+	TopKCommand::~TopKCommand()
+	{
+	}
+
+	TopKCommand* TopKCommand::cloneImpl() const
+	{
+		return new TopKCommand{ *this };
+	}
+
+	utility::Status TopKCommand::checkPreConditionImpl() const
+	{
+		auto& stack = model::Stack::getInstance();
+		auto status = checkCountedRange(stack);
+		if (!status) return status;
+
+		if (stack.hasArrays(stack.size()))
+			return utility::Status::failure("Warning: the elements must be numbers, not vectors or matrices!");
+
+		return {};
+	}
+
+	const char* TopKCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Pop k, then keep only the k largest elements of the stack, sorted with the largest on top";
+	}
+
+	void TopKCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		m_count = *stack.pop(false);
+		size_t k{ static_cast<size_t>(m_count) };
+
+		std::vector<double> v;
+		stack.pop(stack.size(), v, false);
+
+		m_original = v;
+		utility::selectLargest(v.data(), v.size(), k);
+		v.erase(v.begin(), v.end() - k);
+		stack.push(std::move(v));
+	}
+
+	void TopKCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		std::vector<double> largest;
+		stack.pop(stack.size(), largest, false);
+		stack.push(std::move(m_original), false);
+		stack.push(m_count);
+	}
+
+	void TopKCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_count);
+		archive.field(m_original);
+	}
+
+	QuantileCommand::QuantileCommand(const QuantileCommand& c)
+		:Command(c), m_mode{ c.m_mode }, m_percent{ c.m_percent }, m_operands{ c.m_operands }
+	{
+	}
+
+	QuantileCommand::~QuantileCommand()
+	{
+	}
+
+	QuantileCommand* QuantileCommand::cloneImpl() const
+	{
+		return new QuantileCommand{ *this };
+	}
+
+	utility::Status QuantileCommand::checkPreConditionImpl() const
+	{
+		auto& stack = model::Stack::getInstance();
+		if (m_mode == Mode::Percentile)
+		{
+			if (stack.size() < 2)
+				return utility::Status::failure("Warning: Stack must have the percentile p and at least one Element!");
+
+			double p{ stack.top() };
+			if (!(p >= 0.0 && p <= 100.0))
+				return utility::Status::failure("Warning: the percentile p must be between 0 and 100!");
+		}
+		else if (stack.size() < 1)
+			return utility::Status::failure("Warning: Stack must have at least one Element!");
+
+		if (stack.hasArrays(stack.size()))
+			return utility::Status::failure("Warning: the elements must be numbers, not vectors or matrices!");
+
+		return {};
+	}
+
+	const char* QuantileCommand::getHelpMessageImpl() const noexcept
+	{
+		if (m_mode == Mode::Median)
+			return "Replace all the elements on the stack with their median";
+		else
+			return "Pop p, then replace all the elements on the stack with their p-th percentile";
+	}
+
+	void QuantileCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		double p{ 0.5 };
+		if (m_mode == Mode::Percentile)
+		{
+			m_percent = *stack.pop(false);
+			p = m_percent / 100.0;
+		}
+
+		// the selection reorders its input, the operands stay as they were for undo
+		stack.pop(stack.size(), m_operands, false);
+		std::vector<double> scratch{ m_operands };
+		stack.push(utility::selectQuantile(scratch.data(), scratch.size(), p));
+	}
+
+	void QuantileCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		stack.pop(false);
+		stack.push(std::move(m_operands), m_mode == Mode::Median);
+		if (m_mode == Mode::Percentile)
+			stack.push(m_percent);
+	}
+
+	void QuantileCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_percent);
+		archive.field(m_operands);
+	}
+
+	SeriesCommand::SeriesCommand(const SeriesCommand& rhs)
+		:Command(rhs), m_range{ rhs.m_range }, m_count{ rhs.m_count }, m_operands{ rhs.m_operands }
+	{
+	}
+
+	utility::Status SeriesCommand::checkPreConditionImpl() const
+	{
+		auto& stack = model::Stack::getInstance();
+		if (m_range == Range::Window)
+		{
+			auto status = checkCountedRange(stack);
+			if (!status) return status;
+		}
+		else if (stack.size() < 1)
+			return utility::Status::failure("Warning: Stack must have at least one Element!");
+
+		if (stack.hasArrays(stack.size()))
+			return utility::Status::failure("Warning: the elements must be numbers, not vectors or matrices!");
+
+		return {};
+	}
+
+	void SeriesCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		size_t w{ 1 };
+		if (m_range == Range::Window)
+		{
+			m_count = *stack.pop(false);
+			w = static_cast<size_t>(m_count);
+		}
+
+		// the old storage becomes the undo record as it is, only the new
+		// series is allocated: undo needs every operand back, a running sum
+		// does not give them back exactly and a window not at all, so the
+		// series cannot overwrite them
+		stack.pop(stack.size(), m_operands, false);
+		std::vector<double> series(m_operands.size() - w + 1);
+		transform(m_operands.data(), series.data(), m_operands.size(), w);
+		stack.push(std::move(series));
+	}
+
+	void SeriesCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		std::vector<double> series;
+		stack.pop(stack.size(), series, false);
+		stack.push(std::move(m_operands), m_range == Range::Stack);
+		if (m_range == Range::Window)
+			stack.push(m_count);
+	}
+
+	void SeriesCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_count);
+		archive.field(m_operands);
+	}
+
+	CumulativeSumCommand::CumulativeSumCommand(const CumulativeSumCommand& c) :SeriesCommand(c)
+	{
+	}
+
+	CumulativeSumCommand::~CumulativeSumCommand()
+	{
+	}
+
+	void CumulativeSumCommand::transform(const double* in, double* out, size_t n, size_t /*w*/) const noexcept
+	{
+		utility::prefixSum(in, out, n);
+	}
+
+	CumulativeSumCommand* CumulativeSumCommand::cloneImpl() const
+	{
+		return new CumulativeSumCommand{ *this };
+	}
+
+	const char* CumulativeSumCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Replace every element with the sum of the elements below it and itself";
+	}
+
+	CumulativeProductCommand::CumulativeProductCommand(const CumulativeProductCommand& c) :SeriesCommand(c)
+	{
+	}
+
+	CumulativeProductCommand::~CumulativeProductCommand()
+	{
+	}
+
+	void CumulativeProductCommand::transform(const double* in, double* out, size_t n, size_t /*w*/) const noexcept
+	{
+		utility::prefixProduct(in, out, n);
+	}
+
+	CumulativeProductCommand* CumulativeProductCommand::cloneImpl() const
+	{
+		return new CumulativeProductCommand{ *this };
+	}
+
+	const char* CumulativeProductCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Replace every element with the product of the elements below it and itself";
+	}
+
+	WindowSumCommand::WindowSumCommand(const WindowSumCommand& c) :SeriesCommand(c)
+	{
+	}
+
+	WindowSumCommand::~WindowSumCommand()
+	{
+	}
+
+	void WindowSumCommand::transform(const double* in, double* out, size_t n, size_t w) const noexcept
+	{
+		utility::windowSum(in, out, n, w);
+	}
+
+	WindowSumCommand* WindowSumCommand::cloneImpl() const
+	{
+		return new WindowSumCommand{ *this };
+	}
+
+	const char* WindowSumCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Pop n, then replace the stack with the sums of its windows of n consecutive elements";
+	}
+
+	WindowMeanCommand::WindowMeanCommand(const WindowMeanCommand& c) :SeriesCommand(c)
+	{
+	}
+
+	WindowMeanCommand::~WindowMeanCommand()
+	{
+	}
+
+	void WindowMeanCommand::transform(const double* in, double* out, size_t n, size_t w) const noexcept
+	{
+		utility::windowSum(in, out, n, w);
+		utility::applyBroadcastRight(utility::BinaryOp::Divide, out, static_cast<double>(w), out, n - w + 1);
+	}
+
+	WindowMeanCommand* WindowMeanCommand::cloneImpl() const
+	{
+		return new WindowMeanCommand{ *this };
+	}
+
+	const char* WindowMeanCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Pop n, then replace the stack with the means of its windows of n consecutive elements";
+	}
+
+	WindowMinCommand::WindowMinCommand(const WindowMinCommand& c) :SeriesCommand(c)
+	{
+	}
+
+	WindowMinCommand::~WindowMinCommand()
+	{
+	}
+
+	void WindowMinCommand::transform(const double* in, double* out, size_t n, size_t w) const noexcept
+	{
+		utility::windowMin(in, out, n, w);
+	}
+
+	WindowMinCommand* WindowMinCommand::cloneImpl() const
+	{
+		return new WindowMinCommand{ *this };
+	}
+
+	const char* WindowMinCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Pop n, then replace the stack with the minima of its windows of n consecutive elements";
+	}
+
+	WindowMaxCommand::WindowMaxCommand(const WindowMaxCommand& c) :SeriesCommand(c)
+	{
+	}
+
+	WindowMaxCommand::~WindowMaxCommand()
+	{
+	}
+
+	void WindowMaxCommand::transform(const double* in, double* out, size_t n, size_t w) const noexcept
+	{
+		utility::windowMax(in, out, n, w);
+	}
+
+	WindowMaxCommand* WindowMaxCommand::cloneImpl() const
+	{
+		return new WindowMaxCommand{ *this };
+	}
+
+	const char* WindowMaxCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Pop n, then replace the stack with the maxima of its windows of n consecutive elements";
+	}
+
+	GeneratorCommand::GeneratorCommand(const GeneratorCommand& rhs)
+		:Command(rhs), m_arity{ rhs.m_arity }, m_arguments{ rhs.m_arguments }, m_count{ rhs.m_count }
+	{
+	}
+
+	utility::Status GeneratorCommand::checkPreConditionImpl() const
+	{
+		auto& stack = model::Stack::getInstance();
+		if (stack.size() < m_arity)
+			return utility::Status::failure("Warning: Stack has too few arguments for this command!");
+
+		if (stack.hasArrays(m_arity))
+			return utility::Status::failure("Warning: the arguments must be numbers, not vectors or matrices!");
+
+		std::vector<double> arguments{ stack.getElements(m_arity) };
+		std::reverse(arguments.begin(), arguments.end());
+		return count(arguments.data()).status();
+	}
+
+	void GeneratorCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		m_arguments.clear();
+		stack.pop(m_arity, m_arguments, false);
+		m_count = *count(m_arguments.data());
+
+		stack.generate(m_count, [this](double* out) { generate(m_arguments.data(), out, m_count); });
+	}
+
+	void GeneratorCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		stack.drop(m_count, false);
+		stack.push(std::move(m_arguments));
+	}
+
+	void GeneratorCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_arguments);
+		archive.field(m_count);
+	}
+
+	IotaCommand::IotaCommand(const IotaCommand& c) :GeneratorCommand(c)
+	{
+	}
+
+	IotaCommand::~IotaCommand()
+	{
+	}
+
+	utility::Expected<size_t> IotaCommand::count(const double* args) const
+	{
+		double a{ args[0] }, b{ args[1] }, step{ args[2] };
+		if (!std::isfinite(a) || !std::isfinite(b) || !std::isfinite(step) || step == 0.0)
+			return utility::Status::failure("Warning: a, b and the step must be finite and the step not zero!");
+
+		// a little slack so that a step like 0.1 still reaches b
+		double steps{ (b - a) / step };
+		if (steps < -eps)
+			return utility::Status::failure("Warning: the step must lead from a towards b!");
+
+		return checkGeneratedCount(std::floor(std::max(steps, 0.0) + eps) + 1.0);
+	}
+
+	void IotaCommand::generate(const double* args, double* out, size_t n)noexcept
+	{
+		utility::generateLinear(args[0], args[2], out, n);
+	}
+
+	IotaCommand* IotaCommand::cloneImpl() const
+	{
+		return new IotaCommand{ *this };
+	}
+
+	const char* IotaCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Pop a, b and step, then push a, a + step, ... up to b";
+	}
+
+	FillCommand::FillCommand(const FillCommand& c) :GeneratorCommand(c)
+	{
+	}
+
+	FillCommand::~FillCommand()
+	{
+	}
+
+	utility::Expected<size_t> FillCommand::count(const double* args) const
+	{
+		return checkGeneratedCount(args[0]);
+	}
+
+	void FillCommand::generate(const double* args, double* out, size_t n)noexcept
+	{
+		utility::generateConstant(args[1], out, n);
+	}
+
+	FillCommand* FillCommand::cloneImpl() const
+	{
+		return new FillCommand{ *this };
+	}
+
+	const char* FillCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Pop n and x, then push n copies of x";
+	}
+
+	RandomCommand::RandomCommand(const RandomCommand& c)
+		:GeneratorCommand(c), m_mode{ c.m_mode }, m_drawn{ c.m_drawn }, m_seed{ c.m_seed }, m_counter{ c.m_counter }
+	{
+	}
+
+	RandomCommand::~RandomCommand()
+	{
+	}
+
+	utility::Expected<size_t> RandomCommand::count(const double* args) const
+	{
+		if (m_mode == Mode::Seeded)
+		{
+			double seed{ args[1] };
+			if (seed < 0.0 || seed != std::floor(seed) || seed >= 18446744073709551616.0)
+				return utility::Status::failure("Warning: the seed must be a non negative integer below 2^64!");
+		}
+
+		return checkGeneratedCount(args[0]);
+	}
+
+	void RandomCommand::serializeImpl(Archive& archive)
+	{
+		GeneratorCommand::serializeImpl(archive);
+		archive.field(m_drawn);
+		archive.field(m_seed);
+		archive.field(m_counter);
+	}
+
+	void RandomCommand::serializeInputImpl(Archive& archive)
+	{
+		// the part of the stream drawn, the numbers themselves are not kept
+		archive.field(m_drawn);
+		archive.field(m_seed);
+		archive.field(m_counter);
+	}
+
+	void RandomCommand::generate(const double* args, double* out, size_t n)noexcept
+	{
+		// the part of the stream is fixed the first time, so redo brings the
+		// same numbers back
+		if (!m_drawn)
+		{
+			if (m_mode == Mode::Seeded)
+			{
+				m_seed = static_cast<std::uint64_t>(args[1]);
+				m_counter = 0;
+			}
+			else
+			{
+				auto& stream = sessionStream();
+				m_seed = stream.seed;
+				m_counter = stream.next;
+				stream.next += n;
+			}
+			m_drawn = true;
+		}
+
+		utility::generateUniform(m_seed, m_counter, out, n);
+	}
+
+	RandomCommand* RandomCommand::cloneImpl() const
+	{
+		return new RandomCommand{ *this };
+	}
+
+	const char* RandomCommand::getHelpMessageImpl() const noexcept
+	{
+		if (m_mode == Mode::Stream)
+			return "Pop n, then push n random numbers uniform in [0, 1) from the session's stream";
+		else
+			return "Pop n and seed, then push the first n random numbers uniform in [0, 1) of that seed";
+	}
+
+	LoadCommand::LoadCommand(const LoadCommand& c)
+		:Command(c), m_path{ c.m_path }, m_numbers{ c.m_numbers }, m_count{ c.m_count }
+	{
+	}
+
+	LoadCommand::~LoadCommand()
+	{
+	}
+
+	LoadCommand* LoadCommand::cloneImpl() const
+	{
+		return new LoadCommand{ *this };
+	}
+
+	bool LoadCommand::takesArgumentImpl() const noexcept
+	{
+		return true;
+	}
+
+	void LoadCommand::setArgumentImpl(const std::string& path)
+	{
+		m_path = path;
+	}
+
+	utility::Status LoadCommand::checkPreConditionImpl() const
+	{
+		if (m_count > 0)
+			return {};
+
+		// what is wrong with the file is thrown, like what readNumbers finds
+		utility::readNumbers(m_path, m_numbers);
+		if (m_numbers.empty())
+			throw utility::Exception("Warning: " + m_path + " holds no numbers!");
+
+		m_count = m_numbers.size();
+
+		return {};
+	}
+
+	const char* LoadCommand::getHelpMessageImpl() const noexcept
+	{
+		return "Push the numbers of the file whose path follows, raw little endian doubles for a .bin path, text otherwise";
+	}
+
+	void LoadCommand::executeImpl()noexcept
+	{
+		model::Stack::getInstance().push(std::move(m_numbers));
+	}
+
+	void LoadCommand::undoImpl()noexcept
+	{
+		m_numbers.clear();
+		model::Stack::getInstance().pop(m_count, m_numbers);
+	}
+
+	void LoadCommand::serializeImpl(Archive& archive)
+	{
+		archive.field(m_path);
+		archive.field(m_numbers);
+		archive.field(m_count);
+	}
+
+	void LoadCommand::serializeInputImpl(Archive& archive)
+	{
+		// the file is read again
+		archive.field(m_path);
+	}
+
+	CommandPtr MacroCommand::compile(const std::vector<std::string>& tokens)
+	{
+		std::vector<CommandPtr> steps;
+		for (size_t i = 0; i < tokens.size(); ++i)
+		{
+			std::string name{ tokens[i] };
+			std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+			double d;
+			if (utility::parseNumber(name, d))
+			{
+				steps.push_back(MakeCommandPtr<EnterNumber>(d));
+				continue;
+			}
+
+			auto c = CommandRepository::getInstance().getCommandByName(name);
+			if (!c)
+				throw utility::Exception("Warning: " + tokens[i] + " is not a command a macro can run");
+
+			if (c->takesArgument())
+			{
+				if (i + 1 == tokens.size())
+					throw utility::Exception("Warning: " + tokens[i] + " needs an argument");
+				c->setArgument(tokens[++i]);
+			}
+			steps.push_back(std::move(c));
+		}
+
+		if (steps.empty())
+			throw utility::Exception("Warning: a macro needs at least one command");
+
+		return MakeCommandPtr(new MacroCommand{ tokens, std::move(steps) });
+	}
+
+	MacroCommand::MacroCommand(const std::vector<std::string>& tokens, std::vector<CommandPtr> steps)
+		:Command{}, m_tokens{ tokens }, m_steps{ std::move(steps) }, m_help{ "Run the macro:" }, m_failure{}, m_thrown{}
+	{
+		for (const auto& t : m_tokens)
+			m_help += " " + t;
+	}
+
+	MacroCommand::MacroCommand(const MacroCommand& c)
+		:Command(c), m_tokens{ c.m_tokens }, m_steps{}, m_help{ c.m_help }, m_failure{}, m_thrown{}
+	{
+		m_steps.reserve(c.m_steps.size());
+		for (const auto& step : c.m_steps)
+			m_steps.push_back(MakeCommandPtr(step->clone()));
+	}
+
+	MacroCommand::~MacroCommand()
+	{
+	}
+
+	const std::vector<std::string>& MacroCommand::getTokens() const
+	{
+		return m_tokens;
+	}
+
+	MacroCommand* MacroCommand::cloneImpl() const
+	{
+		return new MacroCommand{ *this };
+	}
+
+	utility::Status MacroCommand::checkPostConditionImpl() const
+	{
+		if (!m_thrown.empty())
+			throw utility::Exception(m_thrown);
+
+		return m_failure;
+	}
+
+	const char* MacroCommand::getHelpMessageImpl() const noexcept
+	{
+		return m_help.c_str();
+	}
+
+	void MacroCommand::executeImpl()noexcept
+	{
+		// a step checks its own preconditions, which only hold once the steps
+		// before it have run; one that fails is reported by the postcondition
+		auto& stack = model::Stack::getInstance();
+		stack.holdChanges();
+
+		m_failure = {};
+		m_thrown.clear();
+		size_t done{ 0 };
+		try
+		{
+			for (; done < m_steps.size() && m_failure; ++done)
+				m_failure = m_steps[done]->execute();
+			if (!m_failure) --done;
+		}
+		catch (utility::Exception& e)
+		{
+			m_thrown = e.what();
+		}
+
+		bool failed{ !m_failure || !m_thrown.empty() };
+		if (failed)
+		{
+			while (done > 0)
+				m_steps[--done]->undo();
+		}
+
+		stack.releaseChanges(!failed);
+	}
+
+	void MacroCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		stack.holdChanges();
+
+		for (auto step = m_steps.rbegin(); step != m_steps.rend(); ++step)
+			(*step)->undo();
+
+		stack.releaseChanges();
+	}
+
+	void MacroCommand::serializeImpl(Archive& archive)
+	{
+		// the steps as they ran, even if the macro has been defined again since
+		std::vector<std::string> tokens{ m_tokens };
+		archive.field(tokens);
+		if (archive.isLoading() && tokens != m_tokens)
+		{
+			auto compiled = compile(tokens);
+			auto& macro = static_cast<MacroCommand&>(*compiled);
+			m_tokens.swap(macro.m_tokens);
+			m_steps.swap(macro.m_steps);
+			m_help.swap(macro.m_help);
+		}
+
+		for (auto& step : m_steps)
+			step->serialize(archive);
+	}
+
+	void MacroCommand::serializeInputImpl(Archive& archive)
+	{
+		for (auto& step : m_steps)
+			step->serializeInput(archive);
+	}
+	CommandPtr FunctionCommand::compile(const std::vector<std::string>& tokens)
+	{
+		auto program = std::make_shared<const Program>(tokens, &FunctionCommand::find);
+		return MakeCommandPtr(new FunctionCommand{ tokens, std::move(program) });
+	}
+
+	std::shared_ptr<const Program> FunctionCommand::find(const std::string& name)
+	{
+		// the functions defined before are looked up by their prototypes
+		auto c = CommandRepository::getInstance().getCommandByName(name);
+		auto function = dynamic_cast<FunctionCommand*>(c.get());
+		return function ? function->m_program : nullptr;
+	}
+
+	FunctionCommand::FunctionCommand(const std::vector<std::string>& tokens, std::shared_ptr<const Program> program)
+		:Command{}, m_tokens{ tokens }, m_program{ std::move(program) }, m_help{ "Run the function:" }, m_results{}, m_consumed{}, m_taken{}
+	{
+		for (const auto& t : m_tokens)
+			m_help += " " + t;
+	}
+
+	FunctionCommand::FunctionCommand(const FunctionCommand& c)
+		:Command(c), m_tokens{ c.m_tokens }, m_program{ c.m_program }, m_help{ c.m_help }, m_results{}, m_consumed{}, m_taken{}
+	{
+	}
+
+	FunctionCommand::~FunctionCommand()
+	{
+	}
+
+	const std::vector<std::string>& FunctionCommand::getTokens() const
+	{
+		return m_tokens;
+	}
+
+	FunctionCommand* FunctionCommand::cloneImpl() const
+	{
+		return new FunctionCommand{ *this };
+	}
+
+	utility::Status FunctionCommand::checkPreConditionImpl() const
+	{
+		// the elements under the ones the program pushed are read from the
+		// stack when it first reaches for them, a growing piece at a time
+		auto& stack = model::Stack::getInstance();
+		std::vector<double> window;
+		auto below = [&](size_t k) -> utility::Expected<double>
+		{
+			if (k >= window.size())
+			{
+				size_t n{ std::min(stack.size(), std::max<size_t>(16, 2 * (k + 1))) };
+				if (k >= n)
+					return utility::Status::failure("Warning: Stack has too few elements for the function!");
+				if (stack.hasArrays(n))
+					return utility::Status::failure("Warning: the function works on numbers, not vectors or matrices!");
+				// getElements appends, the window is read again from the top
+				window.clear();
+				stack.getElements(n, window);
+			}
+			return window[k];
+		};
+
+		std::vector<double> results;
+		auto consumed = m_program->run(results, below);
+		if (!consumed) return consumed.status();
+
+		m_consumed = *consumed;
+		m_results.swap(results);
+
+		return {};
+	}
+
+	const char* FunctionCommand::getHelpMessageImpl() const noexcept
+	{
+		return m_help.c_str();
+	}
+
+	void FunctionCommand::executeImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		stack.holdChanges();
+
+		stack.pop(m_consumed, m_taken);
+		std::vector<double> results{ m_results };
+		stack.push(std::move(results));
+
+		stack.releaseChanges();
+	}
+
+	void FunctionCommand::undoImpl()noexcept
+	{
+		auto& stack = model::Stack::getInstance();
+		stack.holdChanges();
+
+		stack.drop(m_results.size());
+		std::vector<double> taken{ m_taken };
+		stack.push(std::move(taken));
+
+		stack.releaseChanges();
+	}
+
+	void FunctionCommand::serializeImpl(Archive& archive)
+	{
+		// the function as it ran, even if it has been defined again since
+		std::vector<std::string> tokens{ m_tokens };
+		archive.field(tokens);
+		if (archive.isLoading() && tokens != m_tokens)
+		{
+			auto compiled = compile(tokens);
+			auto& function = static_cast<FunctionCommand&>(*compiled);
+			m_tokens.swap(function.m_tokens);
+			m_program.swap(function.m_program);
+			m_help.swap(function.m_help);
+		}
+
+		archive.field(m_results);
+		archive.field(m_consumed);
+		archive.field(m_taken);
+	}
 }
\ No newline at end of file
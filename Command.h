@@ -22,11 +22,25 @@
 
 #ifndef COMMAND_H
 #define COMMAND_H
+#include<cstdint>
 #include<memory>
-#include<stack>
+#include<string>
+#include<vector>
+
+#include"Kernels.h"
+#include"Status.h"
+#include"Value.h"
+#include"VectorMath.h"
+
+namespace model
+{
+	class Archive;
+}
 
 namespace control
 {
+	class Program;
+
 	// The Command Hierarchy
 	class Command
 	{
@@ -34,22 +48,43 @@ namespace control
 		virtual~Command() = default;
 		virtual void deallocate();
 
-		void execute();
+		// runs the command if its preconditions hold, otherwise it reports why
+		// not and leaves the stack as it was
+		utility::Status execute();
 		void undo();
 
 		// The Prototyp pattern
 		Command* clone()const;
 		const char* getHelpMessage()const;
 
+		// a command like "load <path>" takes the next input token as its
+		// argument, the dispatcher hands it over before executing the command
+		bool takesArgument()const;
+		void setArgument(const std::string&);
+
+		// the name the command is registered under, so a snapshot of the
+		// history can find its prototype again
+		const std::string& getName()const;
+		void setName(const std::string&);
+
+		// saves the state kept for undo and redo into a snapshot, or loads it
+		// back into a fresh clone of the prototype
+		void serialize(model::Archive&);
+
+		// saves or loads what execute takes besides the stack, like the number
+		// entered or the path loaded, so a journal can run the command again
+		void serializeInput(model::Archive&);
+
 	protected:
 		// only the children of this class are allowed to call this Command Class.
 		Command() = default;
 		Command(const Command&) = default;
 
 	private:
-		// check some precondition before execute this Command
-		virtual void checkPostConditionImpl()const;
-		virtual void checkPreConditionImpl()const;
+		// check some precondition before execute this Command, a failure is
+		// returned with a static message
+		virtual utility::Status checkPostConditionImpl()const;
+		virtual utility::Status checkPreConditionImpl()const;
 
 	private:
 		// NVI Pattern, This are the methode to be overriden by the children
@@ -57,6 +92,12 @@ namespace control
 		virtual void undoImpl()noexcept = 0;			// atomic function (commit-or roll back)
 		virtual Command* cloneImpl()const = 0;
 		virtual const char* getHelpMessageImpl()const noexcept = 0; // atomic function (commit-or roll back)
+		virtual bool takesArgumentImpl()const noexcept;
+		virtual void setArgumentImpl(const std::string&);
+		virtual void serializeImpl(model::Archive&);
+		virtual void serializeInputImpl(model::Archive&);
+
+		std::string m_name;
 
 	private:
 		// uneeded Capabiliies
@@ -74,20 +115,28 @@ namespace control
 	private:
 		virtual void executeImpl()noexcept override;
 		virtual void undoImpl()noexcept override;
+		virtual void serializeImpl(model::Archive&) override;
 
 		// needed for the children of this class
 		virtual double unaryOperation(double)const noexcept = 0;
 
+		// a vector element is mapped element by element; children with a bulk
+		// kernel override this
+		virtual void unaryOperation(const double* in, double* out, size_t n)const noexcept;
+
+		// the function the command evaluates, which lazy mode defers on arrays
+		virtual utility::MathFunction getFunction()const noexcept = 0;
+
 		// not needed in this hierarchy
 		// virtual Command* cloneImpl()const override; 
 		// virtual const char* getHelpMessageImpl()const override;
 
-		double m_stackTop;
+		model::Value m_stackTop;
 
 	protected:
 
-		virtual void checkPostConditionImpl()const override;
-		virtual void checkPreConditionImpl()const override;
+		virtual utility::Status checkPostConditionImpl()const override;
+		virtual utility::Status checkPreConditionImpl()const override;
 
 		UnaryCommand() = default;
 		UnaryCommand(const UnaryCommand&);
@@ -108,22 +157,29 @@ namespace control
 		BinaryCommand() :m_stackNext{}, m_stackTop{}{};
 		BinaryCommand(const BinaryCommand&);
 
-		virtual void checkPostConditionImpl()const override;
-		virtual void checkPreConditionImpl()const override;
+		virtual utility::Status checkPostConditionImpl()const override;
+		virtual utility::Status checkPreConditionImpl()const override;
 
 	private:
 		virtual void executeImpl()noexcept override;
 		virtual void undoImpl()noexcept override;
+		virtual void serializeImpl(model::Archive&) override;
 
 		// needed for the children of this class
 		virtual double binaryOperation(double d, double b)const noexcept = 0;
 
+		// the kernel used when one of the operands is a vector or a matrix: a
+		// scalar operand is broadcast over it, two operands of the same shape are
+		// combined element wise
+		virtual utility::BinaryOp getOperator()const noexcept = 0;
+		model::Value binaryOperation(const model::Value& next, const model::Value& top)const noexcept;
+
 		// not needed in this hierarchy
 		// virtual Command* cloneImpl()const override; 
 		// virtual const char* getHelpMessageImpl()const override;
 	private:
-		double m_stackTop;
-		double m_stackNext;
+		model::Value m_stackTop;
+		model::Value m_stackNext;
 
 	private:
 		BinaryCommand(BinaryCommand&&) = delete;
@@ -136,6 +192,8 @@ namespace control
 	{
 	public:
 		double unaryOperation(double)const noexcept override;
+		void unaryOperation(const double* in, double* out, size_t n)const noexcept override;
+		utility::MathFunction getFunction()const noexcept override;
 		CosineCommand() = default;
 
 		// needed for the Clone operation
@@ -158,6 +216,8 @@ namespace control
 	{
 	public:
 		double unaryOperation(double)const noexcept override;
+		void unaryOperation(const double* in, double* out, size_t n)const noexcept override;
+		utility::MathFunction getFunction()const noexcept override;
 		ACosineCommand() = default;
 
 		// needed for the Clone operation
@@ -180,6 +240,8 @@ namespace control
 	{
 	public:
 		double unaryOperation(double)const noexcept override;
+		void unaryOperation(const double* in, double* out, size_t n)const noexcept override;
+		utility::MathFunction getFunction()const noexcept override;
 		SineCommand() = default;
 
 		// needed for the Clone operation
@@ -202,6 +264,8 @@ namespace control
 	{
 	public:
 		double unaryOperation(double)const noexcept override;
+		void unaryOperation(const double* in, double* out, size_t n)const noexcept override;
+		utility::MathFunction getFunction()const noexcept override;
 		ASineCommand() = default;
 		explicit ASineCommand(const ASineCommand& s);
 		~ASineCommand();
@@ -222,6 +286,8 @@ namespace control
 	{
 	public:
 		double unaryOperation(double)const noexcept override;
+		void unaryOperation(const double* in, double* out, size_t n)const noexcept override;
+		utility::MathFunction getFunction()const noexcept override;
 		TangentCommand() = default;
 		explicit TangentCommand(const TangentCommand& s);
 		~TangentCommand();
@@ -231,7 +297,7 @@ namespace control
 		// from the base Class
 		TangentCommand* cloneImpl()const override;
 		const char* getHelpMessageImpl()const noexcept override;
-		void checkPreConditionImpl()const override;
+		utility::Status checkPreConditionImpl()const override;
 	
 	private:
 		TangentCommand(TangentCommand&&) = delete;
@@ -244,6 +310,8 @@ namespace control
 	{
 	public:
 		double unaryOperation(double)const noexcept override;
+		void unaryOperation(const double* in, double* out, size_t n)const noexcept override;
+		utility::MathFunction getFunction()const noexcept override;
 		ATangentCommand() = default;
 		explicit ATangentCommand(const ATangentCommand& s);
 		~ATangentCommand();
@@ -278,6 +346,7 @@ namespace control
 		AddCommand& operator=(AddCommand&&) = delete;
 
 		double binaryOperation(double next, double top) const noexcept override;
+		utility::BinaryOp getOperator() const noexcept override;
 
 		AddCommand* cloneImpl() const override;
 
@@ -298,6 +367,7 @@ namespace control
 		SubstractCommand& operator=(SubstractCommand&&) = delete;
 
 		double binaryOperation(double next, double top) const noexcept override;
+		utility::BinaryOp getOperator() const noexcept override;
 
 		SubstractCommand* cloneImpl() const override;
 
@@ -318,6 +388,7 @@ namespace control
 		MultiplyCommand& operator=(MultiplyCommand&&) = delete;
 
 		double binaryOperation(double next, double top) const noexcept override;
+		utility::BinaryOp getOperator() const noexcept override;
 
 		MultiplyCommand* cloneImpl() const override;
 
@@ -334,8 +405,9 @@ namespace control
 
 	private:
 		double binaryOperation(double next, double top) const noexcept override;
+		utility::BinaryOp getOperator() const noexcept override;
 		DivideCommand* cloneImpl() const override;
-		void checkPreConditionImpl()const override;
+		utility::Status checkPreConditionImpl()const override;
 		const char* getHelpMessageImpl() const noexcept override;
 
 	private:
@@ -353,7 +425,7 @@ namespace control
 
 	private:
 		SwapCommand* cloneImpl() const override;
-		void checkPreConditionImpl()const override;
+		utility::Status checkPreConditionImpl()const override;
 		const char* getHelpMessageImpl() const noexcept override;
 		void executeImpl()noexcept override;
 		void undoImpl()noexcept override;
@@ -367,7 +439,7 @@ namespace control
 	class ClearCommand : public Command
 	{
 	public:
-		ClearCommand() :m_stack_{} { }
+		ClearCommand() :m_values_{} { }
 		explicit ClearCommand(const ClearCommand&);
 		~ClearCommand();
 
@@ -376,9 +448,10 @@ namespace control
 		const char* getHelpMessageImpl() const noexcept override;
 		void executeImpl()noexcept override;
 		void undoImpl()noexcept override;
+		void serializeImpl(model::Archive&) override;
 
 	private:
-		std::stack<double> m_stack_;
+		std::vector<model::Value> m_values_;	// top of stack first
 
 	private:
 		ClearCommand(ClearCommand&&) = delete;
@@ -396,23 +469,749 @@ namespace control
 	private:
 		DropCommand* cloneImpl() const override;
 		const char* getHelpMessageImpl() const noexcept override;
+		utility::Status checkPreConditionImpl()const override;
 		void executeImpl()noexcept override;
 		void undoImpl()noexcept override;
+		void serializeImpl(model::Archive&) override;
 
 	private:
-		double m_droppedNumber_;
+		model::Value m_droppedNumber_;
 	private:
 		DropCommand(DropCommand&&) = delete;
 		DropCommand& operator=(const DropCommand&) = delete;
 		DropCommand& operator=(DropCommand&&) = delete;
 	};
 
+	// Reductions collapse a range of the stack, either the whole stack or the top n
+	// elements (n taken from the top of the stack), into a single number. The removed
+	// elements are kept so that one undo puts them all back.
+	class ReductionCommand : public Command
+	{
+	public:
+		enum class Range { Stack, TopN };
+		virtual~ReductionCommand() = default;
+
+	protected:
+		explicit ReductionCommand(Range r) :m_range{ r }, m_count{} {}
+		ReductionCommand(const ReductionCommand&);
+
+		Range getRange()const { return m_range; }
+		virtual utility::Status checkPreConditionImpl()const override;
+
+	private:
+		virtual void executeImpl()noexcept override;
+		virtual void undoImpl()noexcept override;
+		virtual void serializeImpl(model::Archive&) override;
+
+		// needed for the children of this class
+		virtual double reduce(const double* first, size_t n)const noexcept = 0;
+
+	private:
+		Range m_range;
+		double m_count;
+		std::vector<double> m_operands;
+
+	private:
+		ReductionCommand(ReductionCommand&&) = delete;
+		ReductionCommand& operator=(const ReductionCommand&) = delete;
+		ReductionCommand& operator=(ReductionCommand&&) = delete;
+	};
+
+	// sum of the elements
+	class SumCommand : public ReductionCommand
+	{
+	public:
+		explicit SumCommand(Range r = Range::Stack) :ReductionCommand{ r } { }
+		explicit SumCommand(const SumCommand&);
+		~SumCommand();
+
+	private:
+		double reduce(const double* first, size_t n)const noexcept override;
+		SumCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		SumCommand(SumCommand&&) = delete;
+		SumCommand& operator=(const SumCommand&) = delete;
+		SumCommand& operator=(SumCommand&&) = delete;
+	};
+
+	// product of the elements
+	class ProductCommand : public ReductionCommand
+	{
+	public:
+		explicit ProductCommand(Range r = Range::Stack) :ReductionCommand{ r } { }
+		explicit ProductCommand(const ProductCommand&);
+		~ProductCommand();
+
+	private:
+		double reduce(const double* first, size_t n)const noexcept override;
+		ProductCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		ProductCommand(ProductCommand&&) = delete;
+		ProductCommand& operator=(const ProductCommand&) = delete;
+		ProductCommand& operator=(ProductCommand&&) = delete;
+	};
+
+	// arithmetic mean of the elements
+	class MeanCommand : public ReductionCommand
+	{
+	public:
+		explicit MeanCommand(Range r = Range::Stack) :ReductionCommand{ r } { }
+		explicit MeanCommand(const MeanCommand&);
+		~MeanCommand();
+
+	private:
+		double reduce(const double* first, size_t n)const noexcept override;
+		MeanCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		MeanCommand(MeanCommand&&) = delete;
+		MeanCommand& operator=(const MeanCommand&) = delete;
+		MeanCommand& operator=(MeanCommand&&) = delete;
+	};
+
+	// smallest element
+	class MinCommand : public ReductionCommand
+	{
+	public:
+		explicit MinCommand(Range r = Range::Stack) :ReductionCommand{ r } { }
+		explicit MinCommand(const MinCommand&);
+		~MinCommand();
+
+	private:
+		double reduce(const double* first, size_t n)const noexcept override;
+		MinCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		MinCommand(MinCommand&&) = delete;
+		MinCommand& operator=(const MinCommand&) = delete;
+		MinCommand& operator=(MinCommand&&) = delete;
+	};
+
+	// largest element
+	class MaxCommand : public ReductionCommand
+	{
+	public:
+		explicit MaxCommand(Range r = Range::Stack) :ReductionCommand{ r } { }
+		explicit MaxCommand(const MaxCommand&);
+		~MaxCommand();
+
+	private:
+		double reduce(const double* first, size_t n)const noexcept override;
+		MaxCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		MaxCommand(MaxCommand&&) = delete;
+		MaxCommand& operator=(const MaxCommand&) = delete;
+		MaxCommand& operator=(MaxCommand&&) = delete;
+	};
+
+	// euclidean norm of the elements
+	class NormCommand : public ReductionCommand
+	{
+	public:
+		explicit NormCommand(Range r = Range::Stack) :ReductionCommand{ r } { }
+		explicit NormCommand(const NormCommand&);
+		~NormCommand();
+
+	private:
+		double reduce(const double* first, size_t n)const noexcept override;
+		NormCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		NormCommand(NormCommand&&) = delete;
+		NormCommand& operator=(const NormCommand&) = delete;
+		NormCommand& operator=(NormCommand&&) = delete;
+	};
+
+	// packs the top n numbers (n taken from the top of the stack) into one vector
+	// element. Undo unpacks the vector again, so nothing but n is kept.
+	class PackCommand : public Command
+	{
+	public:
+		PackCommand() :m_count{} { }
+		explicit PackCommand(const PackCommand&);
+		~PackCommand();
+
+	private:
+		PackCommand* cloneImpl() const override;
+		utility::Status checkPreConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+		void executeImpl()noexcept override;
+		void undoImpl()noexcept override;
+		void serializeImpl(model::Archive&) override;
+
+	private:
+		double m_count;
+
+	private:
+		PackCommand(PackCommand&&) = delete;
+		PackCommand& operator=(const PackCommand&) = delete;
+		PackCommand& operator=(PackCommand&&) = delete;
+	};
+
+	// replaces the vector on top of the stack with its elements followed by their count
+	class UnpackCommand : public Command
+	{
+	public:
+		UnpackCommand() { }
+		explicit UnpackCommand(const UnpackCommand&);
+		~UnpackCommand();
+
+	private:
+		UnpackCommand* cloneImpl() const override;
+		utility::Status checkPreConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+		void executeImpl()noexcept override;
+		void undoImpl()noexcept override;
+
+	private:
+		UnpackCommand(UnpackCommand&&) = delete;
+		UnpackCommand& operator=(const UnpackCommand&) = delete;
+		UnpackCommand& operator=(UnpackCommand&&) = delete;
+	};
+
+	// reshapes the vector below a column count c (taken from the top of the
+	// stack) into a matrix of c columns; the elements are shared, not copied
+	class ReshapeCommand : public Command
+	{
+	public:
+		ReshapeCommand() :m_count{} { }
+		explicit ReshapeCommand(const ReshapeCommand&);
+		~ReshapeCommand();
+
+	private:
+		ReshapeCommand* cloneImpl() const override;
+		utility::Status checkPreConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+		void executeImpl()noexcept override;
+		void undoImpl()noexcept override;
+		void serializeImpl(model::Archive&) override;
+
+	private:
+		double m_count;
+
+	private:
+		ReshapeCommand(ReshapeCommand&&) = delete;
+		ReshapeCommand& operator=(const ReshapeCommand&) = delete;
+		ReshapeCommand& operator=(ReshapeCommand&&) = delete;
+	};
+
+	// the inverse of ReshapeCommand: the matrix on top becomes the vector of
+	// its elements followed by its column count
+	class FlattenCommand : public Command
+	{
+	public:
+		FlattenCommand() { }
+		explicit FlattenCommand(const FlattenCommand&);
+		~FlattenCommand();
+
+	private:
+		FlattenCommand* cloneImpl() const override;
+		utility::Status checkPreConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+		void executeImpl()noexcept override;
+		void undoImpl()noexcept override;
+
+	private:
+		FlattenCommand(FlattenCommand&&) = delete;
+		FlattenCommand& operator=(const FlattenCommand&) = delete;
+		FlattenCommand& operator=(FlattenCommand&&) = delete;
+	};
+
+	class TransposeCommand : public Command
+	{
+	public:
+		TransposeCommand() { }
+		explicit TransposeCommand(const TransposeCommand&);
+		~TransposeCommand();
+
+	private:
+		TransposeCommand* cloneImpl() const override;
+		utility::Status checkPreConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+		void executeImpl()noexcept override;
+		void undoImpl()noexcept override;
+		void serializeImpl(model::Archive&) override;
+
+	private:
+		model::Value m_operand;
+
+	private:
+		TransposeCommand(TransposeCommand&&) = delete;
+		TransposeCommand& operator=(const TransposeCommand&) = delete;
+		TransposeCommand& operator=(TransposeCommand&&) = delete;
+	};
+
+	// Linear algebra on the top two elements: unlike the BinaryCommands these
+	// are not element wise, the children check the shapes and compute the
+	// result, this class keeps both operands for undo
+	class MatrixCommand : public Command
+	{
+	public:
+		virtual~MatrixCommand() = default;
+
+	protected:
+		MatrixCommand() = default;
+		MatrixCommand(const MatrixCommand&);
+
+		virtual utility::Status checkPreConditionImpl()const override;
+
+	private:
+		virtual void executeImpl()noexcept override;
+		virtual void undoImpl()noexcept override;
+		virtual void serializeImpl(model::Archive&) override;
+
+		// needed for the children of this class
+		virtual model::Value matrixOperation(const model::Value& next, const model::Value& top)const noexcept = 0;
+
+	private:
+		model::Value m_stackTop;
+		model::Value m_stackNext;
+
+	private:
+		MatrixCommand(MatrixCommand&&) = delete;
+		MatrixCommand& operator=(const MatrixCommand&) = delete;
+		MatrixCommand& operator=(MatrixCommand&&) = delete;
+	};
+
+	// matrix product of the next (m x k) and the top (k x n matrix or k vector)
+	class MatMulCommand : public MatrixCommand
+	{
+	public:
+		MatMulCommand() { }
+		explicit MatMulCommand(const MatMulCommand&);
+		~MatMulCommand();
+
+	private:
+		model::Value matrixOperation(const model::Value& next, const model::Value& top)const noexcept override;
+		MatMulCommand* cloneImpl() const override;
+		utility::Status checkPreConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		MatMulCommand(MatMulCommand&&) = delete;
+		MatMulCommand& operator=(const MatMulCommand&) = delete;
+		MatMulCommand& operator=(MatMulCommand&&) = delete;
+	};
+
+	// solves a x = b for the square matrix a (next) and b (top, a vector or a
+	// matrix of right hand sides). The factorization is done by the
+	// precondition, which has to reject singular matrices anyway, and reused
+	class SolveCommand : public MatrixCommand
+	{
+	public:
+		SolveCommand() { }
+		explicit SolveCommand(const SolveCommand&);
+		~SolveCommand();
+
+	private:
+		model::Value matrixOperation(const model::Value& next, const model::Value& top)const noexcept override;
+		SolveCommand* cloneImpl() const override;
+		utility::Status checkPreConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		mutable std::vector<double> m_lu;
+		mutable std::vector<size_t> m_pivots;
+
+	private:
+		SolveCommand(SolveCommand&&) = delete;
+		SolveCommand& operator=(const SolveCommand&) = delete;
+		SolveCommand& operator=(SolveCommand&&) = delete;
+	};
+
+	// Order statistics over the whole stack. The commands take the storage out
+	// of the stack, rework it in place and hand it back, so only the undo
+	// record costs a copy.
+
+	// sorts the stack ascending, the largest element ends up on top
+	class SortCommand : public Command
+	{
+	public:
+		SortCommand() :m_original{} { }
+		explicit SortCommand(const SortCommand&);
+		~SortCommand();
+
+	private:
+		SortCommand* cloneImpl() const override;
+		utility::Status checkPreConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+		void executeImpl()noexcept override;
+		void undoImpl()noexcept override;
+		void serializeImpl(model::Archive&) override;
+
+	private:
+		std::vector<double> m_original;
+
+	private:
+		SortCommand(SortCommand&&) = delete;
+		SortCommand& operator=(const SortCommand&) = delete;
+		SortCommand& operator=(SortCommand&&) = delete;
+	};
+
+	// pops k and keeps only the k largest elements of the stack, sorted
+	class TopKCommand : public Command
+	{
+	public:
+		TopKCommand() :m_count{}, m_original{} { }
+		explicit TopKCommand(const TopKCommand&);
+		~TopKCommand();
+
+	private:
+		TopKCommand* cloneImpl() const override;
+		utility::Status checkPreConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+		void executeImpl()noexcept override;
+		void undoImpl()noexcept override;
+		void serializeImpl(model::Archive&) override;
+
+	private:
+		double m_count;
+		std::vector<double> m_original;
+
+	private:
+		TopKCommand(TopKCommand&&) = delete;
+		TopKCommand& operator=(const TopKCommand&) = delete;
+		TopKCommand& operator=(TopKCommand&&) = delete;
+	};
+
+	// replaces the stack with its median, or with its percentile p (0 to 100)
+	// taken from the top of the stack
+	class QuantileCommand : public Command
+	{
+	public:
+		enum class Mode { Median, Percentile };
+		explicit QuantileCommand(Mode m = Mode::Median) :m_mode{ m }, m_percent{}, m_operands{} { }
+		explicit QuantileCommand(const QuantileCommand&);
+		~QuantileCommand();
+
+	private:
+		QuantileCommand* cloneImpl() const override;
+		utility::Status checkPreConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+		void executeImpl()noexcept override;
+		void undoImpl()noexcept override;
+		void serializeImpl(model::Archive&) override;
+
+	private:
+		Mode m_mode;
+		double m_percent;
+		std::vector<double> m_operands;
+
+	private:
+		QuantileCommand(QuantileCommand&&) = delete;
+		QuantileCommand& operator=(const QuantileCommand&) = delete;
+		QuantileCommand& operator=(QuantileCommand&&) = delete;
+	};
+
+	// Series over the whole stack: every element is replaced by a running
+	// value of the elements up to it (Range::Stack), or the stack by the values
+	// of its windows of n consecutive elements, n popped first (Range::Window).
+	// The new series is written next to the old one, which is kept for undo.
+	class SeriesCommand : public Command
+	{
+	public:
+		enum class Range { Stack, Window };
+		virtual~SeriesCommand() = default;
+
+	protected:
+		explicit SeriesCommand(Range r) :m_range{ r }, m_count{}, m_operands{} {}
+		SeriesCommand(const SeriesCommand&);
+
+		Range getRange()const { return m_range; }
+		virtual utility::Status checkPreConditionImpl()const override;
+
+	private:
+		virtual void executeImpl()noexcept override;
+		virtual void undoImpl()noexcept override;
+		virtual void serializeImpl(model::Archive&) override;
+
+		// needed for the children of this class: out holds n elements for
+		// Range::Stack and n - w + 1 for Range::Window
+		virtual void transform(const double* in, double* out, size_t n, size_t w)const noexcept = 0;
+
+	private:
+		Range m_range;
+		double m_count;
+		std::vector<double> m_operands;
+
+	private:
+		SeriesCommand(SeriesCommand&&) = delete;
+		SeriesCommand& operator=(const SeriesCommand&) = delete;
+		SeriesCommand& operator=(SeriesCommand&&) = delete;
+	};
+
+	// running sum, the element n becomes the sum of the elements 1 to n
+	class CumulativeSumCommand : public SeriesCommand
+	{
+	public:
+		CumulativeSumCommand() :SeriesCommand{ Range::Stack } { }
+		explicit CumulativeSumCommand(const CumulativeSumCommand&);
+		~CumulativeSumCommand();
+
+	private:
+		void transform(const double* in, double* out, size_t n, size_t w)const noexcept override;
+		CumulativeSumCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		CumulativeSumCommand(CumulativeSumCommand&&) = delete;
+		CumulativeSumCommand& operator=(const CumulativeSumCommand&) = delete;
+		CumulativeSumCommand& operator=(CumulativeSumCommand&&) = delete;
+	};
+
+	// running product
+	class CumulativeProductCommand : public SeriesCommand
+	{
+	public:
+		CumulativeProductCommand() :SeriesCommand{ Range::Stack } { }
+		explicit CumulativeProductCommand(const CumulativeProductCommand&);
+		~CumulativeProductCommand();
+
+	private:
+		void transform(const double* in, double* out, size_t n, size_t w)const noexcept override;
+		CumulativeProductCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		CumulativeProductCommand(CumulativeProductCommand&&) = delete;
+		CumulativeProductCommand& operator=(const CumulativeProductCommand&) = delete;
+		CumulativeProductCommand& operator=(CumulativeProductCommand&&) = delete;
+	};
+
+	// sums of the windows of n elements
+	class WindowSumCommand : public SeriesCommand
+	{
+	public:
+		WindowSumCommand() :SeriesCommand{ Range::Window } { }
+		explicit WindowSumCommand(const WindowSumCommand&);
+		~WindowSumCommand();
+
+	private:
+		void transform(const double* in, double* out, size_t n, size_t w)const noexcept override;
+		WindowSumCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		WindowSumCommand(WindowSumCommand&&) = delete;
+		WindowSumCommand& operator=(const WindowSumCommand&) = delete;
+		WindowSumCommand& operator=(WindowSumCommand&&) = delete;
+	};
+
+	// means of the windows of n elements
+	class WindowMeanCommand : public SeriesCommand
+	{
+	public:
+		WindowMeanCommand() :SeriesCommand{ Range::Window } { }
+		explicit WindowMeanCommand(const WindowMeanCommand&);
+		~WindowMeanCommand();
+
+	private:
+		void transform(const double* in, double* out, size_t n, size_t w)const noexcept override;
+		WindowMeanCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		WindowMeanCommand(WindowMeanCommand&&) = delete;
+		WindowMeanCommand& operator=(const WindowMeanCommand&) = delete;
+		WindowMeanCommand& operator=(WindowMeanCommand&&) = delete;
+	};
+
+	// minima of the windows of n elements
+	class WindowMinCommand : public SeriesCommand
+	{
+	public:
+		WindowMinCommand() :SeriesCommand{ Range::Window } { }
+		explicit WindowMinCommand(const WindowMinCommand&);
+		~WindowMinCommand();
+
+	private:
+		void transform(const double* in, double* out, size_t n, size_t w)const noexcept override;
+		WindowMinCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		WindowMinCommand(WindowMinCommand&&) = delete;
+		WindowMinCommand& operator=(const WindowMinCommand&) = delete;
+		WindowMinCommand& operator=(WindowMinCommand&&) = delete;
+	};
+
+	// maxima of the windows of n elements
+	class WindowMaxCommand : public SeriesCommand
+	{
+	public:
+		WindowMaxCommand() :SeriesCommand{ Range::Window } { }
+		explicit WindowMaxCommand(const WindowMaxCommand&);
+		~WindowMaxCommand();
+
+	private:
+		void transform(const double* in, double* out, size_t n, size_t w)const noexcept override;
+		WindowMaxCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		WindowMaxCommand(WindowMaxCommand&&) = delete;
+		WindowMaxCommand& operator=(const WindowMaxCommand&) = delete;
+		WindowMaxCommand& operator=(WindowMaxCommand&&) = delete;
+	};
+
+	// Bulk generators: the arguments are popped and the new elements are
+	// written straight into the stack storage in one step. Undo drops them
+	// and gives the arguments back.
+	class GeneratorCommand : public Command
+	{
+	public:
+		virtual~GeneratorCommand() = default;
+
+	protected:
+		explicit GeneratorCommand(size_t arity) :m_arity{ arity }, m_arguments{}, m_count{} {}
+		GeneratorCommand(const GeneratorCommand&);
+
+		virtual void serializeImpl(model::Archive&) override;
+
+	private:
+		virtual utility::Status checkPreConditionImpl()const override;
+		virtual void executeImpl()noexcept override;
+		virtual void undoImpl()noexcept override;
+
+		// needed for the children of this class, args holds the arguments with
+		// the deepest first. count returns how many elements they ask for or
+		// why they are invalid; the precondition calls it first
+		virtual utility::Expected<size_t> count(const double* args)const = 0;
+		virtual void generate(const double* args, double* out, size_t n)noexcept = 0;
+
+	private:
+		size_t m_arity;
+		std::vector<double> m_arguments;
+		size_t m_count;
+
+	private:
+		GeneratorCommand(GeneratorCommand&&) = delete;
+		GeneratorCommand& operator=(const GeneratorCommand&) = delete;
+		GeneratorCommand& operator=(GeneratorCommand&&) = delete;
+	};
+
+	// a, a + step, ... up to b
+	class IotaCommand : public GeneratorCommand
+	{
+	public:
+		IotaCommand() :GeneratorCommand{ 3 } { }
+		explicit IotaCommand(const IotaCommand&);
+		~IotaCommand();
+
+	private:
+		utility::Expected<size_t> count(const double* args)const override;
+		void generate(const double* args, double* out, size_t n)noexcept override;
+		IotaCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		IotaCommand(IotaCommand&&) = delete;
+		IotaCommand& operator=(const IotaCommand&) = delete;
+		IotaCommand& operator=(IotaCommand&&) = delete;
+	};
+
+	// n copies of x
+	class FillCommand : public GeneratorCommand
+	{
+	public:
+		FillCommand() :GeneratorCommand{ 2 } { }
+		explicit FillCommand(const FillCommand&);
+		~FillCommand();
+
+	private:
+		utility::Expected<size_t> count(const double* args)const override;
+		void generate(const double* args, double* out, size_t n)noexcept override;
+		FillCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+
+	private:
+		FillCommand(FillCommand&&) = delete;
+		FillCommand& operator=(const FillCommand&) = delete;
+		FillCommand& operator=(FillCommand&&) = delete;
+	};
+
+	// n uniform random numbers in [0, 1), from the session's stream or from
+	// the start of the stream of a seed popped after n
+	class RandomCommand : public GeneratorCommand
+	{
+	public:
+		enum class Mode { Stream, Seeded };
+		explicit RandomCommand(Mode m = Mode::Stream)
+			:GeneratorCommand{ m == Mode::Seeded ? size_t{ 2 } : size_t{ 1 } }, m_mode{ m }, m_drawn{ false }, m_seed{}, m_counter{} { }
+		explicit RandomCommand(const RandomCommand&);
+		~RandomCommand();
+
+	private:
+		utility::Expected<size_t> count(const double* args)const override;
+		void generate(const double* args, double* out, size_t n)noexcept override;
+		RandomCommand* cloneImpl() const override;
+		const char* getHelpMessageImpl() const noexcept override;
+		void serializeImpl(model::Archive&) override;
+		void serializeInputImpl(model::Archive&) override;
+
+	private:
+		Mode m_mode;
+		bool m_drawn;
+		std::uint64_t m_seed;
+		std::uint64_t m_counter;
+
+	private:
+		RandomCommand(RandomCommand&&) = delete;
+		RandomCommand& operator=(const RandomCommand&) = delete;
+		RandomCommand& operator=(RandomCommand&&) = delete;
+	};
+
+	// load <path>: pushes the numbers of a text file, or of a file of raw
+	// little endian doubles, in the order of the file
+	class LoadCommand : public Command
+	{
+	public:
+		LoadCommand() :m_path{}, m_numbers{}, m_count{} { }
+		explicit LoadCommand(const LoadCommand&);
+		~LoadCommand();
+
+	private:
+		LoadCommand* cloneImpl() const override;
+		utility::Status checkPreConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+		bool takesArgumentImpl()const noexcept override;
+		void setArgumentImpl(const std::string&) override;
+		void executeImpl()noexcept override;
+		void undoImpl()noexcept override;
+		void serializeImpl(model::Archive&) override;
+		void serializeInputImpl(model::Archive&) override;
+
+	private:
+		std::string m_path;
+		// the file is read by the precondition, the place where a command may
+		// fail; after an undo the numbers wait here for redo
+		mutable std::vector<double> m_numbers;
+		mutable size_t m_count;
+
+	private:
+		LoadCommand(LoadCommand&&) = delete;
+		LoadCommand& operator=(const LoadCommand&) = delete;
+		LoadCommand& operator=(LoadCommand&&) = delete;
+	};
+
 	// Other Concrete Command
 	// accepts a number from input and adds it to the stack
 	// no preconditions are necessary for this command
 	class EnterNumber : public Command
 	{
 	public:
+		// not registered, the dispatcher makes one for each number entered
+		static const std::string Name;
+
 		explicit EnterNumber(double d);
 		explicit EnterNumber(const EnterNumber&);
 		~EnterNumber();
@@ -423,6 +1222,8 @@ namespace control
 
 		// removes the number from the stack
 		void undoImpl() noexcept override;
+		void serializeImpl(model::Archive&) override;
+		void serializeInputImpl(model::Archive&) override;
 		EnterNumber* cloneImpl() const override;
 		const char* getHelpMessageImpl() const noexcept override;
 
@@ -454,6 +1255,89 @@ namespace control
 	{
 		return CommandPtr{ p, &CommandDeleter };
 	}
+
+	// record <name> ... end: the commands in between run as one, with one
+	// entry in the undo history and one change event of the stack. A step
+	// that fails undoes the ones before it and the macro fails with it
+	class MacroCommand : public Command
+	{
+	public:
+		// the tokens as they were entered: numbers, commands and the arguments
+		// of the commands taking one, looked up once here; throws on anything else
+		static CommandPtr compile(const std::vector<std::string>& tokens);
+
+		explicit MacroCommand(const MacroCommand&);
+		~MacroCommand();
+
+		const std::vector<std::string>& getTokens()const;
+
+	private:
+		MacroCommand(const std::vector<std::string>& tokens, std::vector<CommandPtr> steps);
+
+		MacroCommand* cloneImpl() const override;
+		utility::Status checkPostConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+		void executeImpl()noexcept override;
+		void undoImpl()noexcept override;
+		void serializeImpl(model::Archive&) override;
+		void serializeInputImpl(model::Archive&) override;
+
+	private:
+		std::vector<std::string> m_tokens;
+		std::vector<CommandPtr> m_steps;
+		std::string m_help;
+		utility::Status m_failure;	// of the last execution, returned by the postcondition
+		std::string m_thrown;		// or a fault a step threw, thrown again there
+
+	private:
+		MacroCommand(MacroCommand&&) = delete;
+		MacroCommand& operator=(const MacroCommand&) = delete;
+		MacroCommand& operator=(MacroCommand&&) = delete;
+	};
+
+	// def <name> ... end: a function, compiled into a Program that runs as one
+	// step on the numbers at the top of the stack; the ones it uses up are
+	// replaced by the ones it leaves, with one change event of the stack
+	class FunctionCommand : public Command
+	{
+	public:
+		// the tokens as they were entered; throws if they do not compile
+		static CommandPtr compile(const std::vector<std::string>& tokens);
+
+		// the program of the function registered as name, null if there is
+		// none; what the functions compiled later copy in
+		static std::shared_ptr<const Program> find(const std::string& name);
+
+		explicit FunctionCommand(const FunctionCommand&);
+		~FunctionCommand();
+
+		const std::vector<std::string>& getTokens()const;
+
+	private:
+		FunctionCommand(const std::vector<std::string>& tokens, std::shared_ptr<const Program> program);
+
+		FunctionCommand* cloneImpl() const override;
+		utility::Status checkPreConditionImpl()const override;
+		const char* getHelpMessageImpl() const noexcept override;
+		void executeImpl()noexcept override;
+		void undoImpl()noexcept override;
+		void serializeImpl(model::Archive&) override;
+
+	private:
+		std::vector<std::string> m_tokens;
+		std::shared_ptr<const Program> m_program;	// shared by the clones
+		std::string m_help;
+		// the program runs in the precondition, the place where a command may
+		// fail; execute then swaps the elements it took for the ones it left
+		mutable std::vector<double> m_results;
+		mutable size_t m_consumed;
+		std::vector<double> m_taken;
+
+	private:
+		FunctionCommand(FunctionCommand&&) = delete;
+		FunctionCommand& operator=(const FunctionCommand&) = delete;
+		FunctionCommand& operator=(FunctionCommand&&) = delete;
+	};
 }
 #endif // !COMMAND_H
 
@@ -25,12 +25,20 @@
 #include "Command.h"
 #include "Exception.h"
 #include <sstream>
-#include <regex>
 #include <cassert>
 #include <algorithm>
 #include "UserInterface.h"
 #include <fstream>
 #include "Tokenizer.h"
+#include "Kernels.h"
+#include "VectorMath.h"
+#include "Expression.h"
+#include "ThreadPool.h"
+#include "DataFile.h"
+#include "Snapshot.h"
+#include "Journal.h"
+#include <filesystem>
+#include "Stack.h"
 
 using std::string;
 using std::ostringstream;
@@ -40,48 +48,154 @@ using std::istringstream;
 
 namespace control {
 
+namespace {
+
+// the words the dispatcher takes before it looks for a command, a macro or
+// function named like one of them could not be run
+const set<string> Keywords{ "undo", "redo", "help", "cpuinfo", "journalinfo", "branches", "fastmath",
+    "exactmath", "lazy", "eager", "threads", "save", "snapshot", "restore", "fork", "switch", "jump", "record", "def", "end", "exit" };
+
+}
+
 class CommandDispatcher::CommandDispatcherImpl
 {
 public:
     explicit CommandDispatcherImpl(view::UserInterface& ui);
 
     void executeCommand(const string& command);
+    void restoreSnapshot(const string& path);
+    void openJournal(const string& path, std::chrono::milliseconds interval);
 
 
 private:
     bool isNum(const string&, double& d);
     void handleCommand(CommandPtr command);
     void printHelp() const;
+    void printCpuInfo() const;
+    void printJournalInfo() const;
+    void printBranches() const;
+    void applySetting(const string& setting, const string& argument);
+
+    // declared first, the manager records into it until it is gone
+    unique_ptr<utility::Journal> m_journal;
 
     CommandManager manager_;
 	view::UserInterface& m_ui;
+
+    // a setting like "threads" or a command like "load" takes the next token
+    // as its argument
+    string m_pendingSetting;
+    CommandPtr m_pendingCommand;
+
+    // between "record <name>" or "def <name>" and "end" the tokens are
+    // collected, not run
+    string m_recording;
+    CommandManager::Kind m_recordingKind;
+    std::vector<string> m_macroTokens;
 };
 
 CommandDispatcher::CommandDispatcherImpl::CommandDispatcherImpl(view::UserInterface& ui)
-: m_ui(ui)
+: manager_(CommandManager::UndoRedoStrategy::TreeStrategy)
+, m_ui(ui)
+, m_pendingCommand(nullptr, &CommandDeleter)
+, m_recordingKind(CommandManager::Kind::Macro)
 { }
 
 void CommandDispatcher::CommandDispatcherImpl::executeCommand(const string& command)
 {
+    if(!m_recording.empty())
+    {
+        string name{ command };
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if(name != "end")
+        {
+            m_macroTokens.push_back(command);
+            return;
+        }
+
+        string defined;
+        std::vector<string> tokens;
+        defined.swap(m_recording);
+        tokens.swap(m_macroTokens);
+        try
+        {
+            manager_.define(defined, tokens, m_recordingKind);
+        }
+        catch(utility::Exception& e)
+        {
+            string kind{ m_recordingKind == CommandManager::Kind::Macro ? "macro " : "function " };
+            m_ui.displayMessage( e.what() + " - the " + kind + defined + " is not defined" );
+        }
+        return;
+    }
+
+    if(!m_pendingSetting.empty())
+    {
+        string setting;
+        setting.swap(m_pendingSetting);
+        applySetting(setting, command);
+        return;
+    }
+
+    // arguments keep their case, a path may need it
+    if(m_pendingCommand)
+    {
+        m_pendingCommand->setArgument(command);
+        handleCommand( std::move(m_pendingCommand) );
+        return;
+    }
+
+    string name{ command };
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
     // entry of a number simply goes onto the the stack
     double d;
-    if( isNum(command, d) )
-        manager_.executeCommand(MakeCommandPtr<EnterNumber>(d));
-    else if(command == "undo")
-        manager_.undo();
-    else if(command == "redo")
-        manager_.redo();
-    else if(command == "help")
+    if( isNum(name, d) )
+        handleCommand(MakeCommandPtr<EnterNumber>(d));
+    else if(name == "undo" || name == "redo")
+    {
+        // redo checks the preconditions again and the journal may fail
+        try
+        {
+            utility::Status status;
+            if(name == "undo") manager_.undo();
+            else status = manager_.redo();
+            if(!status) m_ui.displayMessage( status.message() );
+        }
+        catch(utility::Exception& e)
+        {
+            m_ui.displayMessage( e.what() );
+        }
+    }
+    else if(name == "help")
         printHelp();
+    else if(name == "cpuinfo")
+        printCpuInfo();
+    else if(name == "journalinfo")
+        printJournalInfo();
+    else if(name == "branches")
+        printBranches();
+    else if(name == "fastmath")
+        utility::VectorMath::getInstance().setMode(utility::MathMode::Fast);
+    else if(name == "exactmath")
+        utility::VectorMath::getInstance().setMode(utility::MathMode::Exact);
+    else if(name == "lazy" || name == "eager")
+        model::ExpressionGraph::getInstance().setLazy(name == "lazy");
+    else if(name == "threads" || name == "save" || name == "snapshot" || name == "restore"
+        || name == "fork" || name == "switch" || name == "jump" || name == "record"
+        || name == "def")
+        m_pendingSetting = name;
     else
     {
-        auto c = CommandRepository::getInstance().getCommandByName(command);
+        auto c = CommandRepository::getInstance().getCommandByName(name);
         if(!c)
         {
             ostringstream oss;
             oss << "Command " << command << " is not a known command";
             m_ui.displayMessage( oss.str() );
         }
+        else if(c->takesArgument())
+            m_pendingCommand = std::move(c);
         else handleCommand( std::move(c) );
     }
 
@@ -90,9 +204,11 @@ void CommandDispatcher::CommandDispatcherImpl::executeCommand(const string& comm
 
 void CommandDispatcher::CommandDispatcherImpl::handleCommand(CommandPtr c)
 {
+    // a command that cannot run reports why, the exceptions left are faults such as a failed load
     try
     {
-        manager_.executeCommand( std::move(c) );
+        auto status = manager_.executeCommand( std::move(c) );
+        if(!status) m_ui.displayMessage( status.message() );
     }
     catch(utility::Exception& e)
     {
@@ -108,7 +224,26 @@ void CommandDispatcher::CommandDispatcherImpl::printHelp() const
     set<string> allCommands = CommandRepository::getInstance().getAllCommandNames();
     oss << "\n";
     oss << "undo: undo last operation\n"
-        << "redo: redo last operation\n";
+        << "redo: redo last operation\n"
+        << "cpuinfo: show the cpu features and which numeric kernels are in use\n"
+        << "fastmath: evaluate sin, cos, tan and their inverses with the vectorized approximations\n"
+        << "exactmath: evaluate sin, cos, tan and their inverses with the C runtime (default)\n"
+        << "lazy: defer + - * / and the trigonometric functions on vectors and matrices until the elements are needed, fusing them\n"
+        << "eager: compute every operation as it is entered (default)\n"
+        << "threads n: use n threads for the operations on long vectors and matrices\n"
+        << "save <path>: write the stack to a file, bottom first: raw doubles for a .bin path, a csv column for .csv, one number per line otherwise\n"
+        << "snapshot <path>: write the stack and the undo history of every session to a snapshot file\n"
+        << "restore <path>: continue the sessions kept in a snapshot file, undo included\n"
+        << "journalinfo: show what the journal started with --journal has written and how long its commits take\n"
+        << "fork <name>: go on in a new session called name, starting from the stack as it is, with an undo history of its own\n"
+        << "switch <name>: go back to the session called name, the first one is main\n"
+        << "branches: list the branches of the undo history, a command entered after an undo starts a new one\n"
+        << "jump n: undo and redo until the stack is as it was at point n of the undo history, see branches\n"
+        << "record <name>: collect the tokens up to end as a new command called name, which runs them in one step\n"
+        << "def <name>: compile the tokens up to end into a new command called name, a function of numbers, + - * /,\n"
+        << "    sin cos tan arcsin arccos arctan, < > <= >= == != (1 or 0), dup drop swap over, the functions defined before,\n"
+        << "    c if ... else ... then, and n times ... next with i the turn from 0; it runs in one step, without the dispatcher\n"
+        << "end: finish the macro or function being defined\n";
 
     for(auto i : allCommands)
     {
@@ -120,19 +255,187 @@ void CommandDispatcher::CommandDispatcherImpl::printHelp() const
 
 }
 
-bool CommandDispatcher::CommandDispatcherImpl::isNum(const string& s, double& d)
+void CommandDispatcher::CommandDispatcherImpl::printCpuInfo() const
+{
+    const auto& registry = utility::KernelRegistry::getInstance();
+    const auto& f = registry.getCpuFeatures();
+
+    ostringstream oss;
+    oss << "\n";
+    oss << "cpu: " << (f.brand.empty() ? "unknown" : f.brand) << "\n";
+    oss << "features:" << (f.sse2 ? " sse2" : "") << (f.avx ? " avx" : "") << (f.avx2 ? " avx2" : "")
+        << (f.fma ? " fma" : "") << (f.avx512f ? " avx512f" : "") << "\n";
+    oss << "kernels: " << utility::KernelRegistry::getName(registry.getActiveTier());
+    if (registry.getActiveTier() != registry.getDetectedTier())
+        oss << " (forced, best available is " << utility::KernelRegistry::getName(registry.getDetectedTier()) << ")";
+    oss << "\n";
+    oss << "math mode: " << utility::VectorMath::getName(utility::VectorMath::getInstance().getMode()) << "\n";
+    oss << "threads: " << utility::ThreadPool::getInstance().getThreadCount() << "\n";
+
+    m_ui.displayMessage( oss.str() );
+}
+
+void CommandDispatcher::CommandDispatcherImpl::printJournalInfo() const
 {
-     if(s == "+" || s == "-") return false;
+    if(!m_journal)
+    {
+        m_ui.displayMessage("no journal, start with --journal <path> to keep one");
+        return;
+    }
 
-     std::regex dpRegex("((\\+|-)?[[:digit:]]*)(\\.(([[:digit:]]+)?))?((e|E)((\\+|-)?)[[:digit:]]+)?");
-     bool isNumber{ std::regex_match(s, dpRegex) };
+    auto st = m_journal->getStatistics();
+    ostringstream oss;
+    oss << "\n";
+    oss << "records: " << st.records << "\n";
+    oss << "bytes written: " << st.bytes << " (" << (st.seconds > 0 ? st.bytes / st.seconds : 0.0) << " bytes/s)\n";
+    oss << "group commits: " << st.commits << "\n";
+    oss << "commit latency: " << (st.commits ? st.commitSeconds / st.commits * 1e3 : 0.0) << " ms average, "
+        << st.maxCommitSeconds * 1e3 << " ms at most\n";
+
+    m_ui.displayMessage( oss.str() );
+}
 
-     if(isNumber)
-     {
-         d = std::stod(s);
-     }
+void CommandDispatcher::CommandDispatcherImpl::printBranches() const
+{
+    auto branches = manager_.getBranches();
 
-     return isNumber;
+    ostringstream oss;
+    oss << "\n";
+    oss << "at point " << manager_.getPosition() << " of the undo history, " << branches.size() << " branches:\n";
+    for(const auto& b : branches)
+        oss << (b.active ? "* " : "  ") << b.number << ": " << b.length << " commands, the last one " << b.last << "\n";
+
+    m_ui.displayMessage( oss.str() );
+}
+
+void CommandDispatcher::CommandDispatcherImpl::applySetting(const string& setting, const string& argument)
+{
+    // settings are not commands: they do not touch the stack and are not undone
+    double d;
+    if(setting == "threads")
+    {
+        if(!isNum(argument, d) || d < 1.0 || d > 1024.0 || d != static_cast<size_t>(d))
+            m_ui.displayMessage("threads needs a thread count between 1 and 1024, not " + argument);
+        else
+            utility::ThreadPool::getInstance().setThreadCount(static_cast<size_t>(d));
+    }
+    else if(setting == "save")
+    {
+        auto& stack = model::Stack::getInstance();
+        if(stack.hasArrays(stack.size()))
+        {
+            m_ui.displayMessage("save needs a stack of numbers, not vectors or matrices");
+            return;
+        }
+
+        try
+        {
+            std::vector<utility::NumberRange> ranges;
+            stack.inspect([&](const double* first, size_t n) { ranges.push_back({ first, n }); });
+            utility::writeNumbers(argument, ranges, utility::formatOfPath(argument));
+        }
+        catch(utility::Exception& e)
+        {
+            m_ui.displayMessage( e.what() );
+        }
+    }
+    else if(setting == "snapshot")
+    {
+        try
+        {
+            saveSnapshot(argument, manager_);
+            manager_.restartJournal(std::filesystem::absolute(argument).string());
+        }
+        catch(utility::Exception& e)
+        {
+            m_ui.displayMessage( e.what() );
+        }
+    }
+    else if(setting == "restore")
+        restoreSnapshot(argument);
+    else if(setting == "fork" || setting == "switch")
+    {
+        try
+        {
+            if(setting == "fork") manager_.fork(argument);
+            else manager_.switchTo(argument);
+        }
+        catch(utility::Exception& e)
+        {
+            m_ui.displayMessage( e.what() );
+        }
+    }
+    else if(setting == "record" || setting == "def")
+    {
+        string name{ argument };
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        string kind{ setting == "record" ? "macro" : "function" };
+        if(isNum(name, d) || Keywords.count(name))
+            m_ui.displayMessage(setting + " needs a name for the " + kind + ", not " + argument);
+        else
+        {
+            m_recording = name;
+            m_recordingKind = setting == "record" ? CommandManager::Kind::Macro : CommandManager::Kind::Function;
+            m_ui.displayMessage((setting == "record" ? "recording " : "defining ") + name + ", end finishes it");
+        }
+    }
+    else if(setting == "jump")
+    {
+        if(!isNum(argument, d) || d < 0.0 || d > 1e15 || d != static_cast<size_t>(d))
+        {
+            m_ui.displayMessage("jump needs a point of the undo history, not " + argument);
+            return;
+        }
+
+        try
+        {
+            auto status = manager_.jumpTo(static_cast<size_t>(d));
+            if(!status) m_ui.displayMessage( status.message() );
+        }
+        catch(utility::Exception& e)
+        {
+            m_ui.displayMessage( e.what() );
+        }
+    }
+
+    return;
+}
+
+void CommandDispatcher::CommandDispatcherImpl::restoreSnapshot(const string& path)
+{
+    try
+    {
+        control::restoreSnapshot(path, manager_);
+        manager_.restartJournal(std::filesystem::absolute(path).string());
+    }
+    catch(utility::Exception& e)
+    {
+        m_ui.displayMessage( e.what() );
+    }
+
+    return;
+}
+
+void CommandDispatcher::CommandDispatcherImpl::openJournal(const string& path, std::chrono::milliseconds interval)
+{
+    // the records of an earlier session are applied before new ones are taken
+    try
+    {
+        m_journal = std::make_unique<utility::Journal>(path, interval,
+            [this](const char* record, size_t size) { manager_.replay(record, size); });
+        manager_.setJournal(m_journal.get());
+    }
+    catch(utility::Exception& e)
+    {
+        m_ui.displayMessage( e.what() + " - the journal " + path + " is not kept" );
+    }
+
+    return;
+}
+
+bool CommandDispatcher::CommandDispatcherImpl::isNum(const string& s, double& d)
+{
+     return utility::parseNumber(s, d);
 }
 
 void CommandDispatcher::commandEntered(const std::string& command)
@@ -142,6 +445,20 @@ void CommandDispatcher::commandEntered(const std::string& command)
     return;
 }
 
+void CommandDispatcher::restoreSnapshot(const std::string& path)
+{
+    pimpl_->restoreSnapshot(path);
+
+    return;
+}
+
+void CommandDispatcher::openJournal(const std::string& path, std::chrono::milliseconds interval)
+{
+    pimpl_->openJournal(path, interval);
+
+    return;
+}
+
 CommandDispatcher::CommandDispatcher(view::UserInterface& ui)
 {
     pimpl_ = std::make_unique<CommandDispatcherImpl>(ui);
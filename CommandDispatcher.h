@@ -22,6 +22,7 @@
 #ifndef COMMAND_DISPATCHER_H
 #define COMMAND_DISPATCHER_H
 
+#include <chrono>
 #include <string>
 #include <memory>
 #include "Command.h"
@@ -40,6 +41,14 @@ public:
 
     void commandEntered(const std::string& command);
 
+    // replaces the stack and the undo history with a snapshot file, as the
+    // "restore" setting does; a failure is reported to the user interface
+    void restoreSnapshot(const std::string& path);
+
+    // replays the journal at path, if there is one, and records every command
+    // from then on in it, with a group commit each interval
+    void openJournal(const std::string& path, std::chrono::milliseconds interval);
+
 private:
     CommandDispatcher(const CommandDispatcher&) = delete;
     CommandDispatcher(CommandDispatcher&&) = delete;
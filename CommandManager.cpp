@@ -20,19 +20,49 @@
 */
 
 #include "CommandManager.h"
-#include <stack>
 #include <vector>
 #include <list>
+#include <deque>
+#include <iterator>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 #include "Command.h"
+#include "CommandRepository.h"
+#include "Archive.h"
+#include "Exception.h"
+#include "Journal.h"
+#include "Snapshot.h"
+#include "Reclaimer.h"
 
 using std::unique_ptr;
 using std::make_unique;
-using std::stack;
 using std::vector;
 using std::list;
 
 namespace control {
 
+	namespace
+	{
+		// a journal record starts with its kind; an execution goes on with the
+		// name of the command and its input, a snapshot with its path, a fork or
+		// a switch with the name of the session, a jump with the point reached
+		// and a macro with its name and tokens
+		enum class Record : std::uint64_t { Execute, Undo, Redo, Snapshot, Fork, Switch, Jump, Define, Function };
+
+		// commands thrown away from this many on are destroyed by the reclaimer,
+		// fewer cost less to destroy than to hand over
+		const size_t ReclaimBatch = 64;
+
+		template<typename Commands>
+		void discard(Commands& commands)
+		{
+			if (commands.size() >= ReclaimBatch)
+				utility::Reclaimer::getInstance().retire(std::move(commands));
+			commands.clear();
+		}
+	}
+
 	class CommandManager::CommandManagerImpl
 	{
 	public:
@@ -41,70 +71,165 @@ namespace control {
 		virtual size_t getUndoSize() const = 0;
 		virtual size_t getRedoSize() const = 0;
 
-		virtual void executeCommand(CommandPtr c) = 0;
+		virtual utility::Status executeCommand(CommandPtr c) = 0;
 		virtual void undo() = 0;
-		virtual void redo() = 0;
+		virtual utility::Status redo() = 0;
+
+		virtual void getHistory(vector<const Command*>& undo, vector<const Command*>& redo) const = 0;
+		virtual void setHistory(vector<CommandPtr> undo, vector<CommandPtr> redo) = 0;
+
+		// a history without branches is one line, its points are numbered by the
+		// commands before them
+		virtual void getHistory(History<const Command*>& history) const;
+		virtual void setHistory(History<CommandPtr> history);
+		virtual size_t getPosition() const { return getUndoSize(); }
+		virtual void getBranches(vector<Branch>& branches) const;
+		virtual utility::Status jumpTo(size_t number);
 	};
 
+	void CommandManager::CommandManagerImpl::getBranches(vector<Branch>& branches) const
+	{
+		vector<const Command*> undo, redo;
+		getHistory(undo, redo);
+		if (undo.empty() && redo.empty()) return;
+
+		size_t length{ undo.size() + redo.size() };
+		branches.push_back({ length, length, (redo.empty() ? undo.back() : redo.back())->getName(), true });
+	}
+
+	void CommandManager::CommandManagerImpl::getHistory(History<const Command*>& history) const
+	{
+		vector<const Command*> undo, redo;
+		getHistory(undo, redo);
+
+		size_t number{ 0 };
+		for (auto line : { &undo, &redo })
+			for (auto c : *line)
+			{
+				history.points.push_back({ number + 1, number, true, c });
+				++number;
+			}
+		history.position = undo.size();
+		history.numbered = number;
+	}
+
+	void CommandManager::CommandManagerImpl::setHistory(History<CommandPtr> history)
+	{
+		// the active line, from the start on
+		std::unordered_map<size_t, size_t> next;
+		for (size_t i = 0; i < history.points.size(); ++i)
+			if (history.points[i].active) next[history.points[i].parent] = i;
+
+		vector<CommandPtr> undo, redo;
+		bool done{ history.position == 0 };
+		for (auto i = next.find(0); i != next.end(); i = next.find(history.points[i->second].number))
+		{
+			auto& point = history.points[i->second];
+			(done ? redo : undo).push_back(std::move(point.command));
+			done = done || point.number == history.position;
+		}
+
+		setHistory(std::move(undo), std::move(redo));
+	}
+
+	static const char* const NoSuchPoint = "Warning: there is no such point in the undo history";
+
+	utility::Status CommandManager::CommandManagerImpl::jumpTo(size_t number)
+	{
+		if (number > getUndoSize() + getRedoSize())
+			return utility::Status::failure(NoSuchPoint);
+
+		while (getUndoSize() > number) undo();
+		while (getUndoSize() < number)
+		{
+			auto status = redo();
+			if (!status) return status;
+		}
+
+		return {};
+	}
+
 	class CommandManager::UndoRedoStackStrategy : public CommandManager::CommandManagerImpl
 	{
 	public:
 		size_t getUndoSize() const override { return undoStack_.size(); }
 		size_t getRedoSize() const override { return redoStack_.size(); }
 
-		void executeCommand(CommandPtr c) override;
+		utility::Status executeCommand(CommandPtr c) override;
 		void undo() override;
-		void redo() override;
+		utility::Status redo() override;
+
+		void getHistory(vector<const Command*>& undo, vector<const Command*>& redo) const override;
+		void setHistory(vector<CommandPtr> undo, vector<CommandPtr> redo) override;
 
 	private:
-		void flushStack(stack<CommandPtr>& st);
+		void flushStack(vector<CommandPtr>& st);
 
-		stack<CommandPtr> undoStack_;
-		stack<CommandPtr> redoStack_;
+		// the top of each stack is at the back, a vector so snapshots can walk them
+		vector<CommandPtr> undoStack_;
+		vector<CommandPtr> redoStack_;
 	};
 
-	void CommandManager::UndoRedoStackStrategy::executeCommand(CommandPtr c)
+	utility::Status CommandManager::UndoRedoStackStrategy::executeCommand(CommandPtr c)
 	{
-		c->execute();
+		auto status = c->execute();
+		if (!status) return status;
 
-		undoStack_.push(std::move(c));
+		undoStack_.push_back(std::move(c));
 		flushStack(redoStack_);
 
-		return;
+		return {};
 	}
 
 	void CommandManager::UndoRedoStackStrategy::undo()
 	{
 		if (getUndoSize() == 0) return;
 
-		auto& c = undoStack_.top();
+		auto& c = undoStack_.back();
 		c->undo();
 
-		redoStack_.push(std::move(c));
-		undoStack_.pop();
+		redoStack_.push_back(std::move(c));
+		undoStack_.pop_back();
 
 		return;
 	}
 
-	void CommandManager::UndoRedoStackStrategy::redo()
+	utility::Status CommandManager::UndoRedoStackStrategy::redo()
 	{
-		if (getRedoSize() == 0) return;
+		if (getRedoSize() == 0) return {};
 
-		auto& c = redoStack_.top();
-		c->execute();
+		auto& c = redoStack_.back();
+		auto status = c->execute();
+		if (!status) return status;
 
-		undoStack_.push(std::move(c));
-		redoStack_.pop();
+		undoStack_.push_back(std::move(c));
+		redoStack_.pop_back();
 
-		return;
+		return {};
 	}
 
-	void CommandManager::UndoRedoStackStrategy::flushStack(stack<CommandPtr>& st)
+	void CommandManager::UndoRedoStackStrategy::getHistory(vector<const Command*>& undo, vector<const Command*>& redo) const
 	{
-		while (!st.empty())
+		for (auto& c : undoStack_)
+			undo.push_back(c.get());
+		for (auto i = redoStack_.rbegin(); i != redoStack_.rend(); ++i)
+			redo.push_back(i->get());
+	}
+
+	void CommandManager::UndoRedoStackStrategy::setHistory(vector<CommandPtr> undo, vector<CommandPtr> redo)
+	{
+		undoStack_ = std::move(undo);
+		redoStack_.clear();
+		while (!redo.empty())
 		{
-			st.pop();
+			redoStack_.push_back(std::move(redo.back()));
+			redo.pop_back();
 		}
+	}
+
+	void CommandManager::UndoRedoStackStrategy::flushStack(vector<CommandPtr>& st)
+	{
+		discard(st);
 
 		return;
 	}
@@ -117,9 +242,12 @@ namespace control {
 		size_t getUndoSize() const override { return undoSize_; }
 		size_t getRedoSize() const override { return redoSize_; }
 
-		void executeCommand(CommandPtr c) override;
+		utility::Status executeCommand(CommandPtr c) override;
 		void undo() override;
-		void redo() override;
+		utility::Status redo() override;
+
+		void getHistory(vector<const Command*>& undo, vector<const Command*>& redo) const override;
+		void setHistory(vector<CommandPtr> undo, vector<CommandPtr> redo) override;
 
 	private:
 		void flush();
@@ -130,9 +258,10 @@ namespace control {
 		vector<CommandPtr> undoRedoList_;
 	};
 
-	void CommandManager::UndoRedoListStrategyVector::executeCommand(CommandPtr c)
+	utility::Status CommandManager::UndoRedoListStrategyVector::executeCommand(CommandPtr c)
 	{
-		c->execute();
+		auto status = c->execute();
+		if (!status) return status;
 
 		flush();
 		undoRedoList_.emplace_back(std::move(c));
@@ -140,7 +269,7 @@ namespace control {
 		++undoSize_;
 		redoSize_ = 0;
 
-		return;
+		return {};
 	}
 
 	void CommandManager::UndoRedoListStrategyVector::undo()
@@ -155,21 +284,55 @@ namespace control {
 		return;
 	}
 
-	void CommandManager::UndoRedoListStrategyVector::redo()
+	utility::Status CommandManager::UndoRedoListStrategyVector::redo()
 	{
-		if (getRedoSize() == 0) return;
+		if (getRedoSize() == 0) return {};
+
+		auto status = undoRedoList_[cur_ + 1]->execute();
+		if (!status) return status;
 
 		++cur_;
-		undoRedoList_[cur_]->execute();
 		--redoSize_;
 		++undoSize_;
 
-		return;
+		return {};
+	}
+
+	void CommandManager::UndoRedoListStrategyVector::getHistory(vector<const Command*>& undo, vector<const Command*>& redo) const
+	{
+		for (size_t i = 0; i < undoRedoList_.size(); ++i)
+			(i < undoSize_ ? undo : redo).push_back(undoRedoList_[i].get());
+	}
+
+	void CommandManager::UndoRedoListStrategyVector::setHistory(vector<CommandPtr> undo, vector<CommandPtr> redo)
+	{
+		undoSize_ = undo.size();
+		redoSize_ = redo.size();
+		undoRedoList_ = std::move(undo);
+		for (auto& c : redo)
+			undoRedoList_.push_back(std::move(c));
+		cur_ = static_cast<int>(undoSize_) - 1;
 	}
 
 	void CommandManager::UndoRedoListStrategyVector::flush()
 	{
-		if (!undoRedoList_.empty()) undoRedoList_.erase(undoRedoList_.begin() + cur_ + 1, undoRedoList_.end());
+		if (undoRedoList_.empty()) return;
+
+		// the shorter side is moved, the other one stays where it is
+		auto first = undoRedoList_.begin() + cur_ + 1;
+		vector<CommandPtr> redo;
+		if (first - undoRedoList_.begin() < undoRedoList_.end() - first)
+		{
+			vector<CommandPtr> undo(std::make_move_iterator(undoRedoList_.begin()), std::make_move_iterator(first));
+			redo.swap(undoRedoList_);
+			undoRedoList_.swap(undo);
+		}
+		else
+		{
+			redo.assign(std::make_move_iterator(first), std::make_move_iterator(undoRedoList_.end()));
+			undoRedoList_.erase(first, undoRedoList_.end());
+		}
+		discard(redo);
 
 		return;
 	}
@@ -182,9 +345,12 @@ namespace control {
 		size_t getUndoSize() const override { return undoSize_; }
 		size_t getRedoSize() const override { return redoSize_; }
 
-		void executeCommand(CommandPtr c) override;
+		utility::Status executeCommand(CommandPtr c) override;
 		void undo() override;
-		void redo() override;
+		utility::Status redo() override;
+
+		void getHistory(vector<const Command*>& undo, vector<const Command*>& redo) const override;
+		void setHistory(vector<CommandPtr> undo, vector<CommandPtr> redo) override;
 
 	private:
 		void flush();
@@ -195,9 +361,10 @@ namespace control {
 		list<CommandPtr>::iterator cur_;
 	};
 
-	void CommandManager::UndoRedoListStrategy::executeCommand(CommandPtr c)
+	utility::Status CommandManager::UndoRedoListStrategy::executeCommand(CommandPtr c)
 	{
-		c->execute();
+		auto status = c->execute();
+		if (!status) return status;
 
 		flush();
 		undoRedoList_.emplace_back(std::move(c));
@@ -206,7 +373,7 @@ namespace control {
 		cur_ = undoRedoList_.end();
 		--cur_;
 
-		return;
+		return {};
 	}
 
 	void CommandManager::UndoRedoListStrategy::undo()
@@ -221,45 +388,449 @@ namespace control {
 		return;
 	}
 
-	void CommandManager::UndoRedoListStrategy::redo()
+	utility::Status CommandManager::UndoRedoListStrategy::redo()
 	{
-		if (redoSize_ == 0) return;
+		if (redoSize_ == 0) return {};
+
+		auto next = cur_;
+		++next;
+		auto status = (*next)->execute();
+		if (!status) return status;
 
 		--redoSize_;
 		++undoSize_;
-		++cur_;
-		(*cur_)->execute();
+		cur_ = next;
 
-		return;
+		return {};
+	}
+
+	void CommandManager::UndoRedoListStrategy::getHistory(vector<const Command*>& undo, vector<const Command*>& redo) const
+	{
+		size_t i{ 0 };
+		for (auto& c : undoRedoList_)
+			(i++ < undoSize_ ? undo : redo).push_back(c.get());
+	}
+
+	void CommandManager::UndoRedoListStrategy::setHistory(vector<CommandPtr> undo, vector<CommandPtr> redo)
+	{
+		undoRedoList_.clear();
+		for (auto& c : undo)
+			undoRedoList_.push_back(std::move(c));
+		for (auto& c : redo)
+			undoRedoList_.push_back(std::move(c));
+		undoSize_ = undo.size();
+		redoSize_ = redo.size();
+
+		// cur_ is the last entry undo would take back, the end without one
+		cur_ = undoRedoList_.end();
+		if (undoSize_ > 0) cur_ = std::next(undoRedoList_.begin(), undoSize_ - 1);
 	}
 
 	void CommandManager::UndoRedoListStrategy::flush()
 	{
 		auto i = cur_;
 		++i;
-		if (!undoRedoList_.empty()) undoRedoList_.erase(i, undoRedoList_.end());
+		if (undoRedoList_.empty()) return;
+
+		// splicing a range counts it, the shorter side is moved
+		list<CommandPtr> redo;
+		if (undoSize_ < redoSize_)
+		{
+			redo.splice(redo.begin(), undoRedoList_, undoRedoList_.begin(), i);
+			redo.swap(undoRedoList_);
+		}
+		else
+			redo.splice(redo.begin(), undoRedoList_, i, undoRedoList_.end());
+		discard(redo);
 	}
 
-	CommandManager::CommandManager(UndoRedoStrategy st)
+	class CommandManager::UndoRedoTreeStrategy : public CommandManager::CommandManagerImpl
+	{
+	public:
+		UndoRedoTreeStrategy();
+
+		size_t getUndoSize() const override { return cur_->depth; }
+		size_t getRedoSize() const override { return redoSize_; }
+
+		utility::Status executeCommand(CommandPtr c) override;
+		void undo() override;
+		utility::Status redo() override;
+
+		void getHistory(vector<const Command*>& undo, vector<const Command*>& redo) const override;
+		void setHistory(vector<CommandPtr> undo, vector<CommandPtr> redo) override;
+		void getHistory(History<const Command*>& history) const override;
+		void setHistory(History<CommandPtr> history) override;
+
+		size_t getPosition() const override { return cur_->number; }
+		void getBranches(vector<Branch>& branches) const override;
+		utility::Status jumpTo(size_t number) override;
+
+	private:
+		struct Node
+		{
+			CommandPtr command;		// none at the root
+			Node* parent;
+			Node* next;				// the child redo goes to
+			size_t number;
+			size_t depth;
+			vector<unique_ptr<Node>> children;
+
+			~Node();
+		};
+
+		// commands kept off the active line before the oldest branch is let go
+		static const size_t Retention = 10000;
+
+		// a branch off the active line and the nodes it holds that are not in
+		// a branch left before it
+		struct Abandoned
+		{
+			Node* root;
+			size_t size;
+		};
+
+		Node* addNode(Node* parent, CommandPtr c);
+		void settle();
+		void prune();
+
+		unique_ptr<Node> root_;
+		Node* cur_;
+		size_t redoSize_;
+		size_t size_;				// nodes with a command
+		size_t numbers_;
+
+		// the branches off the active line in the order they were left
+		std::deque<Abandoned> abandoned_;
+	};
+
+	CommandManager::UndoRedoTreeStrategy::Node::~Node()
+	{
+		// node by node, a long line would overflow the call stack of the destructors
+		vector<unique_ptr<Node>> below{ std::move(children) };
+		while (!below.empty())
+		{
+			auto n = std::move(below.back());
+			below.pop_back();
+			for (auto& child : n->children)
+				below.push_back(std::move(child));
+			n->children.clear();
+		}
+	}
+
+	CommandManager::UndoRedoTreeStrategy::UndoRedoTreeStrategy()
+		: root_{ new Node{ CommandPtr{ nullptr, &CommandDeleter }, nullptr, nullptr, 0, 0, {} } }
+		, cur_{ root_.get() }
+		, redoSize_{ 0 }
+		, size_{ 0 }
+		, numbers_{ 0 }
+	{ }
+
+	utility::Status CommandManager::UndoRedoTreeStrategy::executeCommand(CommandPtr c)
+	{
+		auto status = c->execute();
+		if (!status) return status;
+
+		// what redo would have done becomes a branch, nothing is flushed
+		if (cur_->next) abandoned_.push_back({ cur_->next, redoSize_ });
+		cur_ = addNode(cur_, std::move(c));
+		redoSize_ = 0;
+
+		prune();
+
+		return {};
+	}
+
+	void CommandManager::UndoRedoTreeStrategy::undo()
+	{
+		if (getUndoSize() == 0) return;
+
+		cur_->command->undo();
+		cur_ = cur_->parent;
+		++redoSize_;
+
+		return;
+	}
+
+	utility::Status CommandManager::UndoRedoTreeStrategy::redo()
+	{
+		if (getRedoSize() == 0) return {};
+
+		auto status = cur_->next->command->execute();
+		if (!status) return status;
+		cur_ = cur_->next;
+		--redoSize_;
+
+		return {};
+	}
+
+	void CommandManager::UndoRedoTreeStrategy::getHistory(vector<const Command*>& undo, vector<const Command*>& redo) const
+	{
+		size_t first{ undo.size() };
+		for (auto n = cur_; n->parent; n = n->parent)
+			undo.push_back(n->command.get());
+		std::reverse(undo.begin() + first, undo.end());
+
+		for (auto n = cur_->next; n; n = n->next)
+			redo.push_back(n->command.get());
+	}
+
+	void CommandManager::UndoRedoTreeStrategy::setHistory(vector<CommandPtr> undo, vector<CommandPtr> redo)
+	{
+		utility::Reclaimer::getInstance().retire(std::move(root_));
+		root_.reset(new Node{ CommandPtr{ nullptr, &CommandDeleter }, nullptr, nullptr, 0, 0, {} });
+		abandoned_.clear();
+		size_ = 0;
+
+		cur_ = root_.get();
+		for (auto& c : undo)
+			cur_ = addNode(cur_, std::move(c));
+
+		auto last = cur_;
+		for (auto& c : redo)
+			last = addNode(last, std::move(c));
+		redoSize_ = redo.size();
+	}
+
+	void CommandManager::UndoRedoTreeStrategy::getHistory(History<const Command*>& history) const
+	{
+		// parents before children, the children of each in their order
+		vector<const Node*> open{ root_.get() };
+		while (!open.empty())
+		{
+			auto n = open.back();
+			open.pop_back();
+			if (n->parent)
+				history.points.push_back({ n->number, n->parent->number, n->parent->next == n, n->command.get() });
+			for (auto child = n->children.rbegin(); child != n->children.rend(); ++child)
+				open.push_back(child->get());
+		}
+
+		history.position = cur_->number;
+		history.numbered = numbers_;
+		for (auto& a : abandoned_)
+			history.abandoned.push_back(a.root->number);
+	}
+
+	void CommandManager::UndoRedoTreeStrategy::setHistory(History<CommandPtr> history)
+	{
+		utility::Reclaimer::getInstance().retire(std::move(root_));
+		root_.reset(new Node{ CommandPtr{ nullptr, &CommandDeleter }, nullptr, nullptr, 0, 0, {} });
+		size_ = 0;
+
+		std::unordered_map<size_t, Node*> nodes{ { 0, root_.get() } };
+		for (auto& point : history.points)
+		{
+			auto parent = nodes.at(point.parent);
+			parent->children.emplace_back(new Node{ std::move(point.command), parent, nullptr, point.number, parent->depth + 1, {} });
+			if (point.active) parent->next = parent->children.back().get();
+			nodes[point.number] = parent->children.back().get();
+			++size_;
+		}
+
+		cur_ = nodes.at(history.position);
+		numbers_ = history.numbered;
+		redoSize_ = 0;
+		for (auto n = cur_->next; n; n = n->next)
+			++redoSize_;
+
+		// the nodes of each branch that an older one does not hold
+		abandoned_.clear();
+		std::unordered_set<const Node*> counted;
+		for (size_t number : history.abandoned)
+		{
+			Node* root{ nodes.at(number) };
+			size_t size{ 0 };
+			vector<const Node*> open{ root };
+			while (!open.empty())
+			{
+				auto n = open.back();
+				open.pop_back();
+				++size;
+				for (auto& child : n->children)
+					if (!counted.count(child.get()))
+						open.push_back(child.get());
+			}
+			counted.insert(root);
+			abandoned_.push_back({ root, size });
+		}
+	}
+
+	void CommandManager::UndoRedoTreeStrategy::getBranches(vector<Branch>& branches) const
+	{
+		auto tip = cur_;
+		while (tip->next) tip = tip->next;
+
+		vector<const Node*> open{ root_.get() };
+		while (!open.empty())
+		{
+			auto n = open.back();
+			open.pop_back();
+			for (auto& child : n->children)
+				open.push_back(child.get());
+
+			if (n->children.empty() && n->parent)
+				branches.push_back({ n->number, n->depth, n->command->getName(), n == tip });
+		}
+
+		std::sort(branches.begin(), branches.end(), [](const Branch& a, const Branch& b) { return a.number < b.number; });
+	}
+
+	utility::Status CommandManager::UndoRedoTreeStrategy::jumpTo(size_t number)
+	{
+		Node* target{ nullptr };
+		vector<Node*> open{ root_.get() };
+		while (!open.empty() && !target)
+		{
+			auto n = open.back();
+			open.pop_back();
+			if (n->number == number) target = n;
+			for (auto& child : n->children)
+				open.push_back(child.get());
+		}
+
+		if (!target)
+			return utility::Status::failure(NoSuchPoint);
+
+		// up to the point both lines share, then down the other one
+		vector<Node*> path;
+		auto common = target;
+		auto up = cur_;
+		while (up->depth > common->depth) up = up->parent;
+		while (common->depth > up->depth)
+		{
+			path.push_back(common);
+			common = common->parent;
+		}
+		while (up != common)
+		{
+			path.push_back(common);
+			common = common->parent;
+			up = up->parent;
+		}
+
+		utility::Status status;
+		try
+		{
+			while (cur_ != common)
+			{
+				cur_->command->undo();
+				cur_ = cur_->parent;
+			}
+			for (auto n = path.rbegin(); n != path.rend(); ++n)
+			{
+				status = (*n)->command->execute();
+				if (!status) break;
+				cur_->next = *n;
+				cur_ = *n;
+			}
+		}
+		catch (...)
+		{
+			settle();
+			throw;
+		}
+
+		settle();
+		return status;
+	}
+
+	CommandManager::UndoRedoTreeStrategy::Node* CommandManager::UndoRedoTreeStrategy::addNode(Node* parent, CommandPtr c)
+	{
+		parent->children.emplace_back(new Node{ std::move(c), parent, nullptr, ++numbers_, parent->depth + 1, {} });
+		parent->next = parent->children.back().get();
+		++size_;
+
+		return parent->next;
+	}
+
+	void CommandManager::UndoRedoTreeStrategy::settle()
+	{
+		// a jump changes the active line: count it again and collect what is off it
+		redoSize_ = 0;
+		for (auto n = cur_->next; n; n = n->next)
+			++redoSize_;
+
+		abandoned_.clear();
+		for (Node* n = root_.get(); n; n = n->next)
+			for (auto& child : n->children)
+				if (child.get() != n->next)
+				{
+					size_t size{ 0 };
+					vector<const Node*> open{ child.get() };
+					while (!open.empty())
+					{
+						auto m = open.back();
+						open.pop_back();
+						++size;
+						for (auto& below : m->children)
+							open.push_back(below.get());
+					}
+					abandoned_.push_back({ child.get(), size });
+				}
+
+		std::sort(abandoned_.begin(), abandoned_.end(), [](const Abandoned& a, const Abandoned& b) { return a.root->number < b.root->number; });
+	}
+
+	void CommandManager::UndoRedoTreeStrategy::prune()
+	{
+		// a branch left later may hold ones left earlier, never the other way
+		// round, so letting the oldest go first never frees a branch still listed
+		// and frees just the nodes counted for it; the reclaimer destroys them
+		size_t active{ getUndoSize() + getRedoSize() };
+		while (!abandoned_.empty() && size_ - active > Retention)
+		{
+			auto n = abandoned_.front();
+			abandoned_.pop_front();
+
+			auto& siblings = n.root->parent->children;
+			auto i = std::find_if(siblings.begin(), siblings.end(), [&n](const unique_ptr<Node>& child) { return child.get() == n.root; });
+			utility::Reclaimer::getInstance().retire(std::move(*i));
+			siblings.erase(i);
+			size_ -= n.size;
+		}
+	}
+
+	struct CommandManager::Session
+	{
+		std::string name;
+		unique_ptr<CommandManagerImpl> history;
+		model::Stack::Checkpoint stack;
+	};
+
+	unique_ptr<CommandManager::CommandManagerImpl> CommandManager::makeHistory(UndoRedoStrategy st)
 	{
 		switch (st)
 		{
 		case UndoRedoStrategy::ListStrategy:
-			pimpl_ = make_unique<UndoRedoListStrategy>();
-			break;
-
-		case UndoRedoStrategy::StackStrategy:
-			pimpl_ = make_unique<UndoRedoStackStrategy>();
-			break;
+			return make_unique<UndoRedoListStrategy>();
 
 		case UndoRedoStrategy::ListStrategyVector:
-			pimpl_ = make_unique<UndoRedoListStrategyVector>();
-			break;
+			return make_unique<UndoRedoListStrategyVector>();
+
+		case UndoRedoStrategy::TreeStrategy:
+			return make_unique<UndoRedoTreeStrategy>();
+
+		case UndoRedoStrategy::StackStrategy:
+		default:
+			return make_unique<UndoRedoStackStrategy>();
 		}
 	}
 
+	CommandManager::CommandManager(UndoRedoStrategy st)
+		: pimpl_{ makeHistory(st) }
+		, journal_{ nullptr }
+		, strategy_{ st }
+		, session_{ "main" }
+	{
+	}
+
 	CommandManager::~CommandManager()
-	{ }
+	{
+		// a long history takes a while to destroy, the reclaimer does it
+		auto& reclaimer = utility::Reclaimer::getInstance();
+		reclaimer.retire(std::move(pimpl_));
+		reclaimer.retire(std::move(sessions_));
+	}
 
 	size_t CommandManager::getUndoSize() const
 	{
@@ -271,22 +842,308 @@ namespace control {
 		return pimpl_->getRedoSize();
 	}
 
-	void CommandManager::executeCommand(CommandPtr c)
+	utility::Status CommandManager::executeCommand(CommandPtr c)
 	{
-		pimpl_->executeCommand(std::move(c));
-		return;
+		// the history keeps the command, it is still there to be recorded
+		Command* executed{ c.get() };
+		auto status = pimpl_->executeCommand(std::move(c));
+		if (!status) return status;
+
+		if (journal_)
+		{
+			model::Archive record;
+			auto kind = static_cast<std::uint64_t>(Record::Execute);
+			std::string name{ executed->getName() };
+			record.field(kind);
+			record.field(name);
+			executed->serializeInput(record);
+			journal_->append(record.getBuffer().data(), record.getBuffer().size());
+		}
+
+		return {};
 	}
 
 	void CommandManager::undo()
 	{
+		bool done{ getUndoSize() > 0 };
 		pimpl_->undo();
+
+		if (journal_ && done)
+		{
+			auto kind = static_cast<std::uint64_t>(Record::Undo);
+			journal_->append(reinterpret_cast<const char*>(&kind), sizeof kind);
+		}
+
 		return;
 	}
 
-	void CommandManager::redo()
+	utility::Status CommandManager::redo()
 	{
-		pimpl_->redo();
-		return;
+		bool done{ getRedoSize() > 0 };
+		auto status = pimpl_->redo();
+		if (!status) return status;
+
+		if (journal_ && done)
+		{
+			auto kind = static_cast<std::uint64_t>(Record::Redo);
+			journal_->append(reinterpret_cast<const char*>(&kind), sizeof kind);
+		}
+
+		return {};
+	}
+
+	void CommandManager::getHistory(History<const Command*>& history) const
+	{
+		pimpl_->getHistory(history);
+	}
+
+	void CommandManager::setHistory(History<CommandPtr> history)
+	{
+		pimpl_->setHistory(std::move(history));
+	}
+
+	size_t CommandManager::getPosition() const
+	{
+		return pimpl_->getPosition();
+	}
+
+	std::vector<CommandManager::Branch> CommandManager::getBranches() const
+	{
+		std::vector<Branch> branches;
+		pimpl_->getBranches(branches);
+
+		return branches;
+	}
+
+	utility::Status CommandManager::jumpTo(size_t number)
+	{
+		// a jump that stops half way is recorded where it stopped
+		size_t from{ getPosition() };
+		utility::Status status;
+		try
+		{
+			status = pimpl_->jumpTo(number);
+		}
+		catch (utility::Exception&)
+		{
+			recordJump(from);
+			throw;
+		}
+
+		recordJump(from);
+		return status;
+	}
+
+	void CommandManager::setJournal(utility::Journal* journal)
+	{
+		journal_ = journal;
+	}
+
+	void CommandManager::restartJournal(const std::string& snapshotPath)
+	{
+		if (!journal_) return;
+
+		model::Archive record;
+		auto kind = static_cast<std::uint64_t>(Record::Snapshot);
+		std::string path{ snapshotPath };
+		record.field(kind);
+		record.field(path);
+		journal_->restart(record.getBuffer().data(), record.getBuffer().size());
+	}
+
+	// what the journal recorded succeeded once, a record failing now is a damaged journal
+	static void replayed(const utility::Status& status)
+	{
+		if (!status)
+			throw utility::Exception(status.message());
+	}
+
+	void CommandManager::replay(const char* data, size_t size)
+	{
+		model::Archive record{ data, size };
+		std::uint64_t kind{};
+		record.field(kind);
+
+		switch (static_cast<Record>(kind))
+		{
+		case Record::Execute:
+		{
+			std::string name;
+			record.field(name);
+			auto c = name == EnterNumber::Name ? MakeCommandPtr<EnterNumber>(0.0)
+				: CommandRepository::getInstance().getCommandByName(name);
+			if (!c)
+				throw utility::Exception("Warning: the journal uses the unknown command " + name);
+
+			c->serializeInput(record);
+			replayed(executeCommand(std::move(c)));
+			break;
+		}
+		case Record::Undo:
+			undo();
+			break;
+		case Record::Redo:
+			replayed(redo());
+			break;
+		case Record::Snapshot:
+		{
+			std::string path;
+			record.field(path);
+			restoreSnapshot(path, *this);
+			break;
+		}
+		case Record::Fork:
+		case Record::Switch:
+		{
+			std::string name;
+			record.field(name);
+			if (static_cast<Record>(kind) == Record::Fork) fork(name);
+			else switchTo(name);
+			break;
+		}
+		case Record::Define:
+		case Record::Function:
+		{
+			std::string name;
+			std::vector<std::string> tokens;
+			record.field(name);
+			record.field(tokens);
+			define(name, tokens, static_cast<Record>(kind) == Record::Define ? Kind::Macro : Kind::Function);
+			break;
+		}
+		case Record::Jump:
+		{
+			std::uint64_t number{};
+			record.field(number);
+			replayed(jumpTo(number));
+			break;
+		}
+		default:
+			throw utility::Exception("Warning: the journal holds an unknown record");
+		}
+	}
+
+	void CommandManager::fork(const std::string& name)
+	{
+		bool taken{ name == session_ || std::any_of(sessions_.begin(), sessions_.end(),
+			[&](const Session& s) { return s.name == name; }) };
+		if (name.empty() || taken)
+			throw utility::Exception("Warning: there is already a session " + name);
+
+		sessions_.push_back({ session_, std::move(pimpl_), model::Stack::getInstance().checkpoint() });
+		pimpl_ = makeHistory(strategy_);
+		session_ = name;
+
+		recordSession(static_cast<std::uint64_t>(Record::Fork), name);
+	}
+
+	void CommandManager::switchTo(const std::string& name)
+	{
+		if (name == session_)
+			return;
+
+		auto target = std::find_if(sessions_.begin(), sessions_.end(), [&](const Session& s) { return s.name == name; });
+		if (target == sessions_.end())
+			throw utility::Exception("Warning: there is no session " + name);
+
+		auto& stack = model::Stack::getInstance();
+		Session left{ session_, std::move(pimpl_), stack.checkpoint() };
+		pimpl_ = std::move(target->history);
+		session_ = name;
+		stack.restore(target->stack);
+		*target = std::move(left);
+
+		recordSession(static_cast<std::uint64_t>(Record::Switch), name);
+	}
+
+	const std::string& CommandManager::getSessionName() const
+	{
+		return session_;
+	}
+
+	std::vector<CommandManager::SessionState<const Command*>> CommandManager::getSessions() const
+	{
+		std::vector<SessionState<const Command*>> states;
+		for (auto& s : sessions_)
+		{
+			states.push_back({ s.name, s.stack, {} });
+			s.history->getHistory(states.back().history);
+		}
+
+		return states;
+	}
+
+	void CommandManager::setSessions(const std::string& running, std::vector<SessionState<CommandPtr>> sessions)
+	{
+		utility::Reclaimer::getInstance().retire(std::move(sessions_));
+		sessions_.clear();
+		for (auto& state : sessions)
+		{
+			sessions_.push_back({ state.name, makeHistory(strategy_), state.stack });
+			sessions_.back().history->setHistory(std::move(state.history));
+		}
+		session_ = running;
+	}
+
+	void CommandManager::define(const std::string& name, const std::vector<std::string>& tokens, Kind kind)
+	{
+		auto& repository = CommandRepository::getInstance();
+		auto known = std::find_if(definitions_.begin(), definitions_.end(), [&](const Definition& d) { return d.name == name; });
+		if (known == definitions_.end() && repository.hasKey(name))
+			throw utility::Exception("Warning: " + name + " is a command, a definition cannot take its name");
+
+		auto command = kind == Kind::Macro ? MacroCommand::compile(tokens) : FunctionCommand::compile(tokens);
+
+		// the invocations in the history keep what they ran
+		if (known != definitions_.end())
+		{
+			repository.deregisterCommand(name);
+			known->tokens = tokens;
+			known->kind = kind;
+		}
+		else
+			definitions_.push_back({ name, tokens, kind });
+		repository.registerCommand(name, std::move(command));
+
+		if (journal_)
+		{
+			model::Archive record;
+			auto type = static_cast<std::uint64_t>(kind == Kind::Macro ? Record::Define : Record::Function);
+			std::string definedName{ name };
+			std::vector<std::string> definedTokens{ tokens };
+			record.field(type);
+			record.field(definedName);
+			record.field(definedTokens);
+			journal_->append(record.getBuffer().data(), record.getBuffer().size());
+		}
+	}
+
+	const std::vector<CommandManager::Definition>& CommandManager::getDefinitions() const
+	{
+		return definitions_;
+	}
+
+	void CommandManager::recordSession(std::uint64_t kind, const std::string& name)
+	{
+		if (!journal_) return;
+
+		model::Archive record;
+		std::string session{ name };
+		record.field(kind);
+		record.field(session);
+		journal_->append(record.getBuffer().data(), record.getBuffer().size());
+	}
+
+	void CommandManager::recordJump(size_t from)
+	{
+		if (!journal_ || getPosition() == from) return;
+
+		model::Archive record;
+		auto kind = static_cast<std::uint64_t>(Record::Jump);
+		std::uint64_t number{ getPosition() };
+		record.field(kind);
+		record.field(number);
+		journal_->append(record.getBuffer().data(), record.getBuffer().size());
 	}
 
 }
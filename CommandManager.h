@@ -25,7 +25,15 @@
 #define COMMAND_MANAGER_H
 
 #include <memory>
+#include <string>
+#include <vector>
 #include "Command.h"
+#include "Stack.h"
+
+namespace utility
+{
+	class Journal;
+}
 
 namespace control {
 
@@ -35,8 +43,20 @@ namespace control {
 		class UndoRedoStackStrategy;
 		class UndoRedoListStrategyVector;
 		class UndoRedoListStrategy;
+		class UndoRedoTreeStrategy;
 	public:
-		enum class UndoRedoStrategy { ListStrategy, StackStrategy, ListStrategyVector };
+		// the tree keeps the commands undone when a new one is executed as a branch
+		// of the history, the others forget them
+		enum class UndoRedoStrategy { ListStrategy, StackStrategy, ListStrategyVector, TreeStrategy };
+
+		// the end of a line of commands in the undo history
+		struct Branch
+		{
+			size_t number;		// the point of the history jumpTo takes
+			size_t length;		// commands from the start of the history
+			std::string last;	// the name of its last command
+			bool active;		// the one redo goes along
+		};
 
 		explicit CommandManager(UndoRedoStrategy st = UndoRedoStrategy::StackStrategy);
 		~CommandManager();
@@ -46,7 +66,8 @@ namespace control {
 
 		// This function call executes the command, enters the new command onto the undo stack,
 		// and it clears the redo stack. This is consistent with typical undo/redo functionality.
-		void executeCommand(CommandPtr c);
+		// A command whose conditions fail leaves stack and history as they were and returns why.
+		utility::Status executeCommand(CommandPtr c);
 
 		// This function undoes the command at the top of the undo stack and moves this command
 		// to the redo stack. It does nothing if the undo stack is empty.
@@ -54,7 +75,87 @@ namespace control {
 
 		// This function executes the command at the top of the redo stack and moves this command
 		// to the undo stack. It does nothing if the redo stack is empty.
-		void redo();
+		utility::Status redo();
+
+		// Every point of the history has a number, the start is 0. getPosition is the
+		// point the stack is at, getBranches the ends of the history oldest first, and
+		// jumpTo undoes and redoes the commands between the position and number. Only
+		// the tree has more than one branch.
+		size_t getPosition() const;
+		std::vector<Branch> getBranches() const;
+		utility::Status jumpTo(size_t number);
+
+		// The whole history, for snapshots: every point after the start with the
+		// command leading to it, each after the point it follows, the position, the
+		// last number given and the branches off the active line in the order they
+		// were left. A history without branches is one line numbered 1 to n and
+		// keeps only the active line of another. setHistory replaces the history,
+		// the commands must fit the stack as it is then.
+		template<typename C>
+		struct History
+		{
+			struct Point
+			{
+				size_t number;
+				size_t parent;		// the number of the point it follows
+				bool active;		// the one redo goes to from there
+				C command;
+			};
+			std::vector<Point> points;
+			size_t position;
+			size_t numbered;
+			std::vector<size_t> abandoned;
+		};
+		void getHistory(History<const Command*>& history) const;
+		void setHistory(History<CommandPtr> history);
+
+		// From now on every command executed, undone or redone is recorded in the
+		// journal, nullptr stops it. The journal must outlive the manager.
+		void setJournal(utility::Journal* journal);
+
+		// Starts the journal over from the snapshot at path, which holds everything
+		// recorded until then. Does nothing without a journal.
+		void restartJournal(const std::string& snapshotPath);
+
+		// Applies one journal record to the stack and the history: runs the command
+		// again, undoes, redoes or restores the snapshot. Throws if it cannot.
+		void replay(const char* record, size_t size);
+
+		// Sessions share the stack: fork opens a session named name on the stack as it
+		// is, with a history of its own, and goes over to it; switchTo goes to another
+		// session. A session left keeps a checkpoint of its stack, which shares the
+		// storage with the others until one of them writes to it. The first is "main".
+		void fork(const std::string& name);
+		void switchTo(const std::string& name);
+		const std::string& getSessionName() const;
+
+		// The sessions not running, for snapshots, each with the checkpoint of its
+		// stack and its history. setSessions replaces them and renames the
+		// running one, whose stack and history stay as they are.
+		template<typename C>
+		struct SessionState
+		{
+			std::string name;
+			model::Stack::Checkpoint stack;
+			History<C> history;
+		};
+		std::vector<SessionState<const Command*>> getSessions() const;
+		void setSessions(const std::string& running, std::vector<SessionState<CommandPtr>> sessions);
+
+		// Registers the tokens as the command name: a macro runs them as one by a
+		// MacroCommand, a function compiles them into the Program of a
+		// FunctionCommand. A name defined by the user may be defined again, a
+		// built in command not. The definitions go into the journal and the
+		// snapshots, oldest first.
+		enum class Kind : std::uint64_t { Macro, Function };
+		struct Definition
+		{
+			std::string name;
+			std::vector<std::string> tokens;
+			Kind kind;
+		};
+		void define(const std::string& name, const std::vector<std::string>& tokens, Kind kind);
+		const std::vector<Definition>& getDefinitions() const;
 
 	private:
 		CommandManager(CommandManager&) = delete;
@@ -62,7 +163,20 @@ namespace control {
 		CommandManager& operator=(CommandManager&) = delete;
 		CommandManager& operator=(CommandManager&&) = delete;
 
+		static std::unique_ptr<CommandManagerImpl> makeHistory(UndoRedoStrategy st);
+
+		struct Session;
+		void recordSession(std::uint64_t kind, const std::string& name);
+		void recordJump(size_t from);
+
 		std::unique_ptr<CommandManagerImpl> pimpl_;
+		utility::Journal* journal_;
+
+		UndoRedoStrategy strategy_;
+		std::string session_;
+		std::vector<Session> sessions_;		// the ones not running
+
+		std::vector<Definition> definitions_;
 	};
 
 }
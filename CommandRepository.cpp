@@ -31,6 +31,13 @@ using std::set;
 
 namespace control {
 
+	namespace
+	{
+		// the repository a Scope made current on this thread, nullptr for the
+		// process wide one
+		thread_local CommandRepository* t_current = nullptr;
+	}
+
 	class CommandRepository::CommandRepositoryImpl
 	{
 	public:
@@ -98,7 +105,10 @@ namespace control {
 			throw utility::Exception{ oss.str() };
 		}
 		else
+		{
+			c->setName(name);
 			m_repository.emplace(name, std::move(c));
+		}
 
 		return;
 	}
@@ -135,10 +145,33 @@ namespace control {
 
 	CommandRepository& CommandRepository::getInstance()
 	{
+		if (t_current) return *t_current;
+
 		static CommandRepository instance;
 		return instance;
 	}
 
+	void CommandRepository::Deleter::operator()(CommandRepository* r) const
+	{
+		delete r;
+	}
+
+	CommandRepository::Owner CommandRepository::create()
+	{
+		return Owner{ new CommandRepository };
+	}
+
+	CommandRepository::Scope::Scope(CommandRepository& r)
+		: m_previous{ t_current }
+	{
+		t_current = &r;
+	}
+
+	CommandRepository::Scope::~Scope()
+	{
+		t_current = m_previous;
+	}
+
 	void CommandRepository::registerCommand(const string& name, CommandPtr c)
 	{
 		pimpl_->registerCommand(name, std::move(c));
@@ -182,5 +215,63 @@ namespace control {
 		return;
 	}
 
-}
+	void registerCoreCommands(CommandRepository& repository)
+	{
+		repository.registerCommand("+", MakeCommandPtr<AddCommand>());
+		repository.registerCommand("-", MakeCommandPtr<SubstractCommand>());
+		repository.registerCommand("*", MakeCommandPtr<MultiplyCommand>());
+		repository.registerCommand("/", MakeCommandPtr<DivideCommand>());
+
+		repository.registerCommand("cos", MakeCommandPtr<CosineCommand>());
+		repository.registerCommand("arccos", MakeCommandPtr<ACosineCommand>());
+		repository.registerCommand("arcsin", MakeCommandPtr<ASineCommand>());
+		repository.registerCommand("arctan", MakeCommandPtr<ATangentCommand>());
+		repository.registerCommand("sin", MakeCommandPtr<SineCommand>());
+		repository.registerCommand("tan", MakeCommandPtr<TangentCommand>());
+
+		repository.registerCommand("swap", MakeCommandPtr<SwapCommand>());
+		repository.registerCommand("clear", MakeCommandPtr<ClearCommand>());
+		repository.registerCommand("drop", MakeCommandPtr<DropCommand>());
+
+		repository.registerCommand("sum", MakeCommandPtr<SumCommand>());
+		repository.registerCommand("sumn", MakeCommandPtr<SumCommand>(ReductionCommand::Range::TopN));
+		repository.registerCommand("prod", MakeCommandPtr<ProductCommand>());
+		repository.registerCommand("prodn", MakeCommandPtr<ProductCommand>(ReductionCommand::Range::TopN));
+		repository.registerCommand("mean", MakeCommandPtr<MeanCommand>());
+		repository.registerCommand("meann", MakeCommandPtr<MeanCommand>(ReductionCommand::Range::TopN));
+		repository.registerCommand("min", MakeCommandPtr<MinCommand>());
+		repository.registerCommand("minn", MakeCommandPtr<MinCommand>(ReductionCommand::Range::TopN));
+		repository.registerCommand("max", MakeCommandPtr<MaxCommand>());
+		repository.registerCommand("maxn", MakeCommandPtr<MaxCommand>(ReductionCommand::Range::TopN));
+		repository.registerCommand("norm", MakeCommandPtr<NormCommand>());
+		repository.registerCommand("normn", MakeCommandPtr<NormCommand>(ReductionCommand::Range::TopN));
+
+		repository.registerCommand("vec", MakeCommandPtr<PackCommand>());
+		repository.registerCommand("unvec", MakeCommandPtr<UnpackCommand>());
+		repository.registerCommand("mat", MakeCommandPtr<ReshapeCommand>());
+		repository.registerCommand("unmat", MakeCommandPtr<FlattenCommand>());
+		repository.registerCommand("transpose", MakeCommandPtr<TransposeCommand>());
+		repository.registerCommand("matmul", MakeCommandPtr<MatMulCommand>());
+		repository.registerCommand("solve", MakeCommandPtr<SolveCommand>());
+
+		repository.registerCommand("sort", MakeCommandPtr<SortCommand>());
+		repository.registerCommand("topk", MakeCommandPtr<TopKCommand>());
+		repository.registerCommand("median", MakeCommandPtr<QuantileCommand>());
+		repository.registerCommand("pct", MakeCommandPtr<QuantileCommand>(QuantileCommand::Mode::Percentile));
+
+		repository.registerCommand("cumsum", MakeCommandPtr<CumulativeSumCommand>());
+		repository.registerCommand("cumprod", MakeCommandPtr<CumulativeProductCommand>());
+		repository.registerCommand("wsum", MakeCommandPtr<WindowSumCommand>());
+		repository.registerCommand("wmean", MakeCommandPtr<WindowMeanCommand>());
+		repository.registerCommand("wmin", MakeCommandPtr<WindowMinCommand>());
+		repository.registerCommand("wmax", MakeCommandPtr<WindowMaxCommand>());
+
+		repository.registerCommand("iota", MakeCommandPtr<IotaCommand>());
+		repository.registerCommand("fill", MakeCommandPtr<FillCommand>());
+		repository.registerCommand("rand", MakeCommandPtr<RandomCommand>());
+		repository.registerCommand("srand", MakeCommandPtr<RandomCommand>(RandomCommand::Mode::Seeded));
+
+		repository.registerCommand("load", MakeCommandPtr<LoadCommand>());
+	}
 
+}
@@ -40,8 +40,32 @@ namespace control {
 	{
 		class CommandRepositoryImpl;
 	public:
+		// the repository of the calling thread: the process wide one unless a
+		// Scope made another one current there
 		static CommandRepository& getInstance();
 
+		// A repository apart from the process wide one, for an Engine with
+		// definitions of its own. While a Scope of it is alive getInstance
+		// returns it on the thread that made the Scope; scopes nest
+		struct Deleter
+		{
+			void operator()(CommandRepository* r) const;
+		};
+		using Owner = std::unique_ptr<CommandRepository, Deleter>;
+		static Owner create();
+
+		class Scope
+		{
+		public:
+			explicit Scope(CommandRepository& r);
+			~Scope();
+		private:
+			CommandRepository* m_previous;
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+		};
+
 		// register a new command for the factory: throws if a command with the
 		// same name already exists...deregister first to replace a command
 		void registerCommand(const std::string& name, CommandPtr c);
@@ -82,6 +106,10 @@ namespace control {
 		std::unique_ptr<CommandRepositoryImpl> pimpl_;
 	};
 
+	// registers the commands built into the calculator, "+" to "load": throws
+	// if one of the names is taken
+	void registerCoreCommands(CommandRepository& repository);
+
 }
 #endif
 
@@ -0,0 +1,458 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "DataFile.h"
+#include "Exception.h"
+#include "ThreadPool.h"
+#include<algorithm>
+#include<cctype>
+#include<charconv>
+#include<cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include<Windows.h>
+#else
+#include<fcntl.h>
+#include<limits.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/uio.h>
+#include<unistd.h>
+#endif
+
+namespace utility
+{
+	namespace
+	{
+		// the bytes of text one task parses, moved on to the next separator
+		const size_t ParseChunk = 1 << 20;
+
+		// the numbers one task formats, and the chunks formatted before they
+		// are written, which bounds the memory a long text takes
+		const size_t FormatChunk = 1 << 16;
+		const size_t FormatBatch = 64;
+
+		// the most one system call is asked to write
+		const size_t WriteBlock = size_t{ 1 } << 30;
+
+		inline bool isSeparator(char c)
+		{
+			return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == ',' || c == ';' || c == '\f' || c == '\v';
+		}
+
+		struct ParsedChunk
+		{
+			std::vector<double> numbers;
+			size_t error;		// offset of the first bad token, or npos
+		};
+
+		void parseChunk(const char* text, size_t first, size_t last, ParsedChunk& chunk)
+		{
+			chunk.error = std::string::npos;
+			chunk.numbers.reserve((last - first) / 8);
+
+			const char* p{ text + first };
+			const char* end{ text + last };
+			for (;;)
+			{
+				while (p != end && isSeparator(*p))
+					++p;
+				if (p == end)
+					return;
+
+				// from_chars does not take the plus sign
+				const char* token{ p };
+				if (*p == '+' && p + 1 != end && p[1] != '-')
+					++p;
+
+				double d;
+				auto r = std::from_chars(p, end, d);
+				if (r.ec != std::errc{} || (r.ptr != end && !isSeparator(*r.ptr)))
+				{
+					// an out of range number still is a number: it becomes an infinity or zero
+					if (r.ec == std::errc::result_out_of_range && (r.ptr == end || isSeparator(*r.ptr)))
+						d = std::strtod(std::string(p, r.ptr).c_str(), nullptr);
+					else
+					{
+						chunk.error = static_cast<size_t>(token - text);
+						return;
+					}
+				}
+
+				chunk.numbers.push_back(d);
+				p = r.ptr;
+			}
+		}
+
+		// n numbers in shortest round trip form, one per line
+		void formatChunk(const double* first, size_t n, std::string& out)
+		{
+			// 24 characters take any double and its new line
+			out.resize(n * 25);
+			char* p{ &out[0] };
+			char* end{ p + out.size() };
+			for (size_t i = 0; i < n; ++i)
+			{
+				p = std::to_chars(p, end, first[i]).ptr;
+				*p++ = '\n';
+			}
+			out.resize(static_cast<size_t>(p - out.data()));
+		}
+
+		// an open file being written, in order, from pieces of memory
+		class OutputFile
+		{
+		public:
+			explicit OutputFile(const std::string& path) :m_path{ path }
+			{
+#ifdef _WIN32
+				m_file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+					FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+				if (m_file == INVALID_HANDLE_VALUE)
+#else
+				m_file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+				if (m_file < 0)
+#endif
+					throw Exception("Warning: cannot create " + path);
+			}
+
+			~OutputFile()
+			{
+#ifdef _WIN32
+				CloseHandle(m_file);
+#else
+				::close(m_file);
+#endif
+			}
+
+			void write(const char* data, size_t size)
+			{
+				std::vector<Piece> pieces{ { data, size } };
+				write(pieces);
+			}
+
+			// the pieces go out in order; on posix as few writev calls as
+			// the system allows, so they are not copied together first
+			using Piece = FilePiece;
+
+			void write(std::vector<Piece>& pieces)
+			{
+#ifdef _WIN32
+				for (auto& piece : pieces)
+					while (piece.size > 0)
+					{
+						DWORD written{ 0 };
+						DWORD block{ static_cast<DWORD>(std::min(piece.size, WriteBlock)) };
+						if (!WriteFile(m_file, piece.data, block, &written, nullptr) || written == 0)
+							throw Exception("Warning: cannot write to " + m_path);
+						piece.data += written;
+						piece.size -= written;
+					}
+#else
+				std::vector<iovec> vectors;
+				size_t next{ 0 };
+				while (next < pieces.size())
+				{
+					vectors.clear();
+					size_t bytes{ 0 };
+					for (size_t i = next; i < pieces.size() && vectors.size() < IOV_MAX && bytes < WriteBlock; ++i)
+					{
+						size_t size{ std::min(pieces[i].size, WriteBlock - bytes) };
+						vectors.push_back({ const_cast<char*>(pieces[i].data), size });
+						bytes += size;
+					}
+
+					ssize_t written{ ::writev(m_file, vectors.data(), static_cast<int>(vectors.size())) };
+					if (written <= 0)
+						throw Exception("Warning: cannot write to " + m_path);
+
+					// a short write leaves the rest of a piece for the next call
+					size_t left{ static_cast<size_t>(written) };
+					while (next < pieces.size() && left >= pieces[next].size)
+						left -= pieces[next++].size;
+					if (next < pieces.size())
+					{
+						pieces[next].data += left;
+						pieces[next].size -= left;
+					}
+				}
+#endif
+			}
+
+		private:
+			std::string m_path;
+#ifdef _WIN32
+			HANDLE m_file;
+#else
+			int m_file;
+#endif
+
+		private:
+			OutputFile(const OutputFile&) = delete;
+			OutputFile& operator=(const OutputFile&) = delete;
+		};
+	}
+
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& path)
+		:m_data{ nullptr }, m_size{ 0 }, m_file{ INVALID_HANDLE_VALUE }, m_mapping{ nullptr }
+	{
+		m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+			throw Exception("Warning: cannot open " + path);
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size))
+		{
+			CloseHandle(m_file);
+			throw Exception("Warning: cannot read the size of " + path);
+		}
+
+		// an empty file cannot be mapped, there is nothing to map anyway
+		m_size = static_cast<size_t>(size.QuadPart);
+		if (m_size == 0)
+			return;
+
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping)
+			m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+
+		if (!m_data)
+		{
+			if (m_mapping) CloseHandle(m_mapping);
+			CloseHandle(m_file);
+			throw Exception("Warning: cannot map " + path + " into memory");
+		}
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_data) UnmapViewOfFile(m_data);
+		if (m_mapping) CloseHandle(m_mapping);
+		CloseHandle(m_file);
+	}
+#else
+	MappedFile::MappedFile(const std::string& path)
+		:m_data{ nullptr }, m_size{ 0 }, m_file{ -1 }
+	{
+		m_file = ::open(path.c_str(), O_RDONLY);
+		if (m_file < 0)
+			throw Exception("Warning: cannot open " + path);
+
+		struct stat st;
+		if (::fstat(m_file, &st) != 0)
+		{
+			::close(m_file);
+			throw Exception("Warning: cannot read the size of " + path);
+		}
+
+		m_size = static_cast<size_t>(st.st_size);
+		if (m_size == 0)
+			return;
+
+		void* p{ ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0) };
+		if (p == MAP_FAILED)
+		{
+			::close(m_file);
+			throw Exception("Warning: cannot map " + path + " into memory");
+		}
+
+		::madvise(p, m_size, MADV_SEQUENTIAL);
+		m_data = static_cast<const char*>(p);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_data) ::munmap(const_cast<char*>(m_data), m_size);
+		::close(m_file);
+	}
+#endif
+
+	size_t byteOrderMark(const char* data, size_t size)
+	{
+		return size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0 ? 3 : 0;
+	}
+
+	void parseNumbers(const char* text, size_t size, std::vector<double>& out)
+	{
+		// chunk boundaries move forward to a separator, so no number is cut
+		std::vector<size_t> bounds{ 0 };
+		while (bounds.back() < size)
+		{
+			size_t b{ std::min(size, bounds.back() + ParseChunk) };
+			while (b < size && !isSeparator(text[b]))
+				++b;
+			bounds.push_back(b);
+		}
+
+		std::vector<ParsedChunk> chunks(bounds.size() - 1);
+		auto& pool = ThreadPool::getInstance();
+		pool.parallelFor(chunks.size(), 1, [&](size_t c0, size_t c1)
+		{
+			for (size_t c = c0; c < c1; ++c)
+				parseChunk(text, bounds[c], bounds[c + 1], chunks[c]);
+		});
+
+		std::vector<size_t> offsets(chunks.size() + 1, out.size());
+		for (size_t c = 0; c < chunks.size(); ++c)
+		{
+			if (chunks[c].error != std::string::npos)
+			{
+				size_t at{ chunks[c].error };
+				size_t length{ 0 };
+				while (at + length < size && length < 20 && !isSeparator(text[at + length]))
+					++length;
+				throw Exception("Warning: '" + std::string(text + at, length) + "' at byte "
+					+ std::to_string(at) + " is not a number");
+			}
+			offsets[c + 1] = offsets[c] + chunks[c].numbers.size();
+		}
+
+		out.resize(offsets.back());
+		pool.parallelFor(chunks.size(), 1, [&](size_t c0, size_t c1)
+		{
+			for (size_t c = c0; c < c1; ++c)
+			{
+				std::copy(chunks[c].numbers.begin(), chunks[c].numbers.end(), out.begin() + offsets[c]);
+				std::vector<double>{}.swap(chunks[c].numbers);
+			}
+		});
+	}
+
+	void copyBinaryNumbers(const char* data, size_t size, std::vector<double>& out)
+	{
+		if (size % sizeof(double) != 0)
+			throw Exception("Warning: a binary file must hold whole doubles, its size must be a multiple of 8");
+
+		// the supported platforms are little endian, the bytes are the doubles
+		size_t first{ out.size() };
+		out.resize(first + size / sizeof(double));
+		char* to{ reinterpret_cast<char*>(out.data() + first) };
+		ThreadPool::getInstance().parallelFor(size, ParseChunk, [=](size_t i, size_t j)
+		{
+			std::memcpy(to + i, data + i, j - i);
+		});
+	}
+
+	void readNumbers(const std::string& path, std::vector<double>& out)
+	{
+		// the path tells, as for writing: text that merely looks odd, like a
+		// header in utf-8, is never taken for doubles
+		MappedFile file{ path };
+		if (formatOfPath(path) == DataFormat::Binary)
+		{
+			copyBinaryNumbers(file.data(), file.size(), out);
+			return;
+		}
+
+		size_t mark{ byteOrderMark(file.data(), file.size()) };
+		const char* text{ file.data() + mark };
+		size_t size{ file.size() - mark };
+		size_t line{ static_cast<size_t>(std::find(text, text + size, '\n') - text) };
+		ParsedChunk header;
+		parseChunk(text, 0, line, header);
+		if (header.error != std::string::npos)
+		{
+			line = std::min(line + 1, size);
+			text += line;
+			size -= line;
+		}
+
+		parseNumbers(text, size, out);
+	}
+
+	DataFormat formatOfPath(const std::string& path)
+	{
+		auto endsWith = [&](const char* suffix)
+		{
+			size_t n{ std::strlen(suffix) };
+			if (path.size() < n)
+				return false;
+
+			for (size_t i = 0; i < n; ++i)
+				if (std::tolower(static_cast<unsigned char>(path[path.size() - n + i])) != suffix[i])
+					return false;
+			return true;
+		};
+
+		if (endsWith(".bin"))
+			return DataFormat::Binary;
+		if (endsWith(".csv"))
+			return DataFormat::Csv;
+		return DataFormat::Text;
+	}
+
+	void writeNumbers(const std::string& path, const double* first, size_t n, DataFormat format)
+	{
+		writeNumbers(path, std::vector<NumberRange>{ { first, n } }, format);
+	}
+
+	void writeNumbers(const std::string& path, const std::vector<NumberRange>& ranges, DataFormat format)
+	{
+		OutputFile file{ path };
+		if (format == DataFormat::Binary)
+		{
+			std::vector<OutputFile::Piece> pieces;
+			for (const auto& r : ranges)
+				pieces.push_back({ reinterpret_cast<const char*>(r.first), r.n * sizeof(double) });
+			file.write(pieces);
+			return;
+		}
+
+		if (format == DataFormat::Csv)
+			file.write("value\n", 6);
+
+		// formatted in parallel a batch at a time, written in order
+		std::vector<std::string> chunks(FormatBatch);
+		std::vector<OutputFile::Piece> pieces;
+		for (const auto& r : ranges)
+		{
+			const double* first{ r.first };
+			size_t n{ r.n };
+			for (size_t batch = 0; batch < n; batch += FormatBatch * FormatChunk)
+			{
+				size_t count{ std::min(FormatBatch, (n - batch + FormatChunk - 1) / FormatChunk) };
+				ThreadPool::getInstance().parallelFor(count, 1, [&](size_t c0, size_t c1)
+				{
+					for (size_t c = c0; c < c1; ++c)
+					{
+						size_t begin{ batch + c * FormatChunk };
+						formatChunk(first + begin, std::min(FormatChunk, n - begin), chunks[c]);
+					}
+				});
+
+				pieces.clear();
+				for (size_t c = 0; c < count; ++c)
+					pieces.push_back({ chunks[c].data(), chunks[c].size() });
+				file.write(pieces);
+			}
+		}
+	}
+
+	void writeFile(const std::string& path, std::vector<FilePiece>& pieces)
+	{
+		OutputFile file{ path };
+		file.write(pieces);
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DATA_FILE_H
+#define DATA_FILE_H
+#include<cstddef>
+#include<string>
+#include<vector>
+
+namespace utility
+{
+	/*
+		Bulk transfer of numbers between files and ranges of doubles, for
+		stacks far too long to go through the Cli one token at a time.
+
+		Files are read through a memory mapping. Text is split into chunks at
+		separators and the chunks are parsed in parallel with from_chars; a
+		.bin file of raw little endian doubles is taken over without parsing.
+		Writing formats chunks of text in parallel with to_chars and hands
+		them to the system in order, binary data goes out straight from the
+		range. Failures throw a utility::Exception naming the file.
+	*/
+
+	// Text holds one number per line, Csv the same column under a "value"
+	// header, Binary the raw little endian doubles
+	enum class DataFormat { Text, Binary, Csv };
+
+	// a whole file mapped read only into memory; throws if it cannot be opened
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::string& path);
+		~MappedFile();
+
+		const char* data()const { return m_data; }
+		size_t size()const { return m_size; }
+
+	private:
+		const char* m_data;
+		size_t m_size;
+#ifdef _WIN32
+		void* m_file;
+		void* m_mapping;
+#else
+		int m_file;
+#endif
+
+	private:
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&&) = delete;
+	};
+
+	// the length of the utf-8 byte order mark data starts with, 0 without one
+	size_t byteOrderMark(const char* data, size_t size);
+
+	// appends the numbers of text separated by white space, commas or
+	// semicolons to out, in order; throws with the byte offset of the first
+	// token that is not a number
+	void parseNumbers(const char* text, size_t size, std::vector<double>& out);
+
+	// appends size / 8 raw little endian doubles to out; throws if size is
+	// not a multiple of 8
+	void copyBinaryNumbers(const char* data, size_t size, std::vector<double>& out);
+
+	// the numbers of a file, appended to out: raw doubles for a path ending in
+	// .bin, text otherwise; a byte order mark and a first line of text that
+	// is not made of numbers, like a csv header, are skipped
+	void readNumbers(const std::string& path, std::vector<double>& out);
+
+	// Binary for a path ending in .bin, Csv for .csv, Text for anything else
+	DataFormat formatOfPath(const std::string& path);
+
+	// replaces the file at path with the n numbers from first on, shortest
+	// round trip text for Text and Csv
+	void writeNumbers(const std::string& path, const double* first, size_t n, DataFormat format);
+
+	// the same for numbers kept in several ranges, written one after the other
+	struct NumberRange
+	{
+		const double* first;
+		size_t n;
+	};
+	void writeNumbers(const std::string& path, const std::vector<NumberRange>& ranges, DataFormat format);
+
+	// a range of bytes, one of the parts of a file being written
+	struct FilePiece
+	{
+		const char* data;
+		size_t size;
+	};
+
+	// replaces the file at path with the pieces one after the other, handing
+	// them to the system as they are instead of copying them together
+	void writeFile(const std::string& path, std::vector<FilePiece>& pieces);
+}
+#endif // !DATA_FILE_H
@@ -0,0 +1,391 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "Engine.h"
+#include<algorithm>
+#include<cctype>
+#include<stdexcept>
+#include<cmath>
+#include<limits>
+#include"Exception.h"
+#include"Program.h"
+#include"ThreadPool.h"
+#include"Tokenizer.h"
+
+namespace control
+{
+	namespace
+	{
+		bool isSpace(char c)
+		{
+			return std::isspace(static_cast<unsigned char>(c)) != 0;
+		}
+
+		// parseNumber throws where the word has the form of a number but is
+		// none a double holds, like 1e999
+		bool isNumber(const std::string& word, double& d)
+		{
+			try
+			{
+				return utility::parseNumber(word, d);
+			}
+			catch (std::logic_error&)
+			{
+				throw utility::Exception("Warning: " + word + " is not a number a double can hold");
+			}
+		}
+
+		// inputs of a batch per piece of the ThreadPool, and the most kept
+		// compiled before the cache starts over
+		const size_t BatchGrain = 64;
+		const size_t MaxCompiled = 1 << 16;
+
+		// a program of a batch runs on its own operands only
+		const Program::Below NothingBelow = [](size_t) -> utility::Expected<double>
+		{
+			return utility::Status::failure("Warning: Stack has too few arguments for this command!");
+		};
+	}
+
+	const char* getMessage(ErrorCode code)
+	{
+		switch (code)
+		{
+		case ErrorCode::None: return "";
+		case ErrorCode::UnknownWord: return "a word is not a number, a command or a definition";
+		case ErrorCode::BadNumber: return "a number is too large for a double";
+		case ErrorCode::Incomplete: return "a command is missing its argument";
+		case ErrorCode::Failed: return "a command could not run";
+		case ErrorCode::NoResult: return "the stack is empty";
+		case ErrorCode::NotScalar: return "the result is a vector or a matrix";
+		}
+		return "";
+	}
+
+	// what a thread runs the inputs of batches with, kept for the next batch
+	struct Engine::BatchContext
+	{
+		model::Stack::Owner stack{ model::Stack::create() };
+		model::ExpressionGraph::Owner graph{ model::ExpressionGraph::create() };
+		std::vector<double> operands;
+
+		static BatchContext& get()
+		{
+			thread_local BatchContext context;
+			return context;
+		}
+	};
+
+	Engine::Scope::Scope(Engine& e)
+		: m_stack{ *e.m_stack }
+		, m_repository{ *e.m_repository }
+		, m_graph{ *e.m_graph }
+	{
+	}
+
+	Engine::Engine()
+		: m_stack{ model::Stack::create() }
+		, m_repository{ CommandRepository::create() }
+		, m_graph{ model::ExpressionGraph::create() }
+		, m_pending{ nullptr, &CommandDeleter }
+		, m_recordingKind{ CommandManager::Kind::Macro }
+	{
+		registerCoreCommands(*m_repository);
+	}
+
+	Engine::~Engine()
+	{
+	}
+
+	Engine::Result Engine::evaluate(std::string_view input, double* out, size_t capacity)
+	{
+		Scope scope{ *this };
+		m_error.clear();
+
+		try
+		{
+			auto first = input.begin();
+			while (true)
+			{
+				first = std::find_if_not(first, input.end(), isSpace);
+				if (first == input.end()) break;
+				auto last = std::find_if(first, input.end(), isSpace);
+				m_word.assign(first, last);
+				auto status = run(m_word);
+				if (!status)
+				{
+					m_error = status.message();
+					break;
+				}
+				first = last;
+			}
+			if (m_error.empty()) finish();
+		}
+		catch (utility::Exception& e)
+		{
+			m_error = e.what();
+		}
+
+		if (!m_error.empty())
+		{
+			m_pending.reset();
+			m_pendingName.clear();
+			m_recording.clear();
+			m_definition.clear();
+		}
+
+		auto& stack = *m_stack;
+		Result result{ m_error.empty(), stack.size(), std::min(stack.size(), capacity) };
+		m_elements.clear();
+		stack.getElements(result.written, m_elements);
+		std::copy(m_elements.begin(), m_elements.begin() + result.written, out);
+
+		return result;
+	}
+
+	utility::Status Engine::run(const std::string& word)
+	{
+		m_name = word;
+		std::transform(m_name.begin(), m_name.end(), m_name.begin(), ::tolower);
+
+		if (!m_recording.empty())
+		{
+			if (m_name != "end")
+				m_definition.push_back(word);
+			else
+			{
+				std::string name;
+				std::vector<std::string> tokens;
+				name.swap(m_recording);
+				tokens.swap(m_definition);
+				m_manager.define(name, tokens, m_recordingKind);
+				m_compiled.clear();
+			}
+			return {};
+		}
+
+		// arguments keep their case, a path may need it
+		if (m_pending)
+		{
+			m_pending->setArgument(word);
+			m_pendingName.clear();
+			return m_manager.executeCommand(std::move(m_pending));
+		}
+
+		double d;
+		if (m_pendingName == "record" || m_pendingName == "def")
+		{
+			if (isNumber(m_name, d) || m_name == "undo" || m_name == "redo" || m_name == "lazy"
+				|| m_name == "eager" || m_name == "record" || m_name == "def" || m_name == "end")
+				throw utility::Exception("Warning: " + m_pendingName + " needs a name, not " + word);
+
+			m_recordingKind = m_pendingName == "record" ? CommandManager::Kind::Macro : CommandManager::Kind::Function;
+			m_recording = m_name;
+			m_pendingName.clear();
+			return {};
+		}
+
+		if (isNumber(m_name, d))
+			return m_manager.executeCommand(MakeCommandPtr<EnterNumber>(d));
+		else if (m_name == "undo")
+			m_manager.undo();
+		else if (m_name == "redo")
+			return m_manager.redo();
+		else if (m_name == "lazy" || m_name == "eager")
+			m_graph->setLazy(m_name == "lazy");
+		else if (m_name == "record" || m_name == "def")
+			m_pendingName = m_name;
+		else
+		{
+			auto c = m_repository->getCommandByName(m_name);
+			if (!c)
+				throw utility::Exception("Warning: " + word + " is not a known command");
+
+			if (c->takesArgument())
+			{
+				m_pending = std::move(c);
+				m_pendingName = m_name;
+			}
+			else return m_manager.executeCommand(std::move(c));
+		}
+
+		return {};
+	}
+
+	void Engine::finish()
+	{
+		// an input is complete on its own
+		if (!m_recording.empty())
+			throw utility::Exception("Warning: the definition of " + m_recording + " has no end");
+		if (!m_pendingName.empty())
+			throw utility::Exception("Warning: " + m_pendingName + " needs one more word");
+	}
+
+	void Engine::evaluateBatch(const std::string_view* exprs, size_t n, double* out, ErrorCode* errs, bool parallel)
+	{
+		Scope scope{ *this };
+
+		if (m_compiled.size() > MaxCompiled) m_compiled.clear();
+		m_batch.clear();
+		for (size_t i = 0; i < n; ++i)
+			m_batch.push_back(&compile(exprs[i]));
+
+		// every thread has a stack and an eager graph of its own, the
+		// repository is only read
+		auto body = [&](size_t first, size_t last)
+		{
+			auto& context = BatchContext::get();
+			model::Stack::Scope stack{ *context.stack };
+			CommandRepository::Scope repository{ *m_repository };
+			model::ExpressionGraph::Scope graph{ *context.graph };
+
+			for (size_t i = first; i < last; ++i)
+			{
+				out[i] = std::numeric_limits<double>::quiet_NaN();
+				errs[i] = runCompiled(*m_batch[i], context, out[i]);
+			}
+		};
+
+		if (parallel) utility::ThreadPool::getInstance().parallelFor(n, BatchGrain, body);
+		else body(0, n);
+	}
+
+	const Engine::Compiled& Engine::compile(std::string_view input)
+	{
+		m_word.assign(input.begin(), input.end());
+		auto known = m_compiled.find(m_word);
+		if (known != m_compiled.end()) return known->second;
+
+		auto& c = m_compiled[m_word];
+		c.error = ErrorCode::None;
+
+		m_tokens.clear();
+		auto first = input.begin();
+		while (true)
+		{
+			first = std::find_if_not(first, input.end(), isSpace);
+			if (first == input.end()) break;
+			auto last = std::find_if(first, input.end(), isSpace);
+			m_tokens.emplace_back(first, last);
+			first = last;
+		}
+
+		// a program runs without the commands, the stack or a clone; an input
+		// it does not cover goes to the commands
+		auto program = Program::compile(m_tokens, &FunctionCommand::find);
+		if (program)
+			c.program = std::move(*program);
+		else if (program.status().message() == Program::NumberOutOfRange)
+			c.error = ErrorCode::BadNumber;
+		else
+			compileSteps(c);
+		return c;
+	}
+
+	void Engine::compileSteps(Compiled& c)
+	{
+		CommandPtr pending{ nullptr, &CommandDeleter };
+		for (const auto& token : m_tokens)
+		{
+			if (pending)
+			{
+				c.steps.push_back({ 0.0, std::move(pending), token });
+				pending = CommandPtr{ nullptr, &CommandDeleter };
+				continue;
+			}
+
+			m_name = token;
+			std::transform(m_name.begin(), m_name.end(), m_name.begin(), ::tolower);
+
+			double d;
+			bool inRange;
+			if (utility::parseNumber(m_name, d, inRange))
+			{
+				if (!inRange)
+				{
+					c.error = ErrorCode::BadNumber;
+					break;
+				}
+				c.steps.push_back({ d, CommandPtr{ nullptr, &CommandDeleter }, {} });
+				continue;
+			}
+
+			auto command = m_repository->getCommandByName(m_name);
+			if (!command)
+			{
+				c.error = ErrorCode::UnknownWord;
+				break;
+			}
+			if (command->takesArgument()) pending = std::move(command);
+			else c.steps.push_back({ 0.0, std::move(command), {} });
+		}
+
+		if (c.error == ErrorCode::None && pending) c.error = ErrorCode::Incomplete;
+		if (c.error != ErrorCode::None) c.steps.clear();
+	}
+
+	ErrorCode Engine::runCompiled(const Compiled& c, BatchContext& context, double& result)
+	{
+		if (c.error != ErrorCode::None) return c.error;
+
+		try
+		{
+			if (c.program)
+			{
+				auto& operands = context.operands;
+				operands.clear();
+				if (!c.program->run(operands, NothingBelow)) return ErrorCode::Failed;
+				if (operands.empty()) return ErrorCode::NoResult;
+				result = operands.back();
+				return ErrorCode::None;
+			}
+
+			auto& stack = *context.stack;
+			stack.clear();
+			for (const auto& step : c.steps)
+			{
+				if (!step.command)
+				{
+					stack.push(step.number, false);
+					continue;
+				}
+
+				auto command = MakeCommandPtr(step.command->clone());
+				if (!step.argument.empty()) command->setArgument(step.argument);
+				if (!command->execute()) return ErrorCode::Failed;
+			}
+
+			if (stack.size() == 0) return ErrorCode::NoResult;
+			if (stack.hasArrays(1)) return ErrorCode::NotScalar;
+			result = stack.top();
+			return ErrorCode::None;
+		}
+		catch (utility::Exception&)
+		{
+			return ErrorCode::Failed;
+		}
+		catch (std::exception&)
+		{
+			// a bad_alloc or a logic_error of a command fails its input, not the batch
+			return ErrorCode::Failed;
+		}
+	}
+}
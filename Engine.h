@@ -0,0 +1,172 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef ENGINE_H
+#define ENGINE_H
+#include<cstddef>
+#include<cstdint>
+#include<memory>
+#include<string>
+#include<string_view>
+#include<unordered_map>
+#include<vector>
+#include"Command.h"
+#include"CommandManager.h"
+#include"CommandRepository.h"
+#include"Expression.h"
+#include"Stack.h"
+
+namespace control
+{
+	// how an input of a batch went
+	enum class ErrorCode : std::uint8_t
+	{
+		None,
+		UnknownWord,		// not a number, a command or a definition of the engine
+		BadNumber,			// a number a double cannot hold
+		Incomplete,			// a command without its argument at the end
+		Failed,				// a command refused to run, like a division by zero
+		NoResult,			// nothing left on the stack
+		NotScalar			// a vector or a matrix left on top
+	};
+
+	// a fixed description of the code, "" for None
+	const char* getMessage(ErrorCode code);
+
+	/*
+		The calculator embedded in another program, the entry point of
+		libnimpo. An engine owns everything a session needs: a stack, a
+		repository of the built in commands where its own macros and functions
+		go, a lazy mode with its arrays and an undo history. It writes nothing
+		anywhere and shares no state with other engines, so threads may run
+		one engine each at the same time; one engine is used by one thread at
+		a time. The process wide ThreadPool, math mode and kernels are shared.
+
+		evaluate takes the words the calculator takes: numbers, the commands
+		and their arguments, undo, redo, lazy, eager, and "record <name> ...
+		end" or "def <name> ... end" within one input. It stops at the first
+		word that fails, leaving the stack as the words before it left it.
+
+		evaluateBatch takes many inputs at once, each one on an empty stack of
+		its own with no history, and gives the top element each one leaves.
+		An input is compiled once and kept by its text: into a Program where
+		it only has words a function may have, otherwise into the commands it
+		runs. The inputs are spread over the ThreadPool, each thread runs them
+		on a stack it keeps from one batch to the next.
+	*/
+	class Engine
+	{
+	public:
+		struct Result
+		{
+			bool ok;			// every word ran, otherwise see getError
+			size_t size;		// elements on the stack after it
+			size_t written;		// of them in the buffer, the top first
+		};
+
+		Engine();
+		~Engine();
+
+		// Runs input, then writes the top min(size, capacity) elements of the
+		// stack to out, top first; a vector or matrix shows as NaN.
+		Result evaluate(std::string_view input, double* out, size_t capacity);
+
+		// why the last evaluate stopped, empty if it did not
+		const std::string& getError()const { return m_error; }
+
+		// Evaluates exprs[0, n) and writes what each one left on top to out[i],
+		// or NaN, and how it went to errs[i]; the engine's stack and history
+		// stay as they are. Throws nothing for a failing input. Where parallel
+		// is set the inputs are spread over the ThreadPool.
+		void evaluateBatch(const std::string_view* exprs, size_t n, double* out, ErrorCode* errs, bool parallel = true);
+
+	private:
+		// makes the stack, repository and graph of the engine the ones of the
+		// calling thread while it is alive
+		class Scope
+		{
+		public:
+			explicit Scope(Engine& e);
+		private:
+			model::Stack::Scope m_stack;
+			CommandRepository::Scope m_repository;
+			model::ExpressionGraph::Scope m_graph;
+		};
+
+		utility::Status run(const std::string& word);
+		void finish();
+
+		// an input of a batch ready to run
+		struct Compiled
+		{
+			struct Step
+			{
+				double number;			// pushed where there is no command
+				CommandPtr command;		// cloned to run
+				std::string argument;
+			};
+
+			ErrorCode error;			// why it cannot run
+			std::shared_ptr<const Program> program;
+			std::vector<Step> steps;	// where there is no program
+		};
+		struct BatchContext;
+
+		const Compiled& compile(std::string_view input);
+		void compileSteps(Compiled& c);
+		static ErrorCode runCompiled(const Compiled& c, BatchContext& context, double& result);
+
+		// declared first, they outlive the commands of the history
+		model::Stack::Owner m_stack;
+		CommandRepository::Owner m_repository;
+		model::ExpressionGraph::Owner m_graph;
+
+		CommandManager m_manager;
+
+		// the word being run, as entered and in lower case
+		std::string m_word;
+		std::string m_name;
+
+		// what the next word is for: an argument of m_pending, the name after
+		// record or def, or a word of the definition of m_recording
+		CommandPtr m_pending;
+		std::string m_pendingName;
+		std::string m_recording;
+		CommandManager::Kind m_recordingKind;
+		std::vector<std::string> m_definition;
+
+		std::vector<double> m_elements;
+		std::string m_error;
+
+		// the inputs of batches by their text, and those of the current one
+		std::unordered_map<std::string, Compiled> m_compiled;
+		std::vector<std::string> m_tokens;
+		std::vector<const Compiled*> m_batch;
+
+	private:
+		Engine(const Engine&) = delete;
+		Engine(Engine&&) = delete;
+		Engine& operator=(const Engine&) = delete;
+		Engine& operator=(Engine&&) = delete;
+	};
+}
+#endif // !ENGINE_H
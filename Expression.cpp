@@ -0,0 +1,326 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "Expression.h"
+#include<algorithm>
+#include<cstdint>
+#include<cstring>
+#include<vector>
+#include"ThreadPool.h"
+
+namespace model
+{
+	namespace
+	{
+		// elements of a block, few enough for the blocks of a whole graph to
+		// stay in the cache
+		const size_t Block = 1024;
+		const size_t ParallelGrain = size_t{ 1 } << 14;
+
+		// a deferred operand this deep is materialized before an operation is
+		// put on top of it, which bounds the plans and the recursion of the
+		// destructors of a chain
+		const size_t MaxDepth = 256;
+
+		// the graph a Scope made current on this thread, nullptr for the
+		// process wide one
+		thread_local ExpressionGraph* t_current = nullptr;
+
+		// what a step reads: a materialized array, the block of an earlier step
+		// or, for the missing right operand, nothing
+		struct Operand
+		{
+			const double* data;
+			size_t step;
+
+			bool isStep()const { return !data && step != None; }
+			static const size_t None = SIZE_MAX;
+		};
+
+		struct Step
+		{
+			const Expression* e;
+			Operand left;
+			Operand right;
+			size_t buffer;			// of its block; the last step writes to out
+		};
+
+		struct Plan
+		{
+			std::vector<Step> steps;
+			size_t buffers;
+		};
+
+		// the deferred expressions below root, each once, operands first
+		Plan makePlan(const Expression& root)
+		{
+			Plan plan{ {}, 0 };
+			std::unordered_map<const Expression*, size_t> index;
+
+			auto operand = [&index](const Array* a) -> Operand
+			{
+				if (!a) return { nullptr, Operand::None };
+				if (!a->isDeferred()) return { a->data(), Operand::None };
+				return { nullptr, index.at(a->getExpression().get()) };
+			};
+
+			std::vector<std::pair<const Expression*, bool>> work{ { &root, false } };
+			while (!work.empty())
+			{
+				auto next = work.back();
+				work.pop_back();
+				const Expression* e{ next.first };
+				if (index.count(e))
+					continue;
+
+				if (!next.second)
+				{
+					work.push_back({ e, true });
+					for (const Array* a : { e->left.get(), e->right.get() })
+						if (a && a->isDeferred() && !index.count(a->getExpression().get()))
+							work.push_back({ a->getExpression().get(), false });
+					continue;
+				}
+
+				index.emplace(e, plan.steps.size());
+				plan.steps.push_back({ e, operand(e->left.get()), operand(e->right.get()), 0 });
+			}
+
+			// a block is reused once the last step reading it is done
+			std::vector<size_t> lastUse(plan.steps.size(), 0);
+			for (size_t k = 0; k < plan.steps.size(); ++k)
+				for (const Operand* o : { &plan.steps[k].left, &plan.steps[k].right })
+					if (o->isStep())
+						lastUse[o->step] = k;
+
+			std::vector<size_t> free;
+			for (size_t k = 0; k + 1 < plan.steps.size(); ++k)
+			{
+				Step& s{ plan.steps[k] };
+				if (free.empty())
+					free.push_back(plan.buffers++);
+				s.buffer = free.back();
+				free.pop_back();
+
+				// x x * reads one step twice, its block goes back once
+				if (s.left.isStep() && lastUse[s.left.step] == k)
+					free.push_back(plan.steps[s.left.step].buffer);
+				if (s.right.isStep() && lastUse[s.right.step] == k && !(s.left.isStep() && s.left.step == s.right.step))
+					free.push_back(plan.steps[s.right.step].buffer);
+			}
+
+			return plan;
+		}
+
+		// the elements first + i, or at[i] if at is given, for i in [0, n)
+		void run(const Plan& plan, size_t first, const size_t* at, size_t n, double* out)
+		{
+			const auto& kernels = utility::KernelRegistry::getInstance().kernels();
+			const auto& math = utility::VectorMath::getInstance();
+
+			std::vector<double> blocks(plan.buffers * Block);
+			std::vector<double> gathered(at ? 2 * Block : 0);
+			for (size_t done = 0; done < n; done += Block)
+			{
+				size_t m{ std::min(Block, n - done) };
+				auto read = [&](const Operand& o, size_t side) -> const double*
+				{
+					if (o.isStep())
+						return blocks.data() + plan.steps[o.step].buffer * Block;
+					if (!at)
+						return o.data + first + done;
+
+					double* g{ gathered.data() + side * Block };
+					for (size_t i = 0; i < m; ++i)
+						g[i] = o.data[at[done + i]];
+					return g;
+				};
+
+				for (size_t k = 0; k < plan.steps.size(); ++k)
+				{
+					const Step& s{ plan.steps[k] };
+					const Expression& e{ *s.e };
+					double* to{ k + 1 == plan.steps.size() ? out + done : blocks.data() + s.buffer * Block };
+					auto op = static_cast<size_t>(e.op);
+					switch (e.kind)
+					{
+					case Expression::Kind::Function:
+						if (e.mode == utility::MathMode::Exact)
+							math.evaluateExact(e.function, read(s.left, 0), to, m);
+						else
+							math.evaluateFast(e.function, read(s.left, 0), to, m);
+						break;
+					case Expression::Kind::Elementwise:
+						kernels.elementwise[op](read(s.left, 0), read(s.right, 1), to, m);
+						break;
+					case Expression::Kind::BroadcastRight:
+						kernels.broadcastRight[op](read(s.left, 0), e.scalar, to, m);
+						break;
+					case Expression::Kind::BroadcastLeft:
+						kernels.broadcastLeft[op](read(s.left, 0), e.scalar, to, m);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	void Expression::evaluate(size_t first, size_t n, double* out) const
+	{
+		Plan plan{ makePlan(*this) };
+		if (n <= ParallelGrain)
+		{
+			run(plan, first, nullptr, n, out);
+			return;
+		}
+
+		utility::ThreadPool::getInstance().parallelFor(n, ParallelGrain, [&](size_t i, size_t j)
+		{
+			run(plan, first + i, nullptr, j - i, out + i);
+		});
+	}
+
+	void Expression::evaluateAt(const size_t* at, size_t n, double* out) const
+	{
+		run(makePlan(*this), 0, at, n, out);
+	}
+
+	ExpressionGraph& ExpressionGraph::getInstance()
+	{
+		if (t_current) return *t_current;
+
+		static ExpressionGraph instance;
+		return instance;
+	}
+
+	void ExpressionGraph::Deleter::operator()(ExpressionGraph* g) const
+	{
+		delete g;
+	}
+
+	ExpressionGraph::Owner ExpressionGraph::create()
+	{
+		return Owner{ new ExpressionGraph };
+	}
+
+	ExpressionGraph::Scope::Scope(ExpressionGraph& g)
+		: m_previous{ t_current }
+	{
+		t_current = &g;
+	}
+
+	ExpressionGraph::Scope::~Scope()
+	{
+		t_current = m_previous;
+	}
+
+	ExpressionGraph::ExpressionGraph()
+		: m_built{}, m_sweepAt{ 1024 }, m_lazy{ false }, m_statistics{}
+	{
+	}
+
+	ExpressionGraph::~ExpressionGraph()
+	{
+	}
+
+	bool ExpressionGraph::Key::operator==(const Key& k) const
+	{
+		return kind == k.kind && operation == k.operation && scalar == k.scalar && left == k.left && right == k.right;
+	}
+
+	size_t ExpressionGraph::KeyHash::operator()(const Key& k) const
+	{
+		size_t h{ std::hash<const Array*>{}(k.left) };
+		for (size_t x : { std::hash<const Array*>{}(k.right), std::hash<std::uint64_t>{}(k.scalar),
+			static_cast<size_t>(k.operation) << 2 | static_cast<size_t>(k.kind) })
+			h ^= x + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+		return h;
+	}
+
+	std::shared_ptr<const Array> ExpressionGraph::apply(utility::MathFunction f, const std::shared_ptr<const Array>& a)
+	{
+		return make({ Expression::Kind::Function, f, utility::VectorMath::getInstance().getMode(), utility::BinaryOp::Add, 0.0, a, nullptr, 0 });
+	}
+
+	std::shared_ptr<const Array> ExpressionGraph::apply(utility::BinaryOp op, const Value& next, const Value& top)
+	{
+		const auto noFunction = utility::MathFunction::Sin;
+		const auto mode = utility::MathMode::Exact;
+		if (top.isScalar())
+			return make({ Expression::Kind::BroadcastRight, noFunction, mode, op, top.getScalar(), next.getArray(), nullptr, 0 });
+		if (next.isScalar())
+			return make({ Expression::Kind::BroadcastLeft, noFunction, mode, op, next.getScalar(), top.getArray(), nullptr, 0 });
+		return make({ Expression::Kind::Elementwise, noFunction, mode, op, 0.0, next.getArray(), top.getArray(), 0 });
+	}
+
+	void ExpressionGraph::materialized(size_t elements)
+	{
+		++m_statistics.materialized;
+		m_statistics.elements += elements;
+	}
+
+	std::shared_ptr<const Array> ExpressionGraph::make(Expression e)
+	{
+		for (const auto* a : { &e.left, &e.right })
+		{
+			if (!*a || !(*a)->isDeferred())
+				continue;
+			if ((*a)->getExpression()->depth >= MaxDepth)
+				(*a)->data();
+			else
+				e.depth = std::max(e.depth, (*a)->getExpression()->depth);
+		}
+		++e.depth;
+
+		Key key{ e.kind, e.kind == Expression::Kind::Function
+			? static_cast<int>(e.function) | static_cast<int>(e.mode) << 8 : static_cast<int>(e.op),
+			0, e.left.get(), e.right.get() };
+		std::memcpy(&key.scalar, &e.scalar, sizeof key.scalar);
+
+		auto known = m_built.find(key);
+		if (known != m_built.end())
+		{
+			auto result = known->second.result.lock();
+			bool sameOperands{ known->second.left.lock() == e.left && known->second.right.lock() == e.right };
+			if (result && sameOperands)
+			{
+				++m_statistics.reused;
+				return result;
+			}
+		}
+
+		size_t n{ e.left->size() };
+		Entry entry{ {}, e.left, e.right };
+		auto result = std::make_shared<const Array>(n, std::make_shared<const Expression>(std::move(e)));
+		entry.result = result;
+		m_built[key] = std::move(entry);
+		++m_statistics.built;
+
+		if (m_built.size() >= m_sweepAt)
+		{
+			for (auto i = m_built.begin(); i != m_built.end(); )
+				i = i->second.result.expired() ? m_built.erase(i) : std::next(i);
+			m_sweepAt = std::max<size_t>(1024, 2 * m_built.size());
+		}
+
+		return result;
+	}
+}
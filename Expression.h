@@ -0,0 +1,158 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+#include<cstdint>
+#include<memory>
+#include<unordered_map>
+#include"Kernels.h"
+#include"Value.h"
+#include"VectorMath.h"
+
+namespace model
+{
+	// One element wise operation of lazy mode, the definition of a deferred
+	// array: a math function of an array, or an operator between two arrays
+	// or between an array and a scalar. The operands may be deferred
+	// themselves, so the expressions of the stack form a graph.
+	class Expression
+	{
+	public:
+		enum class Kind : unsigned char { Function, Elementwise, BroadcastRight, BroadcastLeft };
+
+		Kind kind;
+		utility::MathFunction function;		// of Function, in the mode it was entered in
+		utility::MathMode mode;
+		utility::BinaryOp op;				// of the others
+		double scalar;						// the right operand of BroadcastRight, the left one of BroadcastLeft
+		std::shared_ptr<const Array> left;	// the array operand, or the left one of Elementwise
+		std::shared_ptr<const Array> right;
+		size_t depth;						// of the deferred operands below, plus one
+
+		// Computes the elements [first, first + n) into out. The whole graph of
+		// deferred operands below is fused: it is run block by block, each block
+		// through every operation while it is in the cache, an operand reached
+		// twice is computed once per block, and none of them is materialized.
+		// Long ranges are split over the ThreadPool.
+		void evaluate(size_t first, size_t n, double* out)const;
+		// the same for the elements at the n positions
+		void evaluateAt(const size_t* at, size_t n, double* out)const;
+	};
+
+	/*
+		Lazy mode: the element wise commands on vectors and matrices build
+		deferred arrays instead of computing them. The elements are computed
+		when something reads them, like a command that is not element wise, a
+		save or a snapshot, and not at all if the array is dropped first. The
+		display reads the few elements it shows on their own. An operation
+		entered again on the same operands gives the array built before.
+		Scalars are always computed right away.
+	*/
+	class ExpressionGraph
+	{
+	public:
+		struct Statistics
+		{
+			std::uint64_t built;			// deferred arrays
+			std::uint64_t reused;			// an identical one that was still there
+			std::uint64_t materialized;		// deferred arrays computed in full
+			std::uint64_t elements;			// in them
+		};
+
+		// the graph of the calling thread: the process wide one unless a Scope
+		// made another one current there
+		static ExpressionGraph& getInstance();
+
+		// A graph apart from the process wide one, for an Engine with a mode
+		// and arrays of its own. While a Scope of it is alive getInstance
+		// returns it on the thread that made the Scope; scopes nest
+		struct Deleter
+		{
+			void operator()(ExpressionGraph* g) const;
+		};
+		using Owner = std::unique_ptr<ExpressionGraph, Deleter>;
+		static Owner create();
+
+		class Scope
+		{
+		public:
+			explicit Scope(ExpressionGraph& g);
+			~Scope();
+		private:
+			ExpressionGraph* m_previous;
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+		};
+
+		void setLazy(bool on) { m_lazy = on; }
+		bool isLazy()const { return m_lazy; }
+
+		// the deferred array for f(a), or next op top where one of them is an array
+		std::shared_ptr<const Array> apply(utility::MathFunction f, const std::shared_ptr<const Array>& a);
+		std::shared_ptr<const Array> apply(utility::BinaryOp op, const Value& next, const Value& top);
+
+		void materialized(size_t elements);
+		Statistics getStatistics()const { return m_statistics; }
+
+	private:
+		ExpressionGraph();
+		~ExpressionGraph();
+
+		std::shared_ptr<const Array> make(Expression e);
+
+		// the arrays built so far by what they compute; an entry is used only
+		// while its operands are the ones it was made of
+		struct Key
+		{
+			Expression::Kind kind;
+			int operation;
+			std::uint64_t scalar;
+			const Array* left;
+			const Array* right;
+			bool operator==(const Key& k)const;
+		};
+		struct KeyHash
+		{
+			size_t operator()(const Key& k)const;
+		};
+		struct Entry
+		{
+			std::weak_ptr<const Array> result;
+			std::weak_ptr<const Array> left;
+			std::weak_ptr<const Array> right;
+		};
+		std::unordered_map<Key, Entry, KeyHash> m_built;
+		size_t m_sweepAt;
+
+		bool m_lazy;
+		Statistics m_statistics;
+
+	private:
+		ExpressionGraph(const ExpressionGraph&) = delete;
+		ExpressionGraph(ExpressionGraph&&) = delete;
+		ExpressionGraph& operator=(const ExpressionGraph&) = delete;
+		ExpressionGraph& operator=(ExpressionGraph&&) = delete;
+	};
+}
+#endif // !EXPRESSION_H
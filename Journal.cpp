@@ -0,0 +1,433 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+#include "Journal.h"
+#include "DataFile.h"
+#include "Exception.h"
+#include<algorithm>
+#include<condition_variable>
+#include<cstring>
+#include<filesystem>
+#include<mutex>
+#include<thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include<Windows.h>
+#else
+#include<fcntl.h>
+#include<unistd.h>
+#endif
+
+namespace utility
+{
+	namespace
+	{
+		// in front of every record; the checksum covers the size too, so a
+		// torn or overwritten frame is not mistaken for a record
+		struct Frame
+		{
+			std::uint32_t size;
+			std::uint32_t checksum;
+		};
+
+		const size_t MaxRecord = std::uint32_t(-1);
+
+		// the records buffered before an append waits for a commit, so a writer
+		// faster than the disk does not buffer without bound
+		const size_t MaxBuffered = size_t{ 64 } << 20;
+
+		// FNV-1a
+		std::uint32_t checksum(std::uint32_t size, const char* record)
+		{
+			std::uint32_t h{ 2166136261u };
+			for (int i = 0; i < 4; ++i)
+				h = (h ^ ((size >> (8 * i)) & 0xff)) * 16777619u;
+			for (std::uint32_t i = 0; i < size; ++i)
+				h = (h ^ static_cast<unsigned char>(record[i])) * 16777619u;
+			return h;
+		}
+
+		void appendFramed(std::string& out, const char* record, size_t size)
+		{
+			if (size > MaxRecord)
+				throw Exception("Warning: a journal record is too long");
+
+			Frame frame{ static_cast<std::uint32_t>(size), checksum(static_cast<std::uint32_t>(size), record) };
+			out.append(reinterpret_cast<const char*>(&frame), sizeof frame);
+			out.append(record, size);
+		}
+
+		// replays the valid records at the start of data and returns their length
+		size_t replayRecords(const char* data, size_t size, const std::function<void(const char*, size_t)>& replay)
+		{
+			size_t p{ 0 };
+			while (size - p >= sizeof(Frame))
+			{
+				Frame frame;
+				std::memcpy(&frame, data + p, sizeof frame);
+				const char* record{ data + p + sizeof frame };
+				if (frame.size > size - p - sizeof frame || checksum(frame.size, record) != frame.checksum)
+					break;
+
+				replay(record, frame.size);
+				p += sizeof frame + frame.size;
+			}
+			return p;
+		}
+	}
+
+	class Journal::JournalImpl
+	{
+	public:
+		JournalImpl(const std::string& path, std::chrono::milliseconds interval,
+			const std::function<void(const char*, size_t)>& replay);
+		~JournalImpl();
+
+		void append(const char* record, size_t size);
+		void commit();
+		void restart(const char* record, size_t size);
+		Statistics getStatistics()const;
+
+	private:
+		// the background thread
+		void run();
+
+		void open(size_t validSize);
+		void close();
+		void write(const char* data, size_t size);
+		void sync();
+		void truncate();
+		void checkFailure()const;
+
+		std::string m_path;
+		std::chrono::milliseconds m_interval;
+		std::chrono::steady_clock::time_point m_opened;
+#ifdef _WIN32
+		HANDLE m_file;
+#else
+		int m_file;
+#endif
+
+		// guards what follows; a thread needing both takes m_fileMutex first
+		mutable std::mutex m_mutex;
+		std::condition_variable m_wake;		// a commit is asked for or the journal closes
+		std::condition_variable m_durable;	// a group commit is done
+		std::string m_buffer;				// framed records waiting for the next commit
+		std::uint64_t m_appended;			// records appended
+		std::uint64_t m_committed;			// of them, durable
+		bool m_commitRequested;
+		bool m_stopping;
+		std::string m_failure;
+		Statistics m_statistics;
+
+		// the file: a group commit and a restart do not interleave
+		std::mutex m_fileMutex;
+		std::string m_batch;
+
+		std::thread m_thread;
+	};
+
+	Journal::JournalImpl::JournalImpl(const std::string& path, std::chrono::milliseconds interval,
+		const std::function<void(const char*, size_t)>& replay)
+		: m_path{ path }
+		, m_interval{ interval }
+		, m_opened{ std::chrono::steady_clock::now() }
+		, m_appended{ 0 }
+		, m_committed{ 0 }
+		, m_commitRequested{ false }
+		, m_stopping{ false }
+		, m_statistics{}
+	{
+		size_t validSize{ 0 };
+		if (std::filesystem::exists(path))
+		{
+			MappedFile file{ path };
+			validSize = replayRecords(file.data(), file.size(), replay);
+		}
+
+		open(validSize);
+		m_thread = std::thread{ [this] { run(); } };
+	}
+
+	Journal::JournalImpl::~JournalImpl()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_stopping = true;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+
+		close();
+	}
+
+	void Journal::JournalImpl::append(const char* record, size_t size)
+	{
+		std::unique_lock<std::mutex> lock{ m_mutex };
+		checkFailure();
+
+		if (m_buffer.size() >= MaxBuffered)
+		{
+			m_commitRequested = true;
+			m_wake.notify_one();
+			m_durable.wait(lock, [this] { return m_buffer.size() < MaxBuffered || !m_failure.empty(); });
+			checkFailure();
+		}
+
+		appendFramed(m_buffer, record, size);
+		++m_appended;
+		++m_statistics.records;
+	}
+
+	void Journal::JournalImpl::commit()
+	{
+		std::unique_lock<std::mutex> lock{ m_mutex };
+		checkFailure();
+
+		std::uint64_t target{ m_appended };
+		m_commitRequested = true;
+		m_wake.notify_one();
+		m_durable.wait(lock, [&] { return m_committed >= target || !m_failure.empty(); });
+
+		checkFailure();
+	}
+
+	void Journal::JournalImpl::restart(const char* record, size_t size)
+	{
+		std::string framed;
+		appendFramed(framed, record, size);
+
+		std::lock_guard<std::mutex> fileLock{ m_fileMutex };
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		checkFailure();
+
+		try
+		{
+			truncate();
+			write(framed.data(), framed.size());
+			sync();
+		}
+		catch (Exception& e)
+		{
+			m_failure = e.what();
+			throw;
+		}
+
+		// what was buffered is older than the new first record
+		m_buffer.clear();
+		m_committed = ++m_appended;
+		++m_statistics.records;
+		m_statistics.bytes += framed.size();
+		m_durable.notify_all();
+	}
+
+	Journal::Statistics Journal::JournalImpl::getStatistics() const
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		Statistics s{ m_statistics };
+		s.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_opened).count();
+		return s;
+	}
+
+	void Journal::JournalImpl::run()
+	{
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock{ m_mutex };
+				m_wake.wait_for(lock, m_interval, [this] { return m_stopping || m_commitRequested; });
+			}
+
+			std::lock_guard<std::mutex> fileLock{ m_fileMutex };
+			std::unique_lock<std::mutex> lock{ m_mutex };
+			bool stopping{ m_stopping };
+			bool failed{ !m_failure.empty() };
+			m_commitRequested = false;
+			m_batch.clear();
+			m_batch.swap(m_buffer);
+			std::uint64_t records{ m_appended };
+			lock.unlock();
+
+			// written and synced without holding up the threads appending
+			double seconds{ 0.0 };
+			std::string failure;
+			if (!m_batch.empty() && !failed)
+			{
+				auto start = std::chrono::steady_clock::now();
+				try
+				{
+					write(m_batch.data(), m_batch.size());
+					sync();
+				}
+				catch (Exception& e)
+				{
+					failure = e.what();
+				}
+				seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
+
+			lock.lock();
+			if (!m_batch.empty() && !failed && failure.empty())
+			{
+				++m_statistics.commits;
+				m_statistics.bytes += m_batch.size();
+				m_statistics.commitSeconds += seconds;
+				m_statistics.maxCommitSeconds = std::max(m_statistics.maxCommitSeconds, seconds);
+			}
+			if (m_failure.empty()) m_failure = failure;
+			m_committed = records;
+			m_durable.notify_all();
+
+			if (stopping) return;
+		}
+	}
+
+	void Journal::JournalImpl::checkFailure() const
+	{
+		if (!m_failure.empty())
+			throw Exception(m_failure);
+	}
+
+#ifdef _WIN32
+	void Journal::JournalImpl::open(size_t validSize)
+	{
+		m_file = CreateFileA(m_path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+			throw Exception("Warning: cannot open the journal " + m_path);
+
+		// a torn record at the end is cut off
+		LARGE_INTEGER end;
+		end.QuadPart = static_cast<LONGLONG>(validSize);
+		if (!SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file))
+		{
+			CloseHandle(m_file);
+			throw Exception("Warning: cannot repair the journal " + m_path);
+		}
+	}
+
+	void Journal::JournalImpl::close()
+	{
+		CloseHandle(m_file);
+	}
+
+	void Journal::JournalImpl::write(const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			DWORD written{ 0 };
+			DWORD block{ static_cast<DWORD>(std::min(size, size_t{ 1 } << 30)) };
+			if (!WriteFile(m_file, data, block, &written, nullptr) || written == 0)
+				throw Exception("Warning: cannot write to the journal " + m_path);
+			data += written;
+			size -= written;
+		}
+	}
+
+	void Journal::JournalImpl::sync()
+	{
+		if (!FlushFileBuffers(m_file))
+			throw Exception("Warning: cannot sync the journal " + m_path);
+	}
+
+	void Journal::JournalImpl::truncate()
+	{
+		LARGE_INTEGER start{};
+		if (!SetFilePointerEx(m_file, start, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file))
+			throw Exception("Warning: cannot restart the journal " + m_path);
+	}
+#else
+	void Journal::JournalImpl::open(size_t validSize)
+	{
+		m_file = ::open(m_path.c_str(), O_WRONLY | O_CREAT, 0644);
+		if (m_file < 0)
+			throw Exception("Warning: cannot open the journal " + m_path);
+
+		// a torn record at the end is cut off
+		off_t end{ static_cast<off_t>(validSize) };
+		if (::ftruncate(m_file, end) != 0 || ::lseek(m_file, end, SEEK_SET) != end)
+		{
+			::close(m_file);
+			throw Exception("Warning: cannot repair the journal " + m_path);
+		}
+	}
+
+	void Journal::JournalImpl::close()
+	{
+		::close(m_file);
+	}
+
+	void Journal::JournalImpl::write(const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			ssize_t written{ ::write(m_file, data, std::min(size, size_t{ 1 } << 30)) };
+			if (written <= 0)
+				throw Exception("Warning: cannot write to the journal " + m_path);
+			data += written;
+			size -= static_cast<size_t>(written);
+		}
+	}
+
+	void Journal::JournalImpl::sync()
+	{
+		if (::fdatasync(m_file) != 0)
+			throw Exception("Warning: cannot sync the journal " + m_path);
+	}
+
+	void Journal::JournalImpl::truncate()
+	{
+		if (::ftruncate(m_file, 0) != 0 || ::lseek(m_file, 0, SEEK_SET) != 0)
+			throw Exception("Warning: cannot restart the journal " + m_path);
+	}
+#endif
+
+	Journal::Journal(const std::string& path, std::chrono::milliseconds interval,
+		const std::function<void(const char*, size_t)>& replay)
+		: impl{ std::make_unique<JournalImpl>(path, interval, replay) }
+	{
+	}
+
+	Journal::~Journal()
+	{
+	}
+
+	void Journal::append(const char* record, size_t size)
+	{
+		impl->append(record, size);
+	}
+
+	void Journal::commit()
+	{
+		impl->commit();
+	}
+
+	void Journal::restart(const char* record, size_t size)
+	{
+		impl->restart(record, size);
+	}
+
+	Journal::Statistics Journal::getStatistics() const
+	{
+		return impl->getStatistics();
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+#include<chrono>
+#include<cstddef>
+#include<cstdint>
+#include<functional>
+#include<memory>
+#include<string>
+
+namespace utility
+{
+	/*
+		Append only file of records for crash recovery, made durable by
+		group commit. Appending only copies a record into a buffer; a
+		background thread writes whatever has gathered once per interval and
+		syncs it with a single fdatasync (FlushFileBuffers on Windows), so the
+		cost of a sync is shared by every record of the interval and a crash
+		loses at most the last interval.
+
+		Each record is framed by its size and a checksum. Opening a journal
+		hands the records already in the file to a replay function and cuts
+		off a torn record a crash left at the end. Failures of the file
+		throw a utility::Exception; the background thread keeps its failure
+		for the next call.
+	*/
+	class Journal
+	{
+	public:
+		struct Statistics
+		{
+			std::uint64_t records;
+			std::uint64_t bytes;			// written by group commits, framing included
+			std::uint64_t commits;
+			double seconds;					// since the journal was opened
+			double commitSeconds;			// spent writing and syncing, over all commits
+			double maxCommitSeconds;
+		};
+
+		// opens or creates the journal at path, handing every valid record in
+		// it to replay, oldest first, before the journal takes new ones
+		Journal(const std::string& path, std::chrono::milliseconds interval,
+			const std::function<void(const char* record, size_t size)>& replay);
+		// commits the records still buffered
+		~Journal();
+
+		// the record is durable after the next group commit
+		void append(const char* record, size_t size);
+
+		// waits until every record appended so far is durable
+		void commit();
+
+		// replaces the whole journal with this one record, durable on return;
+		// the records buffered until then are dropped
+		void restart(const char* record, size_t size);
+
+		Statistics getStatistics()const;
+
+	private:
+		class JournalImpl;
+		std::unique_ptr<JournalImpl> impl;
+
+	private:
+		Journal(const Journal&) = delete;
+		Journal(Journal&&) = delete;
+		Journal& operator=(const Journal&) = delete;
+		Journal& operator=(Journal&&) = delete;
+	};
+}
+#endif // !JOURNAL_H
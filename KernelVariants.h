@@ -0,0 +1,163 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef KERNEL_VARIANTS_H
+#define KERNEL_VARIANTS_H
+
+// private to the kernel translation units: the per tier tables and the
+// helpers they share
+
+#include"Kernels.h"
+#include"VectorMath.h"
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NIMPO_X86
+#endif
+
+// msvc accepts every intrinsic in any function, gcc and clang have to be told
+// per function which instruction set it may use
+#if defined(__GNUC__) || defined(__clang__)
+#define NIMPO_TARGET(isa) __attribute__((target(isa)))
+#else
+#define NIMPO_TARGET(isa)
+#endif
+
+// the loops over a gemm register tile must be unrolled completely, otherwise
+// the accumulators are kept in memory instead of registers
+#if defined(__clang__)
+#define NIMPO_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+#define NIMPO_UNROLL _Pragma("GCC unroll 16")
+#else
+#define NIMPO_UNROLL
+#endif
+
+namespace utility
+{
+	const KernelTable* scalarKernels();
+#ifdef NIMPO_X86
+	const KernelTable* sse2Kernels();
+	const KernelTable* avx2Kernels();
+	const KernelTable* avx512Kernels();
+#endif
+
+	// the fast transcendental functions of each tier; exact is the libm
+	// function used for arguments the fast path cannot reduce
+	using ExactFunction = double(*)(double);
+	void scalarFastMath(MathFunction f, const double* in, double* out, size_t n, ExactFunction exact);
+#ifdef NIMPO_X86
+	void sse2FastMath(MathFunction f, const double* in, double* out, size_t n, ExactFunction exact);
+	void avx2FastMath(MathFunction f, const double* in, double* out, size_t n, ExactFunction exact);
+	void avx512FastMath(MathFunction f, const double* in, double* out, size_t n, ExactFunction exact);
+#endif
+
+	// short enough for the plain partial sums to stay accurate, long enough
+	// for the compensation step to cost nothing next to the memory traffic
+	const size_t SumBlock = 256;
+
+	inline void neumaierAdd(double& s, double& c, double x)
+	{
+		double t = s + x;
+		if (std::fabs(s) >= std::fabs(x))
+			c += (s - t) + x;
+		else
+			c += (x - t) + s;
+		s = t;
+	}
+
+	template<typename BlockSum>
+	double compensatedSum(const double* x, size_t n, BlockSum blockSum)
+	{
+		double s{ 0.0 }, c{ 0.0 };
+		for (size_t i = 0; i < n; i += SumBlock)
+			neumaierAdd(s, c, blockSum(x + i, n - i < SumBlock ? n - i : SumBlock));
+
+		return s + c;
+	}
+
+	// Philox4x32-10 from Salmon et al., "Parallel random numbers: as easy as
+	// 1, 2, 3". The counter of a block is its 64 bit index in the low words,
+	// the key the 64 bit seed; the vector variants run the same rounds on
+	// 32 bit words kept in 64 bit lanes, which is what their multiplies take
+	const std::uint32_t PhiloxM0 = 0xD2511F53u;
+	const std::uint32_t PhiloxM1 = 0xCD9E8D57u;
+	const std::uint32_t PhiloxW0 = 0x9E3779B9u;
+	const std::uint32_t PhiloxW1 = 0xBB67AE85u;
+	const int PhiloxRounds = 10;
+
+	inline void philoxBlock(std::uint64_t block, std::uint64_t seed, std::uint32_t w[4])
+	{
+		std::uint32_t c0{ static_cast<std::uint32_t>(block) }, c1{ static_cast<std::uint32_t>(block >> 32) };
+		std::uint32_t c2{ 0 }, c3{ 0 };
+		std::uint32_t k0{ static_cast<std::uint32_t>(seed) }, k1{ static_cast<std::uint32_t>(seed >> 32) };
+		for (int r = 0; r < PhiloxRounds; ++r)
+		{
+			std::uint64_t p0{ std::uint64_t{ PhiloxM0 } * c0 };
+			std::uint64_t p1{ std::uint64_t{ PhiloxM1 } * c2 };
+			c0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+			c1 = static_cast<std::uint32_t>(p1);
+			c2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+			c3 = static_cast<std::uint32_t>(p0);
+			k0 += PhiloxW0;
+			k1 += PhiloxW1;
+		}
+		w[0] = c0; w[1] = c1; w[2] = c2; w[3] = c3;
+	}
+
+	// the high 52 bits as the mantissa of a number in [1, 2), minus one
+	const std::uint64_t UnitExponent = 0x3ff0000000000000ull;
+
+	inline double unitFromBits(std::uint64_t bits)
+	{
+		bits = bits >> 12 | UnitExponent;
+		double d;
+		std::memcpy(&d, &bits, sizeof d);
+		return d - 1.0;
+	}
+
+	// value i of the stream: block i / 2, words 0 and 1 or 2 and 3
+	inline double philoxUniform(std::uint64_t seed, std::uint64_t i)
+	{
+		std::uint32_t w[4];
+		philoxBlock(i >> 1, seed, w);
+		size_t h{ (i & 1) * 2 };
+		return unitFromBits(std::uint64_t{ w[h + 1] } << 32 | w[h]);
+	}
+
+	// the scalar generator; the vector ones leave it the values before the
+	// first and after the last whole block
+	void scalarUniform(std::uint64_t seed, std::uint64_t counter, double* out, size_t n);
+
+	template<BinaryOp Op>
+	inline double scalarApply(double a, double b)
+	{
+		if constexpr (Op == BinaryOp::Add) return a + b;
+		else if constexpr (Op == BinaryOp::Subtract) return a - b;
+		else if constexpr (Op == BinaryOp::Multiply) return a * b;
+		else return a / b;
+	}
+}
+#endif // !KERNEL_VARIANTS_H
+
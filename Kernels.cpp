@@ -0,0 +1,624 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "Kernels.h"
+#include "KernelVariants.h"
+#include "Exception.h"
+#include "ThreadPool.h"
+#include<algorithm>
+#include<cstdlib>
+#include<cstring>
+
+#ifdef NIMPO_X86
+#include<emmintrin.h>
+#if defined(_MSC_VER)
+#include<intrin.h>
+#else
+#include<cpuid.h>
+#endif
+#endif
+
+namespace utility
+{
+	namespace
+	{
+		// portable fallback, also the reference the vector variants are checked against
+		template<bool Square>
+		double scalarBlockSum(const double* x, size_t n)
+		{
+			double a[4]{};
+			size_t i{ 0 };
+			for (; i + 4 <= n; i += 4)
+				for (size_t j = 0; j < 4; ++j)
+					a[j] += Square ? x[i + j] * x[i + j] : x[i + j];
+
+			double r{ (a[0] + a[1]) + (a[2] + a[3]) };
+			for (; i < n; ++i)
+				r += Square ? x[i] * x[i] : x[i];
+
+			return r;
+		}
+
+		double scalarSum(const double* x, size_t n) { return compensatedSum(x, n, scalarBlockSum<false>); }
+		double scalarSumOfSquares(const double* x, size_t n) { return compensatedSum(x, n, scalarBlockSum<true>); }
+
+		double scalarProduct(const double* x, size_t n)
+		{
+			double r{ 1.0 };
+			for (size_t i = 0; i < n; ++i)
+				r *= x[i];
+			return r;
+		}
+
+		double scalarMin(const double* x, size_t n) { return *std::min_element(x, x + n); }
+		double scalarMax(const double* x, size_t n) { return *std::max_element(x, x + n); }
+
+		template<BinaryOp Op>
+		void scalarElementwise(const double* a, const double* b, double* out, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+				out[i] = scalarApply<Op>(a[i], b[i]);
+		}
+
+		template<BinaryOp Op>
+		void scalarBroadcastRight(const double* a, double b, double* out, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+				out[i] = scalarApply<Op>(a[i], b);
+		}
+
+		template<BinaryOp Op>
+		void scalarBroadcastLeft(const double* a, double b, double* out, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+				out[i] = scalarApply<Op>(b, a[i]);
+		}
+
+		// 4 x 4 register tile
+		void scalarGemm(size_t kc, const double* a, const double* b, double* c, size_t ldc, bool accumulate)
+		{
+			double t[4][4]{};
+			for (size_t p = 0; p < kc; ++p, a += 4, b += 4)
+			{
+				NIMPO_UNROLL
+				for (size_t i = 0; i < 4; ++i)
+				{
+					NIMPO_UNROLL
+					for (size_t j = 0; j < 4; ++j)
+						t[i][j] += a[i] * b[j];
+				}
+			}
+
+			for (size_t i = 0; i < 4; ++i)
+				for (size_t j = 0; j < 4; ++j)
+					c[i * ldc + j] = accumulate ? c[i * ldc + j] + t[i][j] : t[i][j];
+		}
+
+#ifdef NIMPO_X86
+		inline double horizontalAdd(__m128d v)
+		{
+			return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+		}
+
+		template<BinaryOp Op>
+		inline __m128d sse2Apply(__m128d a, __m128d b)
+		{
+			if constexpr (Op == BinaryOp::Add) return _mm_add_pd(a, b);
+			else if constexpr (Op == BinaryOp::Subtract) return _mm_sub_pd(a, b);
+			else if constexpr (Op == BinaryOp::Multiply) return _mm_mul_pd(a, b);
+			else return _mm_div_pd(a, b);
+		}
+
+		template<bool Square>
+		double sse2BlockSum(const double* x, size_t n)
+		{
+			__m128d a0 = _mm_setzero_pd(), a1 = _mm_setzero_pd();
+			__m128d a2 = _mm_setzero_pd(), a3 = _mm_setzero_pd();
+
+			size_t i{ 0 };
+			for (; i + 8 <= n; i += 8)
+			{
+				__m128d v0 = _mm_loadu_pd(x + i), v1 = _mm_loadu_pd(x + i + 2);
+				__m128d v2 = _mm_loadu_pd(x + i + 4), v3 = _mm_loadu_pd(x + i + 6);
+				if (Square)
+				{
+					v0 = _mm_mul_pd(v0, v0); v1 = _mm_mul_pd(v1, v1);
+					v2 = _mm_mul_pd(v2, v2); v3 = _mm_mul_pd(v3, v3);
+				}
+				a0 = _mm_add_pd(a0, v0); a1 = _mm_add_pd(a1, v1);
+				a2 = _mm_add_pd(a2, v2); a3 = _mm_add_pd(a3, v3);
+			}
+
+			double r{ horizontalAdd(_mm_add_pd(_mm_add_pd(a0, a1), _mm_add_pd(a2, a3))) };
+			for (; i < n; ++i)
+				r += Square ? x[i] * x[i] : x[i];
+
+			return r;
+		}
+
+		double sse2Sum(const double* x, size_t n) { return compensatedSum(x, n, sse2BlockSum<false>); }
+		double sse2SumOfSquares(const double* x, size_t n) { return compensatedSum(x, n, sse2BlockSum<true>); }
+
+		double sse2Product(const double* x, size_t n)
+		{
+			size_t i{ 0 };
+			__m128d p0 = _mm_set1_pd(1.0), p1 = _mm_set1_pd(1.0);
+			for (; i + 4 <= n; i += 4)
+			{
+				p0 = _mm_mul_pd(p0, _mm_loadu_pd(x + i));
+				p1 = _mm_mul_pd(p1, _mm_loadu_pd(x + i + 2));
+			}
+			p0 = _mm_mul_pd(p0, p1);
+			double r{ _mm_cvtsd_f64(_mm_mul_sd(p0, _mm_unpackhi_pd(p0, p0))) };
+			for (; i < n; ++i)
+				r *= x[i];
+
+			return r;
+		}
+
+		double sse2Min(const double* x, size_t n)
+		{
+			if (n < 4) return scalarMin(x, n);
+
+			__m128d m0 = _mm_loadu_pd(x), m1 = _mm_loadu_pd(x + 2);
+			size_t i{ 4 };
+			for (; i + 4 <= n; i += 4)
+			{
+				m0 = _mm_min_pd(m0, _mm_loadu_pd(x + i));
+				m1 = _mm_min_pd(m1, _mm_loadu_pd(x + i + 2));
+			}
+			m0 = _mm_min_pd(m0, m1);
+			double r{ _mm_cvtsd_f64(_mm_min_sd(m0, _mm_unpackhi_pd(m0, m0))) };
+			for (; i < n; ++i)
+				r = std::min(r, x[i]);
+
+			return r;
+		}
+
+		double sse2Max(const double* x, size_t n)
+		{
+			if (n < 4) return scalarMax(x, n);
+
+			__m128d m0 = _mm_loadu_pd(x), m1 = _mm_loadu_pd(x + 2);
+			size_t i{ 4 };
+			for (; i + 4 <= n; i += 4)
+			{
+				m0 = _mm_max_pd(m0, _mm_loadu_pd(x + i));
+				m1 = _mm_max_pd(m1, _mm_loadu_pd(x + i + 2));
+			}
+			m0 = _mm_max_pd(m0, m1);
+			double r{ _mm_cvtsd_f64(_mm_max_sd(m0, _mm_unpackhi_pd(m0, m0))) };
+			for (; i < n; ++i)
+				r = std::max(r, x[i]);
+
+			return r;
+		}
+
+		template<BinaryOp Op>
+		void sse2Elementwise(const double* a, const double* b, double* out, size_t n)
+		{
+			size_t i{ 0 };
+			for (; i + 2 <= n; i += 2)
+				_mm_storeu_pd(out + i, sse2Apply<Op>(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+			for (; i < n; ++i)
+				out[i] = scalarApply<Op>(a[i], b[i]);
+		}
+
+		template<BinaryOp Op>
+		void sse2BroadcastRight(const double* a, double b, double* out, size_t n)
+		{
+			__m128d vb = _mm_set1_pd(b);
+			size_t i{ 0 };
+			for (; i + 2 <= n; i += 2)
+				_mm_storeu_pd(out + i, sse2Apply<Op>(_mm_loadu_pd(a + i), vb));
+			for (; i < n; ++i)
+				out[i] = scalarApply<Op>(a[i], b);
+		}
+
+		template<BinaryOp Op>
+		void sse2BroadcastLeft(const double* a, double b, double* out, size_t n)
+		{
+			__m128d vb = _mm_set1_pd(b);
+			size_t i{ 0 };
+			for (; i + 2 <= n; i += 2)
+				_mm_storeu_pd(out + i, sse2Apply<Op>(vb, _mm_loadu_pd(a + i)));
+			for (; i < n; ++i)
+				out[i] = scalarApply<Op>(b, a[i]);
+		}
+
+		// 4 x 4 register tile, two registers per row of c
+		void sse2Gemm(size_t kc, const double* a, const double* b, double* c, size_t ldc, bool accumulate)
+		{
+			__m128d t[4][2];
+			NIMPO_UNROLL
+			for (size_t i = 0; i < 4; ++i)
+				t[i][0] = t[i][1] = _mm_setzero_pd();
+
+			for (size_t p = 0; p < kc; ++p, a += 4, b += 4)
+			{
+				__m128d b0 = _mm_loadu_pd(b), b1 = _mm_loadu_pd(b + 2);
+				NIMPO_UNROLL
+				for (size_t i = 0; i < 4; ++i)
+				{
+					__m128d ai = _mm_set1_pd(a[i]);
+					t[i][0] = _mm_add_pd(t[i][0], _mm_mul_pd(ai, b0));
+					t[i][1] = _mm_add_pd(t[i][1], _mm_mul_pd(ai, b1));
+				}
+			}
+
+			NIMPO_UNROLL
+			for (size_t i = 0; i < 4; ++i)
+			{
+				double* ci = c + i * ldc;
+				if (accumulate)
+				{
+					t[i][0] = _mm_add_pd(t[i][0], _mm_loadu_pd(ci));
+					t[i][1] = _mm_add_pd(t[i][1], _mm_loadu_pd(ci + 2));
+				}
+				_mm_storeu_pd(ci, t[i][0]);
+				_mm_storeu_pd(ci + 2, t[i][1]);
+			}
+		}
+
+		inline __m128d sse2Unit(__m128i bits, __m128i exponent, __m128d one)
+		{
+			return _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(bits, 12), exponent)), one);
+		}
+
+		// two blocks, four values per step
+		void sse2Uniform(std::uint64_t seed, std::uint64_t counter, double* out, size_t n)
+		{
+			size_t head{ std::min(n, static_cast<size_t>(counter & 1)) };
+			scalarUniform(seed, counter, out, head);
+			counter += head; out += head; n -= head;
+
+			__m128i key0[PhiloxRounds], key1[PhiloxRounds];
+			std::uint32_t k0{ static_cast<std::uint32_t>(seed) }, k1{ static_cast<std::uint32_t>(seed >> 32) };
+			for (int r = 0; r < PhiloxRounds; ++r, k0 += PhiloxW0, k1 += PhiloxW1)
+			{
+				key0[r] = _mm_set1_epi64x(k0);
+				key1[r] = _mm_set1_epi64x(k1);
+			}
+
+			const __m128i low = _mm_set1_epi64x(0xffffffffll);
+			const __m128i m0 = _mm_set1_epi64x(PhiloxM0), m1 = _mm_set1_epi64x(PhiloxM1);
+			const __m128i exponent = _mm_set1_epi64x(static_cast<long long>(UnitExponent));
+			const __m128d one = _mm_set1_pd(1.0);
+
+			size_t i{ 0 };
+			for (; i + 4 <= n; i += 4)
+			{
+				__m128i b = _mm_add_epi64(_mm_set1_epi64x(static_cast<long long>((counter + i) >> 1)), _mm_set_epi64x(1, 0));
+				__m128i c0 = _mm_and_si128(b, low), c1 = _mm_srli_epi64(b, 32);
+				__m128i c2 = _mm_setzero_si128(), c3 = _mm_setzero_si128();
+				for (int r = 0; r < PhiloxRounds; ++r)
+				{
+					__m128i p0 = _mm_mul_epu32(c0, m0), p1 = _mm_mul_epu32(c2, m1);
+					c0 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi64(p1, 32), c1), key0[r]);
+					c1 = _mm_and_si128(p1, low);
+					c2 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi64(p0, 32), c3), key1[r]);
+					c3 = _mm_and_si128(p0, low);
+				}
+
+				__m128d even = sse2Unit(_mm_or_si128(_mm_slli_epi64(c1, 32), c0), exponent, one);
+				__m128d odd = sse2Unit(_mm_or_si128(_mm_slli_epi64(c3, 32), c2), exponent, one);
+				_mm_storeu_pd(out + i, _mm_unpacklo_pd(even, odd));
+				_mm_storeu_pd(out + i + 2, _mm_unpackhi_pd(even, odd));
+			}
+			scalarUniform(seed, counter + i, out + i, n - i);
+		}
+
+		struct CpuId { unsigned eax, ebx, ecx, edx; };
+
+		CpuId cpuid(unsigned leaf, unsigned subLeaf)
+		{
+			CpuId r{};
+#if defined(_MSC_VER)
+			int regs[4];
+			__cpuidex(regs, static_cast<int>(leaf), static_cast<int>(subLeaf));
+			r = { static_cast<unsigned>(regs[0]), static_cast<unsigned>(regs[1]),
+				  static_cast<unsigned>(regs[2]), static_cast<unsigned>(regs[3]) };
+#else
+			__cpuid_count(leaf, subLeaf, r.eax, r.ebx, r.ecx, r.edx);
+#endif
+			return r;
+		}
+
+		// which register states the os saves on a context switch
+		unsigned long long xgetbv0()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			unsigned lo, hi;
+			__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+			return (static_cast<unsigned long long>(hi) << 32) | lo;
+#endif
+		}
+
+		CpuFeatures detectCpuFeatures()
+		{
+			CpuFeatures f{};
+
+			unsigned maxLeaf{ cpuid(0, 0).eax };
+			CpuId l1{ cpuid(1, 0) };
+			f.sse2 = (l1.edx >> 26) & 1;
+
+			bool osxsave{ ((l1.ecx >> 27) & 1) != 0 };
+			unsigned long long xcr0{ osxsave ? xgetbv0() : 0 };
+			bool ymmSaved{ (xcr0 & 0x6) == 0x6 };
+			bool zmmSaved{ (xcr0 & 0xe6) == 0xe6 };
+
+			f.avx = ymmSaved && ((l1.ecx >> 28) & 1);
+			f.fma = f.avx && ((l1.ecx >> 12) & 1);
+			if (maxLeaf >= 7)
+			{
+				CpuId l7{ cpuid(7, 0) };
+				f.avx2 = f.avx && ((l7.ebx >> 5) & 1);
+				f.avx512f = zmmSaved && ((l7.ebx >> 16) & 1);
+			}
+
+			if (cpuid(0x80000000u, 0).eax >= 0x80000004u)
+			{
+				char brand[49]{};
+				for (unsigned i = 0; i < 3; ++i)
+				{
+					CpuId b{ cpuid(0x80000002u + i, 0) };
+					std::memcpy(brand + 16 * i, &b, 16);
+				}
+				f.brand = brand;
+				f.brand.erase(0, f.brand.find_first_not_of(' '));
+			}
+
+			return f;
+		}
+#else
+		CpuFeatures detectCpuFeatures()
+		{
+			return CpuFeatures{};
+		}
+#endif
+	}
+
+	void scalarUniform(std::uint64_t seed, std::uint64_t counter, double* out, size_t n)
+	{
+		size_t i{ 0 };
+		if (n > 0 && (counter & 1))
+			out[i++] = philoxUniform(seed, counter);
+
+		for (; i + 2 <= n; i += 2)
+		{
+			std::uint32_t w[4];
+			philoxBlock((counter + i) >> 1, seed, w);
+			out[i] = unitFromBits(std::uint64_t{ w[1] } << 32 | w[0]);
+			out[i + 1] = unitFromBits(std::uint64_t{ w[3] } << 32 | w[2]);
+		}
+
+		if (i < n)
+			out[i] = philoxUniform(seed, counter + i);
+	}
+
+	const KernelTable* scalarKernels()
+	{
+		static const KernelTable table{
+			KernelTier::Scalar,
+			scalarSum, scalarSumOfSquares, scalarProduct, scalarMin, scalarMax,
+			{ scalarElementwise<BinaryOp::Add>, scalarElementwise<BinaryOp::Subtract>,
+			  scalarElementwise<BinaryOp::Multiply>, scalarElementwise<BinaryOp::Divide> },
+			{ scalarBroadcastRight<BinaryOp::Add>, scalarBroadcastRight<BinaryOp::Subtract>,
+			  scalarBroadcastRight<BinaryOp::Multiply>, scalarBroadcastRight<BinaryOp::Divide> },
+			{ scalarBroadcastLeft<BinaryOp::Add>, scalarBroadcastLeft<BinaryOp::Subtract>,
+			  scalarBroadcastLeft<BinaryOp::Multiply>, scalarBroadcastLeft<BinaryOp::Divide> },
+			{ scalarGemm, 4, 4 },
+			scalarUniform
+		};
+		return &table;
+	}
+
+#ifdef NIMPO_X86
+	const KernelTable* sse2Kernels()
+	{
+		static const KernelTable table{
+			KernelTier::SSE2,
+			sse2Sum, sse2SumOfSquares, sse2Product, sse2Min, sse2Max,
+			{ sse2Elementwise<BinaryOp::Add>, sse2Elementwise<BinaryOp::Subtract>,
+			  sse2Elementwise<BinaryOp::Multiply>, sse2Elementwise<BinaryOp::Divide> },
+			{ sse2BroadcastRight<BinaryOp::Add>, sse2BroadcastRight<BinaryOp::Subtract>,
+			  sse2BroadcastRight<BinaryOp::Multiply>, sse2BroadcastRight<BinaryOp::Divide> },
+			{ sse2BroadcastLeft<BinaryOp::Add>, sse2BroadcastLeft<BinaryOp::Subtract>,
+			  sse2BroadcastLeft<BinaryOp::Multiply>, sse2BroadcastLeft<BinaryOp::Divide> },
+			{ sse2Gemm, 4, 4 },
+			sse2Uniform
+		};
+		return &table;
+	}
+#endif
+
+	KernelRegistry& KernelRegistry::getInstance()
+	{
+		static KernelRegistry instance;
+		return instance;
+	}
+
+	KernelRegistry::KernelRegistry()
+		: m_features{ detectCpuFeatures() }
+		, m_detected{ KernelTier::Scalar }
+		, m_active{ scalarKernels() }
+	{
+		if (m_features.sse2) m_detected = KernelTier::SSE2;
+		if (m_features.avx2 && m_features.fma) m_detected = KernelTier::AVX2;
+		if (m_features.avx512f && m_detected == KernelTier::AVX2) m_detected = KernelTier::AVX512;
+
+		bind(m_detected);
+
+		// lets a test run pin the tier without touching the command line
+		if (const char* forced = std::getenv("NIMPO_ISA"))
+		{
+			try
+			{
+				bind(parseTier(forced));
+			}
+			catch (Exception&)
+			{
+				// keep the detected tier
+			}
+		}
+	}
+
+	void KernelRegistry::bind(KernelTier t)
+	{
+		if (t > m_detected)
+			throw Exception{ std::string{ "This cpu does not support the " } + getName(t) + " kernels" };
+
+		switch (t)
+		{
+#ifdef NIMPO_X86
+		case KernelTier::AVX512: m_active = avx512Kernels(); break;
+		case KernelTier::AVX2: m_active = avx2Kernels(); break;
+		case KernelTier::SSE2: m_active = sse2Kernels(); break;
+#endif
+		default: m_active = scalarKernels(); break;
+		}
+	}
+
+	const char* KernelRegistry::getName(KernelTier t)
+	{
+		switch (t)
+		{
+		case KernelTier::Scalar: return "scalar";
+		case KernelTier::SSE2: return "sse2";
+		case KernelTier::AVX2: return "avx2";
+		case KernelTier::AVX512: return "avx512";
+		default: return "unknown";
+		}
+	}
+
+	KernelTier KernelRegistry::parseTier(const std::string& s)
+	{
+		for (auto t : { KernelTier::Scalar, KernelTier::SSE2, KernelTier::AVX2, KernelTier::AVX512 })
+			if (s == getName(t)) return t;
+
+		throw Exception{ "Unknown kernel tier '" + s + "', expected scalar, sse2, avx2 or avx512" };
+	}
+
+	namespace
+	{
+		// the ranges the kernels are split into for the thread pool: big enough
+		// to amortize handing them out, small enough to balance the cores.
+		// Anything shorter runs on the calling thread
+		const size_t ParallelGrain = 1 << 16;
+
+		// a partial sum of the parallel compensated sums
+		struct Compensated
+		{
+			double sum;
+			double error;
+		};
+
+		Compensated combine(Compensated a, Compensated b)
+		{
+			neumaierAdd(a.sum, a.error, b.sum);
+			a.error += b.error;
+			return a;
+		}
+
+		double parallelSum(ReduceKernel kernel, const double* first, size_t n)
+		{
+			auto r = ThreadPool::getInstance().parallelReduce(n, ParallelGrain, Compensated{ 0.0, 0.0 },
+				[=](size_t i, size_t j) { return Compensated{ kernel(first + i, j - i), 0.0 }; },
+				[](Compensated a, Compensated b) { return combine(a, b); });
+			return r.sum + r.error;
+		}
+
+		double parallelExtreme(ReduceKernel kernel, const double* first, size_t n)
+		{
+			return ThreadPool::getInstance().parallelReduce(n, ParallelGrain, first[0],
+				[=](size_t i, size_t j) { return kernel(first + i, j - i); },
+				[=](double a, double b) { double ab[2]{ a, b }; return kernel(ab, 2); });
+		}
+	}
+
+	double reduceSum(const double* first, size_t n)
+	{
+		return parallelSum(KernelRegistry::getInstance().kernels().sum, first, n);
+	}
+
+	double reduceSumOfSquares(const double* first, size_t n)
+	{
+		return parallelSum(KernelRegistry::getInstance().kernels().sumOfSquares, first, n);
+	}
+
+	double reduceProduct(const double* first, size_t n)
+	{
+		auto kernel = KernelRegistry::getInstance().kernels().product;
+		return ThreadPool::getInstance().parallelReduce(n, ParallelGrain, 1.0,
+			[=](size_t i, size_t j) { return kernel(first + i, j - i); },
+			[](double a, double b) { return a * b; });
+	}
+
+	double reduceMin(const double* first, size_t n)
+	{
+		return parallelExtreme(KernelRegistry::getInstance().kernels().min, first, n);
+	}
+
+	double reduceMax(const double* first, size_t n)
+	{
+		return parallelExtreme(KernelRegistry::getInstance().kernels().max, first, n);
+	}
+
+	void applyElementwise(BinaryOp op, const double* a, const double* b, double* out, size_t n)
+	{
+		auto kernel = KernelRegistry::getInstance().kernels().elementwise[static_cast<int>(op)];
+		ThreadPool::getInstance().parallelFor(n, ParallelGrain, [=](size_t i, size_t j) { kernel(a + i, b + i, out + i, j - i); });
+	}
+
+	void applyBroadcastRight(BinaryOp op, const double* a, double b, double* out, size_t n)
+	{
+		auto kernel = KernelRegistry::getInstance().kernels().broadcastRight[static_cast<int>(op)];
+		ThreadPool::getInstance().parallelFor(n, ParallelGrain, [=](size_t i, size_t j) { kernel(a + i, b, out + i, j - i); });
+	}
+
+	void applyBroadcastLeft(BinaryOp op, double a, const double* b, double* out, size_t n)
+	{
+		auto kernel = KernelRegistry::getInstance().kernels().broadcastLeft[static_cast<int>(op)];
+		ThreadPool::getInstance().parallelFor(n, ParallelGrain, [=](size_t i, size_t j) { kernel(b + i, a, out + i, j - i); });
+	}
+
+	void generateLinear(double a, double step, double* out, size_t n)
+	{
+		ThreadPool::getInstance().parallelFor(n, ParallelGrain, [=](size_t i, size_t j)
+		{
+			for (; i < j; ++i)
+				out[i] = a + static_cast<double>(i) * step;
+		});
+	}
+
+	void generateConstant(double x, double* out, size_t n)
+	{
+		ThreadPool::getInstance().parallelFor(n, ParallelGrain, [=](size_t i, size_t j) { std::fill(out + i, out + j, x); });
+	}
+
+	void generateUniform(std::uint64_t seed, std::uint64_t counter, double* out, size_t n)
+	{
+		auto kernel = KernelRegistry::getInstance().kernels().uniform;
+		ThreadPool::getInstance().parallelFor(n, ParallelGrain, [=](size_t i, size_t j) { kernel(seed, counter + i, out + i, j - i); });
+	}
+}
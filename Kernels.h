@@ -0,0 +1,207 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef KERNELS_H
+#define KERNELS_H
+#include<cstddef>
+#include<cstdint>
+#include<string>
+
+namespace utility
+{
+	/*
+		Numeric kernels working on a contiguous range of doubles. They are used
+		by the commands operating on many stack elements at once, so they are
+		written to stream through memory with vector instructions.
+
+		Every kernel exists in one variant per instruction set tier. The
+		KernelRegistry finds out at startup what the cpu supports and binds the
+		best variant, so a portable build still uses the wide vector units.
+		The public functions below split long ranges over the ThreadPool. The
+		ones that do pass on what a piece of the loop throws, a std::bad_alloc
+		for their scratch memory, the others are noexcept.
+	*/
+
+	enum class KernelTier { Scalar, SSE2, AVX2, AVX512 };
+	enum class BinaryOp { Add, Subtract, Multiply, Divide };
+
+	using ReduceKernel = double(*)(const double* first, size_t n);
+	using ElementwiseKernel = void(*)(const double* a, const double* b, double* out, size_t n);
+	using BroadcastKernel = void(*)(const double* a, double b, double* out, size_t n);
+
+	// c (+)= a * b for one register tile of rows x cols elements of c: a holds kc
+	// columns of rows values, b kc rows of cols values, both packed by the
+	// matrix multiply; ldc is the row stride of c
+	using GemmKernel = void(*)(size_t kc, const double* a, const double* b, double* c, size_t ldc, bool accumulate);
+
+	struct GemmTile
+	{
+		GemmKernel kernel;
+		size_t rows;
+		size_t cols;
+	};
+
+	// out[i] = value counter + i of the random stream of seed, see generateUniform
+	using UniformKernel = void(*)(std::uint64_t seed, std::uint64_t counter, double* out, size_t n);
+
+	struct KernelTable
+	{
+		KernelTier tier;
+
+		ReduceKernel sum;
+		ReduceKernel sumOfSquares;
+		ReduceKernel product;
+		ReduceKernel min;
+		ReduceKernel max;
+
+		// out[i] = a[i] op b[i], indexed by BinaryOp
+		ElementwiseKernel elementwise[4];
+		// out[i] = a[i] op b
+		BroadcastKernel broadcastRight[4];
+		// out[i] = b op a[i]
+		BroadcastKernel broadcastLeft[4];
+
+		GemmTile gemm;
+
+		UniformKernel uniform;
+	};
+
+	struct CpuFeatures
+	{
+		std::string brand;
+		bool sse2;
+		bool avx;
+		bool avx2;
+		bool fma;
+		bool avx512f;
+	};
+
+	class KernelRegistry
+	{
+	public:
+		static KernelRegistry& getInstance();
+
+		const KernelTable& kernels()const { return *m_active; }
+		const CpuFeatures& getCpuFeatures()const { return m_features; }
+
+		// the best tier this cpu (and os) can run, and the tier actually bound
+		KernelTier getDetectedTier()const { return m_detected; }
+		KernelTier getActiveTier()const { return m_active->tier; }
+
+		// binds the kernels of a lower tier, mainly for testing; throws if the
+		// cpu does not support the requested tier
+		void bind(KernelTier t);
+
+		static const char* getName(KernelTier t);
+		// parses "scalar", "sse2", "avx2" or "avx512"; throws on anything else
+		static KernelTier parseTier(const std::string& s);
+
+	private:
+		KernelRegistry();
+		~KernelRegistry() = default;
+
+		CpuFeatures m_features;
+		KernelTier m_detected;
+		const KernelTable* m_active;
+
+	private:
+		KernelRegistry(const KernelRegistry&) = delete;
+		KernelRegistry(KernelRegistry&&) = delete;
+		KernelRegistry& operator=(const KernelRegistry&) = delete;
+		KernelRegistry& operator=(KernelRegistry&&) = delete;
+	};
+
+	// compensated sum: plain vector sums over short blocks, the block sums
+	// are accumulated with Neumaier's algorithm
+	double reduceSum(const double* first, size_t n);
+
+	// compensated sum of the squares, same scheme as reduceSum
+	double reduceSumOfSquares(const double* first, size_t n);
+
+	double reduceProduct(const double* first, size_t n);
+
+	// n must be at least 1
+	double reduceMin(const double* first, size_t n);
+	double reduceMax(const double* first, size_t n);
+
+	// element wise arithmetic; out may be the same range as a or b
+	void applyElementwise(BinaryOp op, const double* a, const double* b, double* out, size_t n);
+	void applyBroadcastRight(BinaryOp op, const double* a, double b, double* out, size_t n);
+	void applyBroadcastLeft(BinaryOp op, double a, const double* b, double* out, size_t n);
+
+	// c = a * b for row major matrices, a is m x k and b is k x n; c must not
+	// overlap the operands. Blocked for the caches around the register tile of
+	// the bound tier, large products are split over the cores by rows of c
+	void multiplyMatrices(const double* a, const double* b, double* c, size_t m, size_t k, size_t n);
+
+	// the textbook triple loop, kept as the reference for the benchmark
+	void multiplyMatricesNaive(const double* a, const double* b, double* c, size_t m, size_t k, size_t n) noexcept;
+
+	// out (cols x rows) = transpose of a (rows x cols), done in cache sized tiles
+	void transposeMatrix(const double* a, double* out, size_t rows, size_t cols) noexcept;
+
+	// lu factorization of the n x n matrix a in place, with partial pivoting;
+	// returns false if the matrix is singular to working precision
+	bool factorLU(double* a, size_t* pivots, size_t n) noexcept;
+
+	// solves a x = b in place of the n x nrhs matrix b, given factorLU's result
+	void solveLU(const double* lu, const size_t* pivots, double* b, size_t n, size_t nrhs) noexcept;
+
+	// The order used by the sorting and selection kernels is the total order
+	// of the bit patterns: -nan < -inf < ... < -0 < +0 < ... < +inf < nan.
+
+	// ascending sort; long ranges go through a parallel lsd radix sort
+	void sortAscending(double* first, size_t n);
+
+	// moves the k largest elements, ascending, to the end of the range; the
+	// others are left unordered in front of them
+	void selectLargest(double* first, size_t n, size_t k);
+
+	// the p quantile, 0 <= p <= 1, interpolated linearly between the closest
+	// ranks (the median is p = 0.5); reorders the range
+	double selectQuantile(double* first, size_t n, double p) noexcept;
+
+	// inclusive prefix scans, out[i] = in[0] op ... op in[i]; out may be the
+	// same range as in. The sums are compensated like reduceSum
+	void prefixSum(const double* in, double* out, size_t n);
+	void prefixProduct(const double* in, double* out, size_t n);
+
+	// out[i] = the sum, min or max of in[i] ... in[i + w - 1] for the n - w + 1
+	// windows of w elements, 1 <= w <= n; out must not overlap in. Every
+	// element is visited a constant number of times whatever w is
+	void windowSum(const double* in, double* out, size_t n, size_t w);
+	void windowMin(const double* in, double* out, size_t n, size_t w);
+	void windowMax(const double* in, double* out, size_t n, size_t w);
+
+	// out[i] = a + i * step
+	void generateLinear(double a, double step, double* out, size_t n);
+
+	void generateConstant(double x, double* out, size_t n);
+
+	// out[i] = value counter + i of the stream of seed, uniform in [0, 1) with
+	// 52 random bits. The stream is Philox4x32-10 keyed by the seed, every
+	// 128 bit block gives two values, so any part of it can be computed on its
+	// own: the values do not depend on the tier or the number of threads
+	void generateUniform(std::uint64_t seed, std::uint64_t counter, double* out, size_t n);
+}
+#endif // !KERNELS_H
+
@@ -0,0 +1,276 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+// AVX2 + FMA variants of the kernels. Nothing in here may run before the
+// KernelRegistry has checked that the cpu supports it.
+
+#include "KernelVariants.h"
+
+#ifdef NIMPO_X86
+#include<immintrin.h>
+#include<algorithm>
+
+namespace utility
+{
+	namespace
+	{
+		NIMPO_TARGET("avx2,fma")
+		inline double horizontalAdd(__m256d v)
+		{
+			__m128d h = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+			return _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+		}
+
+		template<BinaryOp Op>
+		NIMPO_TARGET("avx2,fma")
+		inline __m256d avx2Apply(__m256d a, __m256d b)
+		{
+			if constexpr (Op == BinaryOp::Add) return _mm256_add_pd(a, b);
+			else if constexpr (Op == BinaryOp::Subtract) return _mm256_sub_pd(a, b);
+			else if constexpr (Op == BinaryOp::Multiply) return _mm256_mul_pd(a, b);
+			else return _mm256_div_pd(a, b);
+		}
+
+		template<bool Square>
+		NIMPO_TARGET("avx2,fma")
+		double avx2BlockSum(const double* x, size_t n)
+		{
+			__m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+			__m256d a2 = _mm256_setzero_pd(), a3 = _mm256_setzero_pd();
+
+			size_t i{ 0 };
+			for (; i + 16 <= n; i += 16)
+			{
+				__m256d v0 = _mm256_loadu_pd(x + i), v1 = _mm256_loadu_pd(x + i + 4);
+				__m256d v2 = _mm256_loadu_pd(x + i + 8), v3 = _mm256_loadu_pd(x + i + 12);
+				if (Square)
+				{
+					a0 = _mm256_fmadd_pd(v0, v0, a0); a1 = _mm256_fmadd_pd(v1, v1, a1);
+					a2 = _mm256_fmadd_pd(v2, v2, a2); a3 = _mm256_fmadd_pd(v3, v3, a3);
+				}
+				else
+				{
+					a0 = _mm256_add_pd(a0, v0); a1 = _mm256_add_pd(a1, v1);
+					a2 = _mm256_add_pd(a2, v2); a3 = _mm256_add_pd(a3, v3);
+				}
+			}
+
+			double r{ horizontalAdd(_mm256_add_pd(_mm256_add_pd(a0, a1), _mm256_add_pd(a2, a3))) };
+			for (; i < n; ++i)
+				r += Square ? x[i] * x[i] : x[i];
+
+			return r;
+		}
+
+		double avx2Sum(const double* x, size_t n) { return compensatedSum(x, n, avx2BlockSum<false>); }
+		double avx2SumOfSquares(const double* x, size_t n) { return compensatedSum(x, n, avx2BlockSum<true>); }
+
+		NIMPO_TARGET("avx2,fma")
+		double avx2Product(const double* x, size_t n)
+		{
+			__m256d p0 = _mm256_set1_pd(1.0), p1 = _mm256_set1_pd(1.0);
+			size_t i{ 0 };
+			for (; i + 8 <= n; i += 8)
+			{
+				p0 = _mm256_mul_pd(p0, _mm256_loadu_pd(x + i));
+				p1 = _mm256_mul_pd(p1, _mm256_loadu_pd(x + i + 4));
+			}
+
+			alignas(32) double lanes[4];
+			_mm256_store_pd(lanes, _mm256_mul_pd(p0, p1));
+			double r{ (lanes[0] * lanes[1]) * (lanes[2] * lanes[3]) };
+			for (; i < n; ++i)
+				r *= x[i];
+
+			return r;
+		}
+
+		template<bool Min>
+		NIMPO_TARGET("avx2,fma")
+		double avx2Extreme(const double* x, size_t n)
+		{
+			if (n < 8)
+				return Min ? *std::min_element(x, x + n) : *std::max_element(x, x + n);
+
+			__m256d m0 = _mm256_loadu_pd(x), m1 = _mm256_loadu_pd(x + 4);
+			size_t i{ 8 };
+			for (; i + 8 <= n; i += 8)
+			{
+				__m256d v0 = _mm256_loadu_pd(x + i), v1 = _mm256_loadu_pd(x + i + 4);
+				m0 = Min ? _mm256_min_pd(m0, v0) : _mm256_max_pd(m0, v0);
+				m1 = Min ? _mm256_min_pd(m1, v1) : _mm256_max_pd(m1, v1);
+			}
+
+			alignas(32) double lanes[4];
+			_mm256_store_pd(lanes, Min ? _mm256_min_pd(m0, m1) : _mm256_max_pd(m0, m1));
+			double r{ lanes[0] };
+			for (int j = 1; j < 4; ++j)
+				r = Min ? std::min(r, lanes[j]) : std::max(r, lanes[j]);
+			for (; i < n; ++i)
+				r = Min ? std::min(r, x[i]) : std::max(r, x[i]);
+
+			return r;
+		}
+
+		double avx2Min(const double* x, size_t n) { return avx2Extreme<true>(x, n); }
+		double avx2Max(const double* x, size_t n) { return avx2Extreme<false>(x, n); }
+
+		template<BinaryOp Op>
+		NIMPO_TARGET("avx2,fma")
+		void avx2Elementwise(const double* a, const double* b, double* out, size_t n)
+		{
+			size_t i{ 0 };
+			for (; i + 4 <= n; i += 4)
+				_mm256_storeu_pd(out + i, avx2Apply<Op>(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+			for (; i < n; ++i)
+				out[i] = scalarApply<Op>(a[i], b[i]);
+		}
+
+		template<BinaryOp Op>
+		NIMPO_TARGET("avx2,fma")
+		void avx2BroadcastRight(const double* a, double b, double* out, size_t n)
+		{
+			__m256d vb = _mm256_set1_pd(b);
+			size_t i{ 0 };
+			for (; i + 4 <= n; i += 4)
+				_mm256_storeu_pd(out + i, avx2Apply<Op>(_mm256_loadu_pd(a + i), vb));
+			for (; i < n; ++i)
+				out[i] = scalarApply<Op>(a[i], b);
+		}
+
+		template<BinaryOp Op>
+		NIMPO_TARGET("avx2,fma")
+		void avx2BroadcastLeft(const double* a, double b, double* out, size_t n)
+		{
+			__m256d vb = _mm256_set1_pd(b);
+			size_t i{ 0 };
+			for (; i + 4 <= n; i += 4)
+				_mm256_storeu_pd(out + i, avx2Apply<Op>(vb, _mm256_loadu_pd(a + i)));
+			for (; i < n; ++i)
+				out[i] = scalarApply<Op>(b, a[i]);
+		}
+
+		// 6 x 8 register tile: twelve accumulators, two rows of b and the
+		// broadcast element of a fill the sixteen registers
+		NIMPO_TARGET("avx2,fma")
+		void avx2Gemm(size_t kc, const double* a, const double* b, double* c, size_t ldc, bool accumulate)
+		{
+			__m256d t[6][2];
+			NIMPO_UNROLL
+			for (size_t i = 0; i < 6; ++i)
+				t[i][0] = t[i][1] = _mm256_setzero_pd();
+
+			for (size_t p = 0; p < kc; ++p, a += 6, b += 8)
+			{
+				__m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4);
+				NIMPO_UNROLL
+				for (size_t i = 0; i < 6; ++i)
+				{
+					__m256d ai = _mm256_broadcast_sd(a + i);
+					t[i][0] = _mm256_fmadd_pd(ai, b0, t[i][0]);
+					t[i][1] = _mm256_fmadd_pd(ai, b1, t[i][1]);
+				}
+			}
+
+			NIMPO_UNROLL
+			for (size_t i = 0; i < 6; ++i)
+			{
+				double* ci = c + i * ldc;
+				if (accumulate)
+				{
+					t[i][0] = _mm256_add_pd(t[i][0], _mm256_loadu_pd(ci));
+					t[i][1] = _mm256_add_pd(t[i][1], _mm256_loadu_pd(ci + 4));
+				}
+				_mm256_storeu_pd(ci, t[i][0]);
+				_mm256_storeu_pd(ci + 4, t[i][1]);
+			}
+		}
+
+		NIMPO_TARGET("avx2,fma")
+		inline __m256d avx2Unit(__m256i bits, __m256i exponent, __m256d one)
+		{
+			return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 12), exponent)), one);
+		}
+
+		// four blocks, eight values per step
+		NIMPO_TARGET("avx2,fma")
+		void avx2Uniform(std::uint64_t seed, std::uint64_t counter, double* out, size_t n)
+		{
+			size_t head{ std::min(n, static_cast<size_t>(counter & 1)) };
+			scalarUniform(seed, counter, out, head);
+			counter += head; out += head; n -= head;
+
+			__m256i key0[PhiloxRounds], key1[PhiloxRounds];
+			std::uint32_t k0{ static_cast<std::uint32_t>(seed) }, k1{ static_cast<std::uint32_t>(seed >> 32) };
+			for (int r = 0; r < PhiloxRounds; ++r, k0 += PhiloxW0, k1 += PhiloxW1)
+			{
+				key0[r] = _mm256_set1_epi64x(k0);
+				key1[r] = _mm256_set1_epi64x(k1);
+			}
+
+			const __m256i low = _mm256_set1_epi64x(0xffffffffll);
+			const __m256i m0 = _mm256_set1_epi64x(PhiloxM0), m1 = _mm256_set1_epi64x(PhiloxM1);
+			const __m256i exponent = _mm256_set1_epi64x(static_cast<long long>(UnitExponent));
+			const __m256d one = _mm256_set1_pd(1.0);
+
+			size_t i{ 0 };
+			for (; i + 8 <= n; i += 8)
+			{
+				__m256i b = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<long long>((counter + i) >> 1)), _mm256_set_epi64x(3, 2, 1, 0));
+				__m256i c0 = _mm256_and_si256(b, low), c1 = _mm256_srli_epi64(b, 32);
+				__m256i c2 = _mm256_setzero_si256(), c3 = _mm256_setzero_si256();
+				for (int r = 0; r < PhiloxRounds; ++r)
+				{
+					__m256i p0 = _mm256_mul_epu32(c0, m0), p1 = _mm256_mul_epu32(c2, m1);
+					c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), c1), key0[r]);
+					c1 = _mm256_and_si256(p1, low);
+					c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), c3), key1[r]);
+					c3 = _mm256_and_si256(p0, low);
+				}
+
+				__m256d even = avx2Unit(_mm256_or_si256(_mm256_slli_epi64(c1, 32), c0), exponent, one);
+				__m256d odd = avx2Unit(_mm256_or_si256(_mm256_slli_epi64(c3, 32), c2), exponent, one);
+				__m256d lo = _mm256_unpacklo_pd(even, odd), hi = _mm256_unpackhi_pd(even, odd);
+				_mm256_storeu_pd(out + i, _mm256_permute2f128_pd(lo, hi, 0x20));
+				_mm256_storeu_pd(out + i + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+			}
+			scalarUniform(seed, counter + i, out + i, n - i);
+		}
+	}
+
+	const KernelTable* avx2Kernels()
+	{
+		static const KernelTable table{
+			KernelTier::AVX2,
+			avx2Sum, avx2SumOfSquares, avx2Product, avx2Min, avx2Max,
+			{ avx2Elementwise<BinaryOp::Add>, avx2Elementwise<BinaryOp::Subtract>,
+			  avx2Elementwise<BinaryOp::Multiply>, avx2Elementwise<BinaryOp::Divide> },
+			{ avx2BroadcastRight<BinaryOp::Add>, avx2BroadcastRight<BinaryOp::Subtract>,
+			  avx2BroadcastRight<BinaryOp::Multiply>, avx2BroadcastRight<BinaryOp::Divide> },
+			{ avx2BroadcastLeft<BinaryOp::Add>, avx2BroadcastLeft<BinaryOp::Subtract>,
+			  avx2BroadcastLeft<BinaryOp::Multiply>, avx2BroadcastLeft<BinaryOp::Divide> },
+			{ avx2Gemm, 6, 8 },
+			avx2Uniform
+		};
+		return &table;
+	}
+}
+#endif // NIMPO_X86
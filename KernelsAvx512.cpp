@@ -0,0 +1,281 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+// AVX-512F variants of the kernels. Nothing in here may run before the
+// KernelRegistry has checked that the cpu supports it.
+
+#include "KernelVariants.h"
+
+#ifdef NIMPO_X86
+#include<immintrin.h>
+#include<algorithm>
+
+namespace utility
+{
+	namespace
+	{
+		NIMPO_TARGET("avx512f")
+		inline double lanesOf(__m512d v, double (*combine)(double, double))
+		{
+			alignas(64) double lanes[8];
+			_mm512_store_pd(lanes, v);
+			double r{ lanes[0] };
+			for (int j = 1; j < 8; ++j)
+				r = combine(r, lanes[j]);
+			return r;
+		}
+
+		double plus(double a, double b) { return a + b; }
+		double times(double a, double b) { return a * b; }
+		double smaller(double a, double b) { return std::min(a, b); }
+		double larger(double a, double b) { return std::max(a, b); }
+
+		template<BinaryOp Op>
+		NIMPO_TARGET("avx512f")
+		inline __m512d avx512Apply(__m512d a, __m512d b)
+		{
+			if constexpr (Op == BinaryOp::Add) return _mm512_add_pd(a, b);
+			else if constexpr (Op == BinaryOp::Subtract) return _mm512_sub_pd(a, b);
+			else if constexpr (Op == BinaryOp::Multiply) return _mm512_mul_pd(a, b);
+			else return _mm512_div_pd(a, b);
+		}
+
+		template<bool Square>
+		NIMPO_TARGET("avx512f")
+		double avx512BlockSum(const double* x, size_t n)
+		{
+			__m512d a0 = _mm512_setzero_pd(), a1 = _mm512_setzero_pd();
+			__m512d a2 = _mm512_setzero_pd(), a3 = _mm512_setzero_pd();
+
+			size_t i{ 0 };
+			for (; i + 32 <= n; i += 32)
+			{
+				__m512d v0 = _mm512_loadu_pd(x + i), v1 = _mm512_loadu_pd(x + i + 8);
+				__m512d v2 = _mm512_loadu_pd(x + i + 16), v3 = _mm512_loadu_pd(x + i + 24);
+				if (Square)
+				{
+					a0 = _mm512_fmadd_pd(v0, v0, a0); a1 = _mm512_fmadd_pd(v1, v1, a1);
+					a2 = _mm512_fmadd_pd(v2, v2, a2); a3 = _mm512_fmadd_pd(v3, v3, a3);
+				}
+				else
+				{
+					a0 = _mm512_add_pd(a0, v0); a1 = _mm512_add_pd(a1, v1);
+					a2 = _mm512_add_pd(a2, v2); a3 = _mm512_add_pd(a3, v3);
+				}
+			}
+
+			double r{ lanesOf(_mm512_add_pd(_mm512_add_pd(a0, a1), _mm512_add_pd(a2, a3)), plus) };
+			for (; i < n; ++i)
+				r += Square ? x[i] * x[i] : x[i];
+
+			return r;
+		}
+
+		double avx512Sum(const double* x, size_t n) { return compensatedSum(x, n, avx512BlockSum<false>); }
+		double avx512SumOfSquares(const double* x, size_t n) { return compensatedSum(x, n, avx512BlockSum<true>); }
+
+		NIMPO_TARGET("avx512f")
+		double avx512Product(const double* x, size_t n)
+		{
+			__m512d p0 = _mm512_set1_pd(1.0), p1 = _mm512_set1_pd(1.0);
+			size_t i{ 0 };
+			for (; i + 16 <= n; i += 16)
+			{
+				p0 = _mm512_mul_pd(p0, _mm512_loadu_pd(x + i));
+				p1 = _mm512_mul_pd(p1, _mm512_loadu_pd(x + i + 8));
+			}
+
+			double r{ lanesOf(_mm512_mul_pd(p0, p1), times) };
+			for (; i < n; ++i)
+				r *= x[i];
+
+			return r;
+		}
+
+		template<bool Min>
+		NIMPO_TARGET("avx512f")
+		double avx512Extreme(const double* x, size_t n)
+		{
+			if (n < 16)
+				return Min ? *std::min_element(x, x + n) : *std::max_element(x, x + n);
+
+			__m512d m0 = _mm512_loadu_pd(x), m1 = _mm512_loadu_pd(x + 8);
+			size_t i{ 16 };
+			for (; i + 16 <= n; i += 16)
+			{
+				__m512d v0 = _mm512_loadu_pd(x + i), v1 = _mm512_loadu_pd(x + i + 8);
+				m0 = Min ? _mm512_min_pd(m0, v0) : _mm512_max_pd(m0, v0);
+				m1 = Min ? _mm512_min_pd(m1, v1) : _mm512_max_pd(m1, v1);
+			}
+
+			double r{ Min ? lanesOf(_mm512_min_pd(m0, m1), smaller) : lanesOf(_mm512_max_pd(m0, m1), larger) };
+			for (; i < n; ++i)
+				r = Min ? std::min(r, x[i]) : std::max(r, x[i]);
+
+			return r;
+		}
+
+		double avx512Min(const double* x, size_t n) { return avx512Extreme<true>(x, n); }
+		double avx512Max(const double* x, size_t n) { return avx512Extreme<false>(x, n); }
+
+		template<BinaryOp Op>
+		NIMPO_TARGET("avx512f")
+		void avx512Elementwise(const double* a, const double* b, double* out, size_t n)
+		{
+			size_t i{ 0 };
+			for (; i + 8 <= n; i += 8)
+				_mm512_storeu_pd(out + i, avx512Apply<Op>(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+			for (; i < n; ++i)
+				out[i] = scalarApply<Op>(a[i], b[i]);
+		}
+
+		template<BinaryOp Op>
+		NIMPO_TARGET("avx512f")
+		void avx512BroadcastRight(const double* a, double b, double* out, size_t n)
+		{
+			__m512d vb = _mm512_set1_pd(b);
+			size_t i{ 0 };
+			for (; i + 8 <= n; i += 8)
+				_mm512_storeu_pd(out + i, avx512Apply<Op>(_mm512_loadu_pd(a + i), vb));
+			for (; i < n; ++i)
+				out[i] = scalarApply<Op>(a[i], b);
+		}
+
+		template<BinaryOp Op>
+		NIMPO_TARGET("avx512f")
+		void avx512BroadcastLeft(const double* a, double b, double* out, size_t n)
+		{
+			__m512d vb = _mm512_set1_pd(b);
+			size_t i{ 0 };
+			for (; i + 8 <= n; i += 8)
+				_mm512_storeu_pd(out + i, avx512Apply<Op>(vb, _mm512_loadu_pd(a + i)));
+			for (; i < n; ++i)
+				out[i] = scalarApply<Op>(b, a[i]);
+		}
+
+		// 12 x 16 register tile: 24 of the 32 registers accumulate, the rest
+		// hold the rows of b and the broadcast element of a
+		NIMPO_TARGET("avx512f")
+		void avx512Gemm(size_t kc, const double* a, const double* b, double* c, size_t ldc, bool accumulate)
+		{
+			__m512d t[12][2];
+			NIMPO_UNROLL
+			for (size_t i = 0; i < 12; ++i)
+				t[i][0] = t[i][1] = _mm512_setzero_pd();
+
+			for (size_t p = 0; p < kc; ++p, a += 12, b += 16)
+			{
+				__m512d b0 = _mm512_loadu_pd(b), b1 = _mm512_loadu_pd(b + 8);
+				NIMPO_UNROLL
+				for (size_t i = 0; i < 12; ++i)
+				{
+					__m512d ai = _mm512_set1_pd(a[i]);
+					t[i][0] = _mm512_fmadd_pd(ai, b0, t[i][0]);
+					t[i][1] = _mm512_fmadd_pd(ai, b1, t[i][1]);
+				}
+			}
+
+			NIMPO_UNROLL
+			for (size_t i = 0; i < 12; ++i)
+			{
+				double* ci = c + i * ldc;
+				if (accumulate)
+				{
+					t[i][0] = _mm512_add_pd(t[i][0], _mm512_loadu_pd(ci));
+					t[i][1] = _mm512_add_pd(t[i][1], _mm512_loadu_pd(ci + 8));
+				}
+				_mm512_storeu_pd(ci, t[i][0]);
+				_mm512_storeu_pd(ci + 8, t[i][1]);
+			}
+		}
+
+		NIMPO_TARGET("avx512f")
+		inline __m512d avx512Unit(__m512i bits, __m512i exponent, __m512d one)
+		{
+			return _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(_mm512_srli_epi64(bits, 12), exponent)), one);
+		}
+
+		// eight blocks, sixteen values per step
+		NIMPO_TARGET("avx512f")
+		void avx512Uniform(std::uint64_t seed, std::uint64_t counter, double* out, size_t n)
+		{
+			size_t head{ std::min(n, static_cast<size_t>(counter & 1)) };
+			scalarUniform(seed, counter, out, head);
+			counter += head; out += head; n -= head;
+
+			__m512i key0[PhiloxRounds], key1[PhiloxRounds];
+			std::uint32_t k0{ static_cast<std::uint32_t>(seed) }, k1{ static_cast<std::uint32_t>(seed >> 32) };
+			for (int r = 0; r < PhiloxRounds; ++r, k0 += PhiloxW0, k1 += PhiloxW1)
+			{
+				key0[r] = _mm512_set1_epi64(k0);
+				key1[r] = _mm512_set1_epi64(k1);
+			}
+
+			const __m512i low = _mm512_set1_epi64(0xffffffffll);
+			const __m512i m0 = _mm512_set1_epi64(PhiloxM0), m1 = _mm512_set1_epi64(PhiloxM1);
+			const __m512i exponent = _mm512_set1_epi64(static_cast<long long>(UnitExponent));
+			const __m512d one = _mm512_set1_pd(1.0);
+			// interleaves the even and odd values of the eight blocks
+			const __m512i first = _mm512_set_epi64(11, 3, 10, 2, 9, 1, 8, 0);
+			const __m512i second = _mm512_set_epi64(15, 7, 14, 6, 13, 5, 12, 4);
+
+			size_t i{ 0 };
+			for (; i + 16 <= n; i += 16)
+			{
+				__m512i b = _mm512_add_epi64(_mm512_set1_epi64(static_cast<long long>((counter + i) >> 1)), _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0));
+				__m512i c0 = _mm512_and_si512(b, low), c1 = _mm512_srli_epi64(b, 32);
+				__m512i c2 = _mm512_setzero_si512(), c3 = _mm512_setzero_si512();
+				for (int r = 0; r < PhiloxRounds; ++r)
+				{
+					__m512i p0 = _mm512_mul_epu32(c0, m0), p1 = _mm512_mul_epu32(c2, m1);
+					c0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p1, 32), c1), key0[r]);
+					c1 = _mm512_and_si512(p1, low);
+					c2 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p0, 32), c3), key1[r]);
+					c3 = _mm512_and_si512(p0, low);
+				}
+
+				__m512d even = avx512Unit(_mm512_or_si512(_mm512_slli_epi64(c1, 32), c0), exponent, one);
+				__m512d odd = avx512Unit(_mm512_or_si512(_mm512_slli_epi64(c3, 32), c2), exponent, one);
+				_mm512_storeu_pd(out + i, _mm512_permutex2var_pd(even, first, odd));
+				_mm512_storeu_pd(out + i + 8, _mm512_permutex2var_pd(even, second, odd));
+			}
+			scalarUniform(seed, counter + i, out + i, n - i);
+		}
+	}
+
+	const KernelTable* avx512Kernels()
+	{
+		static const KernelTable table{
+			KernelTier::AVX512,
+			avx512Sum, avx512SumOfSquares, avx512Product, avx512Min, avx512Max,
+			{ avx512Elementwise<BinaryOp::Add>, avx512Elementwise<BinaryOp::Subtract>,
+			  avx512Elementwise<BinaryOp::Multiply>, avx512Elementwise<BinaryOp::Divide> },
+			{ avx512BroadcastRight<BinaryOp::Add>, avx512BroadcastRight<BinaryOp::Subtract>,
+			  avx512BroadcastRight<BinaryOp::Multiply>, avx512BroadcastRight<BinaryOp::Divide> },
+			{ avx512BroadcastLeft<BinaryOp::Add>, avx512BroadcastLeft<BinaryOp::Subtract>,
+			  avx512BroadcastLeft<BinaryOp::Multiply>, avx512BroadcastLeft<BinaryOp::Divide> },
+			{ avx512Gemm, 12, 16 },
+			avx512Uniform
+		};
+		return &table;
+	}
+}
+#endif // NIMPO_X86
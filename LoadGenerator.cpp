@@ -0,0 +1,275 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "LoadGenerator.h"
+#include "Exception.h"
+#include<algorithm>
+#include<chrono>
+#include<deque>
+#include<iomanip>
+#include<vector>
+
+#ifndef _WIN32
+#include<cerrno>
+#include<cstring>
+#include<fcntl.h>
+#include<sys/epoll.h>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<unistd.h>
+#endif
+
+namespace utility
+{
+#ifndef _WIN32
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		// a server that answers nothing for this long has stopped
+		const int Timeout = 10000;
+		const size_t ReadSize = size_t{ 64 } << 10;
+
+		struct Connection
+		{
+			int fd{ -1 };
+			size_t share{ 0 };					// the requests it sends
+			size_t issued{ 0 };
+			std::deque<Clock::time_point> inFlight;
+			std::string in;
+			std::string out;
+			size_t sent{ 0 };
+			std::uint32_t events{ 0 };
+		};
+
+		int connectTo(const std::string& path)
+		{
+			sockaddr_un address{};
+			address.sun_family = AF_UNIX;
+			if (path.empty() || path.size() >= sizeof address.sun_path)
+				throw Exception("Warning: " + path + " cannot be the path of a socket");
+			std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+			int fd{ socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+			if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof address) != 0
+				|| fcntl(fd, F_SETFL, O_NONBLOCK) != 0)
+			{
+				std::string reason{ std::strerror(errno) };
+				if (fd >= 0) close(fd);
+				throw Exception("Warning: cannot connect to " + path + ": " + reason);
+			}
+			return fd;
+		}
+
+		// the requests the pipeline has room for
+		void issue(Connection& c, const LoadOptions& options)
+		{
+			auto now = Clock::now();
+			while (c.issued < c.share && c.inFlight.size() < options.pipeline)
+			{
+				c.out += options.request;
+				c.out += '\n';
+				c.inFlight.push_back(now);
+				++c.issued;
+			}
+		}
+
+		void flush(Connection& c)
+		{
+			while (c.sent < c.out.size())
+			{
+				ssize_t n{ send(c.fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL) };
+				if (n < 0)
+				{
+					if (errno == EINTR) continue;
+					if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+					throw Exception("Warning: the server closed a connection");
+				}
+				c.sent += static_cast<size_t>(n);
+			}
+			c.out.clear();
+			c.sent = 0;
+		}
+
+		// one request on a connection with nothing in flight, waiting for its response
+		std::string ask(Connection& c, const std::string& request)
+		{
+			fcntl(c.fd, F_SETFL, 0);
+			c.out = request + '\n';
+			flush(c);
+
+			char buffer[4096];
+			size_t newline;
+			while ((newline = c.in.find('\n')) == std::string::npos)
+			{
+				ssize_t got{ read(c.fd, buffer, sizeof buffer) };
+				if (got < 0 && errno == EINTR) continue;
+				if (got <= 0)
+					throw Exception("Warning: the server closed a connection");
+				c.in.append(buffer, static_cast<size_t>(got));
+			}
+			return c.in.substr(0, newline);
+		}
+
+		double percentile(std::vector<double>& v, double q)
+		{
+			size_t k{ std::min(v.size() - 1, static_cast<size_t>(q * v.size())) };
+			std::nth_element(v.begin(), v.begin() + k, v.end());
+			return v[k];
+		}
+	}
+
+	void runLoad(const LoadOptions& options, std::ostream& os)
+	{
+		if (options.connections == 0 || options.pipeline == 0 || options.requests == 0)
+			throw Exception("Warning: the load needs at least one connection, request and request in flight");
+		if (options.request.find('\n') != std::string::npos)
+			throw Exception("Warning: a request is a single line");
+
+		int epoll{ epoll_create1(EPOLL_CLOEXEC) };
+		if (epoll < 0)
+			throw Exception("Warning: cannot wait on the connections");
+
+		std::vector<Connection> connections(options.connections);
+		std::vector<double> latencies;
+		latencies.reserve(options.requests);
+		size_t errors{ 0 };
+		std::string first;
+
+		auto closeAll = [&]
+		{
+			for (auto& c : connections)
+				if (c.fd >= 0) close(c.fd);
+			close(epoll);
+		};
+
+		try
+		{
+			for (size_t i = 0; i < connections.size(); ++i)
+			{
+				auto& c = connections[i];
+				c.share = options.requests / connections.size() + (i < options.requests % connections.size() ? 1 : 0);
+				c.fd = connectTo(options.path);
+				c.events = EPOLLIN;
+				epoll_event e{};
+				e.events = c.events;
+				e.data.ptr = &c;
+				epoll_ctl(epoll, EPOLL_CTL_ADD, c.fd, &e);
+			}
+
+			auto start = Clock::now();
+			for (auto& c : connections)
+			{
+				issue(c, options);
+				flush(c);
+			}
+
+			epoll_event events[64];
+			char buffer[ReadSize];
+			while (latencies.size() < options.requests)
+			{
+				int n{ epoll_wait(epoll, events, 64, Timeout) };
+				if (n < 0 && errno == EINTR) continue;
+				if (n <= 0)
+					throw Exception("Warning: the server stopped answering");
+
+				for (int i = 0; i < n; ++i)
+				{
+					auto& c = *static_cast<Connection*>(events[i].data.ptr);
+					if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+					{
+						ssize_t got{ read(c.fd, buffer, sizeof buffer) };
+						if (got == 0 || (got < 0 && errno != EAGAIN && errno != EINTR))
+							throw Exception("Warning: the server closed a connection");
+						if (got > 0)
+						{
+							c.in.append(buffer, static_cast<size_t>(got));
+							auto now = Clock::now();
+							size_t begin{ 0 }, newline;
+							while ((newline = c.in.find('\n', begin)) != std::string::npos)
+							{
+								if (c.inFlight.empty())
+									throw Exception("Warning: the server answered a request nobody sent");
+								if (first.empty()) first = c.in.substr(begin, newline - begin);
+								if (c.in.compare(begin, 6, "error ") == 0) ++errors;
+
+								latencies.push_back(std::chrono::duration<double>(now - c.inFlight.front()).count());
+								c.inFlight.pop_front();
+								begin = newline + 1;
+							}
+							c.in.erase(0, begin);
+							issue(c, options);
+						}
+					}
+					flush(c);
+
+					std::uint32_t wanted{ EPOLLIN | (c.out.empty() ? 0u : static_cast<std::uint32_t>(EPOLLOUT)) };
+					if (wanted != c.events)
+					{
+						epoll_event e{};
+						e.events = wanted;
+						e.data.ptr = &c;
+						epoll_ctl(epoll, EPOLL_CTL_MOD, c.fd, &e);
+						c.events = wanted;
+					}
+				}
+			}
+			double seconds{ std::chrono::duration<double>(Clock::now() - start).count() };
+
+			// how the cores of the server took it, asked while the sessions are open
+			std::string statistics{ ask(connections[0], "stats") };
+			closeAll();
+
+			os << std::fixed << std::setprecision(3) << "load: " << options.requests << " requests \""
+				<< options.request << "\" over " << options.connections << " connections, "
+				<< options.pipeline << " in flight each\n";
+			os << "  " << seconds << " s, " << std::setprecision(0) << options.requests / seconds
+				<< " requests/s, " << errors << " errors, the first response: " << first << "\n";
+			os << std::setprecision(1) << "  latency us  p50 " << percentile(latencies, 0.5) * 1e6
+				<< "  p99 " << percentile(latencies, 0.99) * 1e6 << "  p999 " << percentile(latencies, 0.999) * 1e6
+				<< "  max " << *std::max_element(latencies.begin(), latencies.end()) * 1e6 << "\n";
+
+			// one core per line
+			const std::string tag{ "stats " };
+			if (statistics.compare(0, tag.size(), tag) == 0)
+			{
+				size_t begin{ tag.size() }, end;
+				while ((end = statistics.find("; ", begin)) != std::string::npos)
+				{
+					os << "  " << statistics.substr(begin, end - begin) << "\n";
+					begin = end + 2;
+				}
+				os << "  " << statistics.substr(begin) << "\n";
+			}
+		}
+		catch (...)
+		{
+			closeAll();
+			throw;
+		}
+	}
+#else
+	void runLoad(const LoadOptions&, std::ostream&)
+	{
+		throw Exception("Warning: --load needs epoll, it is only available on Linux");
+	}
+#endif
+}
@@ -0,0 +1,49 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+#include<cstddef>
+#include<ostream>
+#include<string>
+
+namespace utility
+{
+	struct LoadOptions
+	{
+		std::string path;							// the socket of the server
+		size_t connections{ 16 };
+		size_t requests{ 200000 };					// over all the connections
+		size_t pipeline{ 8 };						// requests a connection has sent and not had answered
+		std::string request{ "clear 2 3 + 4 *" };
+	};
+
+	// The client that loads a server started with 'nimpo --serve <path>' on
+	// the same machine, started with 'nimpo --load <path>'. Every connection
+	// keeps pipeline requests in flight until it sent its share of them; the
+	// latency of a request runs from the moment it is handed to the socket to
+	// its response. Writes the requests per second, the percentiles of the
+	// latency and the statistics of the cores of the server to os. Failures
+	// of the socket throw a utility::Exception.
+	void runLoad(const LoadOptions& options, std::ostream& os);
+}
+#endif // !LOAD_GENERATOR_H
@@ -2,7 +2,11 @@
 #include <cstddef>
 #include<string>
 
+// the library build, NIMPO_LIBRARY, leaves the tracing out: it writes
+// nothing anywhere
+#ifndef NIMPO_LIBRARY
 #define DEBUG_MODE
+#endif
 namespace utility
 {
 #ifdef DEBUG_MODE
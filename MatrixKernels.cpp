@@ -0,0 +1,260 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+// The matrix kernels: a cache blocked matrix multiply around the register tile
+// of the bound tier, and the transpose and lu solve used by the matrix commands.
+
+#include "Kernels.h"
+#include "ThreadPool.h"
+#include<algorithm>
+#include<cfloat>
+#include<cmath>
+#include<vector>
+
+namespace utility
+{
+	namespace
+	{
+		// kc: a packed row panel of b and a column of a tiles stay in L1,
+		// mc: the packed block of a stays in L2,
+		// nc: the packed panel of b stays in the shared L3
+		const size_t BlockK = 256;
+		const size_t BlockM = 96;
+		const size_t BlockN = 2048;
+
+		// below this many flops a product is not worth starting threads for
+		const double ParallelFlops = 1 << 22;
+
+		const size_t MaxTileSize = 16 * 16;
+
+		// the rows of a block of a, mr at a time, as kc columns of mr values
+		void packA(const double* a, size_t lda, size_t mc, size_t kc, size_t mr, double* out)
+		{
+			for (size_t i = 0; i < mc; i += mr)
+			{
+				size_t rows{ std::min(mr, mc - i) };
+				for (size_t p = 0; p < kc; ++p)
+				{
+					for (size_t r = 0; r < rows; ++r)
+						*out++ = a[(i + r) * lda + p];
+					for (size_t r = rows; r < mr; ++r)
+						*out++ = 0.0;
+				}
+			}
+		}
+
+		// the columns of a panel of b, nr at a time, as kc rows of nr values
+		void packB(const double* b, size_t ldb, size_t kc, size_t nc, size_t nr, double* out)
+		{
+			for (size_t j = 0; j < nc; j += nr)
+			{
+				size_t cols{ std::min(nr, nc - j) };
+				for (size_t p = 0; p < kc; ++p)
+				{
+					const double* row{ b + p * ldb + j };
+					std::copy(row, row + cols, out);
+					std::fill(out + cols, out + nr, 0.0);
+					out += nr;
+				}
+			}
+		}
+
+		// c = a * b for m rows of a and c; the tiles on the right and bottom
+		// edges go through a buffer
+		void multiplyRows(const GemmTile& tile, const double* a, const double* b, double* c, size_t m, size_t k, size_t n)
+		{
+			const size_t mr{ tile.rows }, nr{ tile.cols };
+			const size_t mc{ std::max(BlockM / mr, size_t{ 1 }) * mr };
+
+			std::vector<double> packedA(mc * BlockK);
+			std::vector<double> packedB(BlockK * ((std::min(n, BlockN) + nr - 1) / nr * nr));
+			double edge[MaxTileSize];
+
+			for (size_t jc = 0; jc < n; jc += BlockN)
+			{
+				size_t nc{ std::min(BlockN, n - jc) };
+				for (size_t pc = 0; pc < k; pc += BlockK)
+				{
+					size_t kc{ std::min(BlockK, k - pc) };
+					bool accumulate{ pc > 0 };
+					packB(b + pc * n + jc, n, kc, nc, nr, packedB.data());
+
+					for (size_t ic = 0; ic < m; ic += mc)
+					{
+						size_t mcc{ std::min(mc, m - ic) };
+						packA(a + ic * k + pc, k, mcc, kc, mr, packedA.data());
+
+						for (size_t jr = 0; jr < nc; jr += nr)
+						{
+							size_t cols{ std::min(nr, nc - jr) };
+							for (size_t ir = 0; ir < mcc; ir += mr)
+							{
+								size_t rows{ std::min(mr, mcc - ir) };
+								const double* pa{ packedA.data() + ir * kc };
+								const double* pb{ packedB.data() + jr * kc };
+								double* cc{ c + (ic + ir) * n + jc + jr };
+
+								if (rows == mr && cols == nr)
+								{
+									tile.kernel(kc, pa, pb, cc, n, accumulate);
+									continue;
+								}
+
+								tile.kernel(kc, pa, pb, edge, nr, false);
+								for (size_t r = 0; r < rows; ++r)
+									for (size_t j = 0; j < cols; ++j)
+										cc[r * n + j] = accumulate ? cc[r * n + j] + edge[r * nr + j] : edge[r * nr + j];
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void multiplyMatrices(const double* a, const double* b, double* c, size_t m, size_t k, size_t n)
+	{
+		if (k == 0)
+		{
+			std::fill(c, c + m * n, 0.0);
+			return;
+		}
+
+		const GemmTile& tile = KernelRegistry::getInstance().kernels().gemm;
+
+		// every slab of whole register tiles of rows packs its own copy of b;
+		// that copy costs k * n next to the slab's 2 * rows * k * n flops
+		auto& pool = ThreadPool::getInstance();
+		double flops{ 2.0 * m * k * n };
+		size_t slabs{ pool.getThreadCount() };
+		slabs = std::min(slabs, (m + tile.rows - 1) / tile.rows);
+		slabs = std::min(slabs, static_cast<size_t>(flops / ParallelFlops) + 1);
+
+		size_t rowsPerSlab{ ((m + slabs - 1) / slabs + tile.rows - 1) / tile.rows * tile.rows };
+		pool.parallelFor((m + rowsPerSlab - 1) / rowsPerSlab, 1, [&](size_t first, size_t last)
+		{
+			for (size_t s = first; s < last; ++s)
+			{
+				size_t row{ s * rowsPerSlab };
+				multiplyRows(tile, a + row * k, b, c + row * n, std::min(rowsPerSlab, m - row), k, n);
+			}
+		});
+	}
+
+	void multiplyMatricesNaive(const double* a, const double* b, double* c, size_t m, size_t k, size_t n) noexcept
+	{
+		for (size_t i = 0; i < m; ++i)
+			for (size_t j = 0; j < n; ++j)
+			{
+				double s{ 0.0 };
+				for (size_t p = 0; p < k; ++p)
+					s += a[i * k + p] * b[p * n + j];
+				c[i * n + j] = s;
+			}
+	}
+
+	void transposeMatrix(const double* a, double* out, size_t rows, size_t cols) noexcept
+	{
+		// both sides of a 32 x 32 tile fit in L1
+		const size_t Tile = 32;
+		for (size_t i0 = 0; i0 < rows; i0 += Tile)
+			for (size_t j0 = 0; j0 < cols; j0 += Tile)
+			{
+				size_t i1{ std::min(i0 + Tile, rows) }, j1{ std::min(j0 + Tile, cols) };
+				for (size_t i = i0; i < i1; ++i)
+					for (size_t j = j0; j < j1; ++j)
+						out[j * rows + i] = a[i * cols + j];
+			}
+	}
+
+	bool factorLU(double* a, size_t* pivots, size_t n) noexcept
+	{
+		double largest{ 0.0 };
+		for (size_t i = 0; i < n * n; ++i)
+			largest = std::max(largest, std::fabs(a[i]));
+
+		const double tiny{ largest * static_cast<double>(n) * DBL_EPSILON };
+		for (size_t k = 0; k < n; ++k)
+		{
+			size_t p{ k };
+			for (size_t i = k + 1; i < n; ++i)
+				if (std::fabs(a[i * n + k]) > std::fabs(a[p * n + k]))
+					p = i;
+
+			if (!(std::fabs(a[p * n + k]) > tiny))
+				return false;
+
+			pivots[k] = p;
+			if (p != k)
+				std::swap_ranges(a + k * n, a + (k + 1) * n, a + p * n);
+
+			// the update of the trailing rows runs along the rows, which are contiguous
+			const double* rowK{ a + k * n };
+			for (size_t i = k + 1; i < n; ++i)
+			{
+				double* rowI{ a + i * n };
+				double l{ rowI[k] /= rowK[k] };
+				if (l == 0.0)
+					continue;
+				for (size_t j = k + 1; j < n; ++j)
+					rowI[j] -= l * rowK[j];
+			}
+		}
+
+		return true;
+	}
+
+	void solveLU(const double* lu, const size_t* pivots, double* b, size_t n, size_t nrhs) noexcept
+	{
+		for (size_t k = 0; k < n; ++k)
+			if (pivots[k] != k)
+				std::swap_ranges(b + k * nrhs, b + (k + 1) * nrhs, b + pivots[k] * nrhs);
+
+		// l has a unit diagonal
+		for (size_t i = 1; i < n; ++i)
+		{
+			double* rowI{ b + i * nrhs };
+			for (size_t k = 0; k < i; ++k)
+			{
+				double l{ lu[i * n + k] };
+				const double* rowK{ b + k * nrhs };
+				for (size_t j = 0; j < nrhs; ++j)
+					rowI[j] -= l * rowK[j];
+			}
+		}
+
+		for (size_t i = n; i-- > 0;)
+		{
+			double* rowI{ b + i * nrhs };
+			for (size_t k = i + 1; k < n; ++k)
+			{
+				double u{ lu[i * n + k] };
+				const double* rowK{ b + k * nrhs };
+				for (size_t j = 0; j < nrhs; ++j)
+					rowI[j] -= u * rowK[j];
+			}
+
+			double d{ lu[i * n + i] };
+			for (size_t j = 0; j < nrhs; ++j)
+				rowI[j] /= d;
+		}
+	}
+}
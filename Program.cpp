@@ -0,0 +1,309 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "Program.h"
+#include<algorithm>
+#include<cmath>
+#include<unordered_map>
+#include"Exception.h"
+#include"Tokenizer.h"
+#include"VectorMath.h"
+
+namespace control
+{
+	namespace
+	{
+		// as many elements as a function may leave, like the bulk producers
+		const size_t MaxOperands = size_t{ 1 } << 30;
+
+		// the open control words while compiling, with the instruction to patch
+		enum class Open { If, Else, Times };
+
+		// a static stand-in the throwing constructor replaces by one naming the word
+		const char* const UnknownWord = "Warning: a word cannot be used in a function";
+	}
+
+	const char* const Program::NumberOutOfRange = "Warning: a number is too large for a double";
+
+	Program::Program()
+		:m_code{}
+	{
+	}
+
+	Program::Program(const std::vector<std::string>& tokens, const Lookup& lookup)
+		:m_code{}
+	{
+		size_t at{ 0 };
+		auto status = assemble(tokens, lookup, at);
+		if (status.ok()) return;
+
+		if (status.message() == UnknownWord)
+			throw utility::Exception("Warning: " + tokens[at] + " cannot be used in a function");
+		if (status.message() == NumberOutOfRange)
+			throw utility::Exception("Warning: " + tokens[at] + " is not a number a double can hold");
+		throw utility::Exception(status.message());
+	}
+
+	utility::Expected<std::shared_ptr<const Program>> Program::compile(const std::vector<std::string>& tokens, const Lookup& lookup)
+	{
+		std::shared_ptr<Program> program{ new Program };
+		size_t at{ 0 };
+		auto status = program->assemble(tokens, lookup, at);
+		if (!status) return status;
+		return std::shared_ptr<const Program>{ std::move(program) };
+	}
+
+	utility::Status Program::assemble(const std::vector<std::string>& tokens, const Lookup& lookup, size_t& at)
+	{
+		static const std::unordered_map<std::string, Op> Words{
+			{ "+", Op::Add }, { "-", Op::Subtract }, { "*", Op::Multiply }, { "/", Op::Divide },
+			{ "sin", Op::Sin }, { "cos", Op::Cos }, { "tan", Op::Tan },
+			{ "arcsin", Op::ASin }, { "arccos", Op::ACos }, { "arctan", Op::ATan },
+			{ "<", Op::Less }, { ">", Op::Greater }, { "<=", Op::LessEqual }, { ">=", Op::GreaterEqual },
+			{ "==", Op::Equal }, { "!=", Op::NotEqual },
+			{ "dup", Op::Dup }, { "drop", Op::Drop }, { "swap", Op::Swap }, { "over", Op::Over } };
+
+		std::vector<std::pair<Open, size_t>> open;
+		for (at = 0; at != tokens.size(); ++at)
+		{
+			std::string word{ tokens[at] };
+			std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+
+			double d;
+			bool inRange;
+			auto known = Words.find(word);
+			if (known != Words.end())
+				m_code.push_back({ known->second, 0.0, 0 });
+			else if (utility::parseNumber(word, d, inRange))
+			{
+				if (!inRange)
+					return utility::Status::failure(NumberOutOfRange);
+				m_code.push_back({ Op::Push, d, 0 });
+			}
+			else if (word == "if")
+			{
+				open.emplace_back(Open::If, m_code.size());
+				m_code.push_back({ Op::JumpIfZero, 0.0, 0 });
+			}
+			else if (word == "else")
+			{
+				if (open.empty() || open.back().first != Open::If)
+					return utility::Status::failure("Warning: else without an if");
+				m_code[open.back().second].target = m_code.size() + 1;
+				open.back() = { Open::Else, m_code.size() };
+				m_code.push_back({ Op::Jump, 0.0, 0 });
+			}
+			else if (word == "then")
+			{
+				if (open.empty() || open.back().first == Open::Times)
+					return utility::Status::failure("Warning: then without an if");
+				m_code[open.back().second].target = m_code.size();
+				open.pop_back();
+			}
+			else if (word == "times")
+			{
+				open.emplace_back(Open::Times, m_code.size());
+				m_code.push_back({ Op::Times, 0.0, 0 });
+			}
+			else if (word == "next")
+			{
+				if (open.empty() || open.back().first != Open::Times)
+					return utility::Status::failure("Warning: next without a times");
+				m_code.push_back({ Op::Next, 0.0, open.back().second + 1 });
+				m_code[open.back().second].target = m_code.size();
+				open.pop_back();
+			}
+			else if (word == "i")
+			{
+				if (std::none_of(open.begin(), open.end(), [](const std::pair<Open, size_t>& o) { return o.first == Open::Times; }))
+					return utility::Status::failure("Warning: i is the turn of a loop, it needs a times around it");
+				m_code.push_back({ Op::Index, 0.0, 0 });
+			}
+			else if (auto callee = lookup(word))
+			{
+				// the jumps of the callee move along with its code
+				size_t base{ m_code.size() };
+				for (auto instruction : callee->m_code)
+				{
+					if (instruction.op == Op::JumpIfZero || instruction.op == Op::Jump
+						|| instruction.op == Op::Times || instruction.op == Op::Next)
+						instruction.target += base;
+					m_code.push_back(instruction);
+				}
+			}
+			else
+				return utility::Status::failure(UnknownWord);
+		}
+
+		if (!open.empty())
+			return utility::Status::failure(open.back().first == Open::Times ? "Warning: times without a next" : "Warning: if without a then");
+		if (m_code.empty())
+			return utility::Status::failure("Warning: a function needs at least one word");
+		return {};
+	}
+
+	Program::~Program()
+	{
+	}
+
+	size_t Program::size() const
+	{
+		return m_code.size();
+	}
+
+	utility::Expected<size_t> Program::run(std::vector<double>& operands, const Below& below) const
+	{
+		// a local stack the compiler may keep in registers
+		std::vector<double> s;
+		s.swap(operands);
+
+		struct Turn
+		{
+			std::uint64_t count;
+			std::uint64_t index;
+		};
+		std::vector<Turn> loops;
+
+		// the operands run out rarely, then the deeper elements slide in under
+		// them; a check that fails leaves its reason in failure
+		utility::Status failure;
+		size_t taken{ 0 };
+		auto refill = [&](size_t n)
+		{
+			while (s.size() < n)
+			{
+				auto d = below(taken);
+				if (!d)
+				{
+					failure = d.status();
+					return false;
+				}
+				++taken;
+				s.insert(s.begin(), *d);
+			}
+			return true;
+		};
+		auto need = [&](size_t n)
+		{
+			return s.size() >= n || refill(n);
+		};
+		auto room = [&]()
+		{
+			if (s.size() < MaxOperands) return true;
+			failure = utility::Status::failure("Warning: a function can leave at most 2^30 elements!");
+			return false;
+		};
+		auto binary = [&](double& top)
+		{
+			if (!need(2)) return false;
+			top = s.back();
+			s.pop_back();
+			return true;
+		};
+		auto& math = utility::VectorMath::getInstance();
+
+		const Instruction* const first{ m_code.data() };
+		const Instruction* const last{ first + m_code.size() };
+		const Instruction* pc{ first };
+		double b;
+		while (pc != last)
+		{
+			const Instruction& in{ *pc++ };
+			switch (in.op)
+			{
+			case Op::Push:
+				if (!room()) return failure;
+				s.push_back(in.value);
+				break;
+			case Op::Add: if (!binary(b)) return failure; s.back() += b; break;
+			case Op::Subtract: if (!binary(b)) return failure; s.back() -= b; break;
+			case Op::Multiply: if (!binary(b)) return failure; s.back() *= b; break;
+			case Op::Divide:
+				if (!binary(b)) return failure;
+				if (b == 0.0)
+					return utility::Status::failure("Warning trying to divide by zero!");
+				s.back() /= b;
+				break;
+			case Op::Sin: if (!need(1)) return failure; s.back() = math.evaluate(utility::MathFunction::Sin, s.back()); break;
+			case Op::Cos: if (!need(1)) return failure; s.back() = math.evaluate(utility::MathFunction::Cos, s.back()); break;
+			case Op::Tan: if (!need(1)) return failure; s.back() = math.evaluate(utility::MathFunction::Tan, s.back()); break;
+			case Op::ASin: if (!need(1)) return failure; s.back() = math.evaluate(utility::MathFunction::ASin, s.back()); break;
+			case Op::ACos: if (!need(1)) return failure; s.back() = math.evaluate(utility::MathFunction::ACos, s.back()); break;
+			case Op::ATan: if (!need(1)) return failure; s.back() = math.evaluate(utility::MathFunction::ATan, s.back()); break;
+			case Op::Less: if (!binary(b)) return failure; s.back() = s.back() < b; break;
+			case Op::Greater: if (!binary(b)) return failure; s.back() = s.back() > b; break;
+			case Op::LessEqual: if (!binary(b)) return failure; s.back() = s.back() <= b; break;
+			case Op::GreaterEqual: if (!binary(b)) return failure; s.back() = s.back() >= b; break;
+			case Op::Equal: if (!binary(b)) return failure; s.back() = s.back() == b; break;
+			case Op::NotEqual: if (!binary(b)) return failure; s.back() = s.back() != b; break;
+			case Op::Dup:
+				if (!need(1) || !room()) return failure;
+				s.push_back(s.back());
+				break;
+			case Op::Drop:
+				if (!need(1)) return failure;
+				s.pop_back();
+				break;
+			case Op::Swap:
+				if (!need(2)) return failure;
+				std::swap(s[s.size() - 1], s[s.size() - 2]);
+				break;
+			case Op::Over:
+				if (!need(2) || !room()) return failure;
+				s.push_back(s[s.size() - 2]);
+				break;
+			case Op::JumpIfZero:
+			{
+				if (!need(1)) return failure;
+				double c{ s.back() };
+				s.pop_back();
+				if (c == 0.0) pc = first + in.target;
+				break;
+			}
+			case Op::Jump:
+				pc = first + in.target;
+				break;
+			case Op::Times:
+			{
+				if (!need(1)) return failure;
+				double n{ s.back() };
+				s.pop_back();
+				if (!(n >= 0.0 && n <= 9007199254740992.0) || n != std::floor(n))
+					return utility::Status::failure("Warning: times needs a whole count of at least 0!");
+				if (n == 0.0) pc = first + in.target;
+				else loops.push_back({ static_cast<std::uint64_t>(n), 0 });
+				break;
+			}
+			case Op::Next:
+				if (++loops.back().index < loops.back().count) pc = first + in.target;
+				else loops.pop_back();
+				break;
+			case Op::Index:
+				if (!room()) return failure;
+				s.push_back(static_cast<double>(loops.back().index));
+				break;
+			}
+		}
+
+		operands.swap(s);
+		return taken;
+	}
+}
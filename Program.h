@@ -0,0 +1,96 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PROGRAM_H
+#define PROGRAM_H
+#include<cstdint>
+#include<functional>
+#include<memory>
+#include<string>
+#include<vector>
+#include"Status.h"
+
+namespace control
+{
+	/*
+		The body of a function, def <name> ... end, compiled once into a stream
+		of instructions that runs on a stack of its own, with no command and no
+		dispatcher in between. It knows numbers, + - * /, sin cos tan arcsin
+		arccos arctan, the comparisons < > <= >= == != giving 1 or 0, dup drop
+		swap over, the functions defined before it, which are copied in, and
+		two forms of control:
+			<c> if ... else ... then	runs the first part if c is not 0, else the
+										second one; else is optional
+			<n> times ... next			runs the part n times, i pushes the turn,
+										0 to n - 1, of the innermost loop
+	*/
+	class Program
+	{
+	public:
+		// finds a function defined before, null if there is none
+		using Lookup = std::function<std::shared_ptr<const Program>(const std::string&)>;
+
+		// throws on a word it does not know and on unbalanced control words
+		Program(const std::vector<std::string>& tokens, const Lookup& lookup);
+		~Program();
+
+		// The same without throwing, for callers to whom a body that does not
+		// compile is a normal outcome. A number a double cannot hold fails
+		// with NumberOutOfRange.
+		static utility::Expected<std::shared_ptr<const Program>> compile(const std::vector<std::string>& tokens, const Lookup& lookup);
+		static const char* const NumberOutOfRange;
+
+		// Runs on operands, top last. Once they run out, the elements under them
+		// come from below(k), the k-th one down, or its failure if there is
+		// none; returns how many were taken. Fails on a division by zero and on
+		// a count of times that is not a whole number.
+		using Below = std::function<utility::Expected<double>(size_t)>;
+		utility::Expected<size_t> run(std::vector<double>& operands, const Below& below) const;
+
+		size_t size() const;
+
+	private:
+		enum class Op : std::uint8_t
+		{
+			Push, Add, Subtract, Multiply, Divide,
+			Sin, Cos, Tan, ASin, ACos, ATan,
+			Less, Greater, LessEqual, GreaterEqual, Equal, NotEqual,
+			Dup, Drop, Swap, Over,
+			JumpIfZero, Jump, Times, Next, Index
+		};
+
+		struct Instruction
+		{
+			Op op;
+			double value;		// of Push
+			size_t target;		// of the jumps, Times past its Next, Next back to the body
+		};
+
+		Program();
+
+		// compiles tokens into m_code; on a failure, at is the token it is about
+		utility::Status assemble(const std::vector<std::string>& tokens, const Lookup& lookup, size_t& at);
+
+		std::vector<Instruction> m_code;
+	};
+}
+#endif // !PROGRAM_H
@@ -0,0 +1,225 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+#include "Reclaimer.h"
+#include<algorithm>
+#include<chrono>
+#include<condition_variable>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include<Windows.h>
+#else
+#include<pthread.h>
+#include<sched.h>
+#endif
+
+namespace utility
+{
+	class Reclaimer::ReclaimerImpl
+	{
+	public:
+		ReclaimerImpl();
+		~ReclaimerImpl();
+
+		void enqueue(std::unique_ptr<Batch> batch);
+		void drain();
+		void setBackground(bool on);
+		bool isBackground()const;
+		Statistics getStatistics()const;
+
+	private:
+		// the background thread
+		void run();
+
+		// destroys the batch and returns how long it took
+		static double destroy(std::unique_ptr<Batch>& batch);
+		void account(std::uint64_t batches, double seconds, double longest);
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_wake;		// a batch is retired or the reclaimer stops
+		std::condition_variable m_drained;	// batches are destroyed
+		std::vector<std::unique_ptr<Batch>> m_queue;
+		bool m_background;
+		bool m_stopping;
+		Statistics m_statistics;
+
+		std::thread m_thread;
+	};
+
+	Reclaimer::ReclaimerImpl::ReclaimerImpl()
+		: m_background{ true }
+		, m_stopping{ false }
+		, m_statistics{}
+	{
+		m_thread = std::thread{ [this] { run(); } };
+
+		// freeing is work for when the calculator waits for the user; on few
+		// cores the thread should not preempt the one that retires
+#ifdef _WIN32
+		SetThreadPriority(m_thread.native_handle(), THREAD_PRIORITY_LOWEST);
+#elif defined(SCHED_IDLE)
+		sched_param param{};
+		pthread_setschedparam(m_thread.native_handle(), SCHED_IDLE, &param);
+#endif
+	}
+
+	Reclaimer::ReclaimerImpl::~ReclaimerImpl()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_stopping = true;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+	}
+
+	void Reclaimer::ReclaimerImpl::enqueue(std::unique_ptr<Batch> batch)
+	{
+		std::unique_lock<std::mutex> lock{ m_mutex };
+		++m_statistics.batches;
+		if (!m_background)
+		{
+			lock.unlock();
+			double seconds{ destroy(batch) };
+			lock.lock();
+			account(1, seconds, seconds);
+			return;
+		}
+
+		m_queue.push_back(std::move(batch));
+		lock.unlock();
+		m_wake.notify_one();
+	}
+
+	void Reclaimer::ReclaimerImpl::drain()
+	{
+		std::unique_lock<std::mutex> lock{ m_mutex };
+		m_drained.wait(lock, [this] { return m_statistics.freed == m_statistics.batches; });
+	}
+
+	void Reclaimer::ReclaimerImpl::setBackground(bool on)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_background = on;
+	}
+
+	bool Reclaimer::ReclaimerImpl::isBackground() const
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		return m_background;
+	}
+
+	Reclaimer::Statistics Reclaimer::ReclaimerImpl::getStatistics() const
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		return m_statistics;
+	}
+
+	void Reclaimer::ReclaimerImpl::run()
+	{
+		std::vector<std::unique_ptr<Batch>> batches;
+		for (;;)
+		{
+			std::unique_lock<std::mutex> lock{ m_mutex };
+			m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+			if (m_queue.empty())
+				return;
+
+			batches.swap(m_queue);
+			lock.unlock();
+
+			// destroyed without holding up the threads retiring more
+			double seconds{ 0.0 }, longest{ 0.0 };
+			for (auto& batch : batches)
+			{
+				double s{ destroy(batch) };
+				seconds += s;
+				longest = std::max(longest, s);
+			}
+
+			std::uint64_t destroyed{ batches.size() };
+			batches.clear();
+
+			lock.lock();
+			account(destroyed, seconds, longest);
+		}
+	}
+
+	double Reclaimer::ReclaimerImpl::destroy(std::unique_ptr<Batch>& batch)
+	{
+		auto start = std::chrono::steady_clock::now();
+		batch.reset();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void Reclaimer::ReclaimerImpl::account(std::uint64_t batches, double seconds, double longest)
+	{
+		// under m_mutex
+		m_statistics.freed += batches;
+		m_statistics.seconds += seconds;
+		m_statistics.maxSeconds = std::max(m_statistics.maxSeconds, longest);
+		m_drained.notify_all();
+	}
+
+	Reclaimer& Reclaimer::getInstance()
+	{
+		static Reclaimer instance;
+		return instance;
+	}
+
+	Reclaimer::Reclaimer()
+	{
+		impl = std::make_unique<ReclaimerImpl>();
+	}
+
+	Reclaimer::~Reclaimer()
+	{
+	}
+
+	void Reclaimer::enqueue(std::unique_ptr<Batch> batch)
+	{
+		impl->enqueue(std::move(batch));
+	}
+
+	void Reclaimer::drain()
+	{
+		impl->drain();
+	}
+
+	void Reclaimer::setBackground(bool on)
+	{
+		impl->setBackground(on);
+	}
+
+	bool Reclaimer::isBackground() const
+	{
+		return impl->isBackground();
+	}
+
+	Reclaimer::Statistics Reclaimer::getStatistics() const
+	{
+		return impl->getStatistics();
+	}
+}
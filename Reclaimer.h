@@ -0,0 +1,98 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RECLAIMER_H
+#define RECLAIMER_H
+#include<cstdint>
+#include<memory>
+#include<type_traits>
+
+namespace utility
+{
+	/*
+		Destroys on a background thread what the calling thread is done with,
+		so throwing away a long redo list or a whole undo history does not
+		pause it for as long as the destructors run. Whatever is retired must
+		be safe to destroy on another thread: it owns what it frees and touches
+		nothing shared. With the background off, for measurements and
+		debugging, retire destroys right away on the calling thread.
+	*/
+	class Reclaimer
+	{
+	public:
+		struct Statistics
+		{
+			std::uint64_t batches;		// retired
+			std::uint64_t freed;		// of them, destroyed
+			double seconds;				// spent destroying, over all batches
+			double maxSeconds;			// the longest batch
+		};
+
+		static Reclaimer& getInstance();
+
+		// takes the garbage over, moved in
+		template<typename T>
+		void retire(T&& garbage);
+
+		// waits until every batch retired so far is destroyed
+		void drain();
+
+		void setBackground(bool on);
+		bool isBackground()const;
+
+		Statistics getStatistics()const;
+
+	private:
+		struct Batch
+		{
+			virtual ~Batch() = default;
+		};
+
+		template<typename T>
+		struct BatchOf : Batch
+		{
+			explicit BatchOf(T&& g) : garbage{ std::move(g) } {}
+			T garbage;
+		};
+
+		void enqueue(std::unique_ptr<Batch> batch);
+
+		Reclaimer();
+		~Reclaimer();
+		class ReclaimerImpl;
+		std::unique_ptr<ReclaimerImpl> impl;
+
+	private:
+		Reclaimer(const Reclaimer&) = delete;
+		Reclaimer(Reclaimer&&) = delete;
+		Reclaimer& operator=(const Reclaimer&) = delete;
+		Reclaimer& operator=(Reclaimer&&) = delete;
+	};
+
+	template<typename T>
+	void Reclaimer::retire(T&& garbage)
+	{
+		static_assert(!std::is_lvalue_reference<T>::value, "retire takes the garbage over, move it in");
+		enqueue(std::unique_ptr<Batch>{ new BatchOf<T>{ std::move(garbage) } });
+	}
+}
+#endif // !RECLAIMER_H
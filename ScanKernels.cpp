@@ -0,0 +1,241 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+// Prefix scans and sliding windows over ranges of doubles. Both split the
+// range into fixed chunks, so the results do not depend on the number of
+// threads, and both touch every element a constant number of times whatever
+// the window length.
+
+#include "KernelVariants.h"
+#include "ThreadPool.h"
+#include<algorithm>
+#include<vector>
+
+namespace utility
+{
+	namespace
+	{
+		// the elements one task scans
+		const size_t ScanGrain = 1 << 16;
+
+		struct Compensated
+		{
+			double sum;
+			double error;
+		};
+
+		Compensated operator+(Compensated a, Compensated b)
+		{
+			neumaierAdd(a.sum, a.error, b.sum);
+			a.error += b.error;
+			return a;
+		}
+
+		// the compensation of a sum that overflowed or met a nan is nan itself
+		inline double total(Compensated r)
+		{
+			return std::isfinite(r.sum) ? r.sum + r.error : r.sum;
+		}
+
+		// body(first, last) for the chunks of size elements of 0 ... n; unlike
+		// parallelFor the chunks are the same for any number of threads
+		template<typename Body>
+		void forChunks(size_t n, size_t size, Body&& body)
+		{
+			size_t chunks{ (n + size - 1) / size };
+			ThreadPool::getInstance().parallelFor(chunks, 1, [&](size_t c0, size_t c1)
+			{
+				for (size_t c = c0; c < c1; ++c)
+					body(c * size, std::min(n, (c + 1) * size));
+			});
+		}
+
+		// Two passes over the chunks: the first reduces every chunk but the
+		// last on its own, a short serial scan over the chunk totals gives each
+		// chunk the value it starts from, the second scans the chunks from there.
+		template<typename T, typename Reduce, typename Scan>
+		void scanChunks(size_t n, T identity, Reduce&& reduce, Scan&& scan)
+		{
+			size_t chunks{ (n + ScanGrain - 1) / ScanGrain };
+			std::vector<T> start(chunks, identity);
+			if (chunks > 1)
+			{
+				forChunks((chunks - 1) * ScanGrain, ScanGrain, [&](size_t first, size_t last)
+				{
+					start[first / ScanGrain + 1] = reduce(first, last);
+				});
+				for (size_t c = 1; c < chunks; ++c)
+					start[c] = start[c - 1] + start[c];
+			}
+
+			forChunks(n, ScanGrain, [&](size_t first, size_t last)
+			{
+				scan(first, last, start[first / ScanGrain]);
+			});
+		}
+
+		// counts the values a running sum cannot take back out again
+		struct NonFinite
+		{
+			size_t nan;
+			size_t positive;
+			size_t negative;
+
+			// true if x is one of them; it is counted in, or out when it
+			// leaves the window
+			bool count(double x, bool in)
+			{
+				size_t* counter;
+				if (std::isnan(x))
+					counter = &nan;
+				else if (x == HUGE_VAL)
+					counter = &positive;
+				else if (x == -HUGE_VAL)
+					counter = &negative;
+				else
+					return false;
+
+				in ? ++*counter : --*counter;
+				return true;
+			}
+
+			double apply(double sum)const
+			{
+				if (nan > 0 || (positive > 0 && negative > 0))
+					return std::nan("");
+				if (positive > 0)
+					return HUGE_VAL;
+				if (negative > 0)
+					return -HUGE_VAL;
+				return sum;
+			}
+		};
+
+		// the extremum of every window of w elements, by a monotonic deque of
+		// indices whose values get worse from the front to the back: the front
+		// is the extremum of the window, an index leaves at the back as soon
+		// as a better value comes in and at the front when it drops out of the
+		// window. A nan in a window makes its extremum nan.
+		template<typename Better>
+		void windowExtremum(const double* in, double* out, size_t n, size_t w, Better better)
+		{
+			// the first window of a chunk costs w steps, chunks at least that
+			// long keep the whole pass linear
+			forChunks(n - w + 1, std::max(ScanGrain, w), [=](size_t first, size_t last)
+			{
+				std::vector<size_t> deque(last - first + w);
+				size_t front{ 0 }, back{ 0 };
+				size_t nanUntil{ first };
+
+				for (size_t i = first; i < last + w - 1; ++i)
+				{
+					if (std::isnan(in[i]))
+						nanUntil = i + w;
+					else
+					{
+						while (back > front && !better(in[deque[back - 1]], in[i]))
+							--back;
+						deque[back++] = i;
+					}
+
+					if (i + 1 < first + w)
+						continue;
+
+					size_t window{ i + 1 - w };
+					while (back > front && deque[front] < window)
+						++front;
+					out[window] = nanUntil > i || back == front ? std::nan("") : in[deque[front]];
+				}
+			});
+		}
+	}
+
+	void prefixSum(const double* in, double* out, size_t n)
+	{
+		scanChunks(n, Compensated{ 0.0, 0.0 },
+			[=](size_t first, size_t last)
+			{
+				Compensated r{ 0.0, 0.0 };
+				for (size_t i = first; i < last; ++i)
+					neumaierAdd(r.sum, r.error, in[i]);
+				return r;
+			},
+			[=](size_t first, size_t last, Compensated r)
+			{
+				for (size_t i = first; i < last; ++i)
+				{
+					neumaierAdd(r.sum, r.error, in[i]);
+					out[i] = total(r);
+				}
+			});
+	}
+
+	void prefixProduct(const double* in, double* out, size_t n)
+	{
+		scanChunks(n, 1.0,
+			[=](size_t first, size_t last)
+			{
+				double r{ 1.0 };
+				for (size_t i = first; i < last; ++i)
+					r *= in[i];
+				return r;
+			},
+			[=](size_t first, size_t last, double r)
+			{
+				for (size_t i = first; i < last; ++i)
+					out[i] = r *= in[i];
+			});
+	}
+
+	void windowSum(const double* in, double* out, size_t n, size_t w)
+	{
+		forChunks(n - w + 1, std::max(ScanGrain, w), [=](size_t first, size_t last)
+		{
+			// infinities and nans are counted apart, a sum that took one in
+			// could never subtract it again
+			Compensated r{ 0.0, 0.0 };
+			NonFinite special{ 0, 0, 0 };
+			for (size_t i = first; i < first + w; ++i)
+				if (!special.count(in[i], true))
+					neumaierAdd(r.sum, r.error, in[i]);
+			out[first] = special.apply(total(r));
+
+			for (size_t i = first + 1; i < last; ++i)
+			{
+				if (!special.count(in[i + w - 1], true))
+					neumaierAdd(r.sum, r.error, in[i + w - 1]);
+				if (!special.count(in[i - 1], false))
+					neumaierAdd(r.sum, r.error, -in[i - 1]);
+				out[i] = special.apply(total(r));
+			}
+		});
+	}
+
+	void windowMin(const double* in, double* out, size_t n, size_t w)
+	{
+		windowExtremum(in, out, n, w, [](double a, double b) { return a < b; });
+	}
+
+	void windowMax(const double* in, double* out, size_t n, size_t w)
+	{
+		windowExtremum(in, out, n, w, [](double a, double b) { return a > b; });
+	}
+}
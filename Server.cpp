@@ -0,0 +1,877 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "Server.h"
+#include "Engine.h"
+#include "Exception.h"
+#include<algorithm>
+#include<atomic>
+#include<charconv>
+#include<chrono>
+#include<mutex>
+#include<string_view>
+#include<thread>
+#include<unordered_map>
+#include<utility>
+
+#ifndef _WIN32
+#include<cerrno>
+#include<cstring>
+#include<fcntl.h>
+#include<pthread.h>
+#include<sched.h>
+#include<sys/epoll.h>
+#include<sys/eventfd.h>
+#include<sys/socket.h>
+#include<sys/stat.h>
+#include<sys/un.h>
+#include<unistd.h>
+#endif
+
+namespace control
+{
+#ifndef _WIN32
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		// the longest request, the responses a session keeps before it stops
+		// reading, and the elements a response shows
+		const size_t MaxLine = size_t{ 64 } << 10;
+		const size_t MaxUnsent = size_t{ 1 } << 20;
+		const size_t MaxShown = 16;
+
+		// read at once from one session, so a busy client does not hold up the others
+		const size_t ReadSize = size_t{ 64 } << 10;
+		const int MaxEvents = 64;
+
+		// how often a core measures itself, how busy it is before it gives
+		// sessions away, by how much less busy the core taking them must be,
+		// and the most it gives at once
+		const Clock::duration Tick = std::chrono::milliseconds{ 100 };
+		const double Overloaded = 0.85;
+		const double Gap = 0.25;
+		const size_t MaxMoved = 64;
+
+		void appendNumber(std::string& out, double d)
+		{
+			char text[32];
+			out.append(text, std::to_chars(text, text + sizeof text, d).ptr);
+		}
+
+		void appendNumber(std::string& out, double d, int precision)
+		{
+			char text[32];
+			out.append(text, std::to_chars(text, text + sizeof text, d, std::chars_format::fixed, precision).ptr);
+		}
+
+		void appendNumber(std::string& out, std::uint64_t n)
+		{
+			char text[24];
+			out.append(text, std::to_chars(text, text + sizeof text, n).ptr);
+		}
+
+		// async signal safe, stop calls it
+		void wake(int eventFd) noexcept
+		{
+			std::uint64_t one{ 1 };
+			ssize_t written{ write(eventFd, &one, sizeof one) };
+			(void)written;
+		}
+
+		std::string_view trim(std::string_view s)
+		{
+			while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+			while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+			return s;
+		}
+
+		struct Session
+		{
+			explicit Session(int f) : fd{ f } {}
+
+			int fd;
+			Engine engine;
+			std::string in;				// read, the last line may be incomplete
+			size_t parsed{ 0 };			// of in, answered
+			std::string out;			// responses not written yet
+			size_t sent{ 0 };			// of out, written
+			std::uint32_t events{ 0 };	// what epoll waits for
+			bool ending{ false };		// no more requests, the session ends once out is written
+			std::uint64_t lastTick{ 0 };	// the last measurement of its core it had a request in
+			std::uint64_t requests{ 0 };	// answered in that measurement
+			std::uint64_t arrived{ 0 };		// the measurement of its core it came in
+
+			size_t unsent()const { return out.size() - sent; }
+			// with nothing to write and not ending it moves without losing the order of its responses
+			bool movable()const { return unsent() == 0 && !ending; }
+			// the requests of the measurement before tick
+			std::uint64_t recent(std::uint64_t tick)const { return lastTick + 1 == tick ? requests : 0; }
+		};
+	}
+
+	class Server::ServerImpl
+	{
+	public:
+		ServerImpl(const std::string& path, size_t cores);
+		~ServerImpl();
+
+		void run();
+		void stop() noexcept;
+		std::vector<CoreStatistics> getStatistics()const;
+
+	private:
+		class Core;
+
+		void listen();
+		void accept();
+
+		std::string m_path;
+		int m_listener;
+		int m_epoll;
+		int m_wake;		// an eventfd stop writes to
+
+		std::vector<int> m_processors;	// the ones the process may use
+		std::vector<std::unique_ptr<Core>> m_cores;
+	};
+
+	// an event loop and the sessions it serves
+	class Server::ServerImpl::Core
+	{
+	public:
+		Core(ServerImpl& server, size_t index);
+		~Core();
+
+		// runs the loop on a thread pinned to processor, stop ends it
+		void start(int processor);
+		void stop();
+
+		// from any thread: a connection accepted, or sessions given by another core
+		void adopt(int fd);
+		void adopt(std::vector<std::unique_ptr<Session>> sessions);
+
+		// from any thread: the sessions it serves and the ones handed to it
+		size_t load()const;
+
+		CoreStatistics getStatistics()const;
+
+	private:
+		void run();
+		void takeInbox();
+		void add(std::unique_ptr<Session> s);
+		void measure(Clock::time_point now);
+		void balance(double busy);
+
+		void serve(Session& s, std::uint32_t events);
+		bool receive(Session& s);
+		bool answer(Session& s);
+		void respond(Session& s, std::string_view request);
+		bool send(Session& s);
+		void watch(Session& s);
+		void end(Session& s);
+
+		ServerImpl& m_server;
+		int m_epoll;
+		int m_wake;
+		std::thread m_thread;
+		std::atomic<bool> m_stopping;
+
+		// guards the inbox
+		std::mutex m_mutex;
+		std::vector<int> m_accepted;
+		std::vector<std::unique_ptr<Session>> m_given;
+		std::atomic<size_t> m_handed;	// adopted, not taken in yet
+
+		std::unordered_map<Session*, std::unique_ptr<Session>> m_sessions;
+		std::vector<std::unique_ptr<Session>> m_ended;	// freed after the events of a wait
+		std::vector<double> m_elements;
+		std::vector<char> m_buffer;		// what a read takes in
+
+		// the measurement under way
+		std::uint64_t m_tick;
+		Clock::time_point m_tickStart;
+		Clock::duration m_busy;
+		size_t m_waits;
+		size_t m_ready;
+		std::uint64_t m_requests;
+
+		// written by the core only, read by any thread
+		struct alignas(64) Published
+		{
+			std::atomic<size_t> sessions{ 0 };
+			std::atomic<double> queue{ 0.0 };
+			std::atomic<double> busy{ 0.0 };
+			std::atomic<std::uint64_t> requests{ 0 };
+			std::atomic<std::uint64_t> movedIn{ 0 };
+			std::atomic<std::uint64_t> movedOut{ 0 };
+		};
+		Published m_published;
+	};
+
+	Server::ServerImpl::ServerImpl(const std::string& path, size_t cores)
+		: m_path{ path }
+		, m_listener{ -1 }
+		, m_epoll{ -1 }
+		, m_wake{ -1 }
+	{
+		cpu_set_t allowed;
+		if (sched_getaffinity(0, sizeof allowed, &allowed) == 0)
+		{
+			for (int p = 0; p < CPU_SETSIZE; ++p)
+				if (CPU_ISSET(p, &allowed)) m_processors.push_back(p);
+		}
+		if (m_processors.empty()) m_processors.push_back(-1);
+		if (cores == 0) cores = m_processors.size();
+
+		try
+		{
+			for (size_t i = 0; i < cores; ++i)
+				m_cores.push_back(std::make_unique<Core>(*this, i));
+
+			listen();
+
+			m_epoll = epoll_create1(EPOLL_CLOEXEC);
+			m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (m_epoll < 0 || m_wake < 0)
+				throw utility::Exception("Warning: cannot wait on the socket " + m_path);
+
+			// the listener and the eventfd are told apart by their address
+			epoll_event e{};
+			e.events = EPOLLIN;
+			e.data.ptr = &m_listener;
+			epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_listener, &e);
+			e.data.ptr = &m_wake;
+			epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &e);
+		}
+		catch (...)
+		{
+			if (m_wake >= 0) ::close(m_wake);
+			if (m_epoll >= 0) ::close(m_epoll);
+			if (m_listener >= 0)
+			{
+				::close(m_listener);
+				unlink(m_path.c_str());
+			}
+			throw;
+		}
+	}
+
+	Server::ServerImpl::~ServerImpl()
+	{
+		m_cores.clear();
+		::close(m_wake);
+		::close(m_epoll);
+		::close(m_listener);
+		unlink(m_path.c_str());
+	}
+
+	void Server::ServerImpl::listen()
+	{
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if (m_path.empty() || m_path.size() >= sizeof address.sun_path)
+			throw utility::Exception("Warning: " + m_path + " cannot be the path of a socket");
+		std::memcpy(address.sun_path, m_path.c_str(), m_path.size() + 1);
+		auto a = reinterpret_cast<const sockaddr*>(&address);
+
+		m_listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (m_listener < 0)
+			throw utility::Exception("Warning: cannot create the socket " + m_path);
+
+		// a socket nobody accepts on is what a server that did not stop left
+		struct stat st;
+		if (lstat(m_path.c_str(), &st) == 0)
+		{
+			int probe{ socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+			bool live{ probe >= 0 && connect(probe, a, sizeof address) == 0 };
+			if (probe >= 0) ::close(probe);
+			if (!S_ISSOCK(st.st_mode) || live)
+			{
+				::close(m_listener);
+				m_listener = -1;
+				throw utility::Exception("Warning: " + m_path + " is in use");
+			}
+			unlink(m_path.c_str());
+		}
+
+		if (bind(m_listener, a, sizeof address) != 0 || ::listen(m_listener, SOMAXCONN) != 0)
+		{
+			::close(m_listener);
+			m_listener = -1;
+			throw utility::Exception("Warning: cannot listen on " + m_path + ": " + std::strerror(errno));
+		}
+	}
+
+	void Server::ServerImpl::run()
+	{
+		for (size_t i = 0; i < m_cores.size(); ++i)
+			m_cores[i]->start(m_processors[i % m_processors.size()]);
+
+		auto stopCores = [this]
+		{
+			for (auto& core : m_cores)
+				core->stop();
+		};
+
+		epoll_event events[2];
+		while (true)
+		{
+			int n{ epoll_wait(m_epoll, events, 2, -1) };
+			if (n < 0)
+			{
+				if (errno == EINTR) continue;
+				stopCores();
+				throw utility::Exception("Warning: cannot wait on the socket " + m_path);
+			}
+
+			for (int i = 0; i < n; ++i)
+			{
+				if (events[i].data.ptr == &m_wake)
+				{
+					std::uint64_t count;
+					while (read(m_wake, &count, sizeof count) > 0) {}
+					stopCores();
+					return;
+				}
+				accept();
+			}
+		}
+	}
+
+	void Server::ServerImpl::stop() noexcept
+	{
+		wake(m_wake);
+	}
+
+	std::vector<Server::CoreStatistics> Server::ServerImpl::getStatistics() const
+	{
+		std::vector<CoreStatistics> statistics;
+		for (const auto& core : m_cores)
+			statistics.push_back(core->getStatistics());
+		return statistics;
+	}
+
+	void Server::ServerImpl::accept()
+	{
+		while (true)
+		{
+			int fd{ accept4(m_listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC) };
+			if (fd < 0)
+			{
+				// out of descriptors the client waits in the backlog until a session ends
+				if (errno == EINTR || errno == ECONNABORTED) continue;
+				return;
+			}
+
+			// the core with the fewest sessions, the handed ones counted so a burst spreads
+			Core* least{ m_cores.front().get() };
+			size_t fewest{ least->load() };
+			for (auto& core : m_cores)
+			{
+				size_t l{ core->load() };
+				if (l < fewest)
+				{
+					fewest = l;
+					least = core.get();
+				}
+			}
+			least->adopt(fd);
+		}
+	}
+
+	Server::ServerImpl::Core::Core(ServerImpl& server, size_t index)
+		: m_server{ server }
+		, m_epoll{ epoll_create1(EPOLL_CLOEXEC) }
+		, m_wake{ eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) }
+		, m_stopping{ false }
+		, m_handed{ 0 }
+		, m_elements(MaxShown)
+		, m_buffer(ReadSize)
+		, m_tick{ 0 }
+		, m_busy{}
+		, m_waits{ 0 }
+		, m_ready{ 0 }
+		, m_requests{ 0 }
+	{
+		epoll_event e{};
+		e.events = EPOLLIN;
+		e.data.ptr = &m_wake;
+		if (m_epoll < 0 || m_wake < 0 || epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &e) != 0)
+		{
+			if (m_wake >= 0) ::close(m_wake);
+			if (m_epoll >= 0) ::close(m_epoll);
+			throw utility::Exception("Warning: cannot start the event loop of core " + std::to_string(index));
+		}
+	}
+
+	Server::ServerImpl::Core::~Core()
+	{
+		stop();
+		for (auto& s : m_sessions)
+			::close(s.second->fd);
+		for (int fd : m_accepted)
+			::close(fd);
+		for (auto& s : m_given)
+			::close(s->fd);
+		::close(m_wake);
+		::close(m_epoll);
+	}
+
+	void Server::ServerImpl::Core::start(int processor)
+	{
+		m_thread = std::thread{ [this] { run(); } };
+
+		if (processor >= 0)
+		{
+			cpu_set_t one;
+			CPU_ZERO(&one);
+			CPU_SET(processor, &one);
+			pthread_setaffinity_np(m_thread.native_handle(), sizeof one, &one);
+		}
+	}
+
+	void Server::ServerImpl::Core::stop()
+	{
+		if (!m_thread.joinable()) return;
+
+		m_stopping = true;
+		wake(m_wake);
+		m_thread.join();
+	}
+
+	void Server::ServerImpl::Core::adopt(int fd)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_accepted.push_back(fd);
+		}
+		m_handed.fetch_add(1, std::memory_order_relaxed);
+		wake(m_wake);
+	}
+
+	void Server::ServerImpl::Core::adopt(std::vector<std::unique_ptr<Session>> sessions)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			for (auto& s : sessions)
+				m_given.push_back(std::move(s));
+		}
+		m_handed.fetch_add(sessions.size(), std::memory_order_relaxed);
+		wake(m_wake);
+	}
+
+	size_t Server::ServerImpl::Core::load() const
+	{
+		return m_published.sessions.load(std::memory_order_relaxed) + m_handed.load(std::memory_order_relaxed);
+	}
+
+	Server::CoreStatistics Server::ServerImpl::Core::getStatistics() const
+	{
+		const auto& p = m_published;
+		return { p.sessions.load(std::memory_order_relaxed), p.queue.load(std::memory_order_relaxed),
+			p.busy.load(std::memory_order_relaxed), p.requests.load(std::memory_order_relaxed),
+			p.movedIn.load(std::memory_order_relaxed), p.movedOut.load(std::memory_order_relaxed) };
+	}
+
+	void Server::ServerImpl::Core::run()
+	{
+		m_tickStart = Clock::now();
+		epoll_event events[MaxEvents];
+		while (true)
+		{
+			auto now = Clock::now();
+			if (now - m_tickStart >= Tick)
+				measure(now);
+			auto left = std::chrono::duration_cast<std::chrono::milliseconds>(m_tickStart + Tick - now);
+			int timeout{ static_cast<int>(std::max<std::chrono::milliseconds::rep>(left.count(), 0)) + 1 };
+
+			int n{ epoll_wait(m_epoll, events, MaxEvents, timeout) };
+			if (n < 0)
+			{
+				if (errno == EINTR) continue;
+				return;
+			}
+
+			auto busyStart = Clock::now();
+			size_t ready{ 0 };
+			for (int i = 0; i < n; ++i)
+			{
+				if (events[i].data.ptr == &m_wake)
+				{
+					std::uint64_t count;
+					while (read(m_wake, &count, sizeof count) > 0) {}
+					if (m_stopping) return;
+					takeInbox();
+					continue;
+				}
+
+				// a session ended by an earlier event of this wait is skipped
+				auto s = static_cast<Session*>(events[i].data.ptr);
+				++ready;
+				if (s->fd >= 0)
+					serve(*s, events[i].events);
+			}
+			m_ended.clear();
+
+			if (ready > 0)
+			{
+				m_ready += ready;
+				++m_waits;
+			}
+			m_busy += Clock::now() - busyStart;
+		}
+	}
+
+	void Server::ServerImpl::Core::takeInbox()
+	{
+		std::vector<int> accepted;
+		std::vector<std::unique_ptr<Session>> given;
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			accepted.swap(m_accepted);
+			given.swap(m_given);
+		}
+
+		// the engine of a session is made on the core that serves it
+		for (int fd : accepted)
+			add(std::make_unique<Session>(fd));
+
+		for (auto& s : given)
+		{
+			// it stays through a measurement here, so it is not given back at once
+			s->lastTick = m_tick;
+			s->requests = 0;
+			s->arrived = m_tick;
+			add(std::move(s));
+		}
+		m_published.movedIn.fetch_add(given.size(), std::memory_order_relaxed);
+		m_handed.fetch_sub(accepted.size() + given.size(), std::memory_order_relaxed);
+	}
+
+	void Server::ServerImpl::Core::add(std::unique_ptr<Session> s)
+	{
+		s->events = EPOLLIN;
+		epoll_event e{};
+		e.events = s->events;
+		e.data.ptr = s.get();
+		if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, s->fd, &e) != 0)
+		{
+			::close(s->fd);
+			return;
+		}
+		m_sessions.emplace(s.get(), std::move(s));
+		m_published.sessions.store(m_sessions.size(), std::memory_order_relaxed);
+	}
+
+	void Server::ServerImpl::Core::measure(Clock::time_point now)
+	{
+		double busy{ std::min(1.0, std::chrono::duration<double>(m_busy).count()
+			/ std::chrono::duration<double>(now - m_tickStart).count()) };
+		double queue{ m_waits > 0 ? static_cast<double>(m_ready) / m_waits : 0.0 };
+		m_published.busy.store(busy, std::memory_order_relaxed);
+		m_published.queue.store(queue, std::memory_order_relaxed);
+
+		m_tickStart = now;
+		m_busy = Clock::duration{};
+		m_waits = 0;
+		m_ready = 0;
+		++m_tick;
+
+		if (busy > Overloaded)
+			balance(busy);
+	}
+
+	void Server::ServerImpl::Core::balance(double busy)
+	{
+		Core* target{ nullptr };
+		double least{ busy - Gap };
+		for (auto& core : m_server.m_cores)
+		{
+			double b{ core->m_published.busy.load(std::memory_order_relaxed) };
+			if (core.get() != this && b < least)
+			{
+				least = b;
+				target = core.get();
+			}
+		}
+		if (!target) return;
+
+		// the share of the sessions that evens the two out, rounded, and never
+		// more than half of them, so a lone session does not just change cores
+		double share{ m_sessions.size() * (busy - least) / (2 * busy) };
+		size_t wanted{ std::min({ MaxMoved, m_sessions.size() / 2, static_cast<size_t>(share + 0.5) }) };
+		if (wanted == 0) return;
+
+		// the idle ones first, then the least busy, so a core whose every
+		// session is active still sheds some
+		std::vector<std::pair<std::uint64_t, Session*>> candidates;
+		for (auto& entry : m_sessions)
+		{
+			const Session& s = *entry.second;
+			if (s.movable() && s.arrived + 1 < m_tick)
+				candidates.emplace_back(s.recent(m_tick), entry.first);
+		}
+		if (candidates.size() > wanted)
+		{
+			std::nth_element(candidates.begin(), candidates.begin() + wanted, candidates.end(),
+				[](const auto& a, const auto& b) { return a.first < b.first; });
+			candidates.resize(wanted);
+		}
+		if (candidates.empty()) return;
+
+		std::vector<std::unique_ptr<Session>> moving;
+		for (const auto& c : candidates)
+		{
+			auto found = m_sessions.find(c.second);
+			epoll_ctl(m_epoll, EPOLL_CTL_DEL, found->second->fd, nullptr);
+			moving.push_back(std::move(found->second));
+			m_sessions.erase(found);
+		}
+
+		m_published.sessions.store(m_sessions.size(), std::memory_order_relaxed);
+		m_published.movedOut.fetch_add(moving.size(), std::memory_order_relaxed);
+		target->adopt(std::move(moving));
+	}
+
+	void Server::ServerImpl::Core::serve(Session& s, std::uint32_t events)
+	{
+		if (events & EPOLLERR)
+		{
+			end(s);
+			return;
+		}
+
+		if ((events & (EPOLLIN | EPOLLHUP)) && !s.ending && !receive(s))
+			s.ending = true;
+
+		// answer what was read, write it, and go on while the limit held lines back
+		bool heldBack{ true };
+		while (heldBack)
+		{
+			heldBack = answer(s);
+			if (!send(s))
+			{
+				end(s);
+				return;
+			}
+			if (s.unsent() > 0) break;
+		}
+
+		if (s.ending && s.unsent() == 0 && !heldBack)
+			end(s);
+		else
+			watch(s);
+	}
+
+	bool Server::ServerImpl::Core::receive(Session& s)
+	{
+		ssize_t n;
+		do
+			n = read(s.fd, m_buffer.data(), m_buffer.size());
+		while (n < 0 && errno == EINTR);
+		if (n > 0) s.in.append(m_buffer.data(), static_cast<size_t>(n));
+
+		if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+		return n > 0;
+	}
+
+	// answers the complete lines read, true where the limit of the responses held some back
+	bool Server::ServerImpl::Core::answer(Session& s)
+	{
+		bool heldBack{ false };
+		while (true)
+		{
+			if (s.unsent() >= MaxUnsent)
+			{
+				heldBack = s.parsed < s.in.size();
+				break;
+			}
+
+			size_t newline{ s.in.find('\n', s.parsed) };
+			if (newline == std::string::npos)
+			{
+				// a last line without its newline is still a request
+				if (s.ending && s.parsed < s.in.size() && s.in.size() - s.parsed <= MaxLine)
+				{
+					respond(s, std::string_view{ s.in }.substr(s.parsed));
+					s.parsed = s.in.size();
+				}
+				break;
+			}
+
+			std::string_view line{ std::string_view{ s.in }.substr(s.parsed, newline - s.parsed) };
+			if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+			if (line.size() > MaxLine) break;
+
+			respond(s, line);
+			s.parsed = newline + 1;
+		}
+
+		if (s.in.size() - s.parsed > MaxLine)
+		{
+			s.out += "error the request is longer than 65536 bytes\n";
+			s.parsed = s.in.size();
+			s.ending = true;
+		}
+
+		s.in.erase(0, s.parsed);
+		s.parsed = 0;
+		return heldBack;
+	}
+
+	void Server::ServerImpl::Core::respond(Session& s, std::string_view request)
+	{
+		if (s.lastTick != m_tick) s.requests = 0;
+		s.lastTick = m_tick;
+		++s.requests;
+		m_published.requests.store(++m_requests, std::memory_order_relaxed);
+
+		if (trim(request) == "stats")
+		{
+			s.out += "stats";
+			auto statistics = m_server.getStatistics();
+			for (size_t i = 0; i < statistics.size(); ++i)
+			{
+				const auto& c = statistics[i];
+				s.out += i == 0 ? " core=" : "; core=";
+				appendNumber(s.out, std::uint64_t{ i });
+				s.out += " sessions=";
+				appendNumber(s.out, std::uint64_t{ c.sessions });
+				s.out += " queue=";
+				appendNumber(s.out, c.queue, 2);
+				s.out += " busy=";
+				appendNumber(s.out, c.busy, 3);
+				s.out += " requests=";
+				appendNumber(s.out, c.requests);
+				s.out += " in=";
+				appendNumber(s.out, c.movedIn);
+				s.out += " out=";
+				appendNumber(s.out, c.movedOut);
+			}
+			s.out += '\n';
+			return;
+		}
+
+		auto result = s.engine.evaluate(request, m_elements.data(), MaxShown);
+		if (!result.ok)
+		{
+			s.out += "error ";
+			s.out += s.engine.getError();
+			s.out += '\n';
+			return;
+		}
+
+		s.out += "ok ";
+		appendNumber(s.out, std::uint64_t{ result.size });
+		for (size_t i = 0; i < result.written; ++i)
+		{
+			s.out += ' ';
+			appendNumber(s.out, m_elements[i]);
+		}
+		s.out += '\n';
+	}
+
+	// writes what the socket takes, false where the client is gone
+	bool Server::ServerImpl::Core::send(Session& s)
+	{
+		while (s.unsent() > 0)
+		{
+			ssize_t n{ ::send(s.fd, s.out.data() + s.sent, s.unsent(), MSG_NOSIGNAL) };
+			if (n < 0)
+			{
+				if (errno == EINTR) continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+				return false;
+			}
+			s.sent += static_cast<size_t>(n);
+		}
+
+		if (s.sent == s.out.size())
+		{
+			s.out.clear();
+			s.sent = 0;
+		}
+		return true;
+	}
+
+	void Server::ServerImpl::Core::watch(Session& s)
+	{
+		std::uint32_t events{ 0 };
+		if (!s.ending && s.unsent() < MaxUnsent) events |= EPOLLIN;
+		if (s.unsent() > 0) events |= EPOLLOUT;
+		if (events == s.events) return;
+
+		epoll_event e{};
+		e.events = events;
+		e.data.ptr = &s;
+		epoll_ctl(m_epoll, EPOLL_CTL_MOD, s.fd, &e);
+		s.events = events;
+	}
+
+	void Server::ServerImpl::Core::end(Session& s)
+	{
+		::close(s.fd);
+		s.fd = -1;
+
+		auto found = m_sessions.find(&s);
+		m_ended.push_back(std::move(found->second));
+		m_sessions.erase(found);
+		m_published.sessions.store(m_sessions.size(), std::memory_order_relaxed);
+	}
+#else
+	// the server waits on epoll, Windows has none
+	class Server::ServerImpl
+	{
+	public:
+		ServerImpl(const std::string&, size_t)
+		{
+			throw utility::Exception("Warning: --serve needs epoll, it is only available on Linux");
+		}
+		void run() {}
+		void stop() noexcept {}
+		std::vector<CoreStatistics> getStatistics()const { return {}; }
+	};
+#endif
+
+	Server::Server(const std::string& path, size_t cores)
+		: impl{ std::make_unique<ServerImpl>(path, cores) }
+	{
+	}
+
+	Server::~Server()
+	{
+	}
+
+	void Server::run()
+	{
+		impl->run();
+	}
+
+	void Server::stop() noexcept
+	{
+		impl->stop();
+	}
+
+	std::vector<Server::CoreStatistics> Server::getStatistics() const
+	{
+		return impl->getStatistics();
+	}
+}
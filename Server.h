@@ -0,0 +1,108 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SERVER_H
+#define SERVER_H
+#include<cstddef>
+#include<cstdint>
+#include<memory>
+#include<string>
+#include<vector>
+
+namespace control
+{
+	/*
+		Serves many clients from one process, started with 'nimpo --serve
+		<path>'. The server listens on a Unix socket at path and gives every
+		connection an Engine of its own, so a session has its own stack,
+		definitions and CommandManager history and ends with the connection.
+
+		The protocol is one line per request and one line per response, the
+		responses in the order of the requests. A client may send many
+		requests before it reads a response. A request is an input of
+		Engine::evaluate, the response is either
+			ok <size> <elements>	the stack size and up to 16 elements, top first
+			error <message>		the stack stays as the words before the failing one left it
+		The request 'stats' is answered by the statistics of every core, as
+			stats core=0 sessions=<n> queue=<q> busy=<b> requests=<n> in=<n> out=<n>; core=1 ...
+		A request longer than 64 KiB gets an error and ends the session.
+
+		Every core runs an event loop of its own on a thread pinned to it,
+		waiting on an epoll of its own. The thread of run accepts the
+		connections and hands each one to the core with the fewest sessions,
+		counting the ones handed to it and not taken in yet; from then on a
+		session is touched by its core only, and the cores share nothing
+		while they serve. A session handles every complete line it has read
+		before its responses are written together. It stops reading while
+		1 MiB of its responses waits for the client, so a client that sends
+		without reading does not make the server buffer without bound.
+
+		Each core measures itself every 100 ms. A core busy more than 85% of
+		that time gives sessions to the least busy core, if that one is less
+		busy by a quarter of the time: the ones idle through it first, then
+		the ones with the fewest requests in it. Only a session with no
+		response left to write moves, so its responses keep their order, and
+		one given to a core stays there through a measurement. Failures of
+		the socket throw a utility::Exception; a failing connection only ends
+		its session.
+	*/
+	class Server
+	{
+	public:
+		// of the last 100 ms of a core, but for the counts
+		struct CoreStatistics
+		{
+			size_t sessions;
+			double queue;				// sessions ready per wait of the event loop
+			double busy;				// share of the time spent serving, 0 to 1
+			std::uint64_t requests;		// answered since the start
+			std::uint64_t movedIn;		// sessions taken over from a busier core
+			std::uint64_t movedOut;
+		};
+
+		// a socket a server left behind at path is replaced, a live one is
+		// not; cores 0 runs a loop on each processor the process may use
+		explicit Server(const std::string& path, size_t cores = 0);
+		// closes the sessions and removes the socket
+		~Server();
+
+		// serves until stop is called
+		void run();
+
+		// may be called from any thread and from a signal handler
+		void stop() noexcept;
+
+		// one entry per core, from any thread
+		std::vector<CoreStatistics> getStatistics()const;
+
+	private:
+		class ServerImpl;
+		std::unique_ptr<ServerImpl> impl;
+
+	private:
+		Server(const Server&) = delete;
+		Server(Server&&) = delete;
+		Server& operator=(const Server&) = delete;
+		Server& operator=(Server&&) = delete;
+	};
+}
+#endif // !SERVER_H
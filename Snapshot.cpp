@@ -0,0 +1,370 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+#include "Snapshot.h"
+#include"Archive.h"
+#include"Command.h"
+#include"CommandManager.h"
+#include"CommandRepository.h"
+#include"DataFile.h"
+#include"Exception.h"
+#include"Stack.h"
+#include<algorithm>
+#include<cstdint>
+#include<cstring>
+#include<limits>
+#include<unordered_map>
+#include<unordered_set>
+#include<vector>
+
+namespace control
+{
+	namespace
+	{
+		const char Magic[8] = { 'N', 'I', 'M', 'P', 'O', 'S', 'N', 'P' };
+		// 2 added the macros in front of the arrays, 3 the kind of each definition,
+		// 4 the branches and numbers of the history, 5 the sessions not running
+		const std::uint32_t Version = 5;
+		// reads back as another number on a machine of the other byte order
+		const std::uint32_t ByteOrderMark = 0x01020304;
+
+		struct Header
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t byteOrder;
+			std::uint64_t elements;		// doubles of stack storage after the header
+			std::uint64_t archiveSize;	// bytes of archive after the storage
+		};
+		static_assert(sizeof(Header) == 32, "the storage after the header must stay 8 byte aligned");
+
+		void corrupt(const std::string& path)
+		{
+			throw utility::Exception("Warning: " + path + " is not a valid snapshot");
+		}
+
+		void saveArrays(model::Archive& archive, std::vector<model::Stack::ArrayElement>& arrays)
+		{
+			size_t n{ arrays.size() };
+			archive.field(n);
+			for (auto& a : arrays)
+			{
+				archive.field(a.first);
+				archive.field(a.second);
+			}
+		}
+
+		// each array sits on a slot of its own, marked by the NaN placeholder
+		bool loadArrays(model::Archive& archive, std::vector<double>& storage, std::vector<model::Stack::ArrayElement>& arrays)
+		{
+			size_t n{};
+			archive.field(n);
+			arrays.resize(std::min(n, archive.remaining() / 16));
+			if (arrays.size() != n) return false;
+			for (size_t i = 0; i < n; ++i)
+			{
+				auto& a = arrays[i];
+				archive.field(a.first);
+				archive.field(a.second);
+				bool ascending{ i == 0 || a.first > arrays[i - 1].first };
+				if (!ascending || a.first >= storage.size() || a.second.isScalar()) return false;
+				storage[a.first] = std::numeric_limits<double>::quiet_NaN();
+			}
+			return true;
+		}
+
+		using SavedHistory = CommandManager::History<const Command*>;
+		using LoadedHistory = CommandManager::History<CommandPtr>;
+
+		void saveCommand(model::Archive& archive, const Command* c)
+		{
+			std::string name{ c->getName() };
+			archive.field(name);
+			const_cast<Command*>(c)->serialize(archive);
+		}
+
+		CommandPtr loadCommand(model::Archive& archive)
+		{
+			std::string name;
+			archive.field(name);
+
+			auto c = name == EnterNumber::Name ? MakeCommandPtr<EnterNumber>(0.0)
+				: CommandRepository::getInstance().getCommandByName(name);
+			if (!c)
+				throw utility::Exception("Warning: the snapshot uses the unknown command " + name);
+
+			c->serialize(archive);
+			return c;
+		}
+
+		void saveHistory(model::Archive& archive, const SavedHistory& history)
+		{
+			size_t position{ history.position }, numbered{ history.numbered }, n{ history.points.size() };
+			archive.field(position);
+			archive.field(numbered);
+			archive.field(n);
+			for (auto& point : history.points)
+			{
+				size_t number{ point.number }, parent{ point.parent };
+				bool active{ point.active };
+				archive.field(number);
+				archive.field(parent);
+				archive.field(active);
+				saveCommand(archive, point.command);
+			}
+
+			size_t m{ history.abandoned.size() };
+			archive.field(m);
+			for (size_t number : history.abandoned)
+				archive.field(number);
+		}
+
+		LoadedHistory loadHistory(model::Archive& archive)
+		{
+			LoadedHistory history{};
+			size_t n{};
+			archive.field(history.position);
+			archive.field(history.numbered);
+			archive.field(n);
+			for (size_t i = 0; i < n; ++i)
+			{
+				LoadedHistory::Point point{ 0, 0, false, CommandPtr{ nullptr, &CommandDeleter } };
+				archive.field(point.number);
+				archive.field(point.parent);
+				archive.field(point.active);
+				point.command = loadCommand(archive);
+				history.points.push_back(std::move(point));
+			}
+
+			size_t m{};
+			archive.field(m);
+			for (size_t i = 0; i < m; ++i)
+			{
+				size_t number{};
+				archive.field(number);
+				history.abandoned.push_back(number);
+			}
+			return history;
+		}
+
+		// before version 4 the history was its active line, the undo entries
+		// oldest first and then the redo entries
+		LoadedHistory loadLine(model::Archive& archive)
+		{
+			LoadedHistory history{};
+			for (int part = 0; part < 2; ++part)
+			{
+				size_t n{};
+				archive.field(n);
+				for (size_t i = 0; i < n; ++i)
+				{
+					size_t number{ history.points.size() + 1 };
+					history.points.push_back({ number, number - 1, true, loadCommand(archive) });
+				}
+				if (part == 0) history.position = history.points.size();
+			}
+			history.numbered = history.points.size();
+			return history;
+		}
+
+		// every point follows one before it, the position is on the active line,
+		// and a branch left is off it and inside only branches left after it
+		bool isConsistent(const LoadedHistory& history)
+		{
+			const size_t Outside = std::numeric_limits<size_t>::max();
+			std::unordered_map<size_t, size_t> left;
+			for (size_t i = 0; i < history.abandoned.size(); ++i)
+				if (!left.emplace(history.abandoned[i], i).second) return false;
+
+			// per point its parent, whether it is active and the branch left it is in
+			struct Seen { size_t parent; bool active; size_t branch; };
+			std::unordered_map<size_t, Seen> seen{ { 0, { 0, true, Outside } } };
+			std::unordered_set<size_t> withActive;
+			for (auto& point : history.points)
+			{
+				auto parent = seen.find(point.parent);
+				if (point.number == 0 || point.number > history.numbered || parent == seen.end() || seen.count(point.number))
+					return false;
+				if (point.active && !withActive.insert(point.parent).second)
+					return false;
+
+				size_t branch{ parent->second.branch };
+				auto l = left.find(point.number);
+				if (l != left.end())
+				{
+					if (point.active || l->second >= branch) return false;
+					branch = l->second;
+				}
+				seen[point.number] = { point.parent, point.active, branch };
+			}
+
+			for (size_t number : history.abandoned)
+				if (!seen.count(number)) return false;
+
+			for (size_t n = history.position; n != 0;)
+			{
+				auto point = seen.find(n);
+				if (point == seen.end() || !point->second.active) return false;
+				n = point->second.parent;
+			}
+			return true;
+		}
+	}
+
+	void saveSnapshot(const std::string& path, const CommandManager& manager)
+	{
+		auto& stack = model::Stack::getInstance();
+
+		// the macros and functions come first, the history may run them, then
+		// the arrays of the stack, so the history shares them
+		model::Archive archive;
+		auto definitions = manager.getDefinitions();
+		size_t m{ definitions.size() };
+		archive.field(m);
+		for (auto& definition : definitions)
+		{
+			archive.field(definition.name);
+			archive.field(definition.tokens);
+			auto kind = static_cast<std::uint64_t>(definition.kind);
+			archive.field(kind);
+		}
+
+		auto arrays = stack.getArrayElements();
+		saveArrays(archive, arrays);
+
+		SavedHistory history{};
+		manager.getHistory(history);
+		saveHistory(archive, history);
+
+		// the other sessions go after the running one, their storage in the archive
+		std::string running{ manager.getSessionName() };
+		archive.field(running);
+		auto sessions = manager.getSessions();
+		size_t n{ sessions.size() };
+		archive.field(n);
+		for (auto& session : sessions)
+		{
+			auto other = model::Stack::create();
+			other->restore(session.stack, false);
+			std::vector<double> storage;
+			other->inspect([&](const double* first, size_t n) { storage.insert(storage.end(), first, first + n); });
+			auto otherArrays = other->getArrayElements();
+
+			archive.field(session.name);
+			archive.field(storage);
+			saveArrays(archive, otherArrays);
+			saveHistory(archive, session.history);
+		}
+
+		Header header{};
+		std::memcpy(header.magic, Magic, sizeof Magic);
+		header.version = Version;
+		header.byteOrder = ByteOrderMark;
+		header.elements = stack.size();
+		header.archiveSize = archive.getBuffer().size();
+
+		// the storage goes out straight from the chunks of the stack
+		std::vector<utility::FilePiece> pieces{ { reinterpret_cast<const char*>(&header), sizeof header } };
+		stack.inspect([&](const double* first, size_t n)
+		{
+			pieces.push_back({ reinterpret_cast<const char*>(first), n * sizeof(double) });
+		});
+		pieces.push_back({ archive.getBuffer().data(), archive.getBuffer().size() });
+		utility::writeFile(path, pieces);
+	}
+
+	void restoreSnapshot(const std::string& path, CommandManager& manager)
+	{
+		utility::MappedFile file{ path };
+
+		Header header;
+		if (file.size() < sizeof header) corrupt(path);
+		std::memcpy(&header, file.data(), sizeof header);
+		if (std::memcmp(header.magic, Magic, sizeof Magic) != 0 || header.byteOrder != ByteOrderMark) corrupt(path);
+		if (header.version < 1 || header.version > Version)
+			throw utility::Exception("Warning: " + path + " is a snapshot of version " + std::to_string(header.version)
+				+ ", this calculator reads versions 1 to " + std::to_string(Version));
+
+		size_t body{ file.size() - sizeof header };
+		if (header.elements > body / sizeof(double) || header.archiveSize != body - header.elements * sizeof(double))
+			corrupt(path);
+
+		const char* storageData{ file.data() + sizeof header };
+		std::vector<double> storage(static_cast<size_t>(header.elements));
+		if (!storage.empty())
+			std::memcpy(storage.data(), storageData, storage.size() * sizeof(double));
+
+		model::Archive archive{ storageData + storage.size() * sizeof(double), static_cast<size_t>(header.archiveSize) };
+
+		size_t m{};
+		if (header.version > 1) archive.field(m);
+		for (size_t i = 0; i < m; ++i)
+		{
+			std::string name;
+			std::vector<std::string> tokens;
+			std::uint64_t kind{ static_cast<std::uint64_t>(CommandManager::Kind::Macro) };
+			archive.field(name);
+			archive.field(tokens);
+			if (header.version > 2) archive.field(kind);
+			if (kind > static_cast<std::uint64_t>(CommandManager::Kind::Function)) corrupt(path);
+			manager.define(name, tokens, static_cast<CommandManager::Kind>(kind));
+		}
+
+		std::vector<model::Stack::ArrayElement> arrays;
+		if (!loadArrays(archive, storage, arrays)) corrupt(path);
+
+		auto history = header.version > 3 ? loadHistory(archive) : loadLine(archive);
+		if (!isConsistent(history)) corrupt(path);
+
+		// a snapshot before version 5 holds one session
+		std::string running{ "main" };
+		std::vector<CommandManager::SessionState<CommandPtr>> sessions;
+		size_t n{};
+		if (header.version > 4)
+		{
+			archive.field(running);
+			archive.field(n);
+		}
+		for (size_t i = 0; i < n; ++i)
+		{
+			std::string name;
+			std::vector<double> otherStorage;
+			std::vector<model::Stack::ArrayElement> otherArrays;
+			archive.field(name);
+			archive.field(otherStorage);
+			if (!loadArrays(archive, otherStorage, otherArrays)) corrupt(path);
+			auto otherHistory = loadHistory(archive);
+			if (!isConsistent(otherHistory)) corrupt(path);
+
+			bool taken{ name == running || std::any_of(sessions.begin(), sessions.end(),
+				[&](const CommandManager::SessionState<CommandPtr>& s) { return s.name == name; }) };
+			if (name.empty() || taken) corrupt(path);
+
+			auto other = model::Stack::create();
+			other->assign(std::move(otherStorage), std::move(otherArrays), false);
+			sessions.push_back({ name, other->checkpoint(), std::move(otherHistory) });
+		}
+		if (running.empty() || archive.remaining() != 0) corrupt(path);
+
+		model::Stack::getInstance().assign(std::move(storage), std::move(arrays));
+		manager.setHistory(std::move(history));
+		manager.setSessions(running, std::move(sessions));
+	}
+}
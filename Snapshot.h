@@ -0,0 +1,56 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include<string>
+
+namespace control
+{
+	class CommandManager;
+
+	/*
+		A snapshot keeps every session in one file: the stack and the undo
+		and redo history of each, so a long calculation can be picked up later
+		with undo still working.
+
+		The file starts with a fixed header (magic, format version, a byte
+		order mark and the section sizes), followed by the storage of the
+		running stack as raw doubles, 8 byte aligned, and by an archive holding
+		the macros and functions, the vectors and matrices of the stack, the
+		history with its branches and the numbers of its points, and then the
+		name of the running session and the stack and history of each of the
+		others. Commands are kept with their state under the name they are
+		registered with. A restore maps the file and takes the running storage
+		over in one copy, nothing is parsed. Failures throw a
+		utility::Exception and leave the sessions untouched; the definitions
+		read until then stay defined.
+	*/
+
+	// writes the sessions of manager to the file at path
+	void saveSnapshot(const std::string& path, const CommandManager& manager);
+
+	// replaces the sessions of manager with the ones of the snapshot at path,
+	// a snapshot before version 5 holds one called main
+	void restoreSnapshot(const std::string& path, CommandManager& manager);
+}
+#endif // !SNAPSHOT_H
@@ -0,0 +1,195 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+// Sorting and selection over ranges of doubles. Doubles are mapped to unsigned
+// keys that compare like the values, so the radix sort works on plain integer
+// digits and std::sort and nth_element see a strict order even with NaNs.
+
+#include "KernelVariants.h"
+#include "ThreadPool.h"
+#include<algorithm>
+#include<cstdint>
+#include<cstring>
+#include<vector>
+
+namespace utility
+{
+	namespace
+	{
+		// shorter ranges are sorted by std::sort on the keys
+		const size_t RadixThreshold = 1 << 16;
+		// the smallest range one thread counts and scatters
+		const size_t RadixGrain = 1 << 16;
+
+		const int DigitBits = 8;
+		const size_t Buckets = size_t{ 1 } << DigitBits;
+
+		// positive numbers get the sign bit set, negative ones all bits flipped
+		inline std::uint64_t toKey(double d)
+		{
+			std::uint64_t u;
+			std::memcpy(&u, &d, sizeof u);
+			return u & 0x8000000000000000ull ? ~u : u | 0x8000000000000000ull;
+		}
+
+		inline double fromKey(std::uint64_t u)
+		{
+			u = u & 0x8000000000000000ull ? u & 0x7fffffffffffffffull : ~u;
+			double d;
+			std::memcpy(&d, &u, sizeof d);
+			return d;
+		}
+
+		inline bool keyLess(double a, double b)
+		{
+			return toKey(a) < toKey(b);
+		}
+
+		void toKeys(const double* first, std::uint64_t* keys, size_t n)
+		{
+			ThreadPool::getInstance().parallelFor(n, RadixGrain, [=](size_t i, size_t j)
+			{
+				for (; i < j; ++i)
+					keys[i] = toKey(first[i]);
+			});
+		}
+
+		void fromKeys(const std::uint64_t* keys, double* out, size_t n)
+		{
+			ThreadPool::getInstance().parallelFor(n, RadixGrain, [=](size_t i, size_t j)
+			{
+				for (; i < j; ++i)
+					out[i] = fromKey(keys[i]);
+			});
+		}
+
+		// one chunk per thread: every pass counts the digit in each chunk of the
+		// current order, turns the counts into the chunk's write positions and
+		// scatters the chunks in parallel, which keeps the sort stable. The
+		// sorted keys end up in keys or buffer, the one returned
+		std::uint64_t* radixSort(std::uint64_t* keys, size_t n, std::uint64_t* buffer)
+		{
+			const int Passes = 64 / DigitBits;
+			auto& pool = ThreadPool::getInstance();
+			size_t chunks{ std::max(std::min(pool.getThreadCount(), n / RadixGrain), size_t{ 1 }) };
+			auto chunkBegin = [=](size_t c) { return c * (n / chunks) + std::min(c, n % chunks); };
+			std::vector<size_t> counts(chunks * Buckets);
+
+			std::uint64_t* from{ keys };
+			std::uint64_t* to{ buffer };
+			for (int p = 0; p < Passes; ++p)
+			{
+				const int shift{ p * DigitBits };
+				pool.parallelFor(chunks, 1, [&](size_t c0, size_t c1)
+				{
+					for (size_t c = c0; c < c1; ++c)
+					{
+						size_t* count{ counts.data() + c * Buckets };
+						std::fill(count, count + Buckets, size_t{ 0 });
+						const std::uint64_t* in{ from };
+						const size_t last{ chunkBegin(c + 1) };
+						for (size_t i = chunkBegin(c); i < last; ++i)
+							++count[(in[i] >> shift) & (Buckets - 1)];
+					}
+				});
+
+				// a digit all keys share does not reorder anything
+				size_t offset{ 0 };
+				bool trivial{ false };
+				for (size_t d = 0; d < Buckets && !trivial; ++d)
+				{
+					size_t inBucket{ 0 };
+					for (size_t c = 0; c < chunks; ++c)
+					{
+						size_t& count{ counts[c * Buckets + d] };
+						inBucket += count;
+						std::swap(count, offset);
+						offset += count;
+					}
+					trivial = inBucket == n;
+				}
+				if (trivial)
+					continue;
+
+				pool.parallelFor(chunks, 1, [&](size_t c0, size_t c1)
+				{
+					for (size_t c = c0; c < c1; ++c)
+					{
+						// local copies, the stores through out may alias anything captured
+						size_t* position{ counts.data() + c * Buckets };
+						const std::uint64_t* in{ from };
+						std::uint64_t* out{ to };
+						const size_t last{ chunkBegin(c + 1) };
+						for (size_t i = chunkBegin(c); i < last; ++i)
+						{
+							std::uint64_t key{ in[i] };
+							out[position[(key >> shift) & (Buckets - 1)]++] = key;
+						}
+					}
+				});
+				std::swap(from, to);
+			}
+			return from;
+		}
+	}
+
+	void sortAscending(double* first, size_t n)
+	{
+		if (n < RadixThreshold)
+		{
+			std::sort(first, first + n, keyLess);
+			return;
+		}
+
+		std::vector<std::uint64_t> keys(n);
+		std::vector<std::uint64_t> buffer(n);
+		toKeys(first, keys.data(), n);
+		fromKeys(radixSort(keys.data(), n, buffer.data()), first, n);
+	}
+
+	void selectLargest(double* first, size_t n, size_t k)
+	{
+		k = std::min(k, n);
+		if (k == 0)
+			return;
+
+		std::nth_element(first, first + (n - k), first + n, keyLess);
+		sortAscending(first + (n - k), k);
+	}
+
+	double selectQuantile(double* first, size_t n, double p) noexcept
+	{
+		double rank{ p * static_cast<double>(n - 1) };
+		size_t lo{ static_cast<size_t>(rank) };
+		if (lo >= n - 1)
+			lo = n - 1;
+
+		std::nth_element(first, first + lo, first + n, keyLess);
+		double low{ first[lo] };
+		double fraction{ rank - static_cast<double>(lo) };
+		if (lo + 1 >= n || fraction == 0.0)
+			return low;
+
+		// nth_element left everything above lo behind it, the next rank is its minimum
+		double high{ *std::min_element(first + lo + 1, first + n, keyLess) };
+		return low + fraction * (high - low);
+	}
+}
@@ -19,32 +19,79 @@
 
 */
 #include "Stack.h"
-#include"Exception.h"
+#include"ChunkedStorage.h"
 #include"ConsoleLogger.h"
-#include<deque>
+#include<algorithm>
+#include<limits>
+#include<utility>
 
 namespace model
 {
 	const std::string Stack::StackChanged = "stackChanged";
 	const std::string Stack::StackError = "stackError";
 
+	namespace
+	{
+		// a vector or matrix element: its slot in the storage holds a NaN placeholder
+		struct ArraySlot
+		{
+			size_t position;
+			Value value;
+		};
+
+		// the stack a Scope made current on this thread, nullptr for the
+		// process wide one
+		thread_local Stack* t_current = nullptr;
+	}
+
+	struct Stack::Checkpoint::State
+	{
+		ChunkedStorage model;
+		std::vector<ArraySlot> arrays;
+	};
+
 	class Stack::StackImpl
 	{
 	public:
 		explicit StackImpl(const Stack&);
 		
 		void push(double, bool notify = false);
-		double pop(bool notify = false);
+		utility::Expected<double> pop(bool notify = false);
 		double top()const;
-		void swap();
+		utility::Status swap();
+		utility::Status pop(size_t n, std::vector<double>& out, bool notify = false);
+		void push(std::vector<double>&& v, bool notify = false);
+		void generate(size_t n, const std::function<void(double*)>& fill, bool notify = false);
+		utility::Status drop(size_t n, bool notify = false);
+		void inspect(const std::function<void(const double*, size_t)>& reader) const;
+		std::vector<ArrayElement> getArrayElements() const;
+		void assign(std::vector<double>&& storage, std::vector<ArrayElement>&& arrays, bool notify = false);
+		std::shared_ptr<const Checkpoint::State> checkpoint() const;
+		void restore(const Checkpoint::State*, bool notify = false);
+		void push(const Value&, bool notify = false);
+		utility::Expected<Value> popValue(bool notify = false);
+		utility::Expected<Value> topValue()const;
+		bool hasArrays(size_t n)const;
 		size_t size() const;
 		void clear();
 		std::vector<double> getElements(size_t n) const;
 		void getElements(size_t n, std::vector<double>&) const;
+		std::vector<Value> getValues(size_t n) const;
+		void holdChanges();
+		void releaseChanges(bool notify);
 
 	private:
+		utility::Status checkNotEmpty()const;
+		utility::Status failure(ErrorType e)const;
+		Value makeValue(size_t position)const;
+		void changed();
+
 		const Stack& parent;
-		std::deque<double> m_model;
+		ChunkedStorage m_model;
+		std::vector<ArraySlot> m_arrays;	// sorted by position, usually empty
+
+		size_t m_holds;						// change events held back while not 0
+		bool m_changedWhileHeld;
 	};
 
 	Stack::Stack()
@@ -73,10 +120,33 @@ namespace model
 		utility::logToConsole("Stack::getInstance()");
 #endif // DEBUG_MODE
 
+		if (t_current) return *t_current;
+
 		static Stack instance;
 		return instance;
 	}
 
+	void Stack::Deleter::operator()(Stack* s) const
+	{
+		delete s;
+	}
+
+	Stack::Owner Stack::create()
+	{
+		return Owner{ new Stack };
+	}
+
+	Stack::Scope::Scope(Stack& s)
+		: m_previous{ t_current }
+	{
+		t_current = &s;
+	}
+
+	Stack::Scope::~Scope()
+	{
+		t_current = m_previous;
+	}
+
 	void Stack::push(double d, bool suppressChangeEvent)
 	{
 #ifdef DEBUG_MODE
@@ -87,7 +157,7 @@ namespace model
 		impl->push(d, suppressChangeEvent);
 	}
 
-	double Stack::pop(bool suppressChangeEvent)
+	utility::Expected<double> Stack::pop(bool suppressChangeEvent)
 	{
 #ifdef DEBUG_MODE
 		utility::logToConsole("Stack::pop()");
@@ -106,14 +176,142 @@ namespace model
 		return impl->top();
 	}
 
-	void Stack::swap()
+	utility::Status Stack::swap()
 	{
 #ifdef DEBUG_MODE
 		utility::logToConsole("Stack::swap()");
 #endif // DEBUG_MODE
 
 
-		impl->swap();
+		return impl->swap();
+	}
+
+	utility::Status Stack::pop(size_t n, std::vector<double>& out, bool notify)
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::pop(n,v)", "n = ", n);
+#endif // DEBUG_MODE
+
+		return impl->pop(n, out, notify);
+	}
+
+	void Stack::push(std::vector<double>&& v, bool notify)
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::push(v)", "vector size = ", v.size());
+#endif // DEBUG_MODE
+
+		impl->push(std::move(v), notify);
+	}
+
+	void Stack::generate(size_t n, const std::function<void(double*)>& fill, bool notify)
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::generate(n)", "n = ", n);
+#endif // DEBUG_MODE
+
+		impl->generate(n, fill, notify);
+	}
+
+	utility::Status Stack::drop(size_t n, bool notify)
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::drop(n)", "n = ", n);
+#endif // DEBUG_MODE
+
+		return impl->drop(n, notify);
+	}
+
+	void Stack::inspect(const std::function<void(const double*, size_t)>& reader) const
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::inspect()");
+#endif // DEBUG_MODE
+
+		impl->inspect(reader);
+	}
+
+	std::vector<Stack::ArrayElement> Stack::getArrayElements() const
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::getArrayElements()");
+#endif // DEBUG_MODE
+
+		return impl->getArrayElements();
+	}
+
+	void Stack::assign(std::vector<double>&& storage, std::vector<ArrayElement>&& arrays, bool notify)
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::assign()", "storage size = ", storage.size(), "arrays = ", arrays.size());
+#endif // DEBUG_MODE
+
+		impl->assign(std::move(storage), std::move(arrays), notify);
+	}
+
+	Stack::Checkpoint Stack::checkpoint() const
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::checkpoint()");
+#endif // DEBUG_MODE
+
+		Checkpoint c;
+		c.m_state = impl->checkpoint();
+		return c;
+	}
+
+	void Stack::restore(const Checkpoint& c, bool notify)
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::restore()");
+#endif // DEBUG_MODE
+
+		impl->restore(c.m_state.get(), notify);
+	}
+
+	void Stack::push(const Value& v, bool notify)
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::push(Value)", v.isScalar(), notify);
+#endif // DEBUG_MODE
+
+		impl->push(v, notify);
+	}
+
+	utility::Expected<Value> Stack::popValue(bool notify)
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::popValue()");
+#endif // DEBUG_MODE
+
+		return impl->popValue(notify);
+	}
+
+	utility::Expected<Value> Stack::topValue() const
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::topValue()");
+#endif // DEBUG_MODE
+
+		return impl->topValue();
+	}
+
+	bool Stack::hasArrays(size_t n) const
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::hasArrays(n)", "n = ", n);
+#endif // DEBUG_MODE
+
+		return impl->hasArrays(n);
+	}
+
+	std::vector<Value> Stack::getValues(size_t n) const
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::getValues(n)", "n = ", n);
+#endif // DEBUG_MODE
+
+		return impl->getValues(n);
 	}
 
 	std::vector<double> Stack::getElements(size_t n) const
@@ -156,7 +354,25 @@ namespace model
 		impl->clear();
 	}
 
-	Stack::StackImpl::StackImpl(const Stack & p): parent{p}
+	void Stack::holdChanges()
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::holdChanges()");
+#endif // DEBUG_MODE
+
+		impl->holdChanges();
+	}
+
+	void Stack::releaseChanges(bool notify)
+	{
+#ifdef DEBUG_MODE
+		utility::logToConsole("Stack::releaseChanges()", notify);
+#endif // DEBUG_MODE
+
+		impl->releaseChanges(notify);
+	}
+
+	Stack::StackImpl::StackImpl(const Stack & p): parent{p}, m_holds{0}, m_changedWhileHeld{false}
 	{
 #ifdef DEBUG_MODE
 		utility::logToConsole("Stack::StackImpl::StackImpl()",sizeof(this)," bytes");
@@ -167,26 +383,84 @@ namespace model
 	void Stack::StackImpl::push(double d, bool notify)
 	{
 		m_model.push_back(d);
-		if (notify) parent.notify(Stack::StackChanged, nullptr);
+		if (notify) changed();
 	}
 
-	double Stack::StackImpl::pop(bool notify)
+	utility::Expected<double> Stack::StackImpl::pop(bool notify)
 	{
-		if (m_model.empty())
-		{
-			parent.notify(Stack::StackError,
-				std::make_shared<StackEventData>(ErrorType::EMPTY));
+		auto status = checkNotEmpty();
+		if (!status) return status;
 
-			throw utility::Exception{ StackEventData::getMessage(ErrorType::EMPTY) };
+		auto val = m_model.back();
+		m_model.pop_back();
+		if (!m_arrays.empty() && m_arrays.back().position == m_model.size())
+			m_arrays.pop_back();
 
-		}
+		if (notify) changed();
+		return val;
+	}
+
+	void Stack::StackImpl::push(const Value& v, bool notify)
+	{
+		if (v.isScalar())
+			m_model.push_back(v.getScalar());
 		else
 		{
-			auto val = m_model.back();
-			m_model.pop_back();
-			if (notify) parent.notify(Stack::StackChanged, nullptr);
-			return val;
+			m_arrays.push_back({ m_model.size(), v });
+			m_model.push_back(std::numeric_limits<double>::quiet_NaN());
 		}
+
+		if (notify) changed();
+	}
+
+	utility::Expected<Value> Stack::StackImpl::popValue(bool notify)
+	{
+		auto status = checkNotEmpty();
+		if (!status) return status;
+
+		Value v{ makeValue(m_model.size() - 1) };
+		pop(notify);
+		return v;
+	}
+
+	utility::Expected<Value> Stack::StackImpl::topValue() const
+	{
+		auto status = checkNotEmpty();
+		if (!status) return status;
+
+		return makeValue(m_model.size() - 1);
+	}
+
+	bool Stack::StackImpl::hasArrays(size_t n) const
+	{
+		if (n > m_model.size()) n = m_model.size();
+
+		return !m_arrays.empty() && m_arrays.back().position >= m_model.size() - n;
+	}
+
+	utility::Status Stack::StackImpl::checkNotEmpty() const
+	{
+		return m_model.empty() ? failure(ErrorType::EMPTY) : utility::Status{};
+	}
+
+	utility::Status Stack::StackImpl::failure(ErrorType e) const
+	{
+		parent.notify(Stack::StackError, std::make_shared<StackEventData>(e));
+
+		return utility::Status::failure(StackEventData::getMessage(e));
+	}
+
+	Value Stack::StackImpl::makeValue(size_t position) const
+	{
+		// the arrays sit at the end of the table when they are near the top,
+		// which is where the commands look
+		for (auto i = m_arrays.rbegin(); i != m_arrays.rend() && i->position >= position; ++i)
+		{
+			if (i->position == position)
+				return i->value;
+		}
+
+		return Value{ m_model[position] };
 	}
 
 	double Stack::StackImpl::top() const
@@ -194,27 +468,125 @@ namespace model
 		return m_model.back();
 	}
 
-	void Stack::StackImpl::swap()
+	utility::Status Stack::StackImpl::swap()
 	{
 		if (m_model.size() < 2)
+			return failure(ErrorType::TOO_FEW_ARGUMENT);
+		else
 		{
-			parent.notify(Stack::StackError,
-				std::make_shared<StackEventData>(ErrorType::TOO_FEW_ARGUMENT));
+			size_t top{ m_model.size() - 1 };
+			double d{ m_model[top] };
+			m_model.set(top, m_model[top - 1]);
+			m_model.set(top - 1, d);
+
+			// move the vectors along with their slots
+			size_t k{ m_arrays.size() };
+			bool topIsArray{ k > 0 && m_arrays[k - 1].position == top };
+			bool nextIsArray{ k > (topIsArray ? 1u : 0u) && m_arrays[k - (topIsArray ? 2 : 1)].position == top - 1 };
+			if (topIsArray && nextIsArray)
+				std::swap(m_arrays[k - 1].value, m_arrays[k - 2].value);
+			else if (topIsArray)
+				m_arrays[k - 1].position = top - 1;
+			else if (nextIsArray)
+				m_arrays[k - 1].position = top;
+
+			changed();
+		}
+
+		return {};
+	}
+
+	utility::Status Stack::StackImpl::pop(size_t n, std::vector<double>& out, bool notify)
+	{
+		if (n > m_model.size())
+			return failure(ErrorType::TOO_FEW_ELEMENTS);
+
+		if (hasArrays(n))
+			return failure(ErrorType::NOT_SCALAR);
 
-			throw utility::Exception{ StackEventData::getMessage(ErrorType::TOO_FEW_ARGUMENT) };
+		m_model.popTo(n, out);
+
+		if (notify) changed();
+		return {};
+	}
+
+	void Stack::StackImpl::push(std::vector<double>&& v, bool notify)
+	{
+		m_model.append(std::move(v));
+
+		v.clear();
+		if (notify) changed();
+	}
+
+	void Stack::StackImpl::generate(size_t n, const std::function<void(double*)>& fill, bool notify)
+	{
+		fill(m_model.extend(n));
+
+		if (notify) changed();
+	}
+
+	utility::Status Stack::StackImpl::drop(size_t n, bool notify)
+	{
+		if (n > m_model.size())
+			return failure(ErrorType::TOO_FEW_ELEMENTS);
+
+		m_model.truncate(m_model.size() - n);
+		while (!m_arrays.empty() && m_arrays.back().position >= m_model.size())
+			m_arrays.pop_back();
+
+		if (notify) changed();
+		return {};
+	}
+
+	void Stack::StackImpl::inspect(const std::function<void(const double*, size_t)>& reader) const
+	{
+		m_model.forEachChunk(reader);
+	}
+
+	std::vector<Stack::ArrayElement> Stack::StackImpl::getArrayElements() const
+	{
+		std::vector<ArrayElement> v;
+		v.reserve(m_arrays.size());
+		for (const auto& slot : m_arrays)
+			v.emplace_back(slot.position, slot.value);
+		return v;
+	}
+
+	void Stack::StackImpl::assign(std::vector<double>&& storage, std::vector<ArrayElement>&& arrays, bool notify)
+	{
+		std::vector<ArraySlot> slots;
+		slots.reserve(arrays.size());
+		for (auto& a : arrays)
+			slots.push_back(ArraySlot{ a.first, std::move(a.second) });
+		std::sort(slots.begin(), slots.end(), [](const ArraySlot& l, const ArraySlot& r) { return l.position < r.position; });
+
+		m_model.clear();
+		m_model.append(std::move(storage));
+		m_arrays = std::move(slots);
+
+		if (notify) changed();
+	}
+
+	std::shared_ptr<const Stack::Checkpoint::State> Stack::StackImpl::checkpoint() const
+	{
+		return std::make_shared<const Checkpoint::State>(Checkpoint::State{ m_model, m_arrays });
+	}
+
+	void Stack::StackImpl::restore(const Checkpoint::State* state, bool notify)
+	{
+		// a default constructed checkpoint is the empty stack
+		if (state)
+		{
+			m_model = state->model;
+			m_arrays = state->arrays;
 		}
 		else
 		{
-			auto first = m_model.back();
-			m_model.pop_back();
-			auto second = m_model.back();
-			m_model.pop_back();
-			m_model.push_back(first);
-			m_model.push_back(second);
-
-			parent.notify(Stack::StackChanged, nullptr);
+			m_model.clear();
+			m_arrays.clear();
 		}
 
+		if (notify) changed();
 	}
 
 	size_t Stack::StackImpl::size() const
@@ -225,8 +597,9 @@ namespace model
 	void Stack::StackImpl::clear()
 	{
 		m_model.clear();
-		
-		parent.notify(Stack::StackChanged, nullptr);
+		m_arrays.clear();
+
+		changed();
 
 	}
 
@@ -241,8 +614,41 @@ namespace model
 	{
 		if (n > m_model.size()) n = m_model.size();
 
-		v.insert(v.end(), m_model.rbegin(), m_model.rbegin() + n);
+		m_model.copyTop(n, v);
+
+	}
+
+	std::vector<Value> Stack::StackImpl::getValues(size_t n) const
+	{
+		if (n > m_model.size()) n = m_model.size();
+
+		std::vector<Value> v;
+		v.reserve(n);
+		for (size_t i = 0; i < n; ++i)
+			v.push_back(makeValue(m_model.size() - 1 - i));
 
+		return v;
+	}
+
+	void Stack::StackImpl::holdChanges()
+	{
+		++m_holds;
+	}
+
+	void Stack::StackImpl::releaseChanges(bool notify)
+	{
+		if (m_holds == 0 || --m_holds > 0)
+			return;
+
+		bool changed{ m_changedWhileHeld };
+		m_changedWhileHeld = false;
+		if (changed && notify) parent.notify(Stack::StackChanged, nullptr);
+	}
+
+	void Stack::StackImpl::changed()
+	{
+		if (m_holds > 0) m_changedWhileHeld = true;
+		else parent.notify(Stack::StackChanged, nullptr);
 	}
 
 	const char * StackEventData::getMessage(ErrorType e)
@@ -251,6 +657,8 @@ namespace model
 		{
 		case ErrorType::EMPTY: return "Attempting to pop empty stack";
 		case ErrorType::TOO_FEW_ARGUMENT: return "Need at least two stack elements to swap top";
+		case ErrorType::TOO_FEW_ELEMENTS: return "Not enough stack elements for this operation";
+		case ErrorType::NOT_SCALAR: return "This operation needs scalar stack elements";
 		default: return "Unknown error";
 		};
 	}
@@ -22,19 +22,25 @@
 
 #ifndef STACK_H
 #define STACK_H
+#include<functional>
 #include<memory>
 #include<string>
+#include<utility>
 #include<vector>
 
 #include"Publisher.h"
 #include"EventData.h"
+#include"Status.h"
+#include"Value.h"
 
 namespace model
 {
 	enum class ErrorType
 	{
 		EMPTY,
-		TOO_FEW_ARGUMENT
+		TOO_FEW_ARGUMENT,
+		TOO_FEW_ELEMENTS,
+		NOT_SCALAR
 	};
 	class StackEventData : public utility::EventData
 	{
@@ -57,15 +63,100 @@ namespace model
 		using Publisher::unsubscribe;
 
 	public:
+		// the stack of the calling thread: the process wide one unless a Scope
+		// made another one current there
 		static Stack& getInstance();
+
+		// A stack apart from the process wide one, for an Engine that keeps its
+		// own. While a Scope of it is alive getInstance returns it on the thread
+		// that made the Scope; scopes nest
+		struct Deleter
+		{
+			void operator()(Stack* s) const;
+		};
+		using Owner = std::unique_ptr<Stack, Deleter>;
+		static Owner create();
+
+		class Scope
+		{
+		public:
+			explicit Scope(Stack& s);
+			~Scope();
+		private:
+			Stack* m_previous;
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+		};
+
+		// the operations that need elements the stack may not have report it
+		// in their Status, with the message of the ErrorType, and leave the
+		// stack as it was
 		void push(double, bool notify = true);
-		double pop(bool notify = true);
+		utility::Expected<double> pop(bool notify = true);
 		double top()const;
-		void swap();
+		utility::Status swap();
+
+		// bulk variants for stack wide operations: the top n elements are moved out
+		// (deepest first) or a whole range is pushed back in one step with a single
+		// change event instead of one per element
+		utility::Status pop(size_t n, std::vector<double>& out, bool notify = true);
+		void push(std::vector<double>&& v, bool notify = true);
+
+		// bulk producers: n scalars are added on top and fill writes them in
+		// place, getting the first of them, before the single change event.
+		// drop discards the top n elements of any kind without copying them
+		void generate(size_t n, const std::function<void(double*)>& fill, bool notify = true);
+		utility::Status drop(size_t n, bool notify = true);
+
+		// bulk consumers read the storage in place, bottom of the stack first,
+		// one contiguous piece per call of reader; an array element shows as
+		// its NaN placeholder
+		void inspect(const std::function<void(const double* first, size_t n)>& reader) const;
+
+		// the whole state for snapshots: the vector and matrix elements with their
+		// positions counted from the bottom, next to the storage inspect shows.
+		// assign replaces everything at once; each position must be below the
+		// storage size and hold a NaN placeholder there
+		using ArrayElement = std::pair<size_t, Value>;
+		std::vector<ArrayElement> getArrayElements() const;
+		void assign(std::vector<double>&& storage, std::vector<ArrayElement>&& arrays, bool notify = true);
+
+		// A copy of the whole stack to come back to with restore. The storage
+		// is kept in chunks shared with the checkpoint, a chunk is copied only
+		// once one side writes to it, so a checkpoint of any size costs a copy
+		// of the list of chunks and of the vector and matrix handles
+		class Checkpoint
+		{
+		public:
+			struct State;
+		private:
+			friend class Stack;
+			std::shared_ptr<const State> m_state;
+		};
+		Checkpoint checkpoint() const;
+		void restore(const Checkpoint&, bool notify = true);
+
+		// elements of any kind: a vector or matrix takes one slot like a scalar
+		// does. The double based accessors see NaN in such a slot and pop()
+		// discards the array; the bulk pop only accepts ranges holding scalars
+		void push(const Value&, bool notify = true);
+		utility::Expected<Value> popValue(bool notify = true);
+		utility::Expected<Value> topValue()const;
+
+		// true if one of the top n elements is a vector or a matrix
+		bool hasArrays(size_t n)const;
 
 		// returns first min(n, stackSize) elements of the stack with the top of stack at position 0
 		std::vector<double> getElements(size_t n) const;
 		void getElements(size_t n, std::vector<double>&) const;
+		std::vector<Value> getValues(size_t n) const;
+
+		// Between holdChanges and releaseChanges the change events are held back,
+		// release raises a single one if the stack changed meanwhile, or none
+		// without notify. Holds nest, the outermost release raises the event
+		void holdChanges();
+		void releaseChanges(bool notify = true);
 
 		// these are just needed for testing
 		size_t size() const;
@@ -0,0 +1,83 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef STATUS_H
+#define STATUS_H
+#include<utility>
+
+namespace utility
+{
+	/*
+		How an operation went that may fail in the normal course of things,
+		like a command entered on too few elements. A failure is nothing but a
+		message with static storage, so it costs no allocation and no
+		unwinding, and goes back up as a return value. Exceptions are left to
+		the faults no caller plans for, like a file that cannot be read or a
+		journal that does not replay.
+	*/
+	class Status
+	{
+	public:
+		Status() noexcept : m_message{ nullptr } {}
+
+		// message must outlive the status, a string literal does
+		static Status failure(const char* message) noexcept
+		{
+			Status s;
+			s.m_message = message;
+			return s;
+		}
+
+		bool ok()const noexcept { return m_message == nullptr; }
+		explicit operator bool()const noexcept { return ok(); }
+
+		// "" for success
+		const char* message()const noexcept { return m_message ? m_message : ""; }
+
+	private:
+		const char* m_message;
+	};
+
+	// a value, or the failure that left none; like std::expected, * does not
+	// check, the caller tests first or knows the operation cannot fail
+	template<typename T>
+	class Expected
+	{
+	public:
+		Expected(T value) : m_value(std::move(value)), m_status{} {}
+		Expected(Status failure) : m_value{}, m_status{ failure } {}
+
+		bool ok()const noexcept { return m_status.ok(); }
+		explicit operator bool()const noexcept { return ok(); }
+		const Status& status()const noexcept { return m_status; }
+
+		T& operator*() & noexcept { return m_value; }
+		const T& operator*()const & noexcept { return m_value; }
+		T&& operator*() && noexcept { return std::move(m_value); }
+		const T* operator->()const noexcept { return &m_value; }
+
+	private:
+		T m_value;
+		Status m_status;
+	};
+}
+#endif // !STATUS_H
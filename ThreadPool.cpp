@@ -0,0 +1,296 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "ThreadPool.h"
+#include<atomic>
+#include<condition_variable>
+#include<deque>
+#include<exception>
+#include<mutex>
+#include<new>
+#include<thread>
+
+namespace utility
+{
+	namespace
+	{
+		// one call of run(): the loop body and the elements still to process
+		struct Loop
+		{
+			void (*body)(void*, size_t, size_t);
+			void* context;
+			size_t grain;
+			std::atomic<size_t> remaining;
+			std::atomic<bool> failed;
+			std::exception_ptr failure;		// the first body that threw, written by the thread setting failed
+		};
+
+		struct Task
+		{
+			Loop* loop;
+			size_t first;
+			size_t last;
+		};
+
+		struct WorkQueue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+	}
+
+	class ThreadPool::ThreadPoolImpl
+	{
+	public:
+		explicit ThreadPoolImpl(size_t threads);
+		~ThreadPoolImpl();
+
+		size_t getThreadCount()const { return m_workers.size() + 1; }
+		void run(Loop& loop);
+
+	private:
+		void work(size_t index);
+		void execute(Task t);
+		// false if the task could not be queued for want of memory, the
+		// caller then runs it itself
+		bool push(const Task& t);
+		bool tryPop(Task& t);
+		static bool popFront(WorkQueue& q, Task& t);
+		static bool popBack(WorkQueue& q, Task& t);
+
+		std::vector<std::unique_ptr<WorkQueue>> m_queues;	// one per worker
+		WorkQueue m_injector;
+		std::vector<std::thread> m_workers;
+
+		std::atomic<size_t> m_queued;
+		std::atomic<size_t> m_sleeping;
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wake;
+		bool m_stop;
+
+		// set on the workers: the pool they belong to and their queue
+		static thread_local ThreadPoolImpl* t_pool;
+		static thread_local size_t t_index;
+	};
+
+	thread_local ThreadPool::ThreadPoolImpl* ThreadPool::ThreadPoolImpl::t_pool{ nullptr };
+	thread_local size_t ThreadPool::ThreadPoolImpl::t_index{ 0 };
+
+	ThreadPool::ThreadPoolImpl::ThreadPoolImpl(size_t threads)
+		: m_queued{ 0 }, m_sleeping{ 0 }, m_stop{ false }
+	{
+		for (size_t i = 1; i < threads; ++i)
+			m_queues.push_back(std::make_unique<WorkQueue>());
+
+		for (size_t i = 1; i < threads; ++i)
+			m_workers.emplace_back(&ThreadPoolImpl::work, this, i - 1);
+	}
+
+	ThreadPool::ThreadPoolImpl::~ThreadPoolImpl()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_sleepMutex };
+			m_stop = true;
+		}
+		m_wake.notify_all();
+
+		for (auto& w : m_workers)
+			w.join();
+	}
+
+	void ThreadPool::ThreadPoolImpl::run(Loop& loop)
+	{
+		execute({ &loop, 0, loop.remaining.load() });
+
+		// help with whatever is queued until the last piece of this loop is done
+		while (loop.remaining.load(std::memory_order_acquire) != 0)
+		{
+			Task t;
+			if (tryPop(t))
+				execute(t);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	void ThreadPool::ThreadPoolImpl::work(size_t index)
+	{
+		t_pool = this;
+		t_index = index;
+
+		for (;;)
+		{
+			Task t;
+			if (tryPop(t))
+			{
+				execute(t);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock{ m_sleepMutex };
+			++m_sleeping;
+			m_wake.wait(lock, [this] { return m_stop || m_queued.load() > 0; });
+			--m_sleeping;
+			if (m_stop && m_queued.load() == 0)
+				return;
+		}
+	}
+
+	void ThreadPool::ThreadPoolImpl::execute(Task t)
+	{
+		// keep the first half, offer the second one to the thieves
+		while (t.last - t.first > t.loop->grain)
+		{
+			size_t mid{ t.first + (t.last - t.first) / 2 };
+			if (!push({ t.loop, mid, t.last }))
+				break;
+			t.last = mid;
+		}
+
+		// after a failure the rest of the loop is only counted off; the
+		// exception goes back to the caller, never out of a worker
+		if (!t.loop->failed.load(std::memory_order_relaxed))
+		{
+			try
+			{
+				t.loop->body(t.loop->context, t.first, t.last);
+			}
+			catch (...)
+			{
+				if (!t.loop->failed.exchange(true))
+					t.loop->failure = std::current_exception();
+			}
+		}
+
+		// the loop may be gone as soon as remaining reaches zero
+		t.loop->remaining.fetch_sub(t.last - t.first, std::memory_order_acq_rel);
+	}
+
+	bool ThreadPool::ThreadPoolImpl::push(const Task& t)
+	{
+		// counted before it is visible, so m_queued never drops below the
+		// number of queued tasks. A worker going to sleep counts itself before
+		// it checks m_queued, so one of the two sides always sees the other
+		++m_queued;
+
+		WorkQueue& q{ t_pool == this ? *m_queues[t_index] : m_injector };
+		try
+		{
+			std::lock_guard<std::mutex> lock{ q.mutex };
+			q.tasks.push_back(t);
+		}
+		catch (std::bad_alloc&)
+		{
+			--m_queued;
+			return false;
+		}
+
+		if (m_sleeping.load() > 0)
+		{
+			std::lock_guard<std::mutex> lock{ m_sleepMutex };
+			m_wake.notify_one();
+		}
+		return true;
+	}
+
+	bool ThreadPool::ThreadPoolImpl::tryPop(Task& t)
+	{
+		if (m_queued.load() == 0)
+			return false;
+
+		bool found{ t_pool == this && popBack(*m_queues[t_index], t) };
+		if (!found)
+			found = popFront(m_injector, t);
+
+		// steal, starting next to this thread so the thieves spread out
+		size_t start{ t_pool == this ? t_index + 1 : 0 };
+		for (size_t i = 0; !found && i < m_queues.size(); ++i)
+			found = popFront(*m_queues[(start + i) % m_queues.size()], t);
+
+		if (found)
+			--m_queued;
+		return found;
+	}
+
+	bool ThreadPool::ThreadPoolImpl::popFront(WorkQueue& q, Task& t)
+	{
+		std::lock_guard<std::mutex> lock{ q.mutex };
+		if (q.tasks.empty())
+			return false;
+
+		t = q.tasks.front();
+		q.tasks.pop_front();
+		return true;
+	}
+
+	bool ThreadPool::ThreadPoolImpl::popBack(WorkQueue& q, Task& t)
+	{
+		std::lock_guard<std::mutex> lock{ q.mutex };
+		if (q.tasks.empty())
+			return false;
+
+		t = q.tasks.back();
+		q.tasks.pop_back();
+		return true;
+	}
+
+	ThreadPool& ThreadPool::getInstance()
+	{
+		static ThreadPool instance;
+		return instance;
+	}
+
+	ThreadPool::ThreadPool()
+	{
+		impl = std::make_unique<ThreadPoolImpl>(std::max(std::thread::hardware_concurrency(), 1u));
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+	}
+
+	void ThreadPool::setThreadCount(size_t n)
+	{
+		n = std::max(n, size_t{ 1 });
+		if (n == impl->getThreadCount())
+			return;
+
+		impl.reset();
+		impl = std::make_unique<ThreadPoolImpl>(n);
+	}
+
+	size_t ThreadPool::getThreadCount() const
+	{
+		return impl->getThreadCount();
+	}
+
+	void ThreadPool::run(size_t n, size_t grain, RangeBody body, void* context)
+	{
+		Loop loop{ body, context, grain, {}, {}, nullptr };
+		loop.remaining.store(n);
+		loop.failed.store(false);
+		impl->run(loop);
+
+		// every piece is counted off, no thread still reaches the loop
+		if (loop.failure)
+			std::rethrow_exception(loop.failure);
+	}
+}
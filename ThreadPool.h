@@ -0,0 +1,118 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include<algorithm>
+#include<cstddef>
+#include<memory>
+#include<type_traits>
+#include<vector>
+
+namespace utility
+{
+	/*
+		Work stealing thread pool for the numeric kernels. Every worker owns a
+		deque: it pushes the halves it splits off a range at the back and takes
+		its next piece from there, idle workers steal from the front of the
+		others, where the biggest pieces are. Work started from outside the pool
+		goes through a shared injector queue. A thread waiting for its loop to
+		finish runs queued pieces instead of blocking, so loops may nest.
+	*/
+	class ThreadPool
+	{
+	public:
+		static ThreadPool& getInstance();
+
+		// the threads taking part in a loop, the calling one included; 1 runs
+		// everything on the calling thread. Not to be called from inside a loop
+		void setThreadCount(size_t n);
+		size_t getThreadCount()const;
+
+		// calls body(first, last) on disjoint ranges covering [0, n). Ranges are
+		// halved down to grain elements, so up to grain elements (or a pool of
+		// one thread) run serially on the calling thread. If a body throws, the
+		// ranges not started yet are skipped and the first exception is
+		// rethrown on the calling thread once no range runs any more
+		template<typename Body>
+		void parallelFor(size_t n, size_t grain, Body&& body);
+
+		// map(first, last) reduces a range to a T, combine(T, T) folds two.
+		// The ranges depend on n and grain only and are combined in order, so
+		// the result is the same for any number of threads
+		template<typename T, typename Map, typename Combine>
+		T parallelReduce(size_t n, size_t grain, T identity, Map&& map, Combine&& combine);
+
+	private:
+		using RangeBody = void(*)(void* context, size_t first, size_t last);
+		void run(size_t n, size_t grain, RangeBody body, void* context);
+
+		ThreadPool();
+		~ThreadPool();
+		class ThreadPoolImpl;
+		std::unique_ptr<ThreadPoolImpl> impl;
+
+	private:
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) = delete;
+	};
+
+	template<typename Body>
+	void ThreadPool::parallelFor(size_t n, size_t grain, Body&& body)
+	{
+		grain = std::max(grain, size_t{ 1 });
+		if (n <= grain || getThreadCount() == 1)
+		{
+			if (n > 0) body(size_t{ 0 }, n);
+			return;
+		}
+
+		using B = std::remove_reference_t<Body>;
+		run(n, grain, [](void* context, size_t first, size_t last) { (*static_cast<B*>(context))(first, last); },
+			const_cast<void*>(static_cast<const void*>(&body)));
+	}
+
+	template<typename T, typename Map, typename Combine>
+	T ThreadPool::parallelReduce(size_t n, size_t grain, T identity, Map&& map, Combine&& combine)
+	{
+		grain = std::max(grain, size_t{ 1 });
+		size_t chunks{ (n + grain - 1) / grain };
+		if (chunks <= 1)
+			return n > 0 ? combine(identity, map(size_t{ 0 }, n)) : identity;
+
+		std::vector<T> partial(chunks, identity);
+		parallelFor(chunks, 1, [&](size_t first, size_t last)
+		{
+			for (size_t c = first; c < last; ++c)
+				partial[c] = map(c * grain, std::min(n, (c + 1) * grain));
+		});
+
+		T r{ identity };
+		for (const auto& p : partial)
+			r = combine(r, p);
+		return r;
+	}
+}
+#endif // !THREAD_POOL_H
+
@@ -22,6 +22,9 @@
 #include "Tokenizer.h"
 #include<iterator>
 #include<algorithm>
+#include<cerrno>
+#include<cstdlib>
+#include<regex>
 #include<sstream>
 
 using std::string;
@@ -46,9 +49,43 @@ namespace utility
 
 	void Tokenizer::tokenize(std::istream& is)
 	{
+		// the tokens keep their case: command names are matched without it,
+		// arguments like paths need it
 		tokens_.assign(std::istream_iterator<string>{is}, std::istream_iterator<string>{});
+	}
+
+	namespace
+	{
+		bool hasNumberForm(const string& token)
+		{
+			if (token == "+" || token == "-") return false;
+
+			static const std::regex dpRegex("((\\+|-)?[[:digit:]]*)(\\.(([[:digit:]]+)?))?((e|E)((\\+|-)?)[[:digit:]]+)?");
+			return std::regex_match(token, dpRegex);
+		}
+	}
+
+	bool parseNumber(const string& token, double& d)
+	{
+		bool isNumber{ hasNumberForm(token) };
+
+		if (isNumber)
+		{
+			d = std::stod(token);
+		}
+
+		return isNumber;
+	}
+
+	bool parseNumber(const string& token, double& d, bool& inRange)
+	{
+		if (!hasNumberForm(token)) return false;
 
-		for (auto& i : tokens_)
-			std::transform(i.begin(), i.end(), i.begin(), ::tolower);
+		// the form also lets through words stod refuses, like "." or "e5"
+		char* end;
+		errno = 0;
+		d = std::strtod(token.c_str(), &end);
+		inRange = end != token.c_str() && errno != ERANGE;
+		return true;
 	}
 }
@@ -58,6 +58,14 @@ namespace utility
 		Tokens tokens_;
 
 	};
+
+	// true if the token is a number as the calculator reads one, which is then
+	// converted into d; "+" and "-" are the operators
+	bool parseNumber(const std::string& token, double& d);
+
+	// the same without throwing: a token of the form of a number a double
+	// cannot hold, like 1e999, is still a number, with inRange false
+	bool parseNumber(const std::string& token, double& d, bool& inRange);
 }
 #endif // !TOKENIZER_H
 
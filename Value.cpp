@@ -0,0 +1,75 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "Value.h"
+#include<new>
+#include"Expression.h"
+
+namespace model
+{
+	namespace
+	{
+		double* allocate(size_t n)
+		{
+			return static_cast<double*>(::operator new(n ? n * sizeof(double) : Array::Alignment, std::align_val_t{ Array::Alignment }));
+		}
+	}
+
+	Array::Array(size_t n)
+		: m_data{ allocate(n) }
+		, m_size{ n }
+		, m_expression{}
+	{
+	}
+
+	Array::Array(size_t n, std::shared_ptr<const Expression> e)
+		: m_data{ nullptr }
+		, m_size{ n }
+		, m_expression{ std::move(e) }
+	{
+	}
+
+	Array::~Array()
+	{
+		if (m_data)
+			::operator delete(m_data, std::align_val_t{ Alignment });
+	}
+
+	void Array::peek(const size_t* at, size_t n, double* out) const
+	{
+		if (m_expression)
+			m_expression->evaluateAt(at, n, out);
+		else
+			for (size_t i = 0; i < n; ++i)
+				out[i] = m_data[at[i]];
+	}
+
+	void Array::materialize() const
+	{
+		// the operands are let go of once they are not needed any more, unless
+		// something else, like the undo history, still holds them
+		double* data{ allocate(m_size) };
+		m_expression->evaluate(0, m_size, data);
+		m_data = data;
+		m_expression.reset();
+		ExpressionGraph::getInstance().materialized(m_size);
+	}
+}
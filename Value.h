@@ -0,0 +1,119 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef VALUE_H
+#define VALUE_H
+#include<cstddef>
+#include<memory>
+
+namespace model
+{
+	class Expression;
+
+	// Dense array of doubles in 64 byte aligned storage, so the vector kernels
+	// never split a cache line. Arrays are immutable once they are on the
+	// stack: the stack and the undo history share them.
+	class Array
+	{
+	public:
+		static const size_t Alignment = 64;
+
+		explicit Array(size_t n);
+		// a deferred array, made in lazy mode: nothing is allocated or computed
+		// before the elements are first read, then the expression is evaluated
+		// in one go and let go of
+		Array(size_t n, std::shared_ptr<const Expression> e);
+		~Array();
+
+		size_t size()const { return m_size; }
+		double* data() { if (m_expression) materialize(); return m_data; }
+		const double* data()const { if (m_expression) materialize(); return m_data; }
+
+		double operator[](size_t i)const { return data()[i]; }
+
+		bool isDeferred()const { return m_expression != nullptr; }
+		const std::shared_ptr<const Expression>& getExpression()const { return m_expression; }
+
+		// the elements at the n positions into out; a deferred array computes
+		// just these and stays deferred, for a display showing a few elements
+		void peek(const size_t* at, size_t n, double* out)const;
+
+	private:
+		void materialize()const;
+
+		mutable double* m_data;
+		size_t m_size;
+		mutable std::shared_ptr<const Expression> m_expression;
+
+	private:
+		Array(const Array&) = delete;
+		Array(Array&&) = delete;
+		Array& operator=(const Array&) = delete;
+		Array& operator=(Array&&) = delete;
+	};
+
+	// One stack element: a scalar, a vector or a row major matrix. The stack
+	// itself only keeps a double per slot and remembers separately which slots
+	// hold an array, so scalars cost nothing extra; Value is how elements
+	// travel in and out.
+	class Value
+	{
+	public:
+		enum class Kind : unsigned char { Scalar, Vector, Matrix };
+
+		Value(double d = 0.0) : m_kind{ Kind::Scalar }, m_scalar{ d }, m_cols{ 1 } {}
+		explicit Value(std::shared_ptr<const Array> a) : m_kind{ Kind::Vector }, m_scalar{}, m_array{ std::move(a) }, m_cols{ 1 } {}
+		// the array holds the rows one after the other, its size must be a multiple of cols
+		Value(std::shared_ptr<const Array> a, size_t cols) : m_kind{ Kind::Matrix }, m_scalar{}, m_array{ std::move(a) }, m_cols{ cols } {}
+
+		Kind getKind()const { return m_kind; }
+		bool isScalar()const { return m_kind == Kind::Scalar; }
+		bool isVector()const { return m_kind == Kind::Vector; }
+		bool isMatrix()const { return m_kind == Kind::Matrix; }
+
+		double getScalar()const { return m_scalar; }
+		const std::shared_ptr<const Array>& getArray()const { return m_array; }
+
+		// a vector counts as one column
+		size_t getRows()const { return m_array->size() / m_cols; }
+		size_t getCols()const { return m_cols; }
+
+		// same kind and shape as this (non scalar) value, holding another array
+		Value withArray(std::shared_ptr<const Array> a)const
+		{
+			return m_kind == Kind::Matrix ? Value{ std::move(a), m_cols } : Value{ std::move(a) };
+		}
+
+		bool hasShapeOf(const Value& v)const
+		{
+			return m_kind == v.m_kind && m_array->size() == v.m_array->size() && m_cols == v.m_cols;
+		}
+
+	private:
+		Kind m_kind;
+		double m_scalar;
+		std::shared_ptr<const Array> m_array;
+		size_t m_cols;
+	};
+}
+#endif // !VALUE_H
+
@@ -0,0 +1,221 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "VectorMath.h"
+#include "KernelVariants.h"
+#include "Exception.h"
+#include "ThreadPool.h"
+#include<cmath>
+
+#ifdef NIMPO_X86
+#include<emmintrin.h>
+#endif
+
+namespace utility
+{
+	namespace
+	{
+		// one lane; the reference implementation of the fast algorithms and
+		// the variant used when no vector unit is available
+		struct ScalarV
+		{
+			using Mask = bool;
+			static constexpr size_t Width = 1;
+
+			ScalarV() = default;
+			ScalarV(double d) : v{ d } {}
+
+			static ScalarV load(const double* p) { return ScalarV{ *p }; }
+			static void store(double* p, ScalarV x) { *p = x.v; }
+
+			double v;
+		};
+
+		inline ScalarV operator+(ScalarV a, ScalarV b) { return a.v + b.v; }
+		inline ScalarV operator-(ScalarV a, ScalarV b) { return a.v - b.v; }
+		inline ScalarV operator*(ScalarV a, ScalarV b) { return a.v * b.v; }
+		inline ScalarV operator/(ScalarV a, ScalarV b) { return a.v / b.v; }
+		inline bool operator<(ScalarV a, ScalarV b) { return a.v < b.v; }
+		inline bool operator>(ScalarV a, ScalarV b) { return a.v > b.v; }
+		inline bool operator==(ScalarV a, ScalarV b) { return a.v == b.v; }
+
+		inline ScalarV abs(ScalarV a) { return std::fabs(a.v); }
+		inline ScalarV sqrt(ScalarV a) { return std::sqrt(a.v); }
+		inline ScalarV roundNearest(ScalarV a) { return std::nearbyint(a.v); }
+		inline ScalarV select(bool m, ScalarV a, ScalarV b) { return m ? a : b; }
+		inline bool maskOr(bool a, bool b) { return a || b; }
+		inline bool anyOf(bool m) { return m; }
+
+#ifdef NIMPO_X86
+		struct Sse2V
+		{
+			using Mask = __m128d;
+			static constexpr size_t Width = 2;
+
+			Sse2V() = default;
+			Sse2V(__m128d x) : v{ x } {}
+			Sse2V(double d) : v{ _mm_set1_pd(d) } {}
+
+			static Sse2V load(const double* p) { return _mm_loadu_pd(p); }
+			static void store(double* p, Sse2V x) { _mm_storeu_pd(p, x.v); }
+
+			__m128d v;
+		};
+
+		inline Sse2V operator+(Sse2V a, Sse2V b) { return _mm_add_pd(a.v, b.v); }
+		inline Sse2V operator-(Sse2V a, Sse2V b) { return _mm_sub_pd(a.v, b.v); }
+		inline Sse2V operator*(Sse2V a, Sse2V b) { return _mm_mul_pd(a.v, b.v); }
+		inline Sse2V operator/(Sse2V a, Sse2V b) { return _mm_div_pd(a.v, b.v); }
+		inline __m128d operator<(Sse2V a, Sse2V b) { return _mm_cmplt_pd(a.v, b.v); }
+		inline __m128d operator>(Sse2V a, Sse2V b) { return _mm_cmpgt_pd(a.v, b.v); }
+		inline __m128d operator==(Sse2V a, Sse2V b) { return _mm_cmpeq_pd(a.v, b.v); }
+
+		inline Sse2V abs(Sse2V a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a.v); }
+		inline Sse2V sqrt(Sse2V a) { return _mm_sqrt_pd(a.v); }
+
+		// sse2 has no rounding instruction: adding and removing 1.5 * 2^52
+		// rounds to nearest for every |a| < 2^51
+		inline Sse2V roundNearest(Sse2V a)
+		{
+			const __m128d magic = _mm_set1_pd(6755399441055744.0);
+			return _mm_sub_pd(_mm_add_pd(a.v, magic), magic);
+		}
+
+		inline Sse2V select(__m128d m, Sse2V a, Sse2V b) { return _mm_or_pd(_mm_and_pd(m, a.v), _mm_andnot_pd(m, b.v)); }
+		inline __m128d maskOr(__m128d a, __m128d b) { return _mm_or_pd(a, b); }
+		inline bool anyOf(__m128d m) { return _mm_movemask_pd(m) != 0; }
+#endif
+
+		double exactSin(double x) { return std::sin(x); }
+		double exactCos(double x) { return std::cos(x); }
+		double exactTan(double x) { return std::tan(x); }
+		double exactASin(double x) { return std::asin(x); }
+		double exactACos(double x) { return std::acos(x); }
+		double exactATan(double x) { return std::atan(x); }
+
+		ExactFunction exactFunction(MathFunction f)
+		{
+			switch (f)
+			{
+			case MathFunction::Sin: return exactSin;
+			case MathFunction::Cos: return exactCos;
+			case MathFunction::Tan: return exactTan;
+			case MathFunction::ASin: return exactASin;
+			case MathFunction::ACos: return exactACos;
+			default: return exactATan;
+			}
+		}
+	}
+}
+
+#include "VectorMathImpl.h"
+
+namespace utility
+{
+	void scalarFastMath(MathFunction f, const double* in, double* out, size_t n, ExactFunction exact)
+	{
+		vectormath::evaluate<ScalarV>(f, in, out, n, exact);
+	}
+
+#ifdef NIMPO_X86
+	void sse2FastMath(MathFunction f, const double* in, double* out, size_t n, ExactFunction exact)
+	{
+		vectormath::evaluate<Sse2V>(f, in, out, n, exact);
+	}
+#endif
+
+	VectorMath& VectorMath::getInstance()
+	{
+		static VectorMath instance;
+		return instance;
+	}
+
+	void VectorMath::evaluate(MathFunction f, const double* in, double* out, size_t n) const
+	{
+		// an element costs tens of cycles, so shorter ranges than for the
+		// arithmetic kernels pay for a thread
+		const size_t grain{ 1 << 13 };
+		ThreadPool::getInstance().parallelFor(n, grain, [=](size_t i, size_t j)
+		{
+			if (m_mode == MathMode::Exact)
+				evaluateExact(f, in + i, out + i, j - i);
+			else
+				evaluateFast(f, in + i, out + i, j - i);
+		});
+	}
+
+	double VectorMath::evaluate(MathFunction f, double x) const noexcept
+	{
+		if (m_mode == MathMode::Exact)
+			return exactFunction(f)(x);
+
+		double r;
+		evaluateFast(f, &x, &r, 1);
+		return r;
+	}
+
+	void VectorMath::evaluateExact(MathFunction f, const double* in, double* out, size_t n) const noexcept
+	{
+		auto exact = exactFunction(f);
+		for (size_t i = 0; i < n; ++i)
+			out[i] = exact(in[i]);
+	}
+
+	void VectorMath::evaluateFast(MathFunction f, const double* in, double* out, size_t n) const noexcept
+	{
+		auto exact = exactFunction(f);
+		switch (KernelRegistry::getInstance().getActiveTier())
+		{
+#ifdef NIMPO_X86
+		case KernelTier::AVX512: avx512FastMath(f, in, out, n, exact); break;
+		case KernelTier::AVX2: avx2FastMath(f, in, out, n, exact); break;
+		case KernelTier::SSE2: sse2FastMath(f, in, out, n, exact); break;
+#endif
+		default: scalarFastMath(f, in, out, n, exact); break;
+		}
+	}
+
+	const char* VectorMath::getName(MathMode m)
+	{
+		return m == MathMode::Fast ? "fast" : "exact";
+	}
+
+	const char* VectorMath::getName(MathFunction f)
+	{
+		switch (f)
+		{
+		case MathFunction::Sin: return "sin";
+		case MathFunction::Cos: return "cos";
+		case MathFunction::Tan: return "tan";
+		case MathFunction::ASin: return "arcsin";
+		case MathFunction::ACos: return "arccos";
+		default: return "arctan";
+		}
+	}
+
+	MathMode VectorMath::parseMode(const std::string& s)
+	{
+		if (s == "fast") return MathMode::Fast;
+		if (s == "exact") return MathMode::Exact;
+
+		throw Exception{ "Unknown math mode '" + s + "', expected fast or exact" };
+	}
+}
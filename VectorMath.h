@@ -0,0 +1,80 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef VECTOR_MATH_H
+#define VECTOR_MATH_H
+#include<cstddef>
+#include<string>
+
+namespace utility
+{
+	/*
+		Transcendental functions over ranges of doubles, in two modes:
+		- Exact calls the C runtime (libm) for every element, so results are
+		  identical to std::sin and friends.
+		- Fast evaluates polynomial approximations with the widest vector unit
+		  the KernelRegistry has bound. The error stays within a few ulp of
+		  libm; 'nimpo --bench vectormath' measures it.
+		Every command evaluating these functions goes through this class, so the
+		mode applies to single values and to whole arrays alike.
+	*/
+
+	enum class MathFunction { Sin, Cos, Tan, ASin, ACos, ATan };
+	enum class MathMode { Exact, Fast };
+
+	class VectorMath
+	{
+	public:
+		static VectorMath& getInstance();
+
+		void setMode(MathMode m) { m_mode = m; }
+		MathMode getMode()const { return m_mode; }
+
+		// out may be the same range as in; long ranges are split over the
+		// ThreadPool, which passes on what a piece of the loop throws
+		void evaluate(MathFunction f, const double* in, double* out, size_t n)const;
+		double evaluate(MathFunction f, double x)const noexcept;
+
+		// the two modes, independent of the selected one; used by the benchmark
+		void evaluateExact(MathFunction f, const double* in, double* out, size_t n)const noexcept;
+		void evaluateFast(MathFunction f, const double* in, double* out, size_t n)const noexcept;
+
+		static const char* getName(MathMode m);
+		static const char* getName(MathFunction f);
+		// parses "exact" or "fast"; throws on anything else
+		static MathMode parseMode(const std::string& s);
+
+	private:
+		VectorMath() : m_mode{ MathMode::Exact } {}
+		~VectorMath() = default;
+
+		MathMode m_mode;
+
+	private:
+		VectorMath(const VectorMath&) = delete;
+		VectorMath(VectorMath&&) = delete;
+		VectorMath& operator=(const VectorMath&) = delete;
+		VectorMath& operator=(VectorMath&&) = delete;
+	};
+}
+#endif // !VECTOR_MATH_H
+
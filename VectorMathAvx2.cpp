@@ -0,0 +1,90 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+// AVX2 instantiation of the fast transcendental functions. Everything after
+// the target pragma is compiled for AVX2, so all other headers come first.
+
+#include "KernelVariants.h"
+#include<cstddef>
+
+#ifdef NIMPO_X86
+#include<immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+namespace utility
+{
+	namespace
+	{
+		struct Avx2V
+		{
+			using Mask = __m256d;
+			static constexpr size_t Width = 4;
+
+			Avx2V() = default;
+			Avx2V(__m256d x) : v{ x } {}
+			Avx2V(double d) : v{ _mm256_set1_pd(d) } {}
+
+			static Avx2V load(const double* p) { return _mm256_loadu_pd(p); }
+			static void store(double* p, Avx2V x) { _mm256_storeu_pd(p, x.v); }
+
+			__m256d v;
+		};
+
+		inline Avx2V operator+(Avx2V a, Avx2V b) { return _mm256_add_pd(a.v, b.v); }
+		inline Avx2V operator-(Avx2V a, Avx2V b) { return _mm256_sub_pd(a.v, b.v); }
+		inline Avx2V operator*(Avx2V a, Avx2V b) { return _mm256_mul_pd(a.v, b.v); }
+		inline Avx2V operator/(Avx2V a, Avx2V b) { return _mm256_div_pd(a.v, b.v); }
+		inline __m256d operator<(Avx2V a, Avx2V b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+		inline __m256d operator>(Avx2V a, Avx2V b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ); }
+		inline __m256d operator==(Avx2V a, Avx2V b) { return _mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ); }
+
+		inline Avx2V abs(Avx2V a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v); }
+		inline Avx2V sqrt(Avx2V a) { return _mm256_sqrt_pd(a.v); }
+		inline Avx2V roundNearest(Avx2V a) { return _mm256_round_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		inline Avx2V select(__m256d m, Avx2V a, Avx2V b) { return _mm256_blendv_pd(b.v, a.v, m); }
+		inline __m256d maskOr(__m256d a, __m256d b) { return _mm256_or_pd(a, b); }
+		inline bool anyOf(__m256d m) { return _mm256_movemask_pd(m) != 0; }
+	}
+}
+
+#include "VectorMathImpl.h"
+
+namespace utility
+{
+	void avx2FastMath(MathFunction f, const double* in, double* out, size_t n, ExactFunction exact)
+	{
+		vectormath::evaluate<Avx2V>(f, in, out, n, exact);
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif // NIMPO_X86
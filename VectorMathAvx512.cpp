@@ -0,0 +1,91 @@
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+// AVX-512F instantiation of the fast transcendental functions. Everything
+// after the target pragma is compiled for AVX-512, so all other headers come
+// first.
+
+#include "KernelVariants.h"
+#include<cstddef>
+
+#ifdef NIMPO_X86
+#include<immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+namespace utility
+{
+	namespace
+	{
+		struct Avx512V
+		{
+			using Mask = __mmask8;
+			static constexpr size_t Width = 8;
+
+			Avx512V() = default;
+			Avx512V(__m512d x) : v{ x } {}
+			Avx512V(double d) : v{ _mm512_set1_pd(d) } {}
+
+			static Avx512V load(const double* p) { return _mm512_loadu_pd(p); }
+			static void store(double* p, Avx512V x) { _mm512_storeu_pd(p, x.v); }
+
+			__m512d v;
+		};
+
+		inline Avx512V operator+(Avx512V a, Avx512V b) { return _mm512_add_pd(a.v, b.v); }
+		inline Avx512V operator-(Avx512V a, Avx512V b) { return _mm512_sub_pd(a.v, b.v); }
+		inline Avx512V operator*(Avx512V a, Avx512V b) { return _mm512_mul_pd(a.v, b.v); }
+		inline Avx512V operator/(Avx512V a, Avx512V b) { return _mm512_div_pd(a.v, b.v); }
+		inline __mmask8 operator<(Avx512V a, Avx512V b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ); }
+		inline __mmask8 operator>(Avx512V a, Avx512V b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ); }
+		inline __mmask8 operator==(Avx512V a, Avx512V b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_EQ_OQ); }
+
+		inline Avx512V abs(Avx512V a) { return _mm512_abs_pd(a.v); }
+		inline Avx512V sqrt(Avx512V a) { return _mm512_sqrt_pd(a.v); }
+		inline Avx512V roundNearest(Avx512V a) { return _mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEAREST_INT); }
+		inline Avx512V select(__mmask8 m, Avx512V a, Avx512V b) { return _mm512_mask_blend_pd(m, b.v, a.v); }
+		inline __mmask8 maskOr(__mmask8 a, __mmask8 b) { return static_cast<__mmask8>(a | b); }
+		inline bool anyOf(__mmask8 m) { return m != 0; }
+	}
+}
+
+#include "VectorMathImpl.h"
+
+namespace utility
+{
+	void avx512FastMath(MathFunction f, const double* in, double* out, size_t n, ExactFunction exact)
+	{
+		vectormath::evaluate<Avx512V>(f, in, out, n, exact);
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif // NIMPO_X86
@@ -0,0 +1,236 @@
+#pragma once
+/*
+	Copyright (C) 2022  Barth.Feudong
+	Author can be contacted here: <https://github.com/mrSchaffman/Cpp-Nimpo-Calculator>
+
+	This file is part of the Nimpo Command Line Calculator project.
+
+	Nimpo is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Nimpo is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef VECTOR_MATH_IMPL_H
+#define VECTOR_MATH_IMPL_H
+
+/*
+	The fast transcendental algorithms, written once against a small vector
+	type V and instantiated per instruction set tier. Each tier defines its V
+	in an anonymous namespace and includes this header, so every instantiation
+	is private to its translation unit and carries that unit's target options.
+	For the same reason this header must only hold templates on V.
+
+	V provides: a Width constant, load/store, + - * /, comparisons returning
+	V::Mask, and the free functions abs, sqrt, roundNearest, select, maskOr
+	and anyOf.
+
+	sin/cos/tan: Cody-Waite reduction by pi/2 in three parts, then the fdlibm
+	kernel polynomials on [-pi/4, pi/4]. The reduction is exact for |x| below
+	ReductionLimit, larger arguments are handed back to libm by the caller.
+	atan: the Cephes rational approximation after reduction to [0, 0.66].
+	asin/acos: rewritten in terms of atan so there is a single approximation
+	to keep accurate.
+*/
+
+#include"VectorMath.h"
+
+namespace utility
+{
+	namespace vectormath
+	{
+		constexpr double ReductionLimit = 1.0e5;
+
+		constexpr double TwoOverPi = 6.36619772367581382433e-01;
+		constexpr double Pio2_1 = 1.57079632673412561417e+00;
+		constexpr double Pio2_2 = 6.07710050630396597660e-11;
+		constexpr double Pio2_3 = 2.02226624871116645580e-21;
+		constexpr double Pio2 = 1.57079632679489661923e+00;
+		constexpr double Pio4 = 7.85398163397448309616e-01;
+		constexpr double MoreBits = 6.123233995736765886130e-17;
+		constexpr double Tan3Pio8 = 2.41421356237309504880e+00;
+
+		template<class V>
+		V sinPolynomial(V r)
+		{
+			V z = r * r;
+			V v = z * r;
+			V p = V(2.75573137070700676789e-06) + z * (V(-2.50507602534068634195e-08) + z * V(1.58969099521155010221e-10));
+			p = V(8.33333333332248946124e-03) + z * (V(-1.98412698298579493134e-04) + z * p);
+			return r + v * (V(-1.66666666666666324348e-01) + z * p);
+		}
+
+		template<class V>
+		V cosPolynomial(V r)
+		{
+			V z = r * r;
+			V p = V(-2.75573143513906633035e-07) + z * (V(2.08757232129817482790e-09) + z * V(-1.13596475577881948265e-11));
+			p = V(4.16666666666666019037e-02) + z * (V(-1.38888888888741095749e-03) + z * (V(2.48015872894767294178e-05) + z * p));
+			V hz = V(0.5) * z;
+			V w = V(1.0) - hz;
+			return w + (((V(1.0) - w) - hz) + z * (z * p));
+		}
+
+		// r = x - k * pi/2 with |r| <= pi/4, q = k mod 4
+		template<class V>
+		V reduce(V x, V& q)
+		{
+			V k = roundNearest(x * V(TwoOverPi));
+			V r = ((x - k * V(Pio2_1)) - k * V(Pio2_2)) - k * V(Pio2_3);
+
+			// floor(k / 4) for an integral k, without a floor instruction
+			V k4 = roundNearest(k * V(0.25) - V(0.375));
+			q = k - V(4.0) * k4;
+			return r;
+		}
+
+		template<class V>
+		V sin(V x)
+		{
+			V q;
+			V r = reduce(x, q);
+			auto odd = maskOr(q == V(1.0), q == V(3.0));
+			V y = select(odd, cosPolynomial(r), sinPolynomial(r));
+			return select(q > V(1.5), V(0.0) - y, y);
+		}
+
+		template<class V>
+		V cos(V x)
+		{
+			V q;
+			V r = reduce(x, q);
+			auto odd = maskOr(q == V(1.0), q == V(3.0));
+			V y = select(odd, sinPolynomial(r), cosPolynomial(r));
+			auto negative = maskOr(q == V(1.0), q == V(2.0));
+			return select(negative, V(0.0) - y, y);
+		}
+
+		template<class V>
+		V tan(V x)
+		{
+			V q;
+			V r = reduce(x, q);
+			V s = sinPolynomial(r);
+			V c = cosPolynomial(r);
+			auto odd = maskOr(q == V(1.0), q == V(3.0));
+			return select(odd, (V(0.0) - c) / s, s / c);
+		}
+
+		template<class V>
+		V atan(V x)
+		{
+			V a = abs(x);
+			auto big = a > V(Tan3Pio8);
+			auto mid = a > V(0.66);
+
+			V xr = select(big, V(-1.0) / a, select(mid, (a - V(1.0)) / (a + V(1.0)), a));
+			V y = select(big, V(Pio2), select(mid, V(Pio4), V(0.0)));
+			V correction = select(big, V(MoreBits), select(mid, V(0.5 * MoreBits), V(0.0)));
+
+			V z = xr * xr;
+			V p = (((V(-8.750608600031904122785e-01) * z + V(-1.615753718733365076637e+01)) * z
+				+ V(-7.500855792314704667340e+01)) * z + V(-1.228866684490136173410e+02)) * z + V(-6.485021904942025371773e+01);
+			V d = ((((z + V(2.485846490142306297962e+01)) * z + V(1.650270098316988542046e+02)) * z
+				+ V(4.328810604912902668951e+02)) * z + V(4.853903996359136964868e+02)) * z + V(1.945506571482613964425e+02);
+
+			V result = y + ((xr * (z * p / d) + xr) + correction);
+			return select(x < V(0.0), V(0.0) - result, result);
+		}
+
+		template<class V>
+		V asin(V x)
+		{
+			return atan(x / sqrt((V(1.0) - x) * (V(1.0) + x)));
+		}
+
+		template<class V>
+		V acos(V x)
+		{
+			return V(2.0) * atan(sqrt((V(1.0) - x) / (V(1.0) + x)));
+		}
+
+		template<class V, MathFunction F>
+		V apply(V x)
+		{
+			if constexpr (F == MathFunction::Sin) return sin(x);
+			else if constexpr (F == MathFunction::Cos) return cos(x);
+			else if constexpr (F == MathFunction::Tan) return tan(x);
+			else if constexpr (F == MathFunction::ASin) return asin(x);
+			else if constexpr (F == MathFunction::ACos) return acos(x);
+			else return atan(x);
+		}
+
+		// evaluates one full vector; lanes outside the reduction range of the
+		// trigonometric functions are recomputed with libm
+		template<class V, MathFunction F>
+		void evaluateVector(const double* in, double* out, double (*exact)(double))
+		{
+			V x = V::load(in);
+			V y = apply<V, F>(x);
+
+			if constexpr (F == MathFunction::Sin || F == MathFunction::Cos || F == MathFunction::Tan)
+			{
+				if (anyOf(abs(x) > V(ReductionLimit)))
+				{
+					alignas(64) double xs[V::Width];
+					alignas(64) double ys[V::Width];
+					V::store(xs, x);
+					V::store(ys, y);
+					for (size_t j = 0; j < V::Width; ++j)
+						if (xs[j] > ReductionLimit || xs[j] < -ReductionLimit)
+							ys[j] = exact(xs[j]);
+
+					y = V::load(ys);
+				}
+			}
+
+			V::store(out, y);
+		}
+
+		template<class V, MathFunction F>
+		void evaluate(const double* in, double* out, size_t n, double (*exact)(double))
+		{
+			size_t i{ 0 };
+			for (; i + V::Width <= n; i += V::Width)
+				evaluateVector<V, F>(in + i, out + i, exact);
+
+			if (i < n)
+			{
+				// pad the tail to a full vector instead of keeping a scalar copy
+				// of every algorithm
+				alignas(64) double buffer[V::Width]{};
+				alignas(64) double result[V::Width];
+				for (size_t j = 0; j < n - i; ++j)
+					buffer[j] = in[i + j];
+				evaluateVector<V, F>(buffer, result, exact);
+				for (size_t j = 0; j < n - i; ++j)
+					out[i + j] = result[j];
+			}
+		}
+
+		template<class V>
+		void evaluate(MathFunction f, const double* in, double* out, size_t n, double (*exact)(double))
+		{
+			switch (f)
+			{
+			case MathFunction::Sin: evaluate<V, MathFunction::Sin>(in, out, n, exact); break;
+			case MathFunction::Cos: evaluate<V, MathFunction::Cos>(in, out, n, exact); break;
+			case MathFunction::Tan: evaluate<V, MathFunction::Tan>(in, out, n, exact); break;
+			case MathFunction::ASin: evaluate<V, MathFunction::ASin>(in, out, n, exact); break;
+			case MathFunction::ACos: evaluate<V, MathFunction::ACos>(in, out, n, exact); break;
+			case MathFunction::ATan: evaluate<V, MathFunction::ATan>(in, out, n, exact); break;
+			}
+		}
+	}
+}
+#endif // !VECTOR_MATH_IMPL_H
+
@@ -18,6 +18,8 @@
 	along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 */
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include"Cli.h"
 #include"Stack.h"
@@ -25,6 +27,15 @@
 #include"Observers.h"
 #include"CommandRepository.h"
 #include"Exception.h"
+#include"Kernels.h"
+#include"VectorMath.h"
+#include"Benchmark.h"
+#include"ColumnFormula.h"
+#include"DataFile.h"
+#include"LoadGenerator.h"
+#include"Server.h"
+#include<charconv>
+#include<csignal>
 
 using namespace view;
 using namespace model;
@@ -33,11 +44,11 @@ using namespace utility;
 
 using namespace std;
 
-void registerCommand(UserInterface& ui, const string& label, CommandPtr c)
+void RegisterCoreCommands(UserInterface& ui)
 {
 	try
 	{
-		CommandRepository::getInstance().registerCommand(label, std::move(c));
+		registerCoreCommands(CommandRepository::getInstance());
 	}
 	catch (Exception& e)
 	{
@@ -47,36 +58,222 @@ void registerCommand(UserInterface& ui, const string& label, CommandPtr c)
 	return;
 }
 
-void RegisterCoreCommands(UserInterface& ui)
+struct Options
 {
-	registerCommand(ui, "+", MakeCommandPtr<AddCommand>());
-	registerCommand(ui, "-", MakeCommandPtr<SubstractCommand>());
-	registerCommand(ui, "*", MakeCommandPtr<MultiplyCommand>());
-	registerCommand(ui, "/", MakeCommandPtr<DivideCommand>());
-
-	registerCommand(ui, "cos", MakeCommandPtr<CosineCommand>());
-	registerCommand(ui, "arccos", MakeCommandPtr<ACosineCommand>());
-	registerCommand(ui, "arcsin", MakeCommandPtr<ASineCommand>());
-	registerCommand(ui, "arctan", MakeCommandPtr<ATangentCommand>());
-	registerCommand(ui, "sin", MakeCommandPtr<SineCommand>());
-	registerCommand(ui, "tan", MakeCommandPtr<TangentCommand>());
-
-	registerCommand(ui, "swap", MakeCommandPtr<SwapCommand>());
-	registerCommand(ui, "clear", MakeCommandPtr<ClearCommand>());
-	registerCommand(ui, "drop", MakeCommandPtr<DropCommand>());
+	bool benchmark{ false };
+	string benchmarkFilter;
+	string restorePath;
+	string journalPath;
+	long journalInterval{ 10 };
+	string columns;
+	vector<string> inputs;
+	string outputPath;
+	string servePath;
+	size_t serveCores{ 0 };
+	LoadOptions load;
+};
 
-	return;
+// a count an option takes, between 1 and max
+size_t ParseCount(const string& option, const char* text, size_t max)
+{
+	char* end;
+	unsigned long long n{ std::strtoull(text, &end, 10) };
+	if (*text == '\0' || *end != '\0' || n < 1 || n > max)
+		throw Exception(option + " needs a count between 1 and " + to_string(max));
+	return static_cast<size_t>(n);
+}
+
+// --isa <scalar|sse2|avx2|avx512>	binds a lower kernel tier than the detected one
+// --math <exact|fast>				selects how the transcendental functions are evaluated
+// --bench [name]					runs the benchmark suite instead of the calculator
+// --restore <path>					starts from the sessions kept in a snapshot file
+// --journal <path>					replays the journal at path and records every command in it
+// --journal-interval <ms>			time between two group commits of the journal, 10 ms by default
+// --columns <formula>				evaluates the formula over whole columns instead of running the calculator
+// --input <name=path | path.csv>	a column of the formula, or all the columns of a csv file with a header
+// --output <path>					where the result column goes, standard output by default
+// --serve <path>					serves the sessions of the clients connecting to the Unix socket at path
+// --cores <n>						the event loops of --serve, one per processor by default
+// --load <path>					loads the server at path with requests and reports its rate and latency
+// --connections <n>				the connections of --load, 16 by default
+// --requests <n>					the requests of --load over all the connections, 200000 by default
+// --pipeline <n>					the requests a connection of --load keeps in flight, 8 by default
+// --request <input>				what --load sends, "clear 2 3 + 4 *" by default
+Options ParseCommandLine(UserInterface& ui, int argc, char* argv[])
+{
+	Options options;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg{ argv[i] };
+		try
+		{
+			if (arg == "--isa" && i + 1 < argc)
+				KernelRegistry::getInstance().bind(KernelRegistry::parseTier(argv[++i]));
+			else if (arg == "--math" && i + 1 < argc)
+				VectorMath::getInstance().setMode(VectorMath::parseMode(argv[++i]));
+			else if (arg == "--bench")
+			{
+				options.benchmark = true;
+				if (i + 1 < argc && string{ argv[i + 1] }.compare(0, 2, "--") != 0)
+					options.benchmarkFilter = argv[++i];
+			}
+			else if (arg == "--restore" && i + 1 < argc)
+				options.restorePath = argv[++i];
+			else if (arg == "--journal" && i + 1 < argc)
+				options.journalPath = argv[++i];
+			else if (arg == "--journal-interval" && i + 1 < argc)
+			{
+				long ms{ std::strtol(argv[++i], nullptr, 10) };
+				if (ms < 1 || ms > 60000)
+					throw Exception("--journal-interval needs a time between 1 and 60000 ms");
+				options.journalInterval = ms;
+			}
+			else if (arg == "--columns" && i + 1 < argc)
+				options.columns = argv[++i];
+			else if (arg == "--input" && i + 1 < argc)
+				options.inputs.push_back(argv[++i]);
+			else if (arg == "--output" && i + 1 < argc)
+				options.outputPath = argv[++i];
+			else if (arg == "--serve" && i + 1 < argc)
+				options.servePath = argv[++i];
+			else if (arg == "--cores" && i + 1 < argc)
+				options.serveCores = ParseCount(arg, argv[++i], 4096);
+			else if (arg == "--load" && i + 1 < argc)
+				options.load.path = argv[++i];
+			else if (arg == "--connections" && i + 1 < argc)
+				options.load.connections = ParseCount(arg, argv[++i], 10000);
+			else if (arg == "--requests" && i + 1 < argc)
+				options.load.requests = ParseCount(arg, argv[++i], 100000000);
+			else if (arg == "--pipeline" && i + 1 < argc)
+				options.load.pipeline = ParseCount(arg, argv[++i], 100000);
+			else if (arg == "--request" && i + 1 < argc)
+				options.load.request = argv[++i];
+			else
+				ui.displayMessage("Unknown option " + arg);
+		}
+		catch (Exception& e)
+		{
+			ui.displayMessage(e.what());
+		}
+	}
+
+	return options;
+}
+
+// the formula of --columns over the columns of the inputs, one result per row
+int RunColumns(UserInterface& ui, const Options& options)
+{
+	try
+	{
+		ColumnFormula formula{ options.columns };
+		ColumnFormula::Columns columns;
+		for (const auto& input : options.inputs)
+			ColumnFormula::readColumns(input, columns);
+
+		auto result = formula.evaluate(columns);
+		if (!options.outputPath.empty())
+		{
+			writeNumbers(options.outputPath, result->data(), result->size(), formatOfPath(options.outputPath));
+			return 0;
+		}
+
+		const double* values{ result->data() };
+		char text[32];
+		for (size_t i = 0; i < result->size(); ++i)
+		{
+			*to_chars(text, text + sizeof text, values[i]).ptr = '\0';
+			cout << text << '\n';
+		}
+		cout.flush();
+		return 0;
+	}
+	catch (Exception& e)
+	{
+		ui.displayMessage(e.what());
+		return 1;
+	}
+}
+
+// the server SIGINT and SIGTERM stop, so it removes its socket
+Server* runningServer{ nullptr };
+
+extern "C" void StopServer(int)
+{
+	if (runningServer)
+		runningServer->stop();
+}
+
+int RunServer(UserInterface& ui, const Options& options)
+{
+	try
+	{
+		Server server{ options.servePath, options.serveCores };
+		runningServer = &server;
+		signal(SIGINT, StopServer);
+		signal(SIGTERM, StopServer);
+
+		ui.displayMessage("serving on " + options.servePath + " with " + to_string(server.getStatistics().size()) + " cores");
+		server.run();
+
+		signal(SIGINT, SIG_DFL);
+		signal(SIGTERM, SIG_DFL);
+		runningServer = nullptr;
+		return 0;
+	}
+	catch (Exception& e)
+	{
+		runningServer = nullptr;
+		ui.displayMessage(e.what());
+		return 1;
+	}
+}
+
+int RunLoad(UserInterface& ui, const Options& options)
+{
+	try
+	{
+		runLoad(options.load, cout);
+		return 0;
+	}
+	catch (Exception& e)
+	{
+		ui.displayMessage(e.what());
+		return 1;
+	}
 }
 
-int main()
+int main(int argc, char* argv[])
 {
 	Cli cli{ cin,cout };
+	auto options = ParseCommandLine(cli, argc, argv);
+	if (options.benchmark)
+	{
+		runBenchmarks(options.benchmarkFilter, cout);
+		return 0;
+	}
+
+	if (!options.columns.empty())
+		return RunColumns(cli, options);
+
+	if (!options.servePath.empty())
+		return RunServer(cli, options);
+
+	if (!options.load.path.empty())
+		return RunLoad(cli, options);
+
 	RegisterCoreCommands(cli);
 
 	CommandDispatcher ce{ cli };
 
 	cli.subscribe(view::UserInterface::UICommandName, make_unique<CommandIssuedObserver>(ce));
 
+	// a long journal is replayed without showing the stack after each record
+	if (!options.restorePath.empty())
+		ce.restoreSnapshot(options.restorePath);
+
+	if (!options.journalPath.empty())
+		ce.openJournal(options.journalPath, chrono::milliseconds{ options.journalInterval });
+
 	Stack::getInstance().subscribe(Stack::StackChanged, make_unique<StackUpdatedObserver>(cli));
 
 	cli.run();